@@ -79,7 +79,7 @@ void Sound::RegisterObject(Context* context)
     context->RegisterFactory<Sound>();
 }
 
-bool Sound::Load(Deserializer& source)
+bool Sound::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadSound);
     
@@ -378,7 +378,8 @@ void Sound::LoadParameters()
     if (!cache->Exists(xmlName))
         return;
     
-    XMLFile* file = cache->GetResource<XMLFile>(xmlName);
+    // May be in a worker thread, so do not store the XML file to the resource cache
+    SharedPtr<XMLFile> file = cache->GetTempResource<XMLFile>(xmlName);
     if (!file)
         return;
     
@@ -29,6 +29,16 @@ namespace Urho3D
 {
 
 static const int QUICKSORT_THRESHOLD = 16;
+static const unsigned RADIXSORT_THRESHOLD = 64;
+
+/// Key and value pair for radix sorting.
+template <class T> struct RadixSortItem
+{
+    /// Sort key.
+    unsigned long long key_;
+    /// Value.
+    T value_;
+};
 
 // Based on Comparison of several sorting algorithms by Juha Nieminen
 // http://warp.povusers.org/SortComparison/
@@ -141,4 +151,69 @@ template <class T, class U> void Sort(RandomAccessIterator<T> begin, RandomAcces
     InsertionSort(begin, end, compare);
 }
 
+/// Sort key and value pairs in ascending order of the keys. Uses a least significant digit first radix sort with 8-bit digits, which is stable, so pairs with equal keys keep their order. The temporary buffer must have room for as many pairs. Short arrays are insertion sorted instead.
+template <class T> void RadixSort(RadixSortItem<T>* begin, RadixSortItem<T>* end, RadixSortItem<T>* temp)
+{
+    unsigned count = end - begin;
+    if (count < RADIXSORT_THRESHOLD)
+    {
+        for (RadixSortItem<T>* i = begin + 1; i < end; ++i)
+        {
+            RadixSortItem<T> item = *i;
+            RadixSortItem<T>* j = i;
+            while (j > begin && item.key_ < (j - 1)->key_)
+            {
+                *j = *(j - 1);
+                --j;
+            }
+            *j = item;
+        }
+        return;
+    }
+    
+    // Count the digit values of all digits in one pass
+    unsigned histograms[8][256];
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        for (unsigned j = 0; j < 256; ++j)
+            histograms[i][j] = 0;
+    }
+    for (RadixSortItem<T>* i = begin; i < end; ++i)
+    {
+        unsigned long long key = i->key_;
+        for (unsigned j = 0; j < 8; ++j)
+            ++histograms[j][(key >> (j * 8)) & 0xff];
+    }
+    
+    RadixSortItem<T>* source = begin;
+    RadixSortItem<T>* dest = temp;
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        unsigned shift = i * 8;
+        unsigned* histogram = histograms[i];
+        // Skip the digit if it is the same in all keys, which is common for the high digits
+        if (histogram[(source->key_ >> shift) & 0xff] == count)
+            continue;
+        
+        // Convert the counts to destination offsets, then scatter
+        unsigned offset = 0;
+        for (unsigned j = 0; j < 256; ++j)
+        {
+            unsigned digitCount = histogram[j];
+            histogram[j] = offset;
+            offset += digitCount;
+        }
+        for (RadixSortItem<T>* j = source; j < source + count; ++j)
+            dest[histogram[(j->key_ >> shift) & 0xff]++] = *j;
+        
+        Swap(source, dest);
+    }
+    
+    if (source != begin)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            begin[i] = source[i];
+    }
+}
+
 }
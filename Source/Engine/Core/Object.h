@@ -66,7 +66,7 @@ public:
     void UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& exceptions, bool onlyUserData);
     /// Send event to all subscribers.
     void SendEvent(StringHash eventType);
-    /// Send event with parameters to all subscribers.
+    /// Send event with parameters to all subscribers. Ignored when called outside the main thread.
     void SendEvent(StringHash eventType, VariantMap& eventData);
     
     /// Return execution context.
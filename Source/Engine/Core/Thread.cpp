@@ -51,6 +51,8 @@ void* ThreadFunctionStatic(void* data)
 }
 #endif
 
+ThreadID Thread::mainThreadID;
+
 Thread::Thread() :
     handle_(0),
     shouldRun_(false)
@@ -113,4 +115,27 @@ void Thread::SetPriority(int priority)
     #endif
 }
 
+void Thread::SetMainThread()
+{
+    mainThreadID = GetCurrentThreadID();
+}
+
+ThreadID Thread::GetCurrentThreadID()
+{
+    #ifdef WIN32
+    return GetCurrentThreadId();
+    #else
+    return pthread_self();
+    #endif
+}
+
+bool Thread::IsMainThread()
+{
+    #ifdef WIN32
+    return GetCurrentThreadId() == mainThreadID;
+    #else
+    return pthread_equal(pthread_self(), mainThreadID) != 0;
+    #endif
+}
+
 }
@@ -27,6 +27,7 @@
 #include "CoreEvents.h"
 #include "DebugHud.h"
 #include "Engine.h"
+#include "FileReadQueue.h"
 #include "FileSystem.h"
 #include "Graphics.h"
 #include "Input.h"
@@ -100,6 +101,7 @@ Engine::Engine(Context* context) :
     context_->RegisterSubsystem(new Profiler(context_));
     #endif
     context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new FileReadQueue(context_));
     #ifdef ENABLE_LOGGING
     context_->RegisterSubsystem(new Log(context_));
     #endif
@@ -416,13 +418,15 @@ void Engine::DumpResources()
     for (HashMap<ShortStringHash, ResourceGroup>::ConstIterator i = resourceGroups.Begin();
         i != resourceGroups.End(); ++i)
     {
-        unsigned num = i->second_.resources_.Size();
-        unsigned memoryUse = i->second_.memoryUse_;
+        const ResourceGroup& group = i->second_;
+        unsigned num = group.resources_.Size();
+        unsigned memoryUse = group.memoryUse_;
         
         if (num)
         {
-            LOGRAW("Resource type " + i->second_.resources_.Begin()->second_->GetTypeName() +
-                ": count " + String(num) + " memory use " + String(memoryUse) + "\n");
+            LOGRAW("Resource type " + group.resources_.Begin()->second_->GetTypeName() +
+                ": count " + String(num) + " memory use " + String(memoryUse) + " hits " + String(group.hits_) + " misses " +
+                String(group.misses_) + " evicted " + String(group.evictions_) + " (" + String(group.evictedBytes_) + " bytes)\n");
         }
     }
     
@@ -118,6 +118,15 @@ bool AnimatedModel::LoadXML(const XMLElement& source, bool setInstanceDefault)
     return success;
 }
 
+bool AnimatedModel::LoadXML(XMLReader& source, bool setInstanceDefault)
+{
+    loading_ = true;
+    bool success = Component::LoadXML(source, setInstanceDefault);
+    loading_ = false;
+
+    return success;
+}
+
 void AnimatedModel::ApplyAttributes()
 {
     if (assignBonesPending_)
@@ -1160,6 +1169,9 @@ void AnimatedModel::UpdateBoneBoundingBox()
     
     boneBoundingBoxDirty_ = false;
     worldBoundingBoxDirty_ = true;
+    // May be called from a worker thread, so let the octree refresh its copy of the bounding box on the next update
+    if (!reinsertionQueued_ && octant_)
+        octant_->GetRoot()->QueueReinsertion(this);
 }
 
 void AnimatedModel::UpdateSkinning()
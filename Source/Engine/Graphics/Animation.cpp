@@ -73,7 +73,7 @@ void Animation::RegisterObject(Context* context)
     context->RegisterFactory<Animation>();
 }
 
-bool Animation::Load(Deserializer& source)
+bool Animation::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadAnimation);
     
@@ -128,7 +128,8 @@ bool Animation::Load(Deserializer& source)
     
     if (cache->Exists(xmlName))
     {
-        XMLFile* file = cache->GetResource<XMLFile>(xmlName);
+        // May be in a worker thread, so do not store the XML file to the resource cache
+        SharedPtr<XMLFile> file = cache->GetTempResource<XMLFile>(xmlName);
         if (file)
         {
             XMLElement rootElem = file->GetRoot();
@@ -43,28 +43,13 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(Batch* lhs, Batch* rhs)
+/// Return a radix sort key for a distance, which orders the same as comparing the distances, or in reverse.
+inline unsigned long long GetDistanceSortKey(float distance, bool reverse)
 {
-    if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
-}
-
-inline bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
-{
-    if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
-}
-
-inline bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
-{
-    if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    // Flip the sign bit of positive floats and all bits of negative floats to get an unsigned integer order
+    unsigned bits = *((unsigned*)&distance);
+    bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    return reverse ? ~bits : bits;
 }
 
 inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
@@ -742,7 +727,7 @@ void BatchQueue::SortBackToFront()
     for (unsigned i = 0; i < batches_.Size(); ++i)
         sortedBatches_[i] = &batches_[i];
     
-    Sort(sortedBatches_.Begin(), sortedBatches_.End(), CompareBatchesBackToFront);
+    SortBatches(sortedBatches_, BSM_BACKTOFRONT);
     
     // Do not actually sort batch groups, just list them
     sortedBaseBatchGroups_.Resize(baseBatchGroups_.Size());
@@ -827,10 +812,10 @@ void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
     // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
     // method is also time consuming, so just sort with state having priority
     #ifdef GL_ES_VERSION_2_0
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
+    SortBatches(batches, BSM_STATE);
     #else
     // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    Sort(batches.Begin(), batches.End(), CompareBatchesFrontToBack);
+    SortBatches(batches, BSM_FRONTTOBACK);
     
     unsigned freeShaderID = 0;
     unsigned short freeMaterialID = 0;
@@ -878,10 +863,39 @@ void BatchQueue::SortFrontToBack2Pass(PODVector<Batch*>& batches)
     geometryRemapping_.Clear();
     
     // Finally sort again with the rewritten ID's
-    Sort(batches.Begin(), batches.End(), CompareBatchesState);
+    SortBatches(batches, BSM_STATE);
     #endif
 }
 
+void BatchQueue::SortBatches(PODVector<Batch*>& batches, BatchSortMode mode)
+{
+    unsigned numBatches = batches.Size();
+    if (numBatches < 2)
+        return;
+    
+    sortItems_.Resize(numBatches);
+    sortTemp_.Resize(numBatches);
+    RadixSortItem<Batch*>* begin = &sortItems_[0];
+    RadixSortItem<Batch*>* end = begin + numBatches;
+    bool reverse = mode == BSM_BACKTOFRONT;
+    
+    // The radix sort is stable, so sort by the secondary key first and then by the primary key
+    for (unsigned i = 0; i < numBatches; ++i)
+    {
+        Batch* batch = batches[i];
+        begin[i].key_ = mode == BSM_STATE ? GetDistanceSortKey(batch->distance_, false) : batch->sortKey_;
+        begin[i].value_ = batch;
+    }
+    RadixSort(begin, end, &sortTemp_[0]);
+    
+    for (RadixSortItem<Batch*>* i = begin; i != end; ++i)
+        i->key_ = mode == BSM_STATE ? i->value_->sortKey_ : GetDistanceSortKey(i->value_->distance_, reverse);
+    RadixSort(begin, end, &sortTemp_[0]);
+    
+    for (unsigned i = 0; i < numBatches; ++i)
+        batches[i] = begin[i].value_;
+}
+
 void BatchQueue::SetTransforms(void* lockedData, unsigned& freeIndex)
 {
     for (HashMap<BatchGroupKey, BatchGroup>::Iterator i = baseBatchGroups_.Begin(); i != baseBatchGroups_.End(); ++i)
@@ -26,6 +26,7 @@
 #include "MathDefs.h"
 #include "Ptr.h"
 #include "Rect.h"
+#include "Sort.h"
 #include "Vector4.h"
 
 namespace Urho3D
@@ -45,6 +46,14 @@ class View;
 class Zone;
 struct LightBatchQueue;
 
+/// Batch sorting order.
+enum BatchSortMode
+{
+    BSM_STATE = 0,
+    BSM_FRONTTOBACK,
+    BSM_BACKTOFRONT
+};
+
 /// Queued 3D geometry draw call.
 struct Batch
 {
@@ -216,6 +225,8 @@ public:
     void SortFrontToBack();
     /// Sort batches front to back while also maintaining state sorting.
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
+    /// Sort batches by state and then distance, or by distance and then state. Uses radix sorts on the sort key and the distance.
+    void SortBatches(PODVector<Batch*>& batches, BatchSortMode mode);
     /// Pre-set instance transforms of all groups. The vertex buffer must be big enough to hold all transforms.
     void SetTransforms(void* lockedData, unsigned& freeIndex);
     /// Draw.
@@ -237,6 +248,10 @@ public:
     HashMap<unsigned short, unsigned short> materialRemapping_;
     /// Geometry remapping table for 2-pass state and distance sort.
     HashMap<unsigned short, unsigned short> geometryRemapping_;
+    /// Key and batch pairs for radix sorting.
+    PODVector<RadixSortItem<Batch*> > sortItems_;
+    /// Temporary buffer for radix sorting.
+    PODVector<RadixSortItem<Batch*> > sortTemp_;
     
     /// Unsorted non-instanced draw calls.
     PODVector<Batch> batches_;
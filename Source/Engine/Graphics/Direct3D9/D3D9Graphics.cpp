@@ -179,6 +179,7 @@ Graphics::Graphics(Context* context) :
     vsync_(false),
     tripleBuffer_(false),
     sRGB_(false),
+    headless_(false),
     deviceLost_(false),
     lightPrepassSupport_(false),
     deferredSupport_(false),
@@ -264,6 +265,12 @@ bool Graphics::SetMode(int width, int height, bool fullscreen, bool resizable, b
 {
     PROFILE(SetScreenMode);
     
+    if (headless_)
+    {
+        LOGERROR("Can not set screen mode in headless mode");
+        return false;
+    }
+    
     // Find out the full screen mode display format (match desktop color depth)
     SDL_DisplayMode mode;
     SDL_GetDesktopDisplayMode(0, &mode);
@@ -430,6 +437,49 @@ bool Graphics::SetMode(int width, int height)
     return SetMode(width, height, fullscreen_, resizable_, vsync_, tripleBuffer_, multiSample_);
 }
 
+bool Graphics::SetHeadlessMode(int width, int height)
+{
+    if (impl_->window_)
+    {
+        LOGERROR("Window already opened, can not set headless mode");
+        return false;
+    }
+    
+    if (width <= 0 || height <= 0)
+    {
+        width = 1024;
+        height = 768;
+    }
+    
+    headless_ = true;
+    width_ = width;
+    height_ = height;
+    fullscreen_ = false;
+    resizable_ = false;
+    
+    // There is no Direct3D device, so GPU objects keep only their CPU-side data. Report the capabilities of a Shader
+    // Model 3 card so that the renderer prepares instanced batches and shadow maps as on real hardware
+    hasSM3_ = true;
+    streamOffsetSupport_ = true;
+    hardwareShadowSupport_ = true;
+    shadowMapFormat_ = D3DFMT_D16;
+    hiresShadowMapFormat_ = D3DFMT_D24X8;
+    dummyColorFormat_ = D3DFMT_A8R8G8B8;
+    
+    LOGINFO("Set headless mode " + String(width_) + "x" + String(height_));
+    
+    using namespace ScreenMode;
+    
+    VariantMap eventData;
+    eventData[P_WIDTH] = width_;
+    eventData[P_HEIGHT] = height_;
+    eventData[P_FULLSCREEN] = fullscreen_;
+    eventData[P_RESIZABLE] = resizable_;
+    SendEvent(E_SCREENMODE, eventData);
+    
+    return true;
+}
+
 void Graphics::SetSRGB(bool enable)
 {
     sRGB_ = enable && sRGBWriteSupport_;
@@ -442,6 +492,9 @@ bool Graphics::ToggleFullscreen()
 
 void Graphics::Close()
 {
+    // Headless mode has no window or device to release
+    headless_ = false;
+    
     if (impl_->window_)
     {
         SDL_ShowCursor(SDL_TRUE);
@@ -536,7 +589,7 @@ bool Graphics::TakeScreenShot(Image& destImage)
 
 bool Graphics::BeginFrame()
 {
-    if (!IsInitialized())
+    if (!IsInitialized() || headless_)
         return false;
     
     // If using an external window, check it for size changes, and reset screen mode if necessary
@@ -593,7 +646,7 @@ bool Graphics::BeginFrame()
 
 void Graphics::EndFrame()
 {
-    if (!IsInitialized())
+    if (!IsInitialized() || headless_)
         return;
     
     PROFILE(Present);
@@ -1757,7 +1810,7 @@ void Graphics::SetForceSM2(bool enable)
 
 bool Graphics::IsInitialized() const
 {
-    return impl_->window_ != 0 && impl_->GetDevice() != 0;
+    return (impl_->window_ != 0 && impl_->GetDevice() != 0) || headless_;
 }
 
 PODVector<IntVector2> Graphics::GetResolutions() const
@@ -87,6 +87,8 @@ public:
     bool SetMode(int width, int height, bool fullscreen, bool resizable, bool vsync, bool tripleBuffer, int multiSample);
     /// Set screen resolution only. Return true if successful.
     bool SetMode(int width, int height);
+    /// Set headless mode with the given resolution, which runs the renderer's CPU-side work without a window or rendering device. Only effective before setting the initial screen mode. Return true if successful.
+    bool SetHeadlessMode(int width, int height);
     /// Set whether the main window uses sRGB conversion on write.
     void SetSRGB(bool enable);
     /// Toggle between full screen and windowed mode. Return true if successful.
@@ -206,6 +208,8 @@ public:
     
     /// Return whether rendering initialized.
     bool IsInitialized() const;
+    /// Return whether in headless mode.
+    bool IsHeadless() const { return headless_; }
     /// Return graphics implementation, which holds the actual API-specific resources.
     GraphicsImpl* GetImpl() const { return impl_; }
     /// Return OS-specific external window handle. Null if not in use.
@@ -228,8 +232,8 @@ public:
     bool GetTripleBuffer() const { return tripleBuffer_; }
     /// Return whether the main window is using sRGB conversion on write.
     bool GetSRGB() const { return sRGB_; }
-    /// Return whether Direct3D device is lost, and can not yet render. This happens during fullscreen resolution switching.
-    bool IsDeviceLost() const { return deviceLost_; }
+    /// Return whether Direct3D device is lost, and can not yet render. This happens during fullscreen resolution switching, and always in headless mode.
+    bool IsDeviceLost() const { return deviceLost_ || headless_; }
     /// Return number of primitives drawn this frame.
     unsigned GetNumPrimitives() const { return numPrimitives_; }
     /// Return number of batches drawn this frame.
@@ -423,6 +427,8 @@ private:
     bool tripleBuffer_;
     /// sRGB conversion on write flag for the main window.
     bool sRGB_;
+    /// Headless mode flag.
+    bool headless_;
     /// Direct3D device lost flag.
     bool deviceLost_;
     /// Light pre-pass rendering support flag.
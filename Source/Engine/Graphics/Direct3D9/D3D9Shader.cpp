@@ -41,7 +41,8 @@ namespace Urho3D
 
 Shader::Shader(Context* context) :
     Resource(context),
-    sourceModifiedTime_(0)
+    sourceModifiedTime_(0),
+    loadFromFile_(false)
 {
 }
 
@@ -57,16 +58,39 @@ void Shader::RegisterObject(Context* context)
     context->RegisterFactory<Shader>();
 }
 
-bool Shader::Load(Deserializer& source)
+bool Shader::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadShader);
     
+    Graphics* graphics = GetSubsystem<Graphics>();
+    if (!graphics)
+        return false;
+    
+    // Only parse the definition XML here, as checking the source timestamps accesses the resource cache
+    File* sourceFile = dynamic_cast<File*>(&source);
+    loadFromFile_ = sourceFile && !sourceFile->IsPackaged();
+    
+    loadXMLFile_ = new XMLFile(context_);
+    if (!loadXMLFile_->Load(source))
+    {
+        loadXMLFile_.Reset();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Shader::EndLoad()
+{
+    SharedPtr<XMLFile> xml = loadXMLFile_;
+    loadXMLFile_.Reset();
+    if (!xml)
+        return false;
+    
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     cache->ResetDependencies(this);
     
     Graphics* graphics = GetSubsystem<Graphics>();
-    if (!graphics)
-        return false;
     
     if (graphics->GetSM3Support())
     {
@@ -86,8 +110,7 @@ bool Shader::Load(Deserializer& source)
     fullFileName_.Clear();
     sourceModifiedTime_ = 0;
     
-    File* sourceFile = dynamic_cast<File*>(&source);
-    if (sourceFile && !sourceFile->IsPackaged())
+    if (loadFromFile_)
     {
         PROFILE(CheckTimestamps);
         
@@ -139,14 +162,10 @@ bool Shader::Load(Deserializer& source)
         }
     }
     
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
-        return false;
-    
     XMLElement shaders = xml->GetRoot("shaders");
     if (!shaders)
     {
-        LOGERROR("No shaders element in " + source.GetName());
+        LOGERROR("No shaders element in " + GetName());
         return false;
     }
     
@@ -68,6 +68,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     shadowMask_(DEFAULT_SHADOWMASK),
     zoneMask_(DEFAULT_ZONEMASK),
     viewFrameNumber_(0),
+    occlusionFrameNumber_(0),
     distance_(0.0f),
     lodDistance_(0.0f),
     drawDistance_(0.0f),
@@ -82,6 +83,7 @@ Drawable::Drawable(Context* context, unsigned char drawableFlags) :
     firstLight_(0),
     viewFrame_(0),
     viewCamera_(0),
+    occlusionCamera_(0),
     zoneDirty_(false)
 {
 }
@@ -394,7 +396,12 @@ void Drawable::AddToOctree()
 void Drawable::RemoveFromOctree()
 {
     if (octant_)
+    {
+        Octree* octree = octant_->GetRoot();
+        if (octree)
+            octree->MarkChanged(octant_);
         octant_->RemoveDrawable(this);
+    }
 }
 
 }
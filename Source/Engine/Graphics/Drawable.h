@@ -199,6 +199,8 @@ public:
     void SetMinMaxZ(float minZ, float maxZ);
     /// Mark in view (either the main camera, or a shadow camera view) this frame.
     void MarkInView(const FrameInfo& frame, bool mainView = true);
+    /// Mark as having passed the occlusion test of the main camera this frame. Used by temporal coherence.
+    void MarkOcclusionVisible(const FrameInfo& frame) { occlusionFrameNumber_ = frame.frameNumber_; occlusionCamera_ = frame.camera_; }
     /// Clear lights and base pass flags for a new frame.
     void ClearLights();
     /// Add a per-pixel light.
@@ -229,6 +231,8 @@ public:
     bool IsInView(unsigned frameNumber) const { return viewFrameNumber_ == frameNumber; }
     /// Return whether is visible in a specific view this frame.
     bool IsInView(const FrameInfo& frame, bool mainView = true) const { return viewFrameNumber_ == frame.frameNumber_ && viewFrame_ == &frame && (!mainView || viewCamera_ == frame.camera_); }
+    /// Return whether passed the occlusion test of the same camera on the previous frame.
+    bool WasOcclusionVisible(const FrameInfo& frame) const { return occlusionFrameNumber_ + 1 == frame.frameNumber_ && occlusionCamera_ == frame.camera_; }
     /// Return whether has a base pass.
     bool HasBasePass(unsigned batchIndex) const { return (basePassFlags_ & (1 << batchIndex)) != 0; }
     /// Return per-pixel lights.
@@ -284,6 +288,8 @@ protected:
     unsigned zoneMask_;
     /// Last visible frame number.
     unsigned viewFrameNumber_;
+    /// Last frame number on which passed the occlusion test.
+    unsigned occlusionFrameNumber_;
     /// Current distance to camera.
     float distance_;
     /// LOD scaled distance.
@@ -320,6 +326,8 @@ protected:
     const FrameInfo* viewFrame_;
     /// Last view's camera. Not safe to dereference.
     Camera* viewCamera_;
+    /// Camera of the last passed occlusion test. Not safe to dereference.
+    Camera* occlusionCamera_;
     /// Zone assignment dirty flag.
     bool zoneDirty_;
 };
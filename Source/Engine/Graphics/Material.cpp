@@ -82,6 +82,29 @@ TextureUnit ParseTextureUnitName(const String& name)
     return unit;
 }
 
+/// Return the texture unit of a material XML texture element, or MAX_MATERIAL_TEXTURE_UNITS if illegal.
+static TextureUnit GetTextureUnit(const XMLElement& textureElem)
+{
+    TextureUnit unit = TU_DIFFUSE;
+    if (textureElem.HasAttribute("unit"))
+    {
+        String unitName = textureElem.GetAttributeLower("unit");
+        if (unitName.Length() > 1)
+        {
+            unit = ParseTextureUnitName(unitName);
+            if (unit >= MAX_MATERIAL_TEXTURE_UNITS)
+            {
+                LOGERROR("Unknown or illegal texture unit " + unitName);
+                unit = MAX_MATERIAL_TEXTURE_UNITS;
+            }
+        }
+        else
+            unit = (TextureUnit)Clamp(ToInt(unitName), 0, MAX_MATERIAL_TEXTURE_UNITS - 1);
+    }
+    
+    return unit;
+}
+
 static TechniqueEntry noEntry;
 
 bool CompareTechniqueEntries(const TechniqueEntry& lhs, const TechniqueEntry& rhs)
@@ -128,7 +151,7 @@ void Material::RegisterObject(Context* context)
     context->RegisterFactory<Material>();
 }
 
-bool Material::Load(Deserializer& source)
+bool Material::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadMaterial);
     
@@ -137,12 +160,45 @@ bool Material::Load(Deserializer& source)
     if (!graphics)
         return true;
     
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
+    // Only parse the data here. Techniques and textures are acquired from the resource cache in EndLoad()
+    unsigned start = source.GetPosition();
+    if (source.ReadFileID() == "UMAT")
+    {
+        source.Seek(start);
+        loadCookedData_.SetData(source, source.GetSize() - start);
+        return true;
+    }
+    
+    source.Seek(start);
+    loadXMLFile_ = new XMLFile(context_);
+    if (!loadXMLFile_->Load(source))
+    {
+        loadXMLFile_.Reset();
         return false;
+    }
+    
+    return true;
+}
+
+bool Material::EndLoad()
+{
+    // In headless mode, do not actually load the material, just return success
+    Graphics* graphics = GetSubsystem<Graphics>();
+    if (!graphics)
+        return true;
+    
+    bool success = false;
+    if (loadXMLFile_)
+    {
+        XMLElement rootElem = loadXMLFile_->GetRoot();
+        success = Load(rootElem);
+    }
+    else if (loadCookedData_.GetSize())
+        success = LoadCooked(loadCookedData_);
     
-    XMLElement rootElem = xml->GetRoot();
-    return Load(rootElem);
+    loadXMLFile_.Reset();
+    loadCookedData_.Clear();
+    return success;
 }
 
 bool Material::Save(Serializer& dest) const
@@ -189,19 +245,7 @@ bool Material::Load(const XMLElement& source)
     XMLElement textureElem = source.GetChild("texture");
     while (textureElem)
     {
-        TextureUnit unit = TU_DIFFUSE;
-        if (textureElem.HasAttribute("unit"))
-        {
-            String unitName = textureElem.GetAttributeLower("unit");
-            if (unitName.Length() > 1)
-            {
-                unit = ParseTextureUnitName(unitName);
-                if (unit >= MAX_MATERIAL_TEXTURE_UNITS)
-                    LOGERROR("Unknown or illegal texture unit " + unitName);
-            }
-            else
-                unit = (TextureUnit)Clamp(ToInt(unitName), 0, MAX_MATERIAL_TEXTURE_UNITS - 1);
-        }
+        TextureUnit unit = GetTextureUnit(textureElem);
         if (unit != MAX_MATERIAL_TEXTURE_UNITS)
         {
             String name = textureElem.GetAttribute("name");
@@ -236,14 +280,7 @@ bool Material::Load(const XMLElement& source)
     if (depthBiasElem)
         SetDepthBias(BiasParameters(depthBiasElem.GetFloat("constant"), depthBiasElem.GetFloat("slopescaled")));
     
-    // Calculate memory use
-    unsigned memoryUse = sizeof(Material);
-    
-    memoryUse += techniques_.Size() * sizeof(TechniqueEntry);
-    memoryUse += MAX_MATERIAL_TEXTURE_UNITS * sizeof(SharedPtr<Texture>);
-    memoryUse += shaderParameters_.Size() * sizeof(MaterialShaderParameter);
-    
-    SetMemoryUse(memoryUse);
+    UpdateMemoryUse();
     CheckOcclusion();
     return true;
 }
@@ -304,6 +341,78 @@ bool Material::Save(XMLElement& dest) const
     return true;
 }
 
+bool Material::Cook(const XMLElement& source, Serializer& dest)
+{
+    if (source.IsNull())
+    {
+        LOGERROR("Can not cook material from null XML element");
+        return false;
+    }
+    
+    dest.WriteFileID("UMAT");
+    dest.WriteUInt(COOKED_RESOURCE_VERSION);
+    
+    unsigned numTechniques = 0;
+    for (XMLElement techniqueElem = source.GetChild("technique"); techniqueElem; techniqueElem = techniqueElem.GetNext("technique"))
+        ++numTechniques;
+    dest.WriteVLE(numTechniques);
+    for (XMLElement techniqueElem = source.GetChild("technique"); techniqueElem; techniqueElem = techniqueElem.GetNext("technique"))
+    {
+        dest.WriteString(techniqueElem.GetAttribute("name"));
+        dest.WriteInt(techniqueElem.GetInt("quality"));
+        dest.WriteFloat(techniqueElem.GetFloat("loddistance"));
+    }
+    
+    // Textures with an illegal unit are left out, like when loading the XML
+    PODVector<unsigned char> units;
+    Vector<String> textureNames;
+    for (XMLElement textureElem = source.GetChild("texture"); textureElem; textureElem = textureElem.GetNext("texture"))
+    {
+        TextureUnit unit = GetTextureUnit(textureElem);
+        if (unit != MAX_MATERIAL_TEXTURE_UNITS)
+        {
+            units.Push((unsigned char)unit);
+            textureNames.Push(textureElem.GetAttribute("name"));
+        }
+    }
+    dest.WriteVLE(units.Size());
+    for (unsigned i = 0; i < units.Size(); ++i)
+    {
+        dest.WriteUByte(units[i]);
+        dest.WriteString(textureNames[i]);
+    }
+    
+    unsigned numParameters = 0;
+    for (XMLElement parameterElem = source.GetChild("parameter"); parameterElem; parameterElem = parameterElem.GetNext("parameter"))
+        ++numParameters;
+    dest.WriteVLE(numParameters);
+    for (XMLElement parameterElem = source.GetChild("parameter"); parameterElem; parameterElem = parameterElem.GetNext("parameter"))
+    {
+        dest.WriteString(parameterElem.GetAttribute("name"));
+        dest.WriteVariant(parameterElem.GetVectorVariant("value"));
+    }
+    
+    XMLElement cullElem = source.GetChild("cull");
+    dest.WriteBool(cullElem.NotNull());
+    if (cullElem)
+        dest.WriteUByte(GetStringListIndex(cullElem.GetAttribute("value").CString(), cullModeNames, CULL_CCW));
+    
+    XMLElement shadowCullElem = source.GetChild("shadowcull");
+    dest.WriteBool(shadowCullElem.NotNull());
+    if (shadowCullElem)
+        dest.WriteUByte(GetStringListIndex(shadowCullElem.GetAttribute("value").CString(), cullModeNames, CULL_CCW));
+    
+    XMLElement depthBiasElem = source.GetChild("depthbias");
+    dest.WriteBool(depthBiasElem.NotNull());
+    if (depthBiasElem)
+    {
+        dest.WriteFloat(depthBiasElem.GetFloat("constant"));
+        dest.WriteFloat(depthBiasElem.GetFloat("slopescaled"));
+    }
+    
+    return true;
+}
+
 void Material::SetNumTechniques(unsigned num)
 {
     if (!num)
@@ -477,6 +586,81 @@ String Material::GetTextureUnitName(TextureUnit unit)
     return textureUnitNames[unit];
 }
 
+bool Material::LoadCooked(Deserializer& source)
+{
+    ResetToDefaults();
+    
+    if (source.ReadFileID() != "UMAT")
+    {
+        LOGERROR(source.GetName() + " is not a valid cooked material file");
+        return false;
+    }
+    if (source.ReadUInt() != COOKED_RESOURCE_VERSION)
+    {
+        LOGERROR(source.GetName() + " is of an unsupported cooked resource version");
+        return false;
+    }
+    
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    
+    unsigned numTechniques = source.ReadVLE();
+    techniques_.Clear();
+    for (unsigned i = 0; i < numTechniques; ++i)
+    {
+        Technique* tech = cache->GetResource<Technique>(source.ReadString());
+        int qualityLevel = source.ReadInt();
+        float lodDistance = source.ReadFloat();
+        if (tech)
+            techniques_.Push(TechniqueEntry(tech, qualityLevel, lodDistance));
+    }
+    
+    SortTechniques();
+    
+    unsigned numTextures = source.ReadVLE();
+    for (unsigned i = 0; i < numTextures; ++i)
+    {
+        TextureUnit unit = (TextureUnit)source.ReadUByte();
+        String name = source.ReadString();
+        // Detect cube maps by file extension: they are defined by an XML file
+        if (GetExtension(name) == ".xml")
+            SetTexture(unit, cache->GetResource<TextureCube>(name));
+        else
+            SetTexture(unit, cache->GetResource<Texture2D>(name));
+    }
+    
+    unsigned numParameters = source.ReadVLE();
+    for (unsigned i = 0; i < numParameters; ++i)
+    {
+        String name = source.ReadString();
+        SetShaderParameter(name, source.ReadVariant());
+    }
+    
+    if (source.ReadBool())
+        SetCullMode((CullMode)source.ReadUByte());
+    if (source.ReadBool())
+        SetShadowCullMode((CullMode)source.ReadUByte());
+    if (source.ReadBool())
+    {
+        float constantBias = source.ReadFloat();
+        SetDepthBias(BiasParameters(constantBias, source.ReadFloat()));
+    }
+    
+    UpdateMemoryUse();
+    CheckOcclusion();
+    return true;
+}
+
+void Material::UpdateMemoryUse()
+{
+    unsigned memoryUse = sizeof(Material);
+    
+    memoryUse += techniques_.Size() * sizeof(TechniqueEntry);
+    memoryUse += MAX_MATERIAL_TEXTURE_UNITS * sizeof(SharedPtr<Texture>);
+    memoryUse += shaderParameters_.Size() * sizeof(MaterialShaderParameter);
+    
+    SetMemoryUse(memoryUse);
+}
+
 void Material::CheckOcclusion()
 {
     // Determine occlusion by checking the base pass of each technique
@@ -26,6 +26,7 @@
 #include "Light.h"
 #include "Resource.h"
 #include "Vector4.h"
+#include "VectorBuffer.h"
 
 namespace Urho3D
 {
@@ -35,6 +36,7 @@ class Technique;
 class Texture;
 class Texture2D;
 class TextureCube;
+class XMLFile;
 
 /// %Material's shader parameter definition.
 struct MaterialShaderParameter
@@ -76,8 +78,10 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
     
-    /// Load resource. Return true if successful.
-    virtual bool Load(Deserializer& source);
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    virtual bool EndLoad();
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
     
@@ -85,6 +89,8 @@ public:
     bool Load(const XMLElement& source);
     /// Save to an XML element. Return true if successful.
     bool Save(XMLElement& dest) const;
+    /// Convert a material XML definition to the cooked binary format without loading the resources it refers to. Return true if successful.
+    static bool Cook(const XMLElement& source, Serializer& dest);
     /// Set number of techniques.
     void SetNumTechniques(unsigned num);
     /// Set technique.
@@ -149,6 +155,10 @@ public:
     static String GetTextureUnitName(TextureUnit unit);
     
 private:
+    /// Load from the cooked binary format. Return true if successful.
+    bool LoadCooked(Deserializer& source);
+    /// Calculate memory use.
+    void UpdateMemoryUse();
     /// Re-evaluate occlusion rendering.
     void CheckOcclusion();
     /// Reset to defaults.
@@ -172,6 +182,10 @@ private:
     bool occlusion_;
     /// Specular lighting flag.
     bool specular_;
+    /// XML file used while loading.
+    SharedPtr<XMLFile> loadXMLFile_;
+    /// Cooked data used while loading.
+    VectorBuffer loadCookedData_;
 };
 
 }
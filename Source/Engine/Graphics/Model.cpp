@@ -59,6 +59,22 @@ unsigned LookupIndexBuffer(IndexBuffer* buffer, const Vector<SharedPtr<IndexBuff
     return 0;
 }
 
+/// Return pointer to the next bytes of a stream and skip them if the stream resides in memory, for example a memory-mapped file. Otherwise read them to a copy buffer.
+static const unsigned char* ReadBufferData(Deserializer& source, unsigned size, SharedArrayPtr<unsigned char>& copy)
+{
+    const unsigned char* directData = source.GetDirectData();
+    unsigned position = source.GetPosition();
+    if (directData && position + size <= source.GetSize())
+    {
+        source.Seek(position + size);
+        return directData + position;
+    }
+    
+    copy = new unsigned char[size];
+    source.Read(copy.Get(), size);
+    return copy.Get();
+}
+
 Model::Model(Context* context) :
     Resource(context)
 {
@@ -73,7 +89,7 @@ void Model::RegisterObject(Context* context)
     context->RegisterFactory<Model>();
 }
 
-bool Model::Load(Deserializer& source)
+bool Model::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadModel);
     
@@ -93,54 +109,44 @@ bool Model::Load(Deserializer& source)
     
     unsigned memoryUse = sizeof(Model);
     
-    // Read vertex buffers
+    // Read vertex buffers. The GPU objects are created in EndLoad(). The source stream stays valid until then, so if it
+    // resides in memory, the data is uploaded from it without an intermediate copy
     unsigned numVertexBuffers = source.ReadUInt();
-    vertexBuffers_.Reserve(numVertexBuffers);
+    loadVBData_.Resize(numVertexBuffers);
     morphRangeStarts_.Resize(numVertexBuffers);
     morphRangeCounts_.Resize(numVertexBuffers);
     for (unsigned i = 0; i < numVertexBuffers; ++i)
     {
-        unsigned vertexCount = source.ReadUInt();
-        unsigned elementMask = source.ReadUInt();
+        VertexBufferDesc& desc = loadVBData_[i];
+        desc.vertexCount_ = source.ReadUInt();
+        desc.elementMask_ = source.ReadUInt();
         morphRangeStarts_[i] = source.ReadUInt();
         morphRangeCounts_[i] = source.ReadUInt();
         
-        SharedPtr<VertexBuffer> buffer(new VertexBuffer(context_));
-        buffer->SetShadowed(true);
-        buffer->SetSize(vertexCount, elementMask);
-        
-        void* dest = buffer->Lock(0, vertexCount);
-        unsigned vertexSize = buffer->GetVertexSize();
-        source.Read(dest, vertexCount * vertexSize);
-        buffer->Unlock();
+        unsigned vertexSize = VertexBuffer::GetVertexSize(desc.elementMask_);
+        desc.dataSize_ = desc.vertexCount_ * vertexSize;
+        desc.data_ = ReadBufferData(source, desc.dataSize_, desc.dataCopy_);
         
-        memoryUse += sizeof(VertexBuffer) + vertexCount * vertexSize;
-        vertexBuffers_.Push(buffer);
+        memoryUse += sizeof(VertexBuffer) + desc.dataSize_;
     }
 
     // Read index buffers
     unsigned numIndexBuffers = source.ReadUInt();
-    indexBuffers_.Reserve(numIndexBuffers);
+    loadIBData_.Resize(numIndexBuffers);
     for (unsigned i = 0; i < numIndexBuffers; ++i)
     {
-        unsigned indexCount = source.ReadUInt();
-        unsigned indexSize = source.ReadUInt();
-        
-        SharedPtr<IndexBuffer> buffer(new IndexBuffer(context_));
-        buffer->SetShadowed(true);
-        buffer->SetSize(indexCount, indexSize > sizeof(unsigned short));
+        IndexBufferDesc& desc = loadIBData_[i];
+        desc.indexCount_ = source.ReadUInt();
+        desc.indexSize_ = source.ReadUInt();
+        desc.dataSize_ = desc.indexCount_ * desc.indexSize_;
+        desc.data_ = ReadBufferData(source, desc.dataSize_, desc.dataCopy_);
         
-        void* dest = buffer->Lock(0, indexCount);
-        source.Read(dest, indexCount * indexSize);
-        buffer->Unlock();
-        
-        memoryUse += sizeof(IndexBuffer) + indexCount * indexSize;
-        indexBuffers_.Push(buffer);
+        memoryUse += sizeof(IndexBuffer) + desc.dataSize_;
     }
     
     // Read geometries
     unsigned numGeometries = source.ReadUInt();
-    geometries_.Reserve(numGeometries);
+    loadGeometries_.Resize(numGeometries);
     geometryBoneMappings_.Reserve(numGeometries);
     geometryCenters_.Reserve(numGeometries);
     for (unsigned i = 0; i < numGeometries; ++i)
@@ -153,41 +159,37 @@ bool Model::Load(Deserializer& source)
         geometryBoneMappings_.Push(boneMapping);
         
         unsigned numLodLevels = source.ReadUInt();
-        Vector<SharedPtr<Geometry> > geometryLodLevels;
-        geometryLodLevels.Reserve(numLodLevels);
+        loadGeometries_[i].Resize(numLodLevels);
         
         for (unsigned j = 0; j < numLodLevels; ++j)
         {
-            float distance = source.ReadFloat();
-            PrimitiveType type = (PrimitiveType)source.ReadUInt();
+            GeometryDesc& desc = loadGeometries_[i][j];
+            desc.lodDistance_ = source.ReadFloat();
+            desc.type_ = (PrimitiveType)source.ReadUInt();
+            desc.vbRef_ = source.ReadUInt();
+            desc.ibRef_ = source.ReadUInt();
+            desc.indexStart_ = source.ReadUInt();
+            desc.indexCount_ = source.ReadUInt();
             
-            unsigned vertexBufferRef = source.ReadUInt();
-            unsigned indexBufferRef = source.ReadUInt();
-            unsigned indexStart = source.ReadUInt();
-            unsigned indexCount = source.ReadUInt();
-            
-            if (vertexBufferRef >= vertexBuffers_.Size())
+            if (desc.vbRef_ >= loadVBData_.Size())
             {
                 LOGERROR("Vertex buffer index out of bounds");
+                loadVBData_.Clear();
+                loadIBData_.Clear();
+                loadGeometries_.Clear();
                 return false;
             }
-            if (indexBufferRef >= indexBuffers_.Size())
+            if (desc.ibRef_ >= loadIBData_.Size())
             {
                 LOGERROR("Index buffer index out of bounds");
+                loadVBData_.Clear();
+                loadIBData_.Clear();
+                loadGeometries_.Clear();
                 return false;
             }
             
-            SharedPtr<Geometry> geometry(new Geometry(context_));
-            geometry->SetVertexBuffer(0, vertexBuffers_[vertexBufferRef]);
-            geometry->SetIndexBuffer(indexBuffers_[indexBufferRef]);
-            geometry->SetDrawRange(type, indexStart, indexCount);
-            geometry->SetLodDistance(distance);
-            
-            geometryLodLevels.Push(geometry);
             memoryUse += sizeof(Geometry);
         }
-        
-        geometries_.Push(geometryLodLevels);
     }
     
     // Read morphs
@@ -239,16 +241,71 @@ bool Model::Load(Deserializer& source)
     boundingBox_ = source.ReadBoundingBox();
     
     // Read geometry centers
-    for (unsigned i = 0; i < geometries_.Size() && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < loadGeometries_.Size() && !source.IsEof(); ++i)
         geometryCenters_.Push(source.ReadVector3());
-    while (geometryCenters_.Size() < geometries_.Size())
+    while (geometryCenters_.Size() < loadGeometries_.Size())
         geometryCenters_.Push(Vector3::ZERO);
-    memoryUse += sizeof(Vector3) * geometries_.Size();
+    memoryUse += sizeof(Vector3) * loadGeometries_.Size();
     
     SetMemoryUse(memoryUse);
     return true;
 }
 
+bool Model::EndLoad()
+{
+    PROFILE(FinishLoadModel);
+    
+    // Upload vertex buffer data
+    vertexBuffers_.Reserve(loadVBData_.Size());
+    for (unsigned i = 0; i < loadVBData_.Size(); ++i)
+    {
+        VertexBufferDesc& desc = loadVBData_[i];
+        SharedPtr<VertexBuffer> buffer(new VertexBuffer(context_));
+        buffer->SetShadowed(true);
+        buffer->SetSize(desc.vertexCount_, desc.elementMask_);
+        buffer->SetData(desc.data_);
+        vertexBuffers_.Push(buffer);
+    }
+    
+    // Upload index buffer data
+    indexBuffers_.Reserve(loadIBData_.Size());
+    for (unsigned i = 0; i < loadIBData_.Size(); ++i)
+    {
+        IndexBufferDesc& desc = loadIBData_[i];
+        SharedPtr<IndexBuffer> buffer(new IndexBuffer(context_));
+        buffer->SetShadowed(true);
+        buffer->SetSize(desc.indexCount_, desc.indexSize_ > sizeof(unsigned short));
+        buffer->SetData(desc.data_);
+        indexBuffers_.Push(buffer);
+    }
+    
+    // Set up geometries
+    geometries_.Reserve(loadGeometries_.Size());
+    for (unsigned i = 0; i < loadGeometries_.Size(); ++i)
+    {
+        Vector<SharedPtr<Geometry> > geometryLodLevels;
+        geometryLodLevels.Reserve(loadGeometries_[i].Size());
+        
+        for (unsigned j = 0; j < loadGeometries_[i].Size(); ++j)
+        {
+            const GeometryDesc& desc = loadGeometries_[i][j];
+            SharedPtr<Geometry> geometry(new Geometry(context_));
+            geometry->SetVertexBuffer(0, vertexBuffers_[desc.vbRef_]);
+            geometry->SetIndexBuffer(indexBuffers_[desc.ibRef_]);
+            geometry->SetDrawRange(desc.type_, desc.indexStart_, desc.indexCount_);
+            geometry->SetLodDistance(desc.lodDistance_);
+            geometryLodLevels.Push(geometry);
+        }
+        
+        geometries_.Push(geometryLodLevels);
+    }
+    
+    loadVBData_.Clear();
+    loadIBData_.Clear();
+    loadGeometries_.Clear();
+    return true;
+}
+
 bool Model::Save(Serializer& dest) const
 {
     // Write ID
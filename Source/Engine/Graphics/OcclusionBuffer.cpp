@@ -24,9 +24,17 @@
 #include "Camera.h"
 #include "Log.h"
 #include "OcclusionBuffer.h"
+#include "WorkQueue.h"
 
 #include <cstring>
 
+#ifdef USE_SSE
+#include <xmmintrin.h>
+#endif
+#ifdef USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "DebugNew.h"
 
 namespace Urho3D
@@ -39,6 +47,16 @@ static const unsigned CLIPMASK_Y_NEG = 0x8;
 static const unsigned CLIPMASK_Z_POS = 0x10;
 static const unsigned CLIPMASK_Z_NEG = 0x20;
 
+void RasterizeBandWork(const WorkItem* item, unsigned threadIndex)
+{
+    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    const OcclusionBufferBand* band = reinterpret_cast<const OcclusionBufferBand*>(item->start_);
+    const Vector3* vertices = &buffer->queuedTriangles_[0];
+    
+    for (unsigned i = 0; i < band->triangles_.Size(); ++i)
+        buffer->DrawTriangle2D(vertices + band->triangles_[i] * 3, band->startY_, band->endY_);
+}
+
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context),
     buffer_(0),
@@ -48,6 +66,7 @@ OcclusionBuffer::OcclusionBuffer(Context* context) :
     maxTriangles_(OCCLUSION_DEFAULT_MAX_TRIANGLES),
     cullMode_(CULL_CCW),
     depthHierarchyDirty_(true),
+    threaded_(false),
     nearClip_(0.0f),
     farClip_(0.0f)
 {
@@ -82,6 +101,17 @@ bool OcclusionBuffer::SetSize(int width, int height)
     fullBuffer_ = new int[width * (height + 2) + 2];
     buffer_ = fullBuffer_.Get() + width + 1;
     mipBuffers_.Clear();
+    queuedTriangles_.Clear();
+    
+    // Split into horizontal bands for threaded rasterization. The outermost bands also take any rows outside the buffer
+    bands_.Resize((height + OCCLUSION_BAND_HEIGHT - 1) / OCCLUSION_BAND_HEIGHT);
+    for (unsigned i = 0; i < bands_.Size(); ++i)
+    {
+        bands_[i].startY_ = i * OCCLUSION_BAND_HEIGHT;
+        bands_[i].endY_ = Min((int)(i + 1) * OCCLUSION_BAND_HEIGHT, height);
+    }
+    bands_.Front().startY_ = M_MIN_INT;
+    bands_.Back().endY_ = M_MAX_INT;
     
     // Build buffers for mip levels
     for (;;)
@@ -136,6 +166,7 @@ void OcclusionBuffer::Clear()
         return;
     
     Reset();
+    queuedTriangles_.Clear();
     
     int* dest = buffer_;
     int count = width_ * height_;
@@ -152,6 +183,8 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
     
     Matrix4 modelViewProj = viewProj_ * model;
     depthHierarchyDirty_ = true;
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    threaded_ = queue && queue->GetNumThreads();
     
     // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
     Vector4 vertices[64 * 3];
@@ -185,6 +218,8 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
     
     Matrix4 modelViewProj = viewProj_ * model;
     depthHierarchyDirty_ = true;
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    threaded_ = queue && queue->GetNumThreads();
     
     // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
     Vector4 vertices[64 * 3];
@@ -238,11 +273,59 @@ bool OcclusionBuffer::Draw(const Matrix3x4& model, const void* vertexData, unsig
     return true;
 }
 
+void OcclusionBuffer::DrawTriangles()
+{
+    if (queuedTriangles_.Empty())
+        return;
+    
+    // Sort the triangles into the bands they overlap, then rasterize each band in a work item
+    for (unsigned i = 0; i < bands_.Size(); ++i)
+        bands_[i].triangles_.Clear();
+    
+    unsigned numTriangles = queuedTriangles_.Size() / 3;
+    int lastBand = bands_.Size() - 1;
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        const Vector3* vertices = &queuedTriangles_[i * 3];
+        int topY = (int)Min(Min(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+        int bottomY = (int)Max(Max(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+        if (topY == bottomY)
+            continue;
+        
+        int first = Clamp(topY / OCCLUSION_BAND_HEIGHT, 0, lastBand);
+        int last = Clamp((bottomY - 1) / OCCLUSION_BAND_HEIGHT, 0, lastBand);
+        for (int j = first; j <= last; ++j)
+            bands_[j].triangles_.Push(i);
+    }
+    
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    for (unsigned i = 0; i < bands_.Size(); ++i)
+    {
+        if (bands_[i].triangles_.Empty())
+            continue;
+        
+        WorkItem item;
+        item.workFunction_ = RasterizeBandWork;
+        item.start_ = &bands_[i];
+        item.aux_ = this;
+        if (queue)
+            queue->AddWorkItem(item);
+        else
+            RasterizeBandWork(&item, 0);
+    }
+    if (queue)
+        queue->Complete(M_MAX_UNSIGNED);
+    
+    queuedTriangles_.Clear();
+}
+
 void OcclusionBuffer::BuildDepthHierarchy()
 {
     if (!buffer_)
         return;
     
+    DrawTriangles();
+    
     // Build the first mip level from the pixel-level data
     int width = (width_ + 1) / 2;
     int height = (height_ + 1) / 2;
@@ -384,6 +467,102 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
         if (projected.z_ < minZ) minZ = projected.z_;
     }
     
+    return IsVisible(minX, minY, maxX, maxY, minZ);
+}
+
+#ifdef USE_SSE
+/// Transform four points by one row of a matrix, in the same order of operations as OcclusionBuffer::ModelTransform().
+static inline __m128 TransformRow(float m0, float m1, float m2, float m3, __m128 x, __m128 y, __m128 z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m0), x), _mm_mul_ps(_mm_set1_ps(m1), y)),
+        _mm_mul_ps(_mm_set1_ps(m2), z)), _mm_set1_ps(m3));
+}
+#endif
+
+void OcclusionBuffer::IsVisible(const BoundingBox* worldSpaceBoxes, unsigned numBoxes, bool* results) const
+{
+    if (!buffer_)
+    {
+        for (unsigned i = 0; i < numBoxes; ++i)
+            results[i] = true;
+        return;
+    }
+    
+    unsigned i = 0;
+    
+    #ifdef USE_SSE
+    // Project four boxes at a time, one box per lane. The results are the same as projecting the boxes one at a time
+    const Matrix4& m = viewProj_;
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 bias = _mm_set1_ps(OCCLUSION_RELATIVE_BIAS);
+    __m128 scaleX = _mm_set1_ps(scaleX_);
+    __m128 scaleY = _mm_set1_ps(scaleY_);
+    __m128 offsetX = _mm_set1_ps(offsetX_);
+    __m128 offsetY = _mm_set1_ps(offsetY_);
+    __m128 scaleZ = _mm_set1_ps(OCCLUSION_Z_SCALE);
+    
+    for (; i + 4 <= numBoxes; i += 4)
+    {
+        const BoundingBox* boxes = worldSpaceBoxes + i;
+        __m128 x[2], y[2], z[2];
+        x[0] = _mm_setr_ps(boxes[0].min_.x_, boxes[1].min_.x_, boxes[2].min_.x_, boxes[3].min_.x_);
+        y[0] = _mm_setr_ps(boxes[0].min_.y_, boxes[1].min_.y_, boxes[2].min_.y_, boxes[3].min_.y_);
+        z[0] = _mm_setr_ps(boxes[0].min_.z_, boxes[1].min_.z_, boxes[2].min_.z_, boxes[3].min_.z_);
+        x[1] = _mm_setr_ps(boxes[0].max_.x_, boxes[1].max_.x_, boxes[2].max_.x_, boxes[3].max_.x_);
+        y[1] = _mm_setr_ps(boxes[0].max_.y_, boxes[1].max_.y_, boxes[2].max_.y_, boxes[3].max_.y_);
+        z[1] = _mm_setr_ps(boxes[0].max_.z_, boxes[1].max_.z_, boxes[2].max_.z_, boxes[3].max_.z_);
+        
+        __m128 minX = _mm_set1_ps(M_INFINITY);
+        __m128 minY = minX;
+        __m128 minZ = minX;
+        __m128 maxX = _mm_set1_ps(-M_INFINITY);
+        __m128 maxY = maxX;
+        __m128 crossesNear = zero;
+        
+        for (unsigned j = 0; j < 8; ++j)
+        {
+            __m128 cornerX = x[j & 1];
+            __m128 cornerY = y[(j >> 1) & 1];
+            __m128 cornerZ = z[j >> 2];
+            
+            __m128 clipX = TransformRow(m.m00_, m.m01_, m.m02_, m.m03_, cornerX, cornerY, cornerZ);
+            __m128 clipY = TransformRow(m.m10_, m.m11_, m.m12_, m.m13_, cornerX, cornerY, cornerZ);
+            __m128 clipZ = _mm_sub_ps(TransformRow(m.m20_, m.m21_, m.m22_, m.m23_, cornerX, cornerY, cornerZ), bias);
+            __m128 clipW = TransformRow(m.m30_, m.m31_, m.m32_, m.m33_, cornerX, cornerY, cornerZ);
+            crossesNear = _mm_or_ps(crossesNear, _mm_cmple_ps(clipZ, zero));
+            
+            __m128 invW = _mm_div_ps(one, clipW);
+            __m128 projX = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, clipX), scaleX), offsetX);
+            __m128 projY = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, clipY), scaleY), offsetY);
+            __m128 projZ = _mm_mul_ps(_mm_mul_ps(invW, clipZ), scaleZ);
+            minX = _mm_min_ps(minX, projX);
+            maxX = _mm_max_ps(maxX, projX);
+            minY = _mm_min_ps(minY, projY);
+            maxY = _mm_max_ps(maxY, projY);
+            minZ = _mm_min_ps(minZ, projZ);
+        }
+        
+        float minXs[4], minYs[4], maxXs[4], maxYs[4], minZs[4];
+        _mm_storeu_ps(minXs, minX);
+        _mm_storeu_ps(minYs, minY);
+        _mm_storeu_ps(maxXs, maxX);
+        _mm_storeu_ps(maxYs, maxY);
+        _mm_storeu_ps(minZs, minZ);
+        int nearMask = _mm_movemask_ps(crossesNear);
+        
+        // If any of the corners cross the near plane, assume visible
+        for (unsigned j = 0; j < 4; ++j)
+            results[i + j] = (nearMask & (1 << j)) || IsVisible(minXs[j], minYs[j], maxXs[j], maxYs[j], minZs[j]);
+    }
+    #endif
+    
+    for (; i < numBoxes; ++i)
+        results[i] = IsVisible(worldSpaceBoxes[i]);
+}
+
+bool OcclusionBuffer::IsVisible(float minX, float minY, float maxX, float maxY, float minZ) const
+{
     // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
     IntRect rect(
         (int)(minX - 1.5f), (int)(minY - 1.5f),
@@ -735,6 +914,13 @@ struct Edge
         invZStep_ = (int)(slope * gradients.dInvZdX_ + gradients.dInvZdY_ + 0.5f);
     }
     
+    /// Step down by a number of rows.
+    void Step(int rows)
+    {
+        x_ += rows * xStep_;
+        invZ_ += rows * invZStep_;
+    }
+    
     /// X coordinate.
     int x_;
     /// X coordinate step.
@@ -746,6 +932,21 @@ struct Edge
 };
 
 void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices)
+{
+    if (!threaded_)
+    {
+        DrawTriangle2D(vertices, M_MIN_INT, M_MAX_INT);
+        return;
+    }
+    
+    queuedTriangles_.Push(vertices[0]);
+    queuedTriangles_.Push(vertices[1]);
+    queuedTriangles_.Push(vertices[2]);
+    if (queuedTriangles_.Size() >= OCCLUSION_TRIANGLE_BATCH * 3)
+        DrawTriangles();
+}
+
+void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, int startY, int endY)
 {
     int top, middle, bottom;
     bool middleIsRight;
@@ -800,8 +1001,8 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices)
     int middleY = (int)vertices[middle].y_;
     int bottomY = (int)vertices[bottom].y_;
     
-    // Check for degenerate triangle
-    if (topY == bottomY)
+    // Check for degenerate triangle, or triangle outside the row range
+    if (topY == bottomY || topY >= endY || bottomY <= startY)
         return;
     
     Gradients gradients(vertices);
@@ -809,98 +1010,84 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices)
     Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
     Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
     
-    // The triangle is clockwise, so if bottom > middle then middle is right
-    if (middleIsRight)
+    // Step the edges to the first row within the range. The edges are in fixed point, so the result is the same as when
+    // rasterizing the whole triangle at once
+    int topToBottomY = topY;
+    
+    // Top half
+    int firstY = Max(topY, startY);
+    int lastY = Min(middleY, endY);
+    if (firstY < lastY)
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (topToMiddle.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            topToMiddle.x_ += topToMiddle.xStep_;
-            row += width_;
-        }
+        topToMiddle.Step(firstY - topY);
+        topToBottom.Step(firstY - topY);
         
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
-        {
-            int invZ = topToBottom.invZ_;
-            int* dest = row + (topToBottom.x_ >> 16);
-            int* end = row + (middleToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            topToBottom.x_ += topToBottom.xStep_;
-            topToBottom.invZ_ += topToBottom.invZStep_;
-            middleToBottom.x_ += middleToBottom.xStep_;
-            row += width_;
-        }
+        // The triangle is clockwise, so if bottom > middle then middle is right
+        if (middleIsRight)
+            DrawSpans(topToBottom, topToMiddle, firstY, lastY, gradients.dInvZdXInt_);
+        else
+            DrawSpans(topToMiddle, topToBottom, firstY, lastY, gradients.dInvZdXInt_);
+        topToBottomY = lastY;
     }
-    else
+    
+    // Bottom half
+    firstY = Max(middleY, startY);
+    lastY = Min(bottomY, endY);
+    if (firstY < lastY)
+    {
+        middleToBottom.Step(firstY - middleY);
+        topToBottom.Step(firstY - topToBottomY);
+        
+        if (middleIsRight)
+            DrawSpans(topToBottom, middleToBottom, firstY, lastY, gradients.dInvZdXInt_);
+        else
+            DrawSpans(middleToBottom, topToBottom, firstY, lastY, gradients.dInvZdXInt_);
+    }
+}
+
+inline void OcclusionBuffer::DrawSpans(Edge& left, Edge& right, int startY, int endY, int dInvZdX)
+{
+    int* row = buffer_ + startY * width_;
+    int* endRow = buffer_ + endY * width_;
+    
+    while (row < endRow)
     {
-        // Top half
-        int* row = buffer_ + topY * width_;
-        int* endRow = buffer_ + middleY * width_;
-        while (row < endRow)
+        int invZ = left.invZ_;
+        // Clamp to the row so that a band never writes to the rows of another
+        int* dest = row + Max(left.x_ >> 16, 0);
+        int* end = row + Min(right.x_ >> 16, width_);
+        
+        #ifdef USE_SSE2
+        // Interpolate and test four pixels at a time
+        if (end - dest >= 4)
         {
-            int invZ = topToMiddle.invZ_;
-            int* dest = row + (topToMiddle.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
+            __m128i z = _mm_setr_epi32(invZ, invZ + dInvZdX, invZ + 2 * dInvZdX, invZ + 3 * dInvZdX);
+            __m128i zStep = _mm_set1_epi32(4 * dInvZdX);
+            do
             {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
+                __m128i old = _mm_loadu_si128((__m128i*)dest);
+                __m128i nearer = _mm_cmplt_epi32(z, old);
+                _mm_storeu_si128((__m128i*)dest, _mm_or_si128(_mm_and_si128(nearer, z), _mm_andnot_si128(nearer, old)));
+                z = _mm_add_epi32(z, zStep);
+                invZ += 4 * dInvZdX;
+                dest += 4;
             }
-            
-            topToMiddle.x_ += topToMiddle.xStep_;
-            topToMiddle.invZ_ += topToMiddle.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
+            while (end - dest >= 4);
         }
+        #endif
         
-        // Bottom half
-        row = buffer_ + middleY * width_;
-        endRow = buffer_ + bottomY * width_;
-        while (row < endRow)
+        while (dest < end)
         {
-            int invZ = middleToBottom.invZ_;
-            int* dest = row + (middleToBottom.x_ >> 16);
-            int* end = row + (topToBottom.x_ >> 16);
-            while (dest < end)
-            {
-                if (invZ < *dest)
-                    *dest = invZ;
-                invZ += gradients.dInvZdXInt_;
-                ++dest;
-            }
-            
-            middleToBottom.x_ += middleToBottom.xStep_;
-            middleToBottom.invZ_ += middleToBottom.invZStep_;
-            topToBottom.x_ += topToBottom.xStep_;
-            row += width_;
+            if (invZ < *dest)
+                *dest = invZ;
+            invZ += dInvZdX;
+            ++dest;
         }
+        
+        left.x_ += left.xStep_;
+        left.invZ_ += left.invZStep_;
+        right.x_ += right.xStep_;
+        row += width_;
     }
 }
 
@@ -38,6 +38,7 @@ class IntRect;
 class VertexBuffer;
 struct Edge;
 struct Gradients;
+struct WorkItem;
 
 /// Occlusion hierarchy depth range.
 struct DepthValue
@@ -48,18 +49,33 @@ struct DepthValue
     int max_;
 };
 
+/// Horizontal band of the occlusion buffer for threaded rasterization.
+struct OcclusionBufferBand
+{
+    /// First row.
+    int startY_;
+    /// Row after the last.
+    int endY_;
+    /// Indices of the queued triangles that overlap the band.
+    PODVector<unsigned> triangles_;
+};
+
 static const int OCCLUSION_MIN_SIZE = 8;
 static const int OCCLUSION_DEFAULT_MAX_TRIANGLES = 5000;
 static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
 static const float OCCLUSION_Z_SCALE = 16777216.0f;
+static const int OCCLUSION_BAND_HEIGHT = 16;
+static const unsigned OCCLUSION_TRIANGLE_BATCH = 1024;
 
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
 {
     OBJECT(OcclusionBuffer);
     
+    friend void RasterizeBandWork(const WorkItem* item, unsigned threadIndex);
+    
 public:
     /// Construct.
     OcclusionBuffer(Context* context);
@@ -82,7 +98,9 @@ public:
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
     /// Draw a triangle mesh to the buffer using indexed geometry.
     bool Draw(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount);
-    /// Build reduced size mip levels.
+    /// Rasterize the queued triangles. When worker threads exist, triangles are queued by Draw() and rasterized in horizontal bands in parallel, either when the batch is full or here.
+    void DrawTriangles();
+    /// Rasterize the queued triangles and build reduced size mip levels.
     void BuildDepthHierarchy();
     /// Reset last used timer.
     void ResetUseTimer();
@@ -99,12 +117,16 @@ public:
     int GetHeight() const { return height_; }
     /// Return number of rendered triangles.
     unsigned GetNumTriangles() const { return numTriangles_; }
+    /// Return number of projected triangles waiting to be rasterized.
+    unsigned GetNumQueuedTriangles() const { return queuedTriangles_.Size() / 3; }
     /// Return maximum number of triangles.
     unsigned GetMaxTriangles() const { return maxTriangles_; }
     /// Return culling mode.
     CullMode GetCullMode() const { return cullMode_; }
-    /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
+    /// Test a bounding box for visibility. For best performance, build depth hierarchy first. Queued triangles are not taken into account until rasterized.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
+    /// Test an array of bounding boxes for visibility and write the results to an array of the same size. Projects four boxes at a time using SSE when enabled.
+    void IsVisible(const BoundingBox* worldSpaceBoxes, unsigned numBoxes, bool* results) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
     
@@ -117,14 +139,20 @@ private:
     inline Vector4 ClipEdge(const Vector4& v0, const Vector4& v1, float d0, float d1) const;
     /// Check facing of a triangle.
     inline bool CheckFacing(const Vector3& v0, const Vector3& v1, const Vector3& v2) const;
+    /// Test a screen space rectangle with the minimum depth of a projected bounding box for visibility.
+    bool IsVisible(float minX, float minY, float maxX, float maxY, float minZ) const;
     /// Calculate viewport transform.
     void CalculateViewport();
     /// Draw a triangle.
     void DrawTriangle(Vector4* vertices);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
+    /// Draw or queue a clipped triangle.
     void DrawTriangle2D(const Vector3* vertices);
+    /// Rasterize the rows of a clipped triangle that are within the row range.
+    void DrawTriangle2D(const Vector3* vertices, int startY, int endY);
+    /// Rasterize the rows of a triangle half between two edges.
+    inline void DrawSpans(Edge& left, Edge& right, int startY, int endY, int dInvZdX);
     
     /// Highest level depth buffer.
     int* buffer_;
@@ -140,6 +168,8 @@ private:
     CullMode cullMode_;
     /// Depth hierarchy needs update flag.
     bool depthHierarchyDirty_;
+    /// Queue triangles for threaded rasterization flag.
+    bool threaded_;
     /// View transform matrix.
     Matrix3x4 view_;
     /// Projection matrix.
@@ -168,6 +198,10 @@ private:
     SharedArrayPtr<int> fullBuffer_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue> > mipBuffers_;
+    /// Projected triangles waiting to be rasterized, three vertices per triangle.
+    PODVector<Vector3> queuedTriangles_;
+    /// Horizontal bands for threaded rasterization.
+    Vector<OcclusionBufferBand> bands_;
 };
 
 }
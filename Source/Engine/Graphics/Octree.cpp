@@ -43,7 +43,13 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const float DEFAULT_OCTREE_LOOSENESS = 2.0f;
 static const int RAYCASTS_PER_WORK_ITEM = 4;
+static const int RAY_PACKETS_PER_WORK_ITEM = 16;
+static const int REINSERTIONS_PER_WORK_ITEM = 64;
+static const unsigned MIN_DRAWABLES_PER_QUERY_WORK_ITEM = 256;
+static const unsigned QUERY_WORK_ITEMS_PER_THREAD = 4;
+static const unsigned MAX_OCTREE_CHANGES = 64;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
@@ -63,6 +69,15 @@ void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+void RaycastPacketsWork(const WorkItem* item, unsigned threadIndex)
+{
+    const Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    RayOctreeQuery** start = reinterpret_cast<RayOctreeQuery**>(item->start_);
+    RayOctreeQuery** end = reinterpret_cast<RayOctreeQuery**>(item->end_);
+
+    octree->RaycastPackets(start, end);
+}
+
 void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
 {
     const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
@@ -81,6 +96,79 @@ void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+void ReinsertDrawablesWork(const WorkItem* item, unsigned threadIndex)
+{
+    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    WeakPtr<Drawable>* start = reinterpret_cast<WeakPtr<Drawable>*>(item->start_);
+    WeakPtr<Drawable>* end = reinterpret_cast<WeakPtr<Drawable>*>(item->end_);
+    Octant** target = &octree->reinsertionOctants_[start - octree->drawableReinsertions_.Begin().ptr_];
+
+    while (start != end)
+    {
+        Drawable* drawable = *start;
+        *target = 0;
+
+        if (drawable)
+        {
+            Octant* octant = drawable->GetOctant();
+            const BoundingBox& box = drawable->GetWorldBoundingBox();
+
+            // Skip if no octant or does not belong to this octree anymore, or if still fits the current octant. Otherwise find
+            // the target octant as far as it exists, without modifying the octree
+            if (octant && octant->GetRoot() == octree && !(drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) ==
+                INSIDE && octant->CheckDrawableFit(box)))
+                *target = octree->GetInsertionOctant(drawable, false);
+        }
+
+        ++start;
+        ++target;
+    }
+}
+
+void GetDrawablesWork(const WorkItem* item, unsigned threadIndex)
+{
+    const Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    OctreeQuerySubtree* start = reinterpret_cast<OctreeQuerySubtree*>(item->start_);
+    OctreeQuerySubtree* end = reinterpret_cast<OctreeQuerySubtree*>(item->end_);
+    OctreeQuery& query = *octree->threadedQuery_;
+    PODVector<Drawable*>* result = &octree->querySubtreeResults_[start - octree->querySubtrees_.Begin().ptr_];
+
+    while (start != end)
+    {
+        result->Clear();
+        if (start->recursive_)
+            start->octant_->GetDrawablesInternal(query, start->inside_, *result);
+        else
+            start->octant_->TestDrawablesInternal(query, start->inside_, *result);
+
+        ++start;
+        ++result;
+    }
+}
+
+inline void ProcessRayQueryPacket(RayQueryPacket& packet, unsigned index, Drawable* drawable)
+{
+    RayOctreeQuery& query = *packet.queries_[index];
+    if (!(drawable->GetDrawableFlags() & query.drawableFlags_) || !(drawable->GetViewMask() & query.viewMask_))
+        return;
+
+    // Use the closest hit so far as the maximum distance, so that the drawable can early-out
+    RayOctreeQuery closestQuery(packet.results_, query.ray_, query.level_, packet.closest_[index], query.drawableFlags_,
+        query.viewMask_);
+    packet.results_.Clear();
+    drawable->ProcessRayQuery(closestQuery, packet.results_);
+
+    for (PODVector<RayQueryResult>::ConstIterator i = packet.results_.Begin(); i != packet.results_.End(); ++i)
+    {
+        if (i->distance_ < packet.closest_[index])
+        {
+            packet.closest_[index] = i->distance_;
+            query.result_.Clear();
+            query.result_.Push(*i);
+        }
+    }
+}
+
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -91,9 +179,13 @@ Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* r
     numDrawables_(0),
     parent_(parent),
     root_(root),
-    index_(index)
+    index_(index),
+    drawableBoundsDirty_(false),
+    childBoundsDirty_(false),
+    reinsertionQueued_(false)
 {
-    Initialize(box);
+    // The root octant is initialized before the octree members, so it uses the default looseness until resized
+    Initialize(box, parent ? root->GetLooseness() : DEFAULT_OCTREE_LOOSENESS);
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
         children_[i] = 0;
@@ -110,6 +202,7 @@ Octant::~Octant()
             root_->drawables_.Push(*i);
             root_->QueueReinsertion(*i);
         }
+        root_->drawableBoundsDirty_ = true;
         drawables_.Clear();
         numDrawables_ = 0;
     }
@@ -155,55 +248,77 @@ void Octant::DeleteChild(unsigned index)
 
 void Octant::InsertDrawable(Drawable* drawable)
 {
-    const BoundingBox& box = drawable->GetWorldBoundingBox();
-
-    // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
-    // Also if drawable is outside the root octant bounds, insert to root
-    bool insertHere;
-    if (this == root_)
-        insertHere = !drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE || CheckDrawableFit(box);
-    else
-        insertHere = CheckDrawableFit(box);
-
-    if (insertHere)
+    Octant* octant = GetInsertionOctant(drawable, true);
+    Octant* oldOctant = drawable->octant_;
+    root_->MarkChanged(drawable->GetWorldBoundingBox());
+    if (oldOctant != octant)
     {
-        Octant* oldOctant = drawable->octant_;
-        if (oldOctant != this)
+        // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+        octant->AddDrawable(drawable);
+        if (oldOctant)
         {
-            // Add first, then remove, because drawable count going to zero deletes the octree branch in question
-            AddDrawable(drawable);
-            if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+            root_->MarkChanged(oldOctant);
+            oldOctant->RemoveDrawable(drawable, false);
         }
     }
-    else
+}
+
+Octant* Octant::GetInsertionOctant(Drawable* drawable, bool create)
+{
+    const BoundingBox& box = drawable->GetWorldBoundingBox();
+    Vector3 boxCenter = box.Center();
+    Octant* octant = this;
+
+    for (;;)
     {
-        Vector3 boxCenter = box.Center();
-        unsigned x = boxCenter.x_ < center_.x_ ? 0 : 1;
-        unsigned y = boxCenter.y_ < center_.y_ ? 0 : 2;
-        unsigned z = boxCenter.z_ < center_.z_ ? 0 : 4;
+        // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
+        // Also if drawable is outside the root octant bounds, insert to root
+        bool insertHere;
+        if (octant == root_)
+            insertHere = !drawable->IsOccludee() || octant->cullingBox_.IsInside(box) != INSIDE || octant->CheckDrawableFit(box);
+        else
+            insertHere = octant->CheckDrawableFit(box);
+
+        if (insertHere)
+            return octant;
 
-        GetOrCreateChild(x + y + z)->InsertDrawable(drawable);
+        unsigned x = boxCenter.x_ < octant->center_.x_ ? 0 : 1;
+        unsigned y = boxCenter.y_ < octant->center_.y_ ? 0 : 2;
+        unsigned z = boxCenter.z_ < octant->center_.z_ ? 0 : 4;
+
+        Octant* child = octant->children_[x + y + z];
+        if (!child)
+        {
+            if (!create)
+                return octant;
+            child = octant->GetOrCreateChild(x + y + z);
+        }
+        octant = child;
     }
 }
 
 bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
     Vector3 boxSize = box.Size();
+    float looseness = root_->GetLooseness();
+    // Amount by which a child octant's culling box extends past the child octant
+    Vector3 childMargin = 0.5f * (looseness - 1.0f) * halfSize_;
+    // Check size against the child margin of the default looseness at most, so that a looser octree does not insert deeper,
+    // but leaves more room for the drawables to move before they need reinsertion
+    Vector3 minSize = Min(looseness - 1.0f, 1.0f) * halfSize_;
 
     // If max split level, size always OK, otherwise check that box is at least half size of octant
-    if (level_ >= root_->GetNumLevels() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
-        boxSize.z_ >= halfSize_.z_)
+    if (level_ >= root_->GetNumLevels() || boxSize.x_ >= minSize.x_ || boxSize.y_ >= minSize.y_ || boxSize.z_ >= minSize.z_)
         return true;
     // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
     else
     {
-        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - 0.5f * halfSize_.x_ ||
-            box.max_.x_ >= worldBoundingBox_.max_.x_ + 0.5f * halfSize_.x_ ||
-            box.min_.y_ <= worldBoundingBox_.min_.y_ - 0.5f * halfSize_.y_ ||
-            box.max_.y_ >= worldBoundingBox_.max_.y_ + 0.5f * halfSize_.y_ ||
-            box.min_.z_ <= worldBoundingBox_.min_.z_ - 0.5f * halfSize_.z_ ||
-            box.max_.z_ >= worldBoundingBox_.max_.z_ + 0.5f * halfSize_.z_)
+        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - childMargin.x_ ||
+            box.max_.x_ >= worldBoundingBox_.max_.x_ + childMargin.x_ ||
+            box.min_.y_ <= worldBoundingBox_.min_.y_ - childMargin.y_ ||
+            box.max_.y_ >= worldBoundingBox_.max_.y_ + childMargin.y_ ||
+            box.min_.z_ <= worldBoundingBox_.min_.z_ - childMargin.z_ ||
+            box.max_.z_ >= worldBoundingBox_.max_.z_ + childMargin.z_)
             return true;
     }
 
@@ -240,15 +355,49 @@ void Octant::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     }
 }
 
-void Octant::Initialize(const BoundingBox& box)
+void Octant::Initialize(const BoundingBox& box, float looseness)
 {
     worldBoundingBox_ = box;
     center_ = box.Center();
     halfSize_ = 0.5f * box.Size();
-    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
+    Vector3 margin = (looseness - 1.0f) * halfSize_;
+    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - margin, worldBoundingBox_.max_ + margin);
+}
+
+void Octant::UpdateDrawableBounds()
+{
+    if (drawableBoundsDirty_)
+    {
+        unsigned numDrawables = drawables_.Size();
+        unsigned numBlocks = (numDrawables + BOUNDING_BOX_BLOCK_SIZE - 1) / BOUNDING_BOX_BLOCK_SIZE;
+        drawableBounds_.Resize(numBlocks);
+
+        for (unsigned i = 0; i < numDrawables; ++i)
+            drawableBounds_[i / BOUNDING_BOX_BLOCK_SIZE].Define(i % BOUNDING_BOX_BLOCK_SIZE, drawables_[i]->GetWorldBoundingBox());
+        // Fill the unused end of the last block
+        for (unsigned i = numDrawables; i < numBlocks * BOUNDING_BOX_BLOCK_SIZE; ++i)
+            drawableBounds_[i / BOUNDING_BOX_BLOCK_SIZE].Define(i % BOUNDING_BOX_BLOCK_SIZE, BoundingBox(0.0f, 0.0f));
+
+        drawableBoundsDirty_ = false;
+        // The queued reinsertions have been processed before the update, and the blocks now match the drawables
+        reinsertionQueued_ = false;
+    }
+
+    // Descend only into the branches that have been marked dirty
+    if (childBoundsDirty_)
+    {
+        for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        {
+            Octant* child = children_[i];
+            if (child && (child->drawableBoundsDirty_ || child->childBoundsDirty_))
+                child->UpdateDrawableBounds();
+        }
+
+        childBoundsDirty_ = false;
+    }
 }
 
-void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
+void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const
 {
     if (this != root_)
     {
@@ -262,17 +411,55 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
         }
     }
 
+    TestDrawablesInternal(query, inside, result);
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        if (children_[i])
+            children_[i]->GetDrawablesInternal(query, inside, result);
+    }
+}
+
+void Octant::TestDrawablesInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const
+{
     if (drawables_.Size())
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        if (!drawableBoundsDirty_ && !reinsertionQueued_)
+            query.TestDrawableBounds(start, end, &drawableBounds_[0], inside, result);
+        else
+            query.TestDrawables(start, end, inside, result);
+    }
+}
+
+void Octant::GetQuerySubtrees(OctreeQuery& query, bool inside, unsigned maxDrawables, PODVector<OctreeQuerySubtree>& subtrees)
+    const
+{
+    // Query small enough branches whole in one subtree
+    if (numDrawables_ <= maxDrawables)
+    {
+        subtrees.Push(OctreeQuerySubtree(this, inside, true, numDrawables_));
+        return;
+    }
+
+    if (this != root_)
+    {
+        Intersection res = query.TestOctant(cullingBox_, inside);
+        if (res == INSIDE)
+            inside = true;
+        else if (res == OUTSIDE)
+            return;
     }
 
+    // Keep the subtrees in the same order as a single-threaded query would return the drawables
+    if (drawables_.Size())
+        subtrees.Push(OctreeQuerySubtree(this, inside, false, drawables_.Size()));
+
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
     {
         if (children_[i])
-            children_[i]->GetDrawablesInternal(query, inside);
+            children_[i]->GetQuerySubtrees(query, inside, maxDrawables, subtrees);
     }
 }
 
@@ -330,10 +517,67 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
     }
 }
 
+void Octant::GetDrawablesInternal(RayQueryPacket& packet) const
+{
+    // Skip if no ray of the packet hits the octant closer than its closest hit so far
+    unsigned activeMask = 0;
+    for (unsigned i = 0; i < packet.numQueries_; ++i)
+    {
+        if (packet.queries_[i]->ray_.HitDistance(cullingBox_) < packet.closest_[i])
+            activeMask |= 1 << i;
+    }
+    if (!activeMask)
+        return;
+
+    if (drawables_.Size())
+    {
+        unsigned numDrawables = drawables_.Size();
+
+        for (unsigned i = 0; i < packet.numQueries_; ++i)
+        {
+            if (!(activeMask & (1 << i)))
+                continue;
+
+            const Ray& ray = packet.queries_[i]->ray_;
+            if (!drawableBoundsDirty_ && !reinsertionQueued_)
+            {
+                // Test the bounding boxes four at a time, then the drawables that were hit
+                packet.distances_.Resize(drawableBounds_.Size() * BOUNDING_BOX_BLOCK_SIZE);
+                ray.HitDistanceFast(&drawableBounds_[0], drawableBounds_.Size(), &packet.distances_[0]);
+                for (unsigned j = 0; j < numDrawables; ++j)
+                {
+                    if (packet.distances_[j] < packet.closest_[i])
+                        ProcessRayQueryPacket(packet, i, drawables_[j]);
+                }
+            }
+            else
+            {
+                for (unsigned j = 0; j < numDrawables; ++j)
+                {
+                    if (ray.HitDistance(drawables_[j]->GetWorldBoundingBox()) < packet.closest_[i])
+                        ProcessRayQueryPacket(packet, i, drawables_[j]);
+                }
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+    {
+        Octant* child = children_[i ^ packet.childOrder_];
+        if (child)
+            child->GetDrawablesInternal(packet);
+    }
+}
+
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    changeSerial_(0),
+    updateChangeSerial_(0),
+    forgottenChangeSerial_(0),
+    threadedQuery_(0),
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    looseness_(DEFAULT_OCTREE_LOOSENESS)
 {
     // Resize threaded ray query intermediate result vector according to number of worker threads
     WorkQueue* workQueue = GetSubsystem<WorkQueue>();
@@ -356,6 +600,7 @@ void Octree::RegisterObject(Context* context)
     ATTRIBUTE(Octree, VAR_VECTOR3, "Bounding Box Min", worldBoundingBox_.min_, defaultBoundsMin, AM_DEFAULT);
     ATTRIBUTE(Octree, VAR_VECTOR3, "Bounding Box Max", worldBoundingBox_.max_, defaultBoundsMax, AM_DEFAULT);
     ATTRIBUTE(Octree, VAR_INT, "Number of Levels", numLevels_, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    ATTRIBUTE(Octree, VAR_FLOAT, "Looseness", looseness_, DEFAULT_OCTREE_LOOSENESS, AM_DEFAULT);
 }
 
 void Octree::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
@@ -383,13 +628,31 @@ void Octree::Resize(const BoundingBox& box, unsigned numLevels)
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
         DeleteChild(i);
 
-    Initialize(box);
-    numDrawables_ = drawables_.Size();
     numLevels_ = Max((int)numLevels, 1);
+    looseness_ = Max(looseness_, 1.25f);
+    Initialize(box, looseness_);
+    numDrawables_ = drawables_.Size();
+}
+
+void Octree::SetLooseness(float looseness)
+{
+    looseness_ = looseness;
+    Resize(worldBoundingBox_, numLevels_);
 }
 
 void Octree::Update(const FrameInfo& frame)
 {
+    // Forget the changes made before the previous update, as the views have already checked against them
+    unsigned numChanges = 0;
+    for (unsigned i = 0; i < changes_.Size(); ++i)
+    {
+        if (changes_[i].serial_ > updateChangeSerial_)
+            changes_[numChanges++] = changes_[i];
+    }
+    changes_.Resize(numChanges);
+    forgottenChangeSerial_ = updateChangeSerial_;
+    updateChangeSerial_ = changeSerial_;
+
     UpdateDrawables(frame);
 
     // Notify drawable update being finished. Custom animation (eg. IK) can be done at this point
@@ -405,6 +668,11 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     ReinsertDrawables(frame);
+
+    {
+        PROFILE(UpdateDrawableBounds);
+        UpdateDrawableBounds();
+    }
 }
 
 void Octree::AddManualDrawable(Drawable* drawable)
@@ -413,6 +681,7 @@ void Octree::AddManualDrawable(Drawable* drawable)
         return;
 
     AddDrawable(drawable);
+    MarkChanged(drawable->GetWorldBoundingBox());
 }
 
 void Octree::RemoveManualDrawable(Drawable* drawable)
@@ -422,13 +691,64 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
 
     Octant* octant = drawable->GetOctant();
     if (octant && octant->GetRoot() == this)
+    {
+        MarkChanged(octant);
         octant->RemoveDrawable(drawable);
+    }
 }
 
-void Octree::GetDrawables(OctreeQuery& query) const
+void Octree::GetDrawables(OctreeQuery& query, bool threaded) const
 {
     query.result_.Clear();
-    GetDrawablesInternal(query, false);
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    unsigned numThreads = queue ? queue->GetNumThreads() : 0;
+
+    // If no worker threads or too few drawables to justify threading, do not create work items
+    if (!threaded || !numThreads || numDrawables_ < 2 * MIN_DRAWABLES_PER_QUERY_WORK_ITEM)
+    {
+        GetDrawablesInternal(query, false, query.result_);
+        return;
+    }
+
+    // Test the upper octants in the main thread until the branches are small enough, then query them in worker threads
+    unsigned maxDrawables = numDrawables_ / ((numThreads + 1) * QUERY_WORK_ITEMS_PER_THREAD);
+    if (maxDrawables < MIN_DRAWABLES_PER_QUERY_WORK_ITEM)
+        maxDrawables = MIN_DRAWABLES_PER_QUERY_WORK_ITEM;
+    threadedQuery_ = &query;
+    querySubtrees_.Clear();
+    GetQuerySubtrees(query, false, maxDrawables, querySubtrees_);
+    if (querySubtreeResults_.Size() < querySubtrees_.Size())
+        querySubtreeResults_.Resize(querySubtrees_.Size());
+
+    WorkItem item;
+    item.workFunction_ = GetDrawablesWork;
+    item.aux_ = const_cast<Octree*>(this);
+
+    // Combine consecutive small subtrees into one work item
+    PODVector<OctreeQuerySubtree>::Iterator start = querySubtrees_.Begin();
+    while (start != querySubtrees_.End())
+    {
+        PODVector<OctreeQuerySubtree>::Iterator end = start;
+        unsigned numDrawables = 0;
+        while (end != querySubtrees_.End() && numDrawables < maxDrawables)
+        {
+            numDrawables += end->numDrawables_;
+            ++end;
+        }
+
+        item.start_ = &(*start);
+        item.end_ = &(*end);
+        queue->AddWorkItem(item);
+
+        start = end;
+    }
+
+    // Merge the subtree results in order
+    queue->Complete(M_MAX_UNSIGNED);
+    for (unsigned i = 0; i < querySubtrees_.Size(); ++i)
+        query.result_.Insert(query.result_.End(), querySubtreeResults_[i].Begin(), querySubtreeResults_[i].End());
+    threadedQuery_ = 0;
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -528,6 +848,68 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
     }
 }
 
+void Octree::RaycastSingle(const PODVector<RayOctreeQuery*>& queries) const
+{
+    if (queries.Empty())
+        return;
+
+    PROFILE(RaycastBatch);
+
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    RayOctreeQuery** start = const_cast<RayOctreeQuery**>(&queries[0]);
+    RayOctreeQuery** end = start + queries.Size();
+    int raysPerWorkItem = RAY_PACKETS_PER_WORK_ITEM * RAY_PACKET_SIZE;
+
+    // If no worker threads or too few rays to justify threading, do not create work items
+    if (!queue->GetNumThreads() || end - start <= raysPerWorkItem)
+        RaycastPackets(start, end);
+    else
+    {
+        WorkItem item;
+        item.workFunction_ = RaycastPacketsWork;
+        item.aux_ = const_cast<Octree*>(this);
+
+        while (start != end)
+        {
+            RayOctreeQuery** itemEnd = end;
+            if (itemEnd - start > raysPerWorkItem)
+                itemEnd = start + raysPerWorkItem;
+
+            item.start_ = start;
+            item.end_ = itemEnd;
+            queue->AddWorkItem(item);
+
+            start = itemEnd;
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+}
+
+void Octree::RaycastPackets(RayOctreeQuery** start, RayOctreeQuery** end) const
+{
+    RayQueryPacket packet;
+
+    while (start != end)
+    {
+        packet.numQueries_ = Min((int)(end - start), (int)RAY_PACKET_SIZE);
+        for (unsigned i = 0; i < packet.numQueries_; ++i)
+        {
+            RayOctreeQuery* query = start[i];
+            query->result_.Clear();
+            packet.queries_[i] = query;
+            packet.closest_[i] = query->maxDistance_;
+        }
+
+        // Visit the child octants nearest first, so that the closest hits are likely found early
+        const Vector3& direction = start[0]->ray_.direction_;
+        packet.childOrder_ = (direction.x_ < 0.0f ? 1 : 0) | (direction.y_ < 0.0f ? 2 : 0) | (direction.z_ < 0.0f ? 4 : 0);
+
+        GetDrawablesInternal(packet);
+        start += packet.numQueries_;
+    }
+}
+
 void Octree::QueueUpdate(Drawable* drawable)
 {
     drawableUpdates_.Push(WeakPtr<Drawable>(drawable));
@@ -536,16 +918,71 @@ void Octree::QueueUpdate(Drawable* drawable)
 
 void Octree::QueueReinsertion(Drawable* drawable)
 {
-    Scene* scene = GetScene();
-    if (scene && scene->IsThreadedUpdate())
+    // Besides the threaded scene update, drawables queue themselves from the worker threads that process the views, when
+    // their bounding box changes during UpdateBatches() or UpdateGeometry(). Until the reinsertion, queries must test the
+    // drawable's own bounding box instead of its octant's bounding box blocks
+    MutexLock lock(octreeMutex_);
+    drawableReinsertions_.Push(WeakPtr<Drawable>(drawable));
+    drawable->reinsertionQueued_ = true;
+    if (drawable->GetOctant())
+        drawable->GetOctant()->MarkReinsertionQueued();
+}
+
+void Octree::MarkChanged(const BoundingBox& box)
+{
+    ++changeSerial_;
+
+    // If there are too many changes, merge into the latest to keep the checks fast
+    if (changes_.Size() < MAX_OCTREE_CHANGES)
     {
-        MutexLock lock(octreeMutex_);
-        drawableReinsertions_.Push(WeakPtr<Drawable>(drawable));
+        OctreeChange change;
+        change.box_ = box;
+        change.serial_ = changeSerial_;
+        changes_.Push(change);
     }
     else
-        drawableReinsertions_.Push(WeakPtr<Drawable>(drawable));
+    {
+        OctreeChange& change = changes_.Back();
+        change.box_.Merge(box);
+        change.serial_ = changeSerial_;
+    }
+}
 
-    drawable->reinsertionQueued_ = true;
+void Octree::MarkChanged(Octant* octant)
+{
+    // Drawables in the root octant may extend outside its culling box, so the region is unbounded
+    if (octant == this)
+        MarkChanged(BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE));
+    else
+        MarkChanged(octant->GetCullingBox());
+}
+
+bool Octree::HasChanged(const Frustum& frustum, unsigned serial) const
+{
+    if (serial < forgottenChangeSerial_)
+        return true;
+
+    for (PODVector<OctreeChange>::ConstIterator i = changes_.Begin(); i != changes_.End(); ++i)
+    {
+        if (i->serial_ > serial && frustum.IsInsideFast(i->box_) != OUTSIDE)
+            return true;
+    }
+
+    return false;
+}
+
+bool Octree::HasChanged(const Sphere& sphere, unsigned serial) const
+{
+    if (serial < forgottenChangeSerial_)
+        return true;
+
+    for (PODVector<OctreeChange>::ConstIterator i = changes_.Begin(); i != changes_.End(); ++i)
+    {
+        if (i->serial_ > serial && sphere.IsInsideFast(i->box_) != OUTSIDE)
+            return true;
+    }
+
+    return false;
 }
 
 void Octree::DrawDebugGeometry(bool depthTest)
@@ -600,34 +1037,80 @@ void Octree::ReinsertDrawables(const FrameInfo& frame)
 
     PROFILE(ReinsertToOctree);
 
-    for (Vector<WeakPtr<Drawable> >::Iterator i = drawableReinsertions_.Begin(); i != drawableReinsertions_.End(); ++i)
+    // Find the target octants in worker threads. The octree is not modified during this, so the search stops at the first
+    // missing child octant
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    reinsertionOctants_.Resize(drawableReinsertions_.Size());
+
+    WorkItem item;
+    item.workFunction_ = ReinsertDrawablesWork;
+    item.aux_ = this;
+
+    Vector<WeakPtr<Drawable> >::Iterator start = drawableReinsertions_.Begin();
+    while (start != drawableReinsertions_.End())
     {
-        Drawable* drawable = *i;
+        Vector<WeakPtr<Drawable> >::Iterator end = drawableReinsertions_.End();
+        if (end - start > REINSERTIONS_PER_WORK_ITEM)
+            end = start + REINSERTIONS_PER_WORK_ITEM;
+
+        item.start_ = &(*start);
+        item.end_ = &(*end);
+        queue->AddWorkItem(item);
+
+        start = end;
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+
+    // Then link the drawables to their new octants in the main thread, creating the missing child octants. Add to all new
+    // octants first and remove from the old octants only after that, because drawable count going to zero deletes the
+    // octree branch in question
+    for (unsigned i = 0; i < drawableReinsertions_.Size(); ++i)
+    {
+        Drawable* drawable = drawableReinsertions_[i];
         if (!drawable)
             continue;
 
         drawable->reinsertionQueued_ = false;
-        Octant* octant = drawable->GetOctant();
-        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        Octant* oldOctant = drawable->GetOctant();
+        // The drawable has moved or changed inside its old octant's culling box. Its bounding box is also refreshed to the
+        // old octant's bounding box blocks here in the main thread, as it may have changed in a worker thread
+        if (oldOctant && oldOctant->GetRoot() == this)
+        {
+            MarkChanged(oldOctant);
+            oldOctant->MarkDrawableBoundsDirty();
+        }
 
-        // Skip if no octant or does not belong to this octree anymore
-        if (!octant || octant->GetRoot() != this)
+        Octant* octant = reinsertionOctants_[i];
+        if (!octant)
             continue;
-        // Skip if still fits the current octant
-        if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+
+        octant = octant->GetInsertionOctant(drawable, true);
+        if (octant == oldOctant)
+        {
+            reinsertionOctants_[i] = 0;
             continue;
+        }
 
-        InsertDrawable(drawable);
+        octant->AddDrawable(drawable);
+        MarkChanged(drawable->GetWorldBoundingBox());
+        reinsertionOctants_[i] = oldOctant;
 
         #ifdef _DEBUG
         // Verify that the drawable will be culled correctly
-        octant = drawable->GetOctant();
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
         if (octant != this && octant->GetCullingBox().IsInside(box) != INSIDE)
             LOGERROR("Drawable is not fully inside its octant's culling bounds: drawable box " + box.ToString() + " octant box " +
                 octant->GetCullingBox().ToString());
         #endif
     }
 
+    for (unsigned i = 0; i < drawableReinsertions_.Size(); ++i)
+    {
+        if (reinsertionOctants_[i])
+            reinsertionOctants_[i]->RemoveDrawable(drawableReinsertions_[i], false);
+    }
+
     drawableReinsertions_.Clear();
 }
 
@@ -30,14 +30,66 @@
 namespace Urho3D
 {
 
+class Octant;
 class Octree;
 
 static const int NUM_OCTANTS = 8;
 static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
+static const unsigned RAY_PACKET_SIZE = 4;
+
+/// Part of the octree that is queried in one work item of a threaded octree query.
+struct OctreeQuerySubtree
+{
+    /// Construct.
+    OctreeQuerySubtree(const Octant* octant, bool inside, bool recursive, unsigned numDrawables) :
+        octant_(octant),
+        inside_(inside),
+        recursive_(recursive),
+        numDrawables_(numDrawables)
+    {
+    }
+    
+    /// Octant.
+    const Octant* octant_;
+    /// Whether the parent octant is fully inside, or if not recursive, whether the octant is fully inside.
+    bool inside_;
+    /// Whether to query the child octants too. If false, the octant has already been tested and only its drawables are queried.
+    bool recursive_;
+    /// Number of drawables to query.
+    unsigned numDrawables_;
+};
+
+/// Region of an octree where drawable objects have been added, moved or removed.
+struct OctreeChange
+{
+    /// Bounding box of the region.
+    BoundingBox box_;
+    /// Change serial number.
+    unsigned serial_;
+};
+
+/// Ray queries that traverse the octree together in a batched raycast.
+struct RayQueryPacket
+{
+    /// Queries.
+    RayOctreeQuery* queries_[RAY_PACKET_SIZE];
+    /// Closest hit distance so far for each query.
+    float closest_[RAY_PACKET_SIZE];
+    /// Number of queries.
+    unsigned numQueries_;
+    /// Child octant visiting order, nearest first along the first query's ray.
+    unsigned childOrder_;
+    /// Hit distances to the bounding box blocks of an octant.
+    PODVector<float> distances_;
+    /// Results of a single drawable.
+    PODVector<RayQueryResult> results_;
+};
 
 /// %Octree octant
 class URHO3D_API Octant
 {
+    friend void GetDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    
 public:
     /// Construct.
     Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index = ROOT_INDEX);
@@ -50,6 +102,8 @@ public:
     void DeleteChild(unsigned index);
     /// Insert a drawable object by checking for fit recursively.
     void InsertDrawable(Drawable* drawable);
+    /// Return the octant a drawable object should be inserted to, by checking for fit recursively starting from this octant. If create is false, does not create child octants but returns the last existing octant on the way. Does not modify the octree if create is false.
+    Octant* GetInsertionOctant(Drawable* drawable, bool create);
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
     
@@ -58,6 +112,7 @@ public:
     {
         drawable->SetOctant(this);
         drawables_.Push(drawable);
+        MarkDrawableBoundsDirty();
         IncDrawableCount();
     }
     
@@ -68,10 +123,22 @@ public:
         {
             if (resetOctant)
                 drawable->SetOctant(0);
+            MarkDrawableBoundsDirty();
             DecDrawableCount();
         }
     }
     
+    /// Mark the drawable objects' bounding box blocks as needing an update. Until updated, queries test the drawable objects' own bounding boxes. Call only from the main thread; a drawable object whose bounding box changes queues itself for reinsertion instead, which marks its octant so that queries test the own bounding boxes until then.
+    void MarkDrawableBoundsDirty()
+    {
+        drawableBoundsDirty_ = true;
+        for (Octant* octant = parent_; octant && !octant->childBoundsDirty_; octant = octant->parent_)
+            octant->childBoundsDirty_ = true;
+    }
+    
+    /// Mark that a drawable object of this octant has been queued for reinsertion, so its bounding box may no longer match the bounding box blocks. Until the blocks are updated, queries test the drawable objects' own bounding boxes. Called with the octree mutex held, also from worker threads.
+    void MarkReinsertionQueued() { reinsertionQueued_ = true; }
+    
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
     /// Return bounding box used for fitting drawable objects.
@@ -93,14 +160,22 @@ public:
     void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
     
 protected:
-    /// Initialize bounding box.
-    void Initialize(const BoundingBox& box);
+    /// Initialize bounding box and the culling box enlarged by looseness.
+    void Initialize(const BoundingBox& box, float looseness);
+    /// Update the drawable objects' bounding box blocks recursively.
+    void UpdateDrawableBounds();
     /// Return drawable objects by a query, called internally.
-    void GetDrawablesInternal(OctreeQuery& query, bool inside) const;
+    void GetDrawablesInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const;
+    /// Return drawable objects of this octant only by a query, called internally.
+    void TestDrawablesInternal(OctreeQuery& query, bool inside, PODVector<Drawable*>& result) const;
+    /// Split a threaded query into subtrees of at most the given number of drawables, called internally.
+    void GetQuerySubtrees(OctreeQuery& query, bool inside, unsigned maxDrawables, PODVector<OctreeQuerySubtree>& subtrees) const;
     /// Return drawable objects by a ray query, called internally.
     void GetDrawablesInternal(RayOctreeQuery& query) const;
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+    /// Return the closest drawable objects by a packet of ray queries, called internally.
+    void GetDrawablesInternal(RayQueryPacket& packet) const;
     
     /// Increase drawable object count recursively.
     void IncDrawableCount()
@@ -132,6 +207,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// Drawable objects' world bounding boxes in blocks for testing several at once.
+    PODVector<BoundingBoxBlock> drawableBounds_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -148,12 +225,21 @@ protected:
     Octree* root_;
     /// Octant index relative to its siblings or ROOT_INDEX for root octant
     unsigned index_;
+    /// Drawable bounding box blocks dirty flag.
+    bool drawableBoundsDirty_;
+    /// Child octants' drawable bounding box blocks dirty flag.
+    bool childBoundsDirty_;
+    /// Drawable object reinsertion queued flag.
+    bool reinsertionQueued_;
 };
 
 /// %Octree component. Should be added only to the root scene node
 class URHO3D_API Octree : public Component, public Octant
 {
     friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void RaycastPacketsWork(const WorkItem* item, unsigned threadIndex);
+    friend void ReinsertDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void GetDrawablesWork(const WorkItem* item, unsigned threadIndex);
     
     OBJECT(Octree);
     
@@ -172,6 +258,8 @@ public:
     
     /// Resize octree. If octree is not empty, drawable objects will be temporarily moved to the root.
     void Resize(const BoundingBox& box, unsigned numLevels);
+    /// Set size of the octants' culling boxes relative to the octants, minimum 1.25 and default 2. Drawable objects stay in their octant while inside its culling box, so a looser octree reinserts moving objects less often, but the queries test more objects. If octree is not empty, drawable objects will be temporarily moved to the root.
+    void SetLooseness(float looseness);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -179,42 +267,76 @@ public:
     /// Remove a manually added drawable.
     void RemoveManualDrawable(Drawable* drawable);
     
-    /// Return drawable objects by a query.
-    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects by a query. If threaded, splits the octree into subtrees queried in worker threads, which requires the query's tests to be thread-safe. Threaded queries must be made from the main thread.
+    void GetDrawables(OctreeQuery& query, bool threaded = false) const;
     /// Return drawable objects by a ray query.
     void Raycast(RayOctreeQuery& query) const;
     /// Return the closest drawable object by a ray query.
     void RaycastSingle(RayOctreeQuery& query) const;
+    /// Return the closest drawable object by each of several ray queries. The queries are processed in packets of four, which traverse the octree together, and the packets are processed in worker threads. Coherent rays, for example with nearby origins, should be consecutive.
+    void RaycastSingle(const PODVector<RayOctreeQuery*>& queries) const;
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
+    /// Return size of the octants' culling boxes relative to the octants.
+    float GetLooseness() const { return looseness_; }
     
     /// Mark drawable object as requiring an update.
     void QueueUpdate(Drawable* drawable);
     /// Mark drawable object as requiring a reinsertion. Is thread-safe.
     void QueueReinsertion(Drawable* drawable);
+    /// Record a region where drawable objects have been added, moved or removed. Used to check whether cached query results are still valid.
+    void MarkChanged(const BoundingBox& box);
+    /// Record the region of an octant from which drawable objects have been moved or removed.
+    void MarkChanged(Octant* octant);
+    /// Return whether drawable objects have been added, moved or removed inside a frustum after a change serial number.
+    bool HasChanged(const Frustum& frustum, unsigned serial) const;
+    /// Return whether drawable objects have been added, moved or removed inside a sphere after a change serial number.
+    bool HasChanged(const Sphere& sphere, unsigned serial) const;
+    /// Return serial number of the latest change.
+    unsigned GetChangeSerial() const { return changeSerial_; }
     /// Visualize the component as debug geometry.
     void DrawDebugGeometry(bool depthTest);
     
 private:
     /// Update drawable objects marked for update. Updates are executed in worker threads.
     void UpdateDrawables(const FrameInfo& frame);
-    /// Reinsert moved drawable objects into the octree.
+    /// Reinsert moved drawable objects into the octree. The target octants are found in worker threads.
     void ReinsertDrawables(const FrameInfo& frame);
+    /// Return the closest drawable objects by ray queries in packets, called internally.
+    void RaycastPackets(RayOctreeQuery** start, RayOctreeQuery** end) const;
     
     /// Drawable objects that require update.
     Vector<WeakPtr<Drawable> > drawableUpdates_;
     /// Drawable objects that require reinsertion.
     Vector<WeakPtr<Drawable> > drawableReinsertions_;
-    /// Mutex for octree reinsertions.
+    /// Target octants found for the reinsertions, then the octants to remove the reinserted drawable objects from.
+    PODVector<Octant*> reinsertionOctants_;
+    /// Mutex for octree reinsertions, which may be queued from worker threads.
     Mutex octreeMutex_;
+    /// Regions where drawable objects have changed since the start of the previous update.
+    PODVector<OctreeChange> changes_;
+    /// Serial number of the latest change.
+    unsigned changeSerial_;
+    /// Serial number of the latest change at the start of the previous update.
+    unsigned updateChangeSerial_;
+    /// Serial number up to which changes have been forgotten.
+    unsigned forgottenChangeSerial_;
     /// Current threaded ray query.
     mutable RayOctreeQuery* rayQuery_;
     /// Drawable list for threaded ray query.
     mutable PODVector<Drawable*> rayQueryDrawables_;
     /// Threaded ray query intermediate results.
     mutable Vector<PODVector<RayQueryResult> > rayQueryResults_;
+    /// Current threaded query.
+    mutable OctreeQuery* threadedQuery_;
+    /// Subtrees of the threaded query.
+    mutable PODVector<OctreeQuerySubtree> querySubtrees_;
+    /// Threaded query results per subtree.
+    mutable Vector<PODVector<Drawable*> > querySubtreeResults_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Size of the octants' culling boxes relative to the octants.
+    float looseness_;
 };
 
 }
@@ -28,6 +28,8 @@
 namespace Urho3D
 {
 
+static const unsigned BOUNDING_BOX_BLOCKS_PER_BATCH = 64;
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -36,7 +38,7 @@ Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
         return box.IsInside(point_);
 }
 
-void PointOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside)
+void PointOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
 {
     while (start != end)
     {
@@ -45,7 +47,7 @@ void PointOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool insi
         if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
         {
             if (inside || drawable->GetWorldBoundingBox().IsInside(point_))
-                result_.Push(drawable);
+                result.Push(drawable);
         }
     }
 }
@@ -58,7 +60,7 @@ Intersection SphereOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
         return sphere_.IsInside(box);
 }
 
-void SphereOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside)
+void SphereOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
 {
     while (start != end)
     {
@@ -67,7 +69,7 @@ void SphereOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool ins
         if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
         {
             if (inside || sphere_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                result_.Push(drawable);
+                result.Push(drawable);
         }
     }
 }
@@ -80,7 +82,7 @@ Intersection BoxOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
         return box_.IsInside(box);
 }
 
-void BoxOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside)
+void BoxOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
 {
     while (start != end)
     {
@@ -89,7 +91,7 @@ void BoxOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside
         if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
         {
             if (inside || box_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                result_.Push(drawable);
+                result.Push(drawable);
         }
     }
 }
@@ -102,7 +104,7 @@ Intersection FrustumOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
         return frustum_.IsInside(box);
 }
 
-void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside)
+void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
 {
     while (start != end)
     {
@@ -111,8 +113,41 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
         if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
         {
             if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                result_.Push(drawable);
+                result.Push(drawable);
+        }
+    }
+}
+
+void FrustumOctreeQuery::TestDrawableBounds(Drawable** start, Drawable** end, const BoundingBoxBlock* bounds, bool inside,
+    PODVector<Drawable*>& result)
+{
+    if (inside)
+    {
+        TestDrawables(start, end, true, result);
+        return;
+    }
+    
+    unsigned char masks[BOUNDING_BOX_BLOCKS_PER_BATCH];
+    Drawable* visible[BOUNDING_BOX_BLOCKS_PER_BATCH * BOUNDING_BOX_BLOCK_SIZE];
+    
+    while (start != end)
+    {
+        // Test a batch of bounding box blocks, then let the drawable test filter the visible drawables by flags and view mask
+        unsigned numDrawables = Min((int)(end - start), (int)(BOUNDING_BOX_BLOCKS_PER_BATCH * BOUNDING_BOX_BLOCK_SIZE));
+        unsigned numBlocks = (numDrawables + BOUNDING_BOX_BLOCK_SIZE - 1) / BOUNDING_BOX_BLOCK_SIZE;
+        frustum_.IsInsideFast(bounds, numBlocks, masks);
+        
+        unsigned numVisible = 0;
+        for (unsigned i = 0; i < numDrawables; ++i)
+        {
+            if (masks[i / BOUNDING_BOX_BLOCK_SIZE] & (1 << (i % BOUNDING_BOX_BLOCK_SIZE)))
+                visible[numVisible++] = start[i];
         }
+        if (numVisible)
+            TestDrawables(&visible[0], &visible[numVisible], true, result);
+        
+        start += numDrawables;
+        bounds += numBlocks;
     }
 }
 
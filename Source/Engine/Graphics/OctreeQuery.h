@@ -51,10 +51,16 @@ public:
     {
     }
     
-    /// Intersection test for an octant.
+    /// Intersection test for an octant. In a threaded query is called from worker threads, so must not modify the query.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
-    /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables. Add the drawables that pass to the result vector, which in a threaded query is a per-subtree vector instead of result_. In a threaded query is called from worker threads, so must not modify the query.
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result) = 0;
+    /// Intersection test for drawables with their world bounding boxes in blocks. By default ignores the bounding box blocks.
+    virtual void TestDrawableBounds(Drawable** start, Drawable** end, const BoundingBoxBlock* bounds, bool inside,
+        PODVector<Drawable*>& result)
+    {
+        TestDrawables(start, end, inside, result);
+    }
     
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -79,7 +85,7 @@ public:
     /// Intersection test for an octant.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result);
     
     /// Point.
     Vector3 point_;
@@ -100,7 +106,7 @@ public:
     /// Intersection test for an octant.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result);
     
     /// Sphere.
     Sphere sphere_;
@@ -121,7 +127,7 @@ public:
     /// Intersection test for an octant.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result);
     
     /// Bounding box.
     BoundingBox box_;
@@ -142,7 +148,10 @@ public:
     /// Intersection test for an octant.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result);
+    /// Intersection test for drawables with their world bounding boxes in blocks. Tests several bounding boxes at once, then passes the drawables inside to TestDrawables().
+    virtual void TestDrawableBounds(Drawable** start, Drawable** end, const BoundingBoxBlock* bounds, bool inside,
+        PODVector<Drawable*>& result);
     
     /// Frustum.
     Frustum frustum_;
@@ -158,6 +158,7 @@ Graphics::Graphics(Context* context_) :
     vsync_(false),
     tripleBuffer_(false),
     sRGB_(false),
+    headless_(false),
     instancingSupport_(false),
     lightPrepassSupport_(false),
     deferredSupport_(false),
@@ -215,6 +216,12 @@ bool Graphics::SetMode(int width, int height, bool fullscreen, bool resizable, b
 {
     PROFILE(SetScreenMode);
     
+    if (headless_)
+    {
+        LOGERROR("Can not set screen mode in headless mode");
+        return false;
+    }
+    
     // Fullscreen can not be resizable
     if (fullscreen)
         resizable = false;
@@ -440,6 +447,44 @@ bool Graphics::SetMode(int width, int height)
     return SetMode(width, height, fullscreen_, resizable_, vsync_, tripleBuffer_, multiSample_);
 }
 
+bool Graphics::SetHeadlessMode(int width, int height)
+{
+    if (impl_->window_)
+    {
+        LOGERROR("Window already opened, can not set headless mode");
+        return false;
+    }
+    
+    if (width <= 0 || height <= 0)
+    {
+        width = 1024;
+        height = 768;
+    }
+    
+    headless_ = true;
+    width_ = width;
+    height_ = height;
+    fullscreen_ = false;
+    resizable_ = false;
+    
+    // There is no OpenGL context, so GPU objects keep only their CPU-side data. Report instancing as supported so that
+    // the renderer prepares instanced batches as on real hardware
+    instancingSupport_ = true;
+    
+    LOGINFO("Set headless mode " + String(width_) + "x" + String(height_));
+    
+    using namespace ScreenMode;
+    
+    VariantMap eventData;
+    eventData[P_WIDTH] = width_;
+    eventData[P_HEIGHT] = height_;
+    eventData[P_FULLSCREEN] = fullscreen_;
+    eventData[P_RESIZABLE] = resizable_;
+    SendEvent(E_SCREENMODE, eventData);
+    
+    return true;
+}
+
 void Graphics::SetSRGB(bool enable)
 {
     enable &= sRGBWriteSupport_;
@@ -458,6 +503,9 @@ bool Graphics::ToggleFullscreen()
 
 void Graphics::Close()
 {
+    // Headless mode has no window or context to release
+    headless_ = false;
+    
     if (!IsInitialized())
         return;
     
@@ -513,7 +561,7 @@ bool Graphics::BeginFrame()
 
 void Graphics::EndFrame()
 {
-    if (!IsInitialized())
+    if (!IsInitialized() || headless_)
         return;
     
     PROFILE(Present);
@@ -1781,7 +1829,7 @@ void Graphics::SetForceSM2(bool enable)
 
 bool Graphics::IsInitialized() const
 {
-    return impl_->window_ != 0;
+    return impl_->window_ != 0 || headless_;
 }
 
 bool Graphics::IsDeviceLost() const
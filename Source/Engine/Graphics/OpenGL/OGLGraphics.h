@@ -92,6 +92,8 @@ public:
     bool SetMode(int width, int height, bool fullscreen, bool resizable, bool vsync, bool tripleBuffer, int multiSample);
     /// Set screen resolution only. Return true if successful.
     bool SetMode(int width, int height);
+    /// Set headless mode with the given resolution, which runs the renderer's CPU-side work without a window or rendering device. Only effective before setting the initial screen mode. Return true if successful.
+    bool SetHeadlessMode(int width, int height);
     /// Set whether the main window uses sRGB conversion on write.
     void SetSRGB(bool enable);
     /// Toggle between full screen and windowed mode. Return true if successful.
@@ -215,6 +217,8 @@ public:
 
     /// Return whether rendering initialized.
     bool IsInitialized() const;
+    /// Return whether in headless mode.
+    bool IsHeadless() const { return headless_; }
     /// Return graphics implementation, which holds the actual API-specific resources.
     GraphicsImpl* GetImpl() const { return impl_; }
     /// Return OS-specific external window handle. Null if not in use.
@@ -434,6 +438,8 @@ private:
     bool tripleBuffer_;
     /// sRGB conversion on write flag for the main window.
     bool sRGB_;
+    /// Headless mode flag.
+    bool headless_;
     /// Instancing support flag.
     bool instancingSupport_;
     /// Light prepass support flag.
@@ -56,7 +56,7 @@ void Shader::RegisterObject(Context* context)
     context->RegisterFactory<Shader>();
 }
 
-bool Shader::Load(Deserializer& source)
+bool Shader::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadShader);
     
@@ -64,17 +64,31 @@ bool Shader::Load(Deserializer& source)
     if (!graphics)
         return false;
     
+    // Only parse the definition XML here, as processing the source code accesses the resource cache
+    loadXMLFile_ = new XMLFile(context_);
+    if (!loadXMLFile_->Load(source))
+    {
+        loadXMLFile_.Reset();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Shader::EndLoad()
+{
+    SharedPtr<XMLFile> xml = loadXMLFile_;
+    loadXMLFile_.Reset();
+    if (!xml)
+        return false;
+    
     vsSourceCodeLength_ = 0;
     psSourceCodeLength_ = 0;
     
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
-        return false;
-
     XMLElement shaders = xml->GetRoot("shaders");
     if (!shaders)
     {
-        LOGERROR("No shaders element in " + source.GetName());
+        LOGERROR("No shaders element in " + GetName());
         return false;
     }
     
@@ -30,6 +30,7 @@ namespace Urho3D
 {
 
 class ShaderVariation;
+class XMLFile;
 
 /// %Shader resource consisting of several shader variations.
 class URHO3D_API Shader : public Resource
@@ -44,8 +45,10 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
     
-    /// Load resource. Return true if successful.
-    virtual bool Load(Deserializer& source);
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    virtual bool EndLoad();
     
     /// Return a named variation. Return null if not found.
     ShaderVariation* GetVariation(ShaderType type, const String& name);
@@ -70,6 +73,8 @@ private:
     HashMap<StringHash, SharedPtr<ShaderVariation> > vsVariations_;
     /// Pixel shader variations.
     HashMap<StringHash, SharedPtr<ShaderVariation> > psVariations_;
+    /// Shader definition XML file used while loading.
+    SharedPtr<XMLFile> loadXMLFile_;
 };
 
 }
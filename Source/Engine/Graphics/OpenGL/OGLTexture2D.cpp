@@ -22,14 +22,17 @@
 
 #include "Precompiled.h"
 #include "Context.h"
+#include "FileSystem.h"
 #include "Graphics.h"
 #include "GraphicsEvents.h"
 #include "GraphicsImpl.h"
+#include "Image.h"
 #include "Log.h"
 #include "Profiler.h"
 #include "Renderer.h"
 #include "ResourceCache.h"
 #include "Texture2D.h"
+#include "XMLFile.h"
 
 #include "DebugNew.h"
 
@@ -52,7 +55,7 @@ void Texture2D::RegisterObject(Context* context)
     context->RegisterFactory<Texture2D>();
 }
 
-bool Texture2D::Load(Deserializer& source)
+bool Texture2D::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadTexture2D);
     
@@ -61,25 +64,52 @@ bool Texture2D::Load(Deserializer& source)
     if (!graphics)
         return true;
     
+    // Decode the image data for EndLoad()
+    loadImage_ = new Image(context_);
+    if (!loadImage_->Load(source))
+    {
+        loadImage_.Reset();
+        return false;
+    }
+    
+    // Get optional parameters from an XML description file
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    String xmlName = ReplaceExtension(GetName(), ".xml");
+    if (cache->Exists(xmlName))
+        loadParameters_ = cache->GetTempResource<XMLFile>(xmlName);
+    
+    return true;
+}
+
+bool Texture2D::EndLoad()
+{
+    // In headless mode, do not actually load the texture, just return success
+    if (!graphics_)
+        return true;
+    
+    PROFILE(UploadTexture2D);
+    
     // If device is lost, retry later
     if (graphics_->IsDeviceLost())
     {
         LOGWARNING("Texture load while device is lost");
         dataPending_ = true;
+        loadImage_.Reset();
+        loadParameters_.Reset();
         return true;
     }
     
     // If over the texture budget, see if materials can be freed to allow textures to be freed
     CheckTextureBudget(GetTypeStatic());
     
-    SharedPtr<Image> image(new Image(context_));
-    if (!image->Load(source))
-        return false;
+    // Before actually loading the texture, apply the optional parameters
+    LoadParameters(loadParameters_);
+    bool success = Load(loadImage_);
     
-    // Before actually loading the texture, get optional parameters from an XML description file
-    LoadParameters();
+    loadImage_.Reset();
+    loadParameters_.Reset();
     
-    return Load(image);
+    return success;
 }
 
 void Texture2D::OnDeviceLost()
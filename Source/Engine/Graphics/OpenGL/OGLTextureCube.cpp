@@ -242,7 +242,7 @@ bool TextureCube::SetData(CubeMapFace face, unsigned level, int x, int y, int wi
     return true;
 }
 
-bool TextureCube::Load(Deserializer& source)
+bool TextureCube::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadTextureCube);
     
@@ -253,30 +253,21 @@ bool TextureCube::Load(Deserializer& source)
     if (!graphics)
         return true;
     
-    // If device is lost, retry later
-    if (graphics_->IsDeviceLost())
-    {
-        LOGWARNING("Texture load while device is lost");
-        dataPending_ = true;
-        return true;
-    }
-    
-    // If over the texture budget, see if materials can be freed to allow textures to be freed
-    CheckTextureBudget(GetTypeStatic());
-    
     String texPath, texName, texExt;
     SplitPath(GetName(), texPath, texName, texExt);
     
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
+    loadParameters_ = new XMLFile(context_);
+    if (!loadParameters_->Load(source))
+    {
+        loadParameters_.Reset();
         return false;
+    }
     
-    LoadParameters(xml);
-    
-    XMLElement textureElem = xml->GetRoot();
+    // Decode the face images for EndLoad(). They are not stored to the resource cache
+    loadImages_.Clear();
+    XMLElement textureElem = loadParameters_->GetRoot();
     XMLElement faceElem = textureElem.GetChild("face");
-    unsigned faces = 0;
-    while (faceElem && faces < MAX_CUBEMAP_FACES)
+    while (faceElem && loadImages_.Size() < MAX_CUBEMAP_FACES)
     {
         String name = faceElem.GetAttribute("name");
         
@@ -286,9 +277,7 @@ bool TextureCube::Load(Deserializer& source)
         if (faceTexPath.Empty())
             name = texPath + name;
         
-        SharedPtr<Image> image(cache->GetResource<Image>(name));
-        Load((CubeMapFace)faces, image);
-        ++faces;
+        loadImages_.Push(cache->GetTempResource<Image>(name));
         
         faceElem = faceElem.GetNext("face");
     }
@@ -296,6 +285,37 @@ bool TextureCube::Load(Deserializer& source)
     return true;
 }
 
+bool TextureCube::EndLoad()
+{
+    // In headless mode, do not actually load the texture, just return success
+    if (!graphics_)
+        return true;
+    
+    PROFILE(UploadTextureCube);
+    
+    // If device is lost, retry later
+    if (graphics_->IsDeviceLost())
+    {
+        LOGWARNING("Texture load while device is lost");
+        dataPending_ = true;
+        loadImages_.Clear();
+        loadParameters_.Reset();
+        return true;
+    }
+    
+    // If over the texture budget, see if materials can be freed to allow textures to be freed
+    CheckTextureBudget(GetTypeStatic());
+    
+    LoadParameters(loadParameters_);
+    for (unsigned i = 0; i < loadImages_.Size(); ++i)
+        Load((CubeMapFace)i, loadImages_[i]);
+    
+    loadImages_.Clear();
+    loadParameters_.Reset();
+    
+    return true;
+}
+
 bool TextureCube::Load(CubeMapFace face, Deserializer& source)
 {
     PROFILE(LoadTextureCube);
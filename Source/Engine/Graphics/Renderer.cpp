@@ -279,6 +279,7 @@ Renderer::Renderer(Context* context) :
     drawShadows_(true),
     reuseShadowMaps_(true),
     dynamicInstancing_(true),
+    temporalCoherence_(false),
     shadersDirty_(true),
     initialized_(false)
 {
@@ -475,6 +476,11 @@ void Renderer::SetOccluderSizeThreshold(float screenSize)
     occluderSizeThreshold_ = Max(screenSize, 0.0f);
 }
 
+void Renderer::SetTemporalCoherence(bool enable)
+{
+    temporalCoherence_ = enable;
+}
+
 void Renderer::ReloadShaders()
 {
     shadersDirty_ = true;
@@ -552,6 +558,17 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
     return numOccluders;
 }
 
+CoherenceStatistics Renderer::GetCoherenceStatistics(bool allViews) const
+{
+    CoherenceStatistics stats;
+    unsigned lastView = allViews ? numViews_ : 1;
+    
+    for (unsigned i = 0; i < lastView; ++i)
+        stats += views_[i]->GetCoherenceStatistics();
+    
+    return stats;
+}
+
 void Renderer::Update(float timeStep)
 {
     PROFILE(UpdateViews);
@@ -559,8 +576,9 @@ void Renderer::Update(float timeStep)
     numViews_ = 0;
     
     // If device lost, do not perform update. This is because any dynamic vertex/index buffer updates happen already here,
-    // and if the device is lost, the updates queue up, causing memory use to rise constantly
-    if (!graphics_ || !graphics_->IsInitialized() || graphics_->IsDeviceLost())
+    // and if the device is lost, the updates queue up, causing memory use to rise constantly. In headless mode the device
+    // is always lost, but there are no GPU-side buffers to queue updates for
+    if (!graphics_ || !graphics_->IsInitialized() || (graphics_->IsDeviceLost() && !graphics_->IsHeadless()))
         return;
     
     // Set up the frameinfo structure for this frame
@@ -657,10 +675,22 @@ void Renderer::Update(float timeStep)
 void Renderer::Render()
 {
     // Engine does not render when window is closed or device is lost
-    assert(graphics_ && graphics_->IsInitialized() && !graphics_->IsDeviceLost());
+    assert(graphics_ && graphics_->IsInitialized() && (!graphics_->IsDeviceLost() || graphics_->IsHeadless()));
     
     PROFILE(RenderViews);
     
+    // In headless mode perform only the CPU-side part of rendering the views
+    if (graphics_->IsHeadless())
+    {
+        for (unsigned i = numViews_ - 1; i < numViews_; --i)
+            views_[i]->Render();
+        
+        numPrimitives_ = 0;
+        numBatches_ = 0;
+        RemoveUnusedBuffers();
+        return;
+    }
+    
     // If the indirection textures have lost content (OpenGL mode only), restore them now
     if (faceSelectCubeMap_ && faceSelectCubeMap_->IsDataLost())
         SetIndirectionTextureData();
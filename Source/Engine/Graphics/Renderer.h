@@ -49,6 +49,7 @@ class Texture2D;
 class TextureCube;
 class View;
 class Zone;
+struct CoherenceStatistics;
 
 static const int SHADOW_MIN_PIXELS = 64;
 static const int INSTANCING_BUFFER_DEFAULT_SIZE = 1024;
@@ -207,6 +208,8 @@ public:
     void SetOcclusionBufferSize(int size);
     /// Set required screen size (1.0 = full screen) for occluders.
     void SetOccluderSizeThreshold(float screenSize);
+    /// Set temporal coherence on/off. When on, views reuse the previous frame's occlusion buffer and light octree queries if the camera, the lights and the drawable objects inside them have not changed, and skip the occlusion test of objects that were visible on the previous frame, retesting them periodically. Default is off.
+    void SetTemporalCoherence(bool enable);
     /// Force reload of shaders.
     void ReloadShaders();
     
@@ -252,6 +255,8 @@ public:
     int GetOcclusionBufferSize() const { return occlusionBufferSize_; }
     /// Return occluder screen size threshold.
     float GetOccluderSizeThreshold() const { return occluderSizeThreshold_; }
+    /// Return whether temporal coherence is in use.
+    bool GetTemporalCoherence() const { return temporalCoherence_; }
     /// Return number of views rendered.
     unsigned GetNumViews() const { return numViews_; }
     /// Return number of primitives rendered.
@@ -266,6 +271,8 @@ public:
     unsigned GetNumShadowMaps(bool allViews = false) const;
     /// Return number of occluders rendered.
     unsigned GetNumOccluders(bool allViews = false) const;
+    /// Return temporal coherence hit and miss counts.
+    CoherenceStatistics GetCoherenceStatistics(bool allViews = false) const;
     /// Return the default zone.
     Zone* GetDefaultZone() const { return defaultZone_; }
     /// Return the directional light for fullscreen quad rendering.
@@ -491,6 +498,8 @@ private:
     bool reuseShadowMaps_;
     /// Dynamic instancing flag.
     bool dynamicInstancing_;
+    /// Temporal coherence flag.
+    bool temporalCoherence_;
     /// Shaders need reloading flag.
     bool shadersDirty_;
     /// Initialized flag.
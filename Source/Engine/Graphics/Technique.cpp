@@ -67,6 +67,25 @@ static const char* lightingModeNames[] =
     0
 };
 
+/// Flags of the pass attributes stored in a cooked technique.
+static const unsigned char COOKED_PASS_VS = 0x1;
+static const unsigned char COOKED_PASS_PS = 0x2;
+static const unsigned char COOKED_PASS_LIGHTING = 0x4;
+static const unsigned char COOKED_PASS_BLEND = 0x8;
+static const unsigned char COOKED_PASS_DEPTHTEST = 0x10;
+static const unsigned char COOKED_PASS_DEPTHWRITE = 0x20;
+static const unsigned char COOKED_PASS_ALPHAMASK = 0x40;
+
+/// Return the depth test mode of a technique XML pass element.
+static CompareMode GetDepthTestMode(const XMLElement& passElem)
+{
+    String depthTest = passElem.GetAttributeLower("depthtest");
+    if (depthTest == "false")
+        return CMP_ALWAYS;
+    else
+        return (CompareMode)GetStringListIndex(depthTest.CString(), compareModeNames, CMP_LESS);
+}
+
 Pass::Pass(StringHash type) :
     type_(type),
     blendMode_(BLEND_REPLACE),
@@ -150,10 +169,101 @@ void Technique::RegisterObject(Context* context)
     context->RegisterFactory<Technique>();
 }
 
-bool Technique::Load(Deserializer& source)
+bool Technique::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadTechnique);
     
+    // A cooked technique is recognized by its file ID, as an XML definition starts with text
+    unsigned start = source.GetPosition();
+    bool cooked = source.ReadFileID() == "UTEC";
+    source.Seek(start);
+    if (!(cooked ? LoadCooked(source) : LoadXML(source)))
+        return false;
+    
+    // Rehash the pass map to ensure minimum load factor and fast queries
+    passes_.Rehash(NextPowerOfTwo(passes_.Size()));
+    
+    // Calculate memory use
+    unsigned memoryUse = sizeof(Technique);
+    memoryUse += sizeof(HashMap<StringHash, SharedPtr<Pass> >) + passes_.Size() * sizeof(Pass);
+    
+    SetMemoryUse(memoryUse);
+    return true;
+}
+
+bool Technique::Cook(const XMLElement& source, Serializer& dest)
+{
+    if (source.IsNull())
+    {
+        LOGERROR("Can not cook technique from null XML element");
+        return false;
+    }
+    
+    dest.WriteFileID("UTEC");
+    dest.WriteUInt(COOKED_RESOURCE_VERSION);
+    
+    dest.WriteBool(source.HasAttribute("sm3"));
+    if (source.HasAttribute("sm3"))
+        dest.WriteBool(source.GetBool("sm3"));
+    
+    // Passes without a name are left out, like when loading the XML
+    unsigned numPasses = 0;
+    for (XMLElement passElem = source.GetChild("pass"); passElem; passElem = passElem.GetNext("pass"))
+    {
+        if (passElem.HasAttribute("name"))
+            ++numPasses;
+        else
+            LOGERROR("Missing pass name");
+    }
+    dest.WriteVLE(numPasses);
+    
+    for (XMLElement passElem = source.GetChild("pass"); passElem; passElem = passElem.GetNext("pass"))
+    {
+        if (!passElem.HasAttribute("name"))
+            continue;
+        
+        unsigned char flags = 0;
+        if (passElem.HasAttribute("vs"))
+            flags |= COOKED_PASS_VS;
+        if (passElem.HasAttribute("ps"))
+            flags |= COOKED_PASS_PS;
+        if (passElem.HasAttribute("lighting"))
+            flags |= COOKED_PASS_LIGHTING;
+        if (passElem.HasAttribute("blend"))
+            flags |= COOKED_PASS_BLEND;
+        if (passElem.HasAttribute("depthtest"))
+            flags |= COOKED_PASS_DEPTHTEST;
+        if (passElem.HasAttribute("depthwrite"))
+            flags |= COOKED_PASS_DEPTHWRITE;
+        if (passElem.HasAttribute("alphamask"))
+            flags |= COOKED_PASS_ALPHAMASK;
+        
+        dest.WriteString(passElem.GetAttribute("name"));
+        dest.WriteUByte(flags);
+        if (flags & COOKED_PASS_VS)
+            dest.WriteString(passElem.GetAttribute("vs"));
+        if (flags & COOKED_PASS_PS)
+            dest.WriteString(passElem.GetAttribute("ps"));
+        if (flags & COOKED_PASS_LIGHTING)
+        {
+            dest.WriteUByte(GetStringListIndex(passElem.GetAttributeLower("lighting").CString(), lightingModeNames,
+                LIGHTING_UNLIT));
+        }
+        if (flags & COOKED_PASS_BLEND)
+            dest.WriteUByte(GetStringListIndex(passElem.GetAttributeLower("blend").CString(), blendModeNames, BLEND_REPLACE));
+        if (flags & COOKED_PASS_DEPTHTEST)
+            dest.WriteUByte(GetDepthTestMode(passElem));
+        if (flags & COOKED_PASS_DEPTHWRITE)
+            dest.WriteBool(passElem.GetBool("depthwrite"));
+        if (flags & COOKED_PASS_ALPHAMASK)
+            dest.WriteBool(passElem.GetBool("alphamask"));
+    }
+    
+    return true;
+}
+
+bool Technique::LoadXML(Deserializer& source)
+{
     SharedPtr<XMLFile> xml(new XMLFile(context_));
     if (!xml->Load(source))
         return false;
@@ -190,13 +300,7 @@ bool Technique::Load(Deserializer& source)
             }
             
             if (passElem.HasAttribute("depthtest"))
-            {
-                String depthTest = passElem.GetAttributeLower("depthtest");
-                if (depthTest == "false")
-                    newPass->SetDepthTestMode(CMP_ALWAYS);
-                else
-                    newPass->SetDepthTestMode((CompareMode)GetStringListIndex(depthTest.CString(), compareModeNames, CMP_LESS));
-            }
+                newPass->SetDepthTestMode(GetDepthTestMode(passElem));
             
             if (passElem.HasAttribute("depthwrite"))
                 newPass->SetDepthWrite(passElem.GetBool("depthwrite"));
@@ -210,14 +314,46 @@ bool Technique::Load(Deserializer& source)
         passElem = passElem.GetNext("pass");
     }
     
-    // Rehash the pass map to ensure minimum load factor and fast queries
-    passes_.Rehash(NextPowerOfTwo(passes_.Size()));
+    return true;
+}
+
+bool Technique::LoadCooked(Deserializer& source)
+{
+    if (source.ReadFileID() != "UTEC")
+    {
+        LOGERROR(source.GetName() + " is not a valid cooked technique file");
+        return false;
+    }
+    if (source.ReadUInt() != COOKED_RESOURCE_VERSION)
+    {
+        LOGERROR(source.GetName() + " is of an unsupported cooked resource version");
+        return false;
+    }
     
-    // Calculate memory use
-    unsigned memoryUse = sizeof(Technique);
-    memoryUse += sizeof(HashMap<StringHash, SharedPtr<Pass> >) + passes_.Size() * sizeof(Pass);
+    if (source.ReadBool())
+        isSM3_ = source.ReadBool();
+    
+    unsigned numPasses = source.ReadVLE();
+    for (unsigned i = 0; i < numPasses; ++i)
+    {
+        Pass* newPass = CreatePass(StringHash(source.ReadString()));
+        unsigned char flags = source.ReadUByte();
+        if (flags & COOKED_PASS_VS)
+            newPass->SetVertexShader(source.ReadString());
+        if (flags & COOKED_PASS_PS)
+            newPass->SetPixelShader(source.ReadString());
+        if (flags & COOKED_PASS_LIGHTING)
+            newPass->SetLightingMode((PassLightingMode)source.ReadUByte());
+        if (flags & COOKED_PASS_BLEND)
+            newPass->SetBlendMode((BlendMode)source.ReadUByte());
+        if (flags & COOKED_PASS_DEPTHTEST)
+            newPass->SetDepthTestMode((CompareMode)source.ReadUByte());
+        if (flags & COOKED_PASS_DEPTHWRITE)
+            newPass->SetDepthWrite(source.ReadBool());
+        if (flags & COOKED_PASS_ALPHAMASK)
+            newPass->SetAlphaMask(source.ReadBool());
+    }
     
-    SetMemoryUse(memoryUse);
     return true;
 }
 
@@ -29,6 +29,7 @@ namespace Urho3D
 {
 
 class ShaderVariation;
+class XMLElement;
 
 /// Lighting mode of a pass.
 enum PassLightingMode
@@ -129,8 +130,11 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
     
-    /// Load resource. Return true if successful.
-    virtual bool Load(Deserializer& source);
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    
+    /// Convert a technique XML definition to the cooked binary format. Return true if successful.
+    static bool Cook(const XMLElement& source, Serializer& dest);
     
     /// Set whether requires %Shader %Model 3.
     void SetIsSM3(bool enable);
@@ -151,6 +155,11 @@ public:
     bool IsSM3() const { return isSM3_; }
     
 private:
+    /// Load from an XML definition. Return true if successful.
+    bool LoadXML(Deserializer& source);
+    /// Load from the cooked binary format. Return true if successful.
+    bool LoadCooked(Deserializer& source);
+    
     /// Require %Shader %Model 3 flag.
     bool isSM3_;
     /// Passes.
@@ -61,6 +61,7 @@ static const Vector3* directions[] =
 };
 
 static const int CHECK_DRAWABLES_PER_WORK_ITEM = 64;
+static const unsigned COHERENCE_RETEST_INTERVAL = 8;
 static const float LIGHT_INTENSITY_THRESHOLD = 0.003f;
 
 /// %Frustum octree query for shadowcasters.
@@ -75,7 +76,7 @@ public:
     }
     
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
     {
         while (start != end)
         {
@@ -85,7 +86,7 @@ public:
                 (drawable->GetViewMask() & viewMask_))
             {
                 if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
+                    result.Push(drawable);
             }
         }
     }
@@ -103,7 +104,7 @@ public:
     }
     
     /// Intersection test for drawables.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
     {
         while (start != end)
         {
@@ -114,7 +115,7 @@ public:
                 viewMask_))
             {
                 if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
+                    result.Push(drawable);
             }
         }
     }
@@ -147,7 +148,7 @@ public:
     }
     
     /// Intersection test for drawables. Note: drawable occlusion is performed later in worker threads.
-    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside)
+    virtual void TestDrawables(Drawable** start, Drawable** end, bool inside, PODVector<Drawable*>& result)
     {
         while (start != end)
         {
@@ -156,7 +157,7 @@ public:
             if ((drawable->GetDrawableFlags() & drawableFlags_) && (drawable->GetViewMask() & viewMask_))
             {
                 if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                    result_.Push(drawable);
+                    result.Push(drawable);
             }
         }
     }
@@ -174,18 +175,64 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
     const Matrix3x4& viewMatrix = view->camera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
     Vector3 absViewZ = viewZ.Abs();
+    bool temporalCoherence = buffer && view->temporalCoherence_;
+    CoherenceStatistics& stats = view->threadCoherenceStats_[threadIndex];
+    
+    Drawable* drawables[CHECK_DRAWABLES_PER_WORK_ITEM];
+    bool occlusionTested[CHECK_DRAWABLES_PER_WORK_ITEM];
+    BoundingBox occludeeBoxes[CHECK_DRAWABLES_PER_WORK_ITEM];
+    bool occludeeVisible[CHECK_DRAWABLES_PER_WORK_ITEM];
     
     while (start != end)
     {
-        Drawable* drawable = *start++;
-        drawable->UpdateBatches(view->frame_);
+        Drawable** batchEnd = end - start > CHECK_DRAWABLES_PER_WORK_ITEM ? start + CHECK_DRAWABLES_PER_WORK_ITEM : end;
+        unsigned numDrawables = 0;
+        unsigned numOccludees = 0;
+        
+        while (start != batchEnd)
+        {
+            Drawable* drawable = *start++;
+            drawable->UpdateBatches(view->frame_);
+            
+            // If draw distance non-zero, check it
+            float maxDistance = drawable->GetDrawDistance();
+            if (maxDistance > 0.0f && drawable->GetDistance() > maxDistance)
+                continue;
+            
+            drawables[numDrawables] = drawable;
+            occlusionTested[numDrawables] = buffer && drawable->IsOccludee();
+            if (temporalCoherence && occlusionTested[numDrawables])
+            {
+                // With temporal coherence, occludees that were visible on the previous frame are assumed to still be visible,
+                // except for a periodic retest staggered across the drawables
+                if (drawable->WasOcclusionVisible(view->frame_) && ((unsigned)((size_t)drawable >> 4) + view->frame_.frameNumber_) %
+                    COHERENCE_RETEST_INTERVAL)
+                {
+                    occlusionTested[numDrawables] = false;
+                    ++stats.visibilityHits_;
+                }
+                else
+                    ++stats.visibilityMisses_;
+            }
+            if (occlusionTested[numDrawables])
+                occludeeBoxes[numOccludees++] = drawable->GetWorldBoundingBox();
+            ++numDrawables;
+        }
+        
+        // Test the occludees against the occlusion buffer in one batch
+        if (numOccludees)
+            buffer->IsVisible(occludeeBoxes, numOccludees, occludeeVisible);
         
-        // If draw distance non-zero, check it
-        float maxDistance = drawable->GetDrawDistance();
-        if ((maxDistance <= 0.0f || drawable->GetDistance() <= maxDistance) && (!buffer || !drawable->IsOccludee() ||
-            buffer->IsVisible(drawable->GetWorldBoundingBox())))
+        unsigned occludeeIndex = 0;
+        for (unsigned i = 0; i < numDrawables; ++i)
         {
+            if (occlusionTested[i] && !occludeeVisible[occludeeIndex++])
+                continue;
+            
+            Drawable* drawable = drawables[i];
             drawable->MarkInView(view->frame_);
+            if (temporalCoherence && drawable->IsOccludee())
+                drawable->MarkOcclusionVisible(view->frame_);
             
             // For geometries, clear lights and calculate view space Z range
             if (drawable->GetDrawableFlags() & DRAWABLE_GEOMETRY)
@@ -261,7 +308,12 @@ View::View(Context* context) :
     cameraZone_(0),
     farClipZone_(0),
     renderTarget_(0),
-    tempDrawables_(GetSubsystem<WorkQueue>()->GetNumThreads() + 1)  // Create octree query vector for each thread
+    temporalCoherence_(false),
+    tempDrawables_(GetSubsystem<WorkQueue>()->GetNumThreads() + 1),  // Create octree query vector for each thread
+    coherentOcclusionFrameNumber_(0),
+    coherentOcclusionChangeSerial_(0),
+    coherentOcclusionTriangles_(0),
+    threadCoherenceStats_(tempDrawables_.Size())
 {
     frame_.camera_ = 0;
 }
@@ -449,8 +501,24 @@ void View::Update(const FrameInfo& frame)
     if (camera_->GetAutoAspectRatio())
         camera_->SetAspectRatio((float)frame_.viewSize_.x_ / (float)frame_.viewSize_.y_);
     
+    // Forget the previous frame's results if temporal coherence is disabled or the octree has changed
+    temporalCoherence_ = renderer_->GetTemporalCoherence();
+    if (!temporalCoherence_ || coherentOctree_.Get() != octree_)
+    {
+        coherentOctree_ = octree_;
+        coherentOcclusionBuffer_.Reset();
+        coherentOccluders_.Clear();
+        lightQueryCaches_.Clear();
+    }
+    for (unsigned i = 0; i < threadCoherenceStats_.Size(); ++i)
+        threadCoherenceStats_[i] = CoherenceStatistics();
+    
     GetDrawables();
     GetBatches();
+    
+    coherenceStats_ = CoherenceStatistics();
+    for (unsigned i = 0; i < threadCoherenceStats_.Size(); ++i)
+        coherenceStats_ += threadCoherenceStats_[i];
 }
 
 void View::Render()
@@ -461,70 +529,74 @@ void View::Render()
     // Actually update geometry data now
     UpdateGeometries();
     
-    // Allocate screen buffers as necessary
-    AllocateScreenBuffers();
-    
-    // Initialize screenbuffer indices to use for read and write (pingponging)
-    writeBuffer_ = 0;
-    readBuffer_ = 0;
-    
-    // Forget parameter sources from the previous view
-    graphics_->ClearParameterSources();
-    
     // If stream offset is supported, write all instance transforms to a single large buffer
     // Else we must lock the instance buffer for each batch group
     if (renderer_->GetDynamicInstancing() && graphics_->GetStreamOffsetSupport())
         PrepareInstancingBuffer();
     
-    // It is possible, though not recommended, that the same camera is used for multiple main views. Set automatic aspect ratio
-    // again to ensure correct projection will be used
-    if (camera_->GetAutoAspectRatio())
-        camera_->SetAspectRatio((float)(viewSize_.x_) / (float)(viewSize_.y_));
-    
-    // Bind the face selection and indirection cube maps for point light shadows
-    if (renderer_->GetDrawShadows())
+    // In headless mode there is no device to render with, so only the CPU-side preparation above is performed
+    if (!graphics_->IsHeadless())
     {
-        graphics_->SetTexture(TU_FACESELECT, renderer_->GetFaceSelectCubeMap());
-        graphics_->SetTexture(TU_INDIRECTION, renderer_->GetIndirectionCubeMap());
-    }
-    
-    // Set "view texture" to prevent destination texture sampling during all renderpasses
-    if (renderTarget_)
-    {
-        graphics_->SetViewTexture(renderTarget_->GetParentTexture());
+        // Allocate screen buffers as necessary
+        AllocateScreenBuffers();
+        
+        // Initialize screenbuffer indices to use for read and write (pingponging)
+        writeBuffer_ = 0;
+        readBuffer_ = 0;
+        
+        // Forget parameter sources from the previous view
+        graphics_->ClearParameterSources();
+        
+        // It is possible, though not recommended, that the same camera is used for multiple main views. Set automatic aspect ratio
+        // again to ensure correct projection will be used
+        if (camera_->GetAutoAspectRatio())
+            camera_->SetAspectRatio((float)(viewSize_.x_) / (float)(viewSize_.y_));
+        
+        // Bind the face selection and indirection cube maps for point light shadows
+        if (renderer_->GetDrawShadows())
+        {
+            graphics_->SetTexture(TU_FACESELECT, renderer_->GetFaceSelectCubeMap());
+            graphics_->SetTexture(TU_INDIRECTION, renderer_->GetIndirectionCubeMap());
+        }
+        
+        // Set "view texture" to prevent destination texture sampling during all renderpasses
+        if (renderTarget_)
+        {
+            graphics_->SetViewTexture(renderTarget_->GetParentTexture());
+            
+            // On OpenGL, flip the projection if rendering to a texture so that the texture can be addressed in the same way
+            // as a render texture produced on Direct3D9
+            #ifdef USE_OPENGL
+            camera_->SetFlipVertical(true);
+            #endif
+        }
+        
+        // Render
+        ExecuteRenderPathCommands();
         
-        // On OpenGL, flip the projection if rendering to a texture so that the texture can be addressed in the same way
-        // as a render texture produced on Direct3D9
         #ifdef USE_OPENGL
-        camera_->SetFlipVertical(true);
+        camera_->SetFlipVertical(false);
         #endif
-    }
-    
-    // Render
-    ExecuteRenderPathCommands();
-    
-    #ifdef USE_OPENGL
-    camera_->SetFlipVertical(false);
-    #endif
-    
-    graphics_->SetDepthBias(0.0f, 0.0f);
-    graphics_->SetScissorTest(false);
-    graphics_->SetStencilTest(false);
-    graphics_->SetViewTexture(0);
-    graphics_->ResetStreamFrequencies();
-    
-    // Run framebuffer blitting if necessary
-    if (screenBuffers_.Size() && currentRenderTarget_ != renderTarget_)
-        BlitFramebuffer(static_cast<Texture2D*>(currentRenderTarget_->GetParentTexture()), renderTarget_, true);
-    
-    // If this is a main view, draw the associated debug geometry now
-    if (!renderTarget_)
-    {
-        DebugRenderer* debug = octree_->GetComponent<DebugRenderer>();
-        if (debug)
+        
+        graphics_->SetDepthBias(0.0f, 0.0f);
+        graphics_->SetScissorTest(false);
+        graphics_->SetStencilTest(false);
+        graphics_->SetViewTexture(0);
+        graphics_->ResetStreamFrequencies();
+        
+        // Run framebuffer blitting if necessary
+        if (screenBuffers_.Size() && currentRenderTarget_ != renderTarget_)
+            BlitFramebuffer(static_cast<Texture2D*>(currentRenderTarget_->GetParentTexture()), renderTarget_, true);
+        
+        // If this is a main view, draw the associated debug geometry now
+        if (!renderTarget_)
         {
-            debug->SetView(camera_);
-            debug->Render();
+            DebugRenderer* debug = octree_->GetComponent<DebugRenderer>();
+            if (debug)
+            {
+                debug->SetView(camera_);
+                debug->Render();
+            }
         }
     }
     
@@ -621,22 +693,46 @@ void View::GetDrawables()
             PROFILE(DrawOcclusion);
             
             occlusionBuffer_ = renderer_->GetOcclusionBuffer(camera_);
-            DrawOccluders(occlusionBuffer_, occluders_);
+            
+            if (!temporalCoherence_)
+                DrawOccluders(occlusionBuffer_, occluders_);
+            else
+            {
+                // With temporal coherence, reuse the previous frame's occlusion buffer if the camera, the occluders and the
+                // drawable objects inside the view frustum have not changed
+                if (IsOcclusionCoherent())
+                    ++threadCoherenceStats_[0].occlusionHits_;
+                else
+                {
+                    DrawOccluders(occlusionBuffer_, occluders_);
+                    ++threadCoherenceStats_[0].occlusionMisses_;
+                }
+                
+                coherentOcclusionBuffer_ = occlusionBuffer_;
+                coherentOccluders_ = occluders_;
+                coherentOcclusionView_ = camera_->GetView();
+                coherentOcclusionProjection_ = camera_->GetProjection(false);
+                coherentOcclusionFrameNumber_ = frame_.frameNumber_;
+                coherentOcclusionChangeSerial_ = octree_->GetChangeSerial();
+                coherentOcclusionSize_ = IntVector2(occlusionBuffer_->GetWidth(), occlusionBuffer_->GetHeight());
+                coherentOcclusionTriangles_ = maxOccluderTriangles_;
+            }
         }
     }
     
-    // Get lights and geometries. Coarse occlusion for octants is used at this point
+    // Get lights and geometries. Coarse occlusion for octants is used at this point. Large octrees are queried in worker
+    // threads
     if (occlusionBuffer_)
     {
         OccludedFrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), occlusionBuffer_, DRAWABLE_GEOMETRY |
             DRAWABLE_LIGHT, camera_->GetViewMask());
-        octree_->GetDrawables(query);
+        octree_->GetDrawables(query, true);
     }
     else
     {
         FrustumOctreeQuery query(tempDrawables, camera_->GetFrustum(), DRAWABLE_GEOMETRY | DRAWABLE_LIGHT,
             camera_->GetViewMask());
-        octree_->GetDrawables(query);
+        octree_->GetDrawables(query, true);
     }
     
     // Check drawable occlusion and find zones for moved drawables in worker threads
@@ -744,6 +840,15 @@ void View::GetBatches()
         {
             LightQueryResult& query = lightQueryResults_[i];
             query.light_ = lights_[i];
+            query.queryCache_ = 0;
+            
+            // Create the light's query cache in the main thread, as the worker threads can not modify the container
+            if (temporalCoherence_)
+            {
+                LightQueryCache& cache = lightQueryCaches_[lights_[i]];
+                cache.frameNumber_ = frame_.frameNumber_;
+                query.queryCache_ = &cache;
+            }
             
             item.start_ = &query;
             queue->AddWorkItem(item);
@@ -751,6 +856,15 @@ void View::GetBatches()
         
         // Ensure all lights have been processed before proceeding
         queue->Complete(M_MAX_UNSIGNED);
+        
+        // Forget the queries of lights that are no longer visible
+        for (HashMap<Light*, LightQueryCache>::Iterator i = lightQueryCaches_.Begin(); i != lightQueryCaches_.End();)
+        {
+            if (i->second_.frameNumber_ != frame_.frameNumber_)
+                i = lightQueryCaches_.Erase(i);
+            else
+                ++i;
+        }
     }
     
     // Build light queues and lit batches
@@ -1725,7 +1839,10 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
         Drawable* occluder = occluders[i];
         if (i > 0)
         {
-            // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
+            // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary.
+            // Triangles queued for threaded rasterization must be flushed first, or the test would miss the previous occluders
+            if (buffer->GetNumQueuedTriangles())
+                buffer->DrawTriangles();
             if (!buffer->IsVisible(occluder->GetWorldBoundingBox()))
                 continue;
         }
@@ -1738,6 +1855,16 @@ void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& oc
     buffer->BuildDepthHierarchy();
 }
 
+bool View::IsOcclusionCoherent() const
+{
+    // The buffer is handed out to one view per frame, so if this view gets the same buffer, no other view has drawn into it
+    return occlusionBuffer_ == coherentOcclusionBuffer_ && coherentOcclusionFrameNumber_ + 1 == frame_.frameNumber_ &&
+        coherentOcclusionSize_ == IntVector2(occlusionBuffer_->GetWidth(), occlusionBuffer_->GetHeight()) &&
+        coherentOcclusionTriangles_ == maxOccluderTriangles_ && coherentOcclusionView_ == camera_->GetView() &&
+        coherentOcclusionProjection_ == camera_->GetProjection(false) && coherentOccluders_ == occluders_ &&
+        !octree_->HasChanged(camera_->GetFrustum(), coherentOcclusionChangeSerial_);
+}
+
 void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
 {
     Light* light = query.light_;
@@ -1770,8 +1897,13 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
         
     case LIGHT_SPOT:
         {
-            FrustumOctreeQuery octreeQuery(tempDrawables, light->GetFrustum(), DRAWABLE_GEOMETRY, camera_->GetViewMask());
-            octree_->GetDrawables(octreeQuery);
+            if (query.queryCache_)
+                GetCoherentDrawables(query.queryCache_->frustumQueries_[0], light->GetFrustum(), false, tempDrawables, threadIndex);
+            else
+            {
+                FrustumOctreeQuery octreeQuery(tempDrawables, light->GetFrustum(), DRAWABLE_GEOMETRY, camera_->GetViewMask());
+                octree_->GetDrawables(octreeQuery);
+            }
             for (unsigned i = 0; i < tempDrawables.Size(); ++i)
             {
                 if (tempDrawables[i]->IsInView(frame_) && (GetLightMask(tempDrawables[i]) & light->GetLightMask()))
@@ -1782,9 +1914,14 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
         
     case LIGHT_POINT:
         {
-            SphereOctreeQuery octreeQuery(tempDrawables, Sphere(light->GetNode()->GetWorldPosition(), light->GetRange()),
-                DRAWABLE_GEOMETRY, camera_->GetViewMask());
-            octree_->GetDrawables(octreeQuery);
+            Sphere lightSphere(light->GetNode()->GetWorldPosition(), light->GetRange());
+            if (query.queryCache_)
+                GetCoherentDrawables(query.queryCache_->sphereQuery_, lightSphere, tempDrawables, threadIndex);
+            else
+            {
+                SphereOctreeQuery octreeQuery(tempDrawables, lightSphere, DRAWABLE_GEOMETRY, camera_->GetViewMask());
+                octree_->GetDrawables(octreeQuery);
+            }
             for (unsigned i = 0; i < tempDrawables.Size(); ++i)
             {
                 if (tempDrawables[i]->IsInView(frame_) && (GetLightMask(tempDrawables[i]) & light->GetLightMask()))
@@ -1825,9 +1962,14 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
                 continue;
         
             // Reuse lit geometry query for all except directional lights
-            ShadowCasterOctreeQuery query(tempDrawables, shadowCameraFrustum, DRAWABLE_GEOMETRY,
-                camera_->GetViewMask());
-            octree_->GetDrawables(query);
+            if (query.queryCache_)
+                GetCoherentDrawables(query.queryCache_->frustumQueries_[i], shadowCameraFrustum, true, tempDrawables, threadIndex);
+            else
+            {
+                ShadowCasterOctreeQuery query(tempDrawables, shadowCameraFrustum, DRAWABLE_GEOMETRY,
+                    camera_->GetViewMask());
+                octree_->GetDrawables(query);
+            }
         }
         
         // Check which shadow casters actually contribute to the shadowing
@@ -1840,6 +1982,60 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
         query.numSplits_ = 0;
 }
 
+void View::GetCoherentDrawables(CoherentQuery& query, const Frustum& frustum, bool shadowCasters, PODVector<Drawable*>& result,
+    unsigned threadIndex)
+{
+    bool sameFrustum = query.frameNumber_ + 1 == frame_.frameNumber_;
+    for (unsigned i = 0; i < NUM_FRUSTUM_VERTICES && sameFrustum; ++i)
+        sameFrustum = query.frustum_.vertices_[i] == frustum.vertices_[i];
+    
+    if (sameFrustum && !octree_->HasChanged(frustum, query.changeSerial_))
+        ++threadCoherenceStats_[threadIndex].lightQueryHits_;
+    else
+    {
+        // Query without the view mask or shadow casting, as they may change without the octree noticing
+        FrustumOctreeQuery octreeQuery(query.drawables_, frustum, DRAWABLE_GEOMETRY, M_MAX_UNSIGNED);
+        octree_->GetDrawables(octreeQuery);
+        query.frustum_ = frustum;
+        ++threadCoherenceStats_[threadIndex].lightQueryMisses_;
+    }
+    
+    query.frameNumber_ = frame_.frameNumber_;
+    query.changeSerial_ = octree_->GetChangeSerial();
+    FilterCoherentDrawables(query.drawables_, shadowCasters, result);
+}
+
+void View::GetCoherentDrawables(CoherentQuery& query, const Sphere& sphere, PODVector<Drawable*>& result, unsigned threadIndex)
+{
+    if (query.frameNumber_ + 1 == frame_.frameNumber_ && query.sphere_ == sphere && !octree_->HasChanged(sphere,
+        query.changeSerial_))
+        ++threadCoherenceStats_[threadIndex].lightQueryHits_;
+    else
+    {
+        SphereOctreeQuery octreeQuery(query.drawables_, sphere, DRAWABLE_GEOMETRY, M_MAX_UNSIGNED);
+        octree_->GetDrawables(octreeQuery);
+        query.sphere_ = sphere;
+        ++threadCoherenceStats_[threadIndex].lightQueryMisses_;
+    }
+    
+    query.frameNumber_ = frame_.frameNumber_;
+    query.changeSerial_ = octree_->GetChangeSerial();
+    FilterCoherentDrawables(query.drawables_, false, result);
+}
+
+void View::FilterCoherentDrawables(const PODVector<Drawable*>& drawables, bool shadowCasters, PODVector<Drawable*>& result)
+{
+    unsigned viewMask = camera_->GetViewMask();
+    result.Clear();
+    
+    for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+    {
+        Drawable* drawable = *i;
+        if ((drawable->GetViewMask() & viewMask) && (!shadowCasters || drawable->GetCastShadows()))
+            result.Push(drawable);
+    }
+}
+
 void View::ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex)
 {
     Light* light = query.light_;
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "Batch.h"
+#include "Frustum.h"
 #include "HashSet.h"
 #include "List.h"
 #include "Object.h"
@@ -46,6 +47,85 @@ class Zone;
 struct RenderPathCommand;
 struct WorkItem;
 
+/// Octree query result of the previous frame, reused by temporal coherence if the query volume and the drawable objects inside it have not changed.
+struct CoherentQuery
+{
+    /// Construct.
+    CoherentQuery() :
+        frameNumber_(0),
+        changeSerial_(0)
+    {
+    }
+    
+    /// Query frustum.
+    Frustum frustum_;
+    /// Query sphere.
+    Sphere sphere_;
+    /// Geometries inside the query volume, not yet filtered by view mask or shadow casting.
+    PODVector<Drawable*> drawables_;
+    /// Frame number of the query.
+    unsigned frameNumber_;
+    /// Octree change serial number at the time of the query.
+    unsigned changeSerial_;
+};
+
+/// Octree queries of a light from the previous frame.
+struct LightQueryCache
+{
+    /// Construct.
+    LightQueryCache() :
+        frameNumber_(0)
+    {
+    }
+    
+    /// Spot light frustum or directional light split queries.
+    CoherentQuery frustumQueries_[MAX_LIGHT_SPLITS];
+    /// Point light sphere query.
+    CoherentQuery sphereQuery_;
+    /// Last frame number on which the light was processed.
+    unsigned frameNumber_;
+};
+
+/// Temporal coherence hit and miss counts of a view.
+struct URHO3D_API CoherenceStatistics
+{
+    /// Construct with zero counts.
+    CoherenceStatistics() :
+        visibilityHits_(0),
+        visibilityMisses_(0),
+        occlusionHits_(0),
+        occlusionMisses_(0),
+        lightQueryHits_(0),
+        lightQueryMisses_(0)
+    {
+    }
+    
+    /// Add the counts of another.
+    CoherenceStatistics& operator += (const CoherenceStatistics& rhs)
+    {
+        visibilityHits_ += rhs.visibilityHits_;
+        visibilityMisses_ += rhs.visibilityMisses_;
+        occlusionHits_ += rhs.occlusionHits_;
+        occlusionMisses_ += rhs.occlusionMisses_;
+        lightQueryHits_ += rhs.lightQueryHits_;
+        lightQueryMisses_ += rhs.lightQueryMisses_;
+        return *this;
+    }
+    
+    /// Occludees not tested because they were visible on the previous frame.
+    unsigned visibilityHits_;
+    /// Occludees tested.
+    unsigned visibilityMisses_;
+    /// Occlusion buffers reused from the previous frame.
+    unsigned occlusionHits_;
+    /// Occlusion buffers redrawn.
+    unsigned occlusionMisses_;
+    /// Light octree queries reused from the previous frame.
+    unsigned lightQueryHits_;
+    /// Light octree queries performed.
+    unsigned lightQueryMisses_;
+};
+
 /// Intermediate light processing result.
 struct LightQueryResult
 {
@@ -69,6 +149,8 @@ struct LightQueryResult
     float shadowFarSplits_[MAX_LIGHT_SPLITS];
     /// Shadow map split count.
     unsigned numSplits_;
+    /// Octree queries of the previous frame, or null if temporal coherence is disabled.
+    LightQueryCache* queryCache_;
 };
 
 /// Scene render pass info.
@@ -129,6 +211,8 @@ public:
     const PODVector<Light*>& GetLights() const { return lights_; }
     /// Return light batch queues.
     const Vector<LightBatchQueue>& GetLightQueues() const { return lightQueues_; }
+    /// Return temporal coherence statistics of the last update.
+    const CoherenceStatistics& GetCoherenceStatistics() const { return coherenceStats_; }
     
 private:
     /// Query the octree for drawable objects.
@@ -199,6 +283,14 @@ private:
     void RenderShadowMap(const LightBatchQueue& queue);
     /// Return the proper depth-stencil surface to use for a rendertarget.
     RenderSurface* GetDepthStencil(RenderSurface* renderTarget);
+    /// Return whether the occlusion buffer drawn on the previous frame can be reused.
+    bool IsOcclusionCoherent() const;
+    /// Query geometries inside a frustum, or reuse the previous frame's query. Filter by view mask and optionally shadow casting.
+    void GetCoherentDrawables(CoherentQuery& query, const Frustum& frustum, bool shadowCasters, PODVector<Drawable*>& result, unsigned threadIndex);
+    /// Query geometries inside a sphere, or reuse the previous frame's query. Filter by view mask.
+    void GetCoherentDrawables(CoherentQuery& query, const Sphere& sphere, PODVector<Drawable*>& result, unsigned threadIndex);
+    /// Filter the geometries of a coherent query by view mask and optionally shadow casting.
+    void FilterCoherentDrawables(const PODVector<Drawable*>& drawables, bool shadowCasters, PODVector<Drawable*>& result);
     
     /// Graphics subsystem.
     WeakPtr<Graphics> graphics_;
@@ -254,6 +346,8 @@ private:
     bool drawShadows_;
     /// Deferred flag. Inferred from the existence of a light volume command in the renderpath.
     bool deferred_;
+    /// Temporal coherence flag.
+    bool temporalCoherence_;
     /// Renderpath.
     RenderPath* renderPath_;
     /// Intermediate screen buffers used in pingpong copies and OpenGL deferred framebuffer blit.
@@ -304,6 +398,30 @@ private:
     StringHash litBasePassName_;
     /// Hash of the litalpha pass.
     StringHash litAlphaPassName_;
+    /// Octree used on the previous frame, for resetting temporal coherence if it changes.
+    WeakPtr<Octree> coherentOctree_;
+    /// Occlusion buffer drawn on the previous frame.
+    WeakPtr<OcclusionBuffer> coherentOcclusionBuffer_;
+    /// Occluders drawn on the previous frame.
+    PODVector<Drawable*> coherentOccluders_;
+    /// Camera view matrix of the previous frame's occlusion buffer.
+    Matrix3x4 coherentOcclusionView_;
+    /// Camera projection matrix of the previous frame's occlusion buffer.
+    Matrix4 coherentOcclusionProjection_;
+    /// Frame number on which the occlusion buffer was last drawn or reused.
+    unsigned coherentOcclusionFrameNumber_;
+    /// Octree change serial number at the time the occlusion buffer was last drawn or reused.
+    unsigned coherentOcclusionChangeSerial_;
+    /// Occlusion buffer size used on the previous frame.
+    IntVector2 coherentOcclusionSize_;
+    /// Maximum number of occluder triangles used on the previous frame.
+    int coherentOcclusionTriangles_;
+    /// Octree queries of the lights from the previous frame.
+    HashMap<Light*, LightQueryCache> lightQueryCaches_;
+    /// Per-thread temporal coherence statistics.
+    Vector<CoherenceStatistics> threadCoherenceStats_;
+    /// Temporal coherence statistics of the last update.
+    CoherenceStatistics coherenceStats_;
 };
 
 }
@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "Compression.h"
+#include "MathDefs.h"
+
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Minimum match length.
+static const unsigned MIN_MATCH = 4;
+/// Number of literals that must end the block.
+static const unsigned LAST_LITERALS = 5;
+/// Matches may not start within this many bytes of the block end.
+static const unsigned MATCH_SAFE_DISTANCE = 12;
+/// Maximum match offset.
+static const unsigned MAX_OFFSET = 65535;
+/// Number of bits in the match finder hash.
+static const unsigned HASH_BITS = 12;
+
+/// Read 4 bytes for match finding.
+static inline unsigned ReadQuad(const unsigned char* src)
+{
+    unsigned ret;
+    memcpy(&ret, src, sizeof ret);
+    return ret;
+}
+
+/// Hash 4 bytes into a match finder table index.
+static inline unsigned HashQuad(unsigned value)
+{
+    return (value * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/// Write a length that did not fit in the token as a sequence of 255 bytes and a remainder.
+static inline unsigned char* WriteLength(unsigned char* dest, unsigned length)
+{
+    while (length >= 255)
+    {
+        *dest++ = 255;
+        length -= 255;
+    }
+    *dest++ = (unsigned char)length;
+    return dest;
+}
+
+/// Write a sequence of literals and a match. A zero match length writes the final literals only.
+static unsigned char* WriteSequence(unsigned char* dest, const unsigned char* literals, unsigned numLiterals, unsigned offset,
+    unsigned matchLength)
+{
+    unsigned char* token = dest++;
+    *token = (unsigned char)(Min((int)numLiterals, 15) << 4);
+    if (numLiterals >= 15)
+        dest = WriteLength(dest, numLiterals - 15);
+    memcpy(dest, literals, numLiterals);
+    dest += numLiterals;
+    
+    if (matchLength)
+    {
+        *dest++ = (unsigned char)(offset & 0xff);
+        *dest++ = (unsigned char)(offset >> 8);
+        matchLength -= MIN_MATCH;
+        *token |= (unsigned char)Min((int)matchLength, 15);
+        if (matchLength >= 15)
+            dest = WriteLength(dest, matchLength - 15);
+    }
+    
+    return dest;
+}
+
+unsigned EstimateCompressBound(unsigned srcSize)
+{
+    return srcSize + srcSize / 255 + 16;
+}
+
+unsigned CompressData(void* dest, const void* src, unsigned srcSize)
+{
+    if (!dest || !src || !srcSize)
+        return 0;
+    
+    const unsigned char* in = (const unsigned char*)src;
+    const unsigned char* inEnd = in + srcSize;
+    unsigned char* out = (unsigned char*)dest;
+    const unsigned char* anchor = in;
+    
+    if (srcSize > MATCH_SAFE_DISTANCE)
+    {
+        // Positions of the last occurrence of each hashed 4-byte sequence, relative to the source start
+        unsigned table[1 << HASH_BITS];
+        memset(table, 0xff, sizeof table);
+        
+        const unsigned char* matchLimit = inEnd - MATCH_SAFE_DISTANCE;
+        const unsigned char* copyLimit = inEnd - LAST_LITERALS;
+        const unsigned char* pos = in;
+        
+        while (pos < matchLimit)
+        {
+            unsigned quad = ReadQuad(pos);
+            unsigned hash = HashQuad(quad);
+            unsigned candidate = table[hash];
+            unsigned current = (unsigned)(pos - in);
+            table[hash] = current;
+            
+            if (candidate == M_MAX_UNSIGNED || current - candidate > MAX_OFFSET || ReadQuad(in + candidate) != quad)
+            {
+                ++pos;
+                continue;
+            }
+            
+            // Extend the match forward, leaving the required literals at the end
+            const unsigned char* match = in + candidate;
+            const unsigned char* end = pos + MIN_MATCH;
+            match += MIN_MATCH;
+            while (end < copyLimit && *end == *match)
+            {
+                ++end;
+                ++match;
+            }
+            
+            out = WriteSequence(out, anchor, (unsigned)(pos - anchor), current - candidate, (unsigned)(end - pos));
+            pos = end;
+            anchor = pos;
+        }
+    }
+    
+    out = WriteSequence(out, anchor, (unsigned)(inEnd - anchor), 0, 0);
+    return (unsigned)(out - (unsigned char*)dest);
+}
+
+unsigned DecompressData(void* dest, unsigned destSize, const void* src, unsigned srcSize)
+{
+    if (!dest || !src || !srcSize)
+        return 0;
+    
+    const unsigned char* in = (const unsigned char*)src;
+    const unsigned char* inEnd = in + srcSize;
+    unsigned char* out = (unsigned char*)dest;
+    unsigned char* outEnd = out + destSize;
+    
+    for (;;)
+    {
+        unsigned token = *in++;
+        
+        unsigned numLiterals = token >> 4;
+        if (numLiterals == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (in >= inEnd)
+                    return 0;
+                extra = *in++;
+                numLiterals += extra;
+            }
+            while (extra == 255);
+        }
+        
+        if (numLiterals > (unsigned)(inEnd - in) || numLiterals > (unsigned)(outEnd - out))
+            return 0;
+        memcpy(out, in, numLiterals);
+        in += numLiterals;
+        out += numLiterals;
+        
+        // The last sequence has literals only
+        if (in == inEnd)
+            break;
+        
+        if (inEnd - in < 2)
+            return 0;
+        unsigned offset = in[0] | (in[1] << 8);
+        in += 2;
+        if (!offset || offset > (unsigned)(out - (unsigned char*)dest))
+            return 0;
+        
+        unsigned matchLength = token & 15;
+        if (matchLength == 15)
+        {
+            unsigned char extra;
+            do
+            {
+                if (in >= inEnd)
+                    return 0;
+                extra = *in++;
+                matchLength += extra;
+            }
+            while (extra == 255);
+        }
+        matchLength += MIN_MATCH;
+        
+        if (matchLength > (unsigned)(outEnd - out) || in >= inEnd)
+            return 0;
+        
+        // The match may overlap the output, so copy bytewise
+        const unsigned char* match = out - offset;
+        for (unsigned i = 0; i < matchLength; ++i)
+            *out++ = *match++;
+    }
+    
+    return (unsigned)(out - (unsigned char*)dest);
+}
+
+}
@@ -48,6 +48,8 @@ public:
     virtual const String& GetName() const;
     /// Return a checksum if applicable.
     virtual unsigned GetChecksum();
+    /// Return pointer to the whole stream data if it resides in memory and can be accessed without reading, or null if not. Stays valid until the stream is modified or closed.
+    virtual const unsigned char* GetDirectData() const;
     /// Return current position.
     unsigned GetPosition() const { return position_; }
     /// Return size.
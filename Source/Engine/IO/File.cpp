@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "Compression.h"
 #include "File.h"
 #include "FileSystem.h"
 #include "Log.h"
@@ -28,6 +29,15 @@
 #include "Profiler.h"
 
 #include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "DebugNew.h"
 
@@ -64,7 +74,15 @@ File::File(Context* context) :
     readBufferSize_(0),
     #endif
     offset_(0),
-    checksum_(0)
+    checksum_(0),
+    blockIndex_(M_MAX_UNSIGNED),
+    compressed_(false),
+    mapping_(0),
+    #ifdef WIN32
+    mappingHandle_(0),
+    #endif
+    mappingSize_(0),
+    mappedData_(0)
 {
 }
 
@@ -78,7 +96,15 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     readBufferSize_(0),
     #endif
     offset_(0),
-    checksum_(0)
+    checksum_(0),
+    blockIndex_(M_MAX_UNSIGNED),
+    compressed_(false),
+    mapping_(0),
+    #ifdef WIN32
+    mappingHandle_(0),
+    #endif
+    mappingSize_(0),
+    mappedData_(0)
 {
     Open(fileName, mode);
 }
@@ -93,7 +119,15 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     readBufferSize_(0),
     #endif
     offset_(0),
-    checksum_(0)
+    checksum_(0),
+    blockIndex_(M_MAX_UNSIGNED),
+    compressed_(false),
+    mapping_(0),
+    #ifdef WIN32
+    mappingHandle_(0),
+    #endif
+    mappingSize_(0),
+    mappedData_(0)
 {
     Open(package, fileName);
 }
@@ -192,6 +226,7 @@ bool File::Open(PackageFile* package, const String& fileName)
     }
     
     fileName_ = fileName;
+    packageName_ = package->GetName();
     mode_ = FILE_READ;
     offset_ = entry->offset_;
     checksum_ = entry->checksum_;
@@ -199,6 +234,25 @@ bool File::Open(PackageFile* package, const String& fileName)
     size_ = entry->size_;
     
     fseek((FILE*)handle_, offset_, SEEK_SET);
+    
+    if (package->IsCompressed())
+    {
+        // Read the block table, so that any position can be reached by decompressing only the block containing it
+        unsigned numBlocks = (size_ + PACKAGE_BLOCK_SIZE - 1) / PACKAGE_BLOCK_SIZE;
+        blockOffsets_.Resize(numBlocks + 1);
+        if (fread(&blockOffsets_[0], (numBlocks + 1) * sizeof(unsigned), 1, (FILE*)handle_) != 1)
+        {
+            LOGERROR("Could not read block table of " + fileName + " from package file");
+            Close();
+            return false;
+        }
+        
+        blockBuffer_ = new unsigned char[PACKAGE_BLOCK_SIZE];
+        packedBuffer_ = new unsigned char[EstimateCompressBound(PACKAGE_BLOCK_SIZE)];
+        blockIndex_ = M_MAX_UNSIGNED;
+        compressed_ = true;
+    }
+    
     return true;
 }
 
@@ -248,6 +302,38 @@ unsigned File::Read(void* dest, unsigned size)
         return 0;
     }
     
+    if (mappedData_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+    
+    if (compressed_)
+    {
+        unsigned sizeLeft = size;
+        unsigned char* destPtr = (unsigned char*)dest;
+        
+        while (sizeLeft)
+        {
+            unsigned index = position_ / PACKAGE_BLOCK_SIZE;
+            if (index != blockIndex_ && !ReadBlock(index))
+            {
+                LOGERROR("Error while reading from file " + GetName());
+                return size - sizeLeft;
+            }
+            
+            unsigned blockOffset = position_ - index * PACKAGE_BLOCK_SIZE;
+            unsigned copySize = Min((int)(PACKAGE_BLOCK_SIZE - blockOffset), (int)sizeLeft);
+            memcpy(destPtr, blockBuffer_.Get() + blockOffset, copySize);
+            destPtr += copySize;
+            sizeLeft -= copySize;
+            position_ += copySize;
+        }
+        
+        return size;
+    }
+    
     size_t ret = fread(dest, size, 1, (FILE*)handle_);
     if (ret != 1)
     {
@@ -284,6 +370,14 @@ unsigned File::Seek(unsigned position)
         return 0;
     }
     
+    // In a compressed package the block containing the position is read on the next Read(). A memory-mapped file needs
+    // no seek either
+    if (compressed_ || mappedData_)
+    {
+        position_ = position;
+        return position_;
+    }
+    
     fseek((FILE*)handle_, position + offset_, SEEK_SET);
     position_ = position;
     return position_;
@@ -346,6 +440,47 @@ unsigned File::GetChecksum()
     return checksum_;
 }
 
+bool File::Map()
+{
+    if (mappedData_)
+        return true;
+    if (!handle_ || mode_ != FILE_READ || compressed_ || !size_)
+        return false;
+    
+    // The mapping must start at an allocation granularity boundary, so in a package file map also the data before the file
+    #ifdef WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    unsigned granularity = systemInfo.dwAllocationGranularity;
+    #else
+    unsigned granularity = sysconf(_SC_PAGESIZE);
+    #endif
+    unsigned mappingOffset = offset_ - offset_ % granularity;
+    unsigned mappingSize = offset_ - mappingOffset + size_;
+    
+    #ifdef WIN32
+    HANDLE mappingHandle = CreateFileMappingW((HANDLE)_get_osfhandle(_fileno((FILE*)handle_)), 0, PAGE_READONLY, 0, 0, 0);
+    if (!mappingHandle)
+        return false;
+    void* mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, mappingOffset, mappingSize);
+    if (!mapping)
+    {
+        CloseHandle(mappingHandle);
+        return false;
+    }
+    mappingHandle_ = mappingHandle;
+    #else
+    void* mapping = mmap(0, mappingSize, PROT_READ, MAP_PRIVATE, fileno((FILE*)handle_), mappingOffset);
+    if (mapping == MAP_FAILED)
+        return false;
+    #endif
+    
+    mapping_ = mapping;
+    mappingSize_ = mappingSize;
+    mappedData_ = (const unsigned char*)mapping + (offset_ - mappingOffset);
+    return true;
+}
+
 void File::Close()
 {
     #ifdef ANDROID
@@ -357,15 +492,39 @@ void File::Close()
     }
     #endif
     
+    if (mapping_)
+    {
+        #ifdef WIN32
+        UnmapViewOfFile(mapping_);
+        CloseHandle((HANDLE)mappingHandle_);
+        mappingHandle_ = 0;
+        #else
+        munmap(mapping_, mappingSize_);
+        #endif
+        mapping_ = 0;
+        mappingSize_ = 0;
+        mappedData_ = 0;
+    }
+    
     if (handle_)
     {
         fclose((FILE*)handle_);
         handle_ = 0;
+        packageName_.Clear();
         position_ = 0;
         size_ = 0;
         offset_ = 0;
         checksum_ = 0;
     }
+    
+    if (compressed_)
+    {
+        blockOffsets_.Clear();
+        blockBuffer_.Reset();
+        packedBuffer_.Reset();
+        blockIndex_ = M_MAX_UNSIGNED;
+        compressed_ = false;
+    }
 }
 
 void File::Flush()
@@ -379,4 +538,36 @@ void File::SetName(const String& name)
     fileName_ = name;
 }
 
+bool File::ReadBlock(unsigned index)
+{
+    if (index + 1 >= blockOffsets_.Size())
+        return false;
+    
+    unsigned packedSize = blockOffsets_[index + 1] - blockOffsets_[index];
+    unsigned unpackedSize = Min((int)PACKAGE_BLOCK_SIZE, (int)(size_ - index * PACKAGE_BLOCK_SIZE));
+    if (packedSize > EstimateCompressBound(PACKAGE_BLOCK_SIZE))
+        return false;
+    
+    // The buffer is not valid if reading fails halfway
+    blockIndex_ = M_MAX_UNSIGNED;
+    fseek((FILE*)handle_, offset_ + blockOffsets_[index], SEEK_SET);
+    
+    // Blocks that did not compress are stored as is
+    if (packedSize == unpackedSize)
+    {
+        if (fread(blockBuffer_.Get(), unpackedSize, 1, (FILE*)handle_) != 1)
+            return false;
+    }
+    else
+    {
+        if (fread(packedBuffer_.Get(), packedSize, 1, (FILE*)handle_) != 1)
+            return false;
+        if (DecompressData(blockBuffer_.Get(), unpackedSize, packedBuffer_.Get(), packedSize) != unpackedSize)
+            return false;
+    }
+    
+    blockIndex_ = index;
+    return true;
+}
+
 }
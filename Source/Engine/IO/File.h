@@ -22,13 +22,12 @@
 
 #pragma once
 
+#include "ArrayPtr.h"
 #include "Deserializer.h"
 #include "Serializer.h"
 #include "Object.h"
 
 #ifdef ANDROID
-#include "ArrayPtr.h"
-
 #include <SDL_rwops.h>
 #endif
 
@@ -70,11 +69,15 @@ public:
     virtual const String& GetName() const { return fileName_; }
     /// Return a checksum of the file contents using the SDBM hash algorithm.
     virtual unsigned GetChecksum();
+    /// Return pointer to the file contents if memory-mapped, or null if not.
+    virtual const unsigned char* GetDirectData() const { return mappedData_; }
     
     /// Open a filesystem file. Return true if successful.
     bool Open(const String& fileName, FileMode mode = FILE_READ);
     /// Open from within a package file. Return true if successful.
     bool Open(PackageFile* package, const String& fileName);
+    /// Memory-map the file contents for reading. Reads are then copied from the mapping without calls to the C file API, and GetDirectData() returns the contents. Not supported for files opened for writing or in compressed packages. Return true if successful.
+    bool Map();
     /// Close the file.
     void Close();
     /// Flush any buffered output to the file.
@@ -90,8 +93,19 @@ public:
     void* GetHandle() const { return handle_; }
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
+    /// Return the name of the package file the file originates from, or empty if not packaged.
+    const String& GetPackageName() const { return packageName_; }
+    /// Return the start position within a package file, 0 for regular files.
+    unsigned GetOffset() const { return offset_; }
+    /// Return whether the file originates from a compressed package.
+    bool IsCompressed() const { return compressed_; }
+    /// Return whether the file contents are memory-mapped.
+    bool IsMapped() const { return mappedData_ != 0; }
     
 private:
+    /// Read and decompress a block of a file in a compressed package. Return true if successful.
+    bool ReadBlock(unsigned index);
+    
     /// File name.
     String fileName_;
     /// Open mode.
@@ -108,10 +122,32 @@ private:
     /// Bytes in the current read buffer.
     unsigned readBufferSize_;
     #endif
+    /// Package file name, empty for regular files.
+    String packageName_;
     /// Start position within a package file, 0 for regular files.
     unsigned offset_;
     /// Content checksum.
     unsigned checksum_;
+    /// Block offsets relative to the start position, if in a compressed package.
+    PODVector<unsigned> blockOffsets_;
+    /// Decompressed data of the current block.
+    SharedArrayPtr<unsigned char> blockBuffer_;
+    /// Compressed data read buffer.
+    SharedArrayPtr<unsigned char> packedBuffer_;
+    /// Index of the block in the decompressed data buffer.
+    unsigned blockIndex_;
+    /// Compressed package flag.
+    bool compressed_;
+    /// Start address of the memory mapping. May precede the file contents due to alignment.
+    void* mapping_;
+    #ifdef WIN32
+    /// File mapping object handle.
+    void* mappingHandle_;
+    #endif
+    /// Size of the memory mapping.
+    unsigned mappingSize_;
+    /// File contents within the memory mapping.
+    const unsigned char* mappedData_;
 };
 
 }
@@ -0,0 +1,274 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "CoreEvents.h"
+#include "FileReadQueue.h"
+#include "IOEvents.h"
+#include "Profiler.h"
+#include "Sort.h"
+#include "Thread.h"
+#include "Timer.h"
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// I/O thread managed by the file read queue.
+class FileReadThread : public Thread, public RefCounted
+{
+public:
+    /// Construct.
+    FileReadThread(FileReadQueue* owner) :
+        owner_(owner)
+    {
+    }
+    
+    /// Read requests until stopped.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->ProcessBatch())
+                Time::Sleep(1);
+        }
+    }
+    
+private:
+    /// File read queue.
+    FileReadQueue* owner_;
+};
+
+/// Return the position of a request's data within its package file, or within its file if not packaged.
+static unsigned GetReadPosition(const FileReadRequest* request)
+{
+    return request->file_->GetOffset() + request->offset_;
+}
+
+/// Compare requests for reading in the order of position.
+static bool CompareReadPositions(const FileReadRequest* lhs, const FileReadRequest* rhs)
+{
+    return GetReadPosition(lhs) < GetReadPosition(rhs);
+}
+
+FileReadQueue::FileReadQueue(Context* context) :
+    Object(context),
+    nextSequence_(0)
+{
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(FileReadQueue, HandleBeginFrame));
+}
+
+FileReadQueue::~FileReadQueue()
+{
+    // The threads finish the batch they are reading before stopping
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Stop();
+}
+
+void FileReadQueue::CreateThreads(unsigned numThreads)
+{
+    if (!threads_.Empty())
+        return;
+    
+    for (unsigned i = 0; i < numThreads; ++i)
+    {
+        SharedPtr<FileReadThread> thread(new FileReadThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+bool FileReadQueue::AddRequest(FileReadRequest* request)
+{
+    if (!request || !request->file_ || !request->file_->IsOpen() || request->file_->GetMode() == FILE_WRITE)
+        return false;
+    
+    SharedPtr<FileReadRequest> requestPtr(request);
+    if (requests_.Contains(requestPtr))
+        return false;
+    
+    // Allow reusing a completed request
+    request->data_.Clear();
+    request->sequence_ = nextSequence_++;
+    request->started_ = false;
+    request->completed_ = false;
+    request->success_ = false;
+    requests_.Push(requestPtr);
+    
+    {
+        MutexLock lock(queueMutex_);
+        pending_.Push(request);
+    }
+    
+    if (threads_.Empty())
+        CreateThreads(1);
+    
+    return true;
+}
+
+bool FileReadQueue::CancelRequest(FileReadRequest* request)
+{
+    {
+        MutexLock lock(queueMutex_);
+        if (!pending_.Remove(request))
+            return false;
+    }
+    
+    List<SharedPtr<FileReadRequest> >::Iterator i = requests_.Find(SharedPtr<FileReadRequest>(request));
+    if (i != requests_.End())
+        requests_.Erase(i);
+    return true;
+}
+
+void FileReadQueue::WaitForRequest(FileReadRequest* request)
+{
+    if (!request || !request->file_ || request->completed_)
+        return;
+    
+    // If not started yet, read on this thread rather than wait for the I/O threads to get to it
+    bool started;
+    {
+        MutexLock lock(queueMutex_);
+        started = request->started_;
+        if (!started)
+        {
+            request->started_ = true;
+            pending_.Remove(request);
+        }
+    }
+    
+    if (!started)
+        ReadRequest(request);
+    else
+    {
+        while (!request->completed_)
+            Time::Sleep(0);
+    }
+}
+
+unsigned FileReadQueue::GetNumPendingRequests() const
+{
+    unsigned numPending = 0;
+    for (List<SharedPtr<FileReadRequest> >::ConstIterator i = requests_.Begin(); i != requests_.End(); ++i)
+    {
+        if (!(*i)->completed_)
+            ++numPending;
+    }
+    
+    return numPending;
+}
+
+bool FileReadQueue::ProcessBatch()
+{
+    PODVector<FileReadRequest*> batch;
+    {
+        MutexLock lock(queueMutex_);
+        TakeBatch(batch);
+    }
+    
+    for (unsigned i = 0; i < batch.Size(); ++i)
+        ReadRequest(batch[i]);
+    
+    return !batch.Empty();
+}
+
+void FileReadQueue::TakeBatch(PODVector<FileReadRequest*>& batch)
+{
+    if (pending_.Empty())
+        return;
+    
+    FileReadRequest* first = pending_[0];
+    for (unsigned i = 1; i < pending_.Size(); ++i)
+    {
+        FileReadRequest* candidate = pending_[i];
+        if (candidate->priority_ > first->priority_ || (candidate->priority_ == first->priority_ && candidate->sequence_ <
+            first->sequence_))
+            first = candidate;
+    }
+    
+    // Reading a package file sequentially is faster than in the request order, so take also the other requests of the same
+    // priority from the package
+    const String& packageName = first->file_->GetPackageName();
+    if (packageName.Empty())
+        batch.Push(first);
+    else
+    {
+        for (unsigned i = 0; i < pending_.Size(); ++i)
+        {
+            FileReadRequest* candidate = pending_[i];
+            if (candidate->priority_ == first->priority_ && candidate->file_->GetPackageName() == packageName)
+                batch.Push(candidate);
+        }
+        Sort(batch.Begin(), batch.End(), CompareReadPositions);
+    }
+    
+    for (unsigned i = 0; i < batch.Size(); ++i)
+    {
+        batch[i]->started_ = true;
+        pending_.Remove(batch[i]);
+    }
+}
+
+void FileReadQueue::ReadRequest(FileReadRequest* request)
+{
+    File* file = request->file_;
+    unsigned offset = request->offset_ < file->GetSize() ? request->offset_ : file->GetSize();
+    unsigned size = request->size_ < file->GetSize() - offset ? request->size_ : file->GetSize() - offset;
+    
+    request->data_.Resize(size);
+    file->Seek(offset);
+    request->success_ = !size || file->Read(&request->data_[0], size) == size;
+    
+    if (request->callback_)
+        request->callback_(request);
+    
+    request->completed_ = true;
+}
+
+void FileReadQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    for (List<SharedPtr<FileReadRequest> >::Iterator i = requests_.Begin(); i != requests_.End();)
+    {
+        if (!(*i)->completed_)
+        {
+            ++i;
+            continue;
+        }
+        
+        // Release the request before sending the event, as an event handler may queue it again
+        SharedPtr<FileReadRequest> request = *i;
+        i = requests_.Erase(i);
+        
+        if (request->sendEvent_)
+        {
+            using namespace FileReadCompleted;
+            
+            VariantMap newEventData;
+            newEventData[P_REQUEST] = (void*)request.Get();
+            newEventData[P_SUCCESS] = request->success_;
+            SendEvent(E_FILEREADCOMPLETED, newEventData);
+        }
+    }
+}
+
+}
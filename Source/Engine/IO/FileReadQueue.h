@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "File.h"
+#include "List.h"
+#include "Mutex.h"
+
+namespace Urho3D
+{
+
+class FileReadThread;
+
+/// Asynchronous file read request.
+class URHO3D_API FileReadRequest : public RefCounted
+{
+public:
+    /// Construct to read from an open file. The file must not be accessed by other threads until the request completes.
+    FileReadRequest(File* file, unsigned offset = 0, unsigned size = M_MAX_UNSIGNED) :
+        file_(file),
+        offset_(offset),
+        size_(size),
+        priority_(0),
+        callback_(0),
+        userData_(0),
+        sendEvent_(false),
+        sequence_(0),
+        started_(false),
+        completed_(false),
+        success_(false)
+    {
+    }
+    
+    /// Return whether the read and the callback have completed.
+    bool IsCompleted() const { return completed_; }
+    /// Return whether reading from the file succeeded.
+    bool IsSuccess() const { return success_; }
+    
+    /// File to read from.
+    SharedPtr<File> file_;
+    /// Start position within the file.
+    unsigned offset_;
+    /// Number of bytes to read, limited to the end of the file. By default the whole file from the start position is read.
+    unsigned size_;
+    /// Priority. Higher value is read first.
+    int priority_;
+    /// Function called in the I/O thread after the read, for example to decode the data. Null for none.
+    void (*callback_)(FileReadRequest*);
+    /// User data pointer for the callback.
+    void* userData_;
+    /// Whether to send E_FILEREADCOMPLETED on the main thread after completion.
+    bool sendEvent_;
+    /// Data read.
+    PODVector<unsigned char> data_;
+    
+private:
+    friend class FileReadQueue;
+    
+    /// Request order for requests of the same priority.
+    unsigned sequence_;
+    /// I/O thread has started processing the request.
+    bool started_;
+    /// Read and callback completed flag.
+    volatile bool completed_;
+    /// Success flag.
+    bool success_;
+};
+
+/// %File read queue subsystem. Reads files asynchronously in I/O threads, so that the main thread or a decoding thread does not block on the disk. Reads from the same package file are done in the order of their position in the package to reduce seeking.
+class URHO3D_API FileReadQueue : public Object
+{
+    OBJECT(FileReadQueue);
+    
+    friend class FileReadThread;
+    
+public:
+    /// Construct.
+    FileReadQueue(Context* context);
+    /// Destruct. Stop the I/O threads.
+    ~FileReadQueue();
+    
+    /// Create I/O threads. Can only be called once. If not called, one thread is created on the first request.
+    void CreateThreads(unsigned numThreads);
+    /// Queue a read request. Return false if already queued or has no open file.
+    bool AddRequest(FileReadRequest* request);
+    /// Remove a request that has not been started yet. Return true if removed.
+    bool CancelRequest(FileReadRequest* request);
+    /// Wait for a request to complete. If an I/O thread has not started it yet, read on the calling thread instead.
+    void WaitForRequest(FileReadRequest* request);
+    
+    /// Return number of I/O threads.
+    unsigned GetNumThreads() const { return threads_.Size(); }
+    /// Return number of queued requests that have not completed yet.
+    unsigned GetNumPendingRequests() const;
+    
+private:
+    /// Take the next batch of requests and read them. Return false if there were no requests to read. Called by the I/O threads.
+    bool ProcessBatch();
+    /// Take the next batch of requests to read: the highest priority request, and the other requests of the same priority from the same package file, in the order of their position in the package. Called with the queue mutex locked.
+    void TakeBatch(PODVector<FileReadRequest*>& batch);
+    /// Read a request and run its callback.
+    void ReadRequest(FileReadRequest* request);
+    /// Handle frame start event. Send completion events and release completed requests.
+    void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+    
+    /// I/O threads.
+    Vector<SharedPtr<FileReadThread> > threads_;
+    /// Queued requests, including those being read. Referenced only by the main thread.
+    List<SharedPtr<FileReadRequest> > requests_;
+    /// Requests that have not been started yet.
+    PODVector<FileReadRequest*> pending_;
+    /// Mutex for the pending requests and the started flags.
+    mutable Mutex queueMutex_;
+    /// Next request sequence number.
+    unsigned nextSequence_;
+};
+
+}
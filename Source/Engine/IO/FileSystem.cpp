@@ -119,6 +119,28 @@ bool FileSystem::CreateDir(const String& pathName)
     return success;
 }
 
+bool FileSystem::RemoveDir(const String& pathName)
+{
+    if (!CheckAccess(pathName))
+    {
+        LOGERROR("Access denied to " + pathName);
+        return false;
+    }
+
+    #ifdef WIN32
+    bool success = RemoveDirectoryW(GetWideNativePath(RemoveTrailingSlash(pathName)).CString()) != 0;
+    #else
+    bool success = rmdir(GetNativePath(RemoveTrailingSlash(pathName)).CString()) == 0;
+    #endif
+
+    if (success)
+        LOGDEBUG("Removed directory " + pathName);
+    else
+        LOGERROR("Failed to remove directory " + pathName);
+
+    return success;
+}
+
 int FileSystem::SystemCommand(const String& commandLine)
 {
     if (allowedPaths_.Empty())
@@ -499,6 +521,21 @@ String FileSystem::GetUserDocumentsDir() const
     #endif
 }
 
+String FileSystem::GetTemporaryDir() const
+{
+    #if defined(ANDROID) || defined(IOS)
+    return GetUserDocumentsDir();
+    #elif defined(WIN32)
+    wchar_t pathName[MAX_PATH];
+    pathName[0] = 0;
+    GetTempPathW(MAX_PATH, pathName);
+    return AddTrailingSlash(GetInternalPath(String(pathName)));
+    #else
+    const char* pathName = getenv("TMPDIR");
+    return AddTrailingSlash(String(pathName && pathName[0] ? pathName : "/tmp"));
+    #endif
+}
+
 void FileSystem::RegisterPath(const String& pathName)
 {
     if (pathName.Empty())
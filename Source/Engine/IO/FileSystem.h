@@ -50,6 +50,8 @@ public:
     bool SetCurrentDir(const String& pathName);
     /// Create a directory.
     bool CreateDir(const String& pathName);
+    /// Remove an empty directory. Return true if successful.
+    bool RemoveDir(const String& pathName);
     /// Run a program using the command interpreter, block until it exits and return the exit code. Will fail if any allowed paths are defined.
     int SystemCommand(const String& commandLine);
     /// Run a specific program, block until it exits and return the exit code. Will fail if any allowed paths are defined.
@@ -83,6 +85,8 @@ public:
     String GetProgramDir() const;
     /// Return the user documents directory.
     String GetUserDocumentsDir() const;
+    /// Return the temporary files directory.
+    String GetTemporaryDir() const;
     
 private:
     /// Scan directory, called internally.
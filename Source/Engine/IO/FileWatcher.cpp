@@ -239,7 +239,9 @@ void FileWatcher::ThreadFunction()
             {
                 FILE_NOTIFY_INFORMATION* record = (FILE_NOTIFY_INFORMATION*)&buffer[offset];
                 
-                if (record->Action == FILE_ACTION_MODIFIED || record->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                if (record->Action == FILE_ACTION_MODIFIED || record->Action == FILE_ACTION_ADDED ||
+                    record->Action == FILE_ACTION_REMOVED || record->Action == FILE_ACTION_RENAMED_OLD_NAME ||
+                    record->Action == FILE_ACTION_RENAMED_NEW_NAME)
                 {
                     String fileName;
                     const wchar_t* src = record->FileName;
@@ -275,7 +277,7 @@ void FileWatcher::ThreadFunction()
 
             if (event->len > 0)
             {
-                if (event->mask & IN_MODIFY || event->mask & IN_MOVE)
+                if (event->mask & IN_MODIFY || event->mask & IN_MOVE || event->mask & IN_CREATE || event->mask & IN_DELETE)
                 {
                     String fileName;
                     fileName = dirHandle_[event->wd] + event->name;
@@ -33,4 +33,11 @@ EVENT(E_LOGMESSAGE, LogMessage)
     PARAM(P_MESSAGE, Message);              // String
 }
 
+/// Asynchronous file read request completed.
+EVENT(E_FILEREADCOMPLETED, FileReadCompleted)
+{
+    PARAM(P_REQUEST, Request);              // FileReadRequest pointer
+    PARAM(P_SUCCESS, Success);              // bool
+}
+
 }
@@ -22,11 +22,13 @@
 
 #include "Precompiled.h"
 #include "Context.h"
+#include "CoreEvents.h"
 #include "File.h"
 #include "IOEvents.h"
 #include "Log.h"
 #include "Mutex.h"
 #include "ProcessUtils.h"
+#include "Thread.h"
 #include "Timer.h"
 
 #include <cstdio>
@@ -65,6 +67,8 @@ Log::Log(Context* context) :
     quiet_(false)
 {
     logInstance = this;
+    
+    SubscribeToEvent(E_ENDFRAME, HANDLER(Log, HandleEndFrame));
 }
 
 Log::~Log()
@@ -113,6 +117,14 @@ void Log::Write(int level, const String& message)
     // Do not log if message level excluded or if currently sending a log event
     if (!logInstance || logInstance->level_ > level || logInstance->inWrite_)
         return;
+    
+    // If not in the main thread, store message for later processing
+    if (!Thread::IsMainThread())
+    {
+        MutexLock lock(logInstance->logMutex_);
+        logInstance->threadMessages_.Push(StoredLogMessage(message, level, false));
+        return;
+    }
 
     String formattedMessage = logLevelPrefixes[level];
     formattedMessage += ": " + message;
@@ -159,6 +171,14 @@ void Log::WriteRaw(const String& message, bool error)
     // Prevent recursion during log event
     if (!logInstance || logInstance->inWrite_)
         return;
+    
+    // If not in the main thread, store message for later processing
+    if (!Thread::IsMainThread())
+    {
+        MutexLock lock(logInstance->logMutex_);
+        logInstance->threadMessages_.Push(StoredLogMessage(message, -1, error));
+        return;
+    }
 
     logInstance->lastMessage_ = message;
 
@@ -194,4 +214,22 @@ void Log::WriteRaw(const String& message, bool error)
     logInstance->inWrite_ = false;
 }
 
+void Log::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    MutexLock lock(logMutex_);
+    
+    // Process messages accumulated from other threads (if any)
+    while (!threadMessages_.Empty())
+    {
+        const StoredLogMessage& stored = threadMessages_.Front();
+        
+        if (stored.level_ != -1)
+            Write(stored.level_, stored.message_);
+        else
+            WriteRaw(stored.message_, stored.error_);
+        
+        threadMessages_.PopFront();
+    }
+}
+
 }
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include "List.h"
+#include "Mutex.h"
 #include "Object.h"
 
 namespace Urho3D
@@ -40,6 +42,30 @@ static const int LOG_NONE = 4;
 
 class File;
 
+/// Stored log message from another thread.
+struct StoredLogMessage
+{
+    /// Construct undefined.
+    StoredLogMessage()
+    {
+    }
+    
+    /// Construct with parameters.
+    StoredLogMessage(const String& message, int level, bool error) :
+        message_(message),
+        level_(level),
+        error_(error)
+    {
+    }
+    
+    /// Message text.
+    String message_;
+    /// Message level. -1 for raw messages.
+    int level_;
+    /// Error flag for raw messages.
+    bool error_;
+};
+
 /// Logging subsystem.
 class URHO3D_API Log : public Object
 {
@@ -69,12 +95,19 @@ public:
     /// Return whether log is in quiet mode (only errors printed to standard error stream).
     bool IsQuiet() const { return quiet_; }
     
-    /// Write to the log. If logging level is higher than the level of the message, the message is ignored.
+    /// Write to the log. If logging level is higher than the level of the message, the message is ignored. When called from a worker thread, the message is queued and written in the main thread at the end of the frame.
     static void Write(int level, const String& message);
-    /// Write raw output to the log.
+    /// Write raw output to the log. When called from a worker thread, the output is queued like with Write().
     static void WriteRaw(const String& message, bool error = false);
     
 private:
+    /// Handle end of frame. Process the threaded log messages.
+    void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+    
+    /// Mutex for threaded operation.
+    Mutex logMutex_;
+    /// Log messages from other threads.
+    List<StoredLogMessage> threadMessages_;
     /// Log file.
     SharedPtr<File> logFile_;
     /// Last log message.
@@ -31,14 +31,16 @@ namespace Urho3D
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
-    checksum_(0)
+    checksum_(0),
+    compressed_(false)
 {
 }
 
 PackageFile::PackageFile(Context* context, const String& fileName) :
     Object(context),
     totalSize_(0),
-    checksum_(0)
+    checksum_(0),
+    compressed_(false)
 {
     Open(fileName);
 }
@@ -54,13 +56,15 @@ bool PackageFile::Open(const String& fileName)
         return false;
     
     // Check ID, then read the directory
-    if (file->ReadFileID() != "UPAK")
+    String id = file->ReadFileID();
+    if (id != "UPAK" && id != "ULZ4")
     {
         LOGERROR(fileName + " is not a valid package file");
         return false;
     }
     
     fileName_ = fileName;
+    compressed_ = id == "ULZ4";
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
     
@@ -74,7 +78,8 @@ bool PackageFile::Open(const String& fileName)
         newEntry.offset_ = file->ReadUInt();
         newEntry.size_ = file->ReadUInt();
         newEntry.checksum_ = file->ReadUInt();
-        if (newEntry.offset_ + newEntry.size_ > totalSize_)
+        // The size of a compressed file is not known until its block table is read
+        if (newEntry.offset_ + (compressed_ ? 0 : newEntry.size_) > totalSize_)
             LOGERROR("File entry " + entryName + " outside package file");
         else
             entries_[entryName.ToLower()] = newEntry;
@@ -27,12 +27,15 @@
 namespace Urho3D
 {
 
+/// Uncompressed size of the blocks a file is compressed in within a compressed package file.
+static const unsigned PACKAGE_BLOCK_SIZE = 32768;
+
 /// %File entry within the package file.
 struct PackageEntry
 {
-    /// Offset from the beginning.
+    /// Offset from the beginning. In a compressed package file, the file data begins with a table of block offsets relative to this.
     unsigned offset_;
-    /// File size.
+    /// File size, uncompressed.
     unsigned size_;
     /// File checksum.
     unsigned checksum_;
@@ -69,6 +72,8 @@ public:
     unsigned GetTotalSize() const { return totalSize_; }
     /// Return checksum of the package file contents.
     unsigned GetChecksum() const { return checksum_; }
+    /// Return whether the files are compressed.
+    bool IsCompressed() const { return compressed_; }
     
 private:
     /// File entries.
@@ -81,6 +86,8 @@ private:
     unsigned totalSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Compressed flag.
+    bool compressed_;
 };
 
 }
@@ -383,7 +383,8 @@ bool Input::IsMinimized() const
 void Input::Initialize()
 {
     Graphics* graphics = GetSubsystem<Graphics>();
-    if (!graphics || !graphics->IsInitialized())
+    // In headless mode there is no window to receive input from
+    if (!graphics || !graphics->IsInitialized() || graphics->IsHeadless())
         return;
 
     graphics_ = graphics;
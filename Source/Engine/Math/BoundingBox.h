@@ -309,4 +309,37 @@ public:
     bool defined_;
 };
 
+static const unsigned BOUNDING_BOX_BLOCK_SIZE = 4;
+
+/// Block of bounding boxes stored as centers and half sizes in structure-of-arrays form, for testing several boxes at once.
+struct URHO3D_API BoundingBoxBlock
+{
+    /// Set the bounding box at index.
+    void Define(unsigned index, const BoundingBox& box)
+    {
+        Vector3 center = box.Center();
+        Vector3 edge = center - box.min_;
+        
+        centerX_[index] = center.x_;
+        centerY_[index] = center.y_;
+        centerZ_[index] = center.z_;
+        edgeX_[index] = edge.x_;
+        edgeY_[index] = edge.y_;
+        edgeZ_[index] = edge.z_;
+    }
+    
+    /// Center X coordinates.
+    float centerX_[BOUNDING_BOX_BLOCK_SIZE];
+    /// Center Y coordinates.
+    float centerY_[BOUNDING_BOX_BLOCK_SIZE];
+    /// Center Z coordinates.
+    float centerZ_[BOUNDING_BOX_BLOCK_SIZE];
+    /// Half size X components.
+    float edgeX_[BOUNDING_BOX_BLOCK_SIZE];
+    /// Half size Y components.
+    float edgeY_[BOUNDING_BOX_BLOCK_SIZE];
+    /// Half size Z components.
+    float edgeZ_[BOUNDING_BOX_BLOCK_SIZE];
+};
+
 }
@@ -23,6 +23,10 @@
 #include "Precompiled.h"
 #include "Frustum.h"
 
+#ifdef USE_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -169,6 +173,84 @@ Frustum Frustum::Transformed(const Matrix3x4& transform) const
     return transformed;
 }
 
+void Frustum::IsInsideFast(const BoundingBoxBlock* blocks, unsigned numBlocks, unsigned char* masks) const
+{
+    #ifdef USE_SSE
+    // Splat the plane parameters once for all blocks
+    __m128 normalX[NUM_FRUSTUM_PLANES];
+    __m128 normalY[NUM_FRUSTUM_PLANES];
+    __m128 normalZ[NUM_FRUSTUM_PLANES];
+    __m128 absNormalX[NUM_FRUSTUM_PLANES];
+    __m128 absNormalY[NUM_FRUSTUM_PLANES];
+    __m128 absNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 intercept[NUM_FRUSTUM_PLANES];
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = planes_[i];
+        normalX[i] = _mm_set1_ps(plane.normal_.x_);
+        normalY[i] = _mm_set1_ps(plane.normal_.y_);
+        normalZ[i] = _mm_set1_ps(plane.normal_.z_);
+        absNormalX[i] = _mm_set1_ps(plane.absNormal_.x_);
+        absNormalY[i] = _mm_set1_ps(plane.absNormal_.y_);
+        absNormalZ[i] = _mm_set1_ps(plane.absNormal_.z_);
+        intercept[i] = _mm_set1_ps(plane.intercept_);
+    }
+    
+    __m128 zero = _mm_setzero_ps();
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        const BoundingBoxBlock& block = blocks[i];
+        __m128 centerX = _mm_loadu_ps(block.centerX_);
+        __m128 centerY = _mm_loadu_ps(block.centerY_);
+        __m128 centerZ = _mm_loadu_ps(block.centerZ_);
+        __m128 edgeX = _mm_loadu_ps(block.edgeX_);
+        __m128 edgeY = _mm_loadu_ps(block.edgeY_);
+        __m128 edgeZ = _mm_loadu_ps(block.edgeZ_);
+        __m128 outside = zero;
+        
+        // Same operation order as the scalar test, so that the results are identical
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            __m128 dist = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[j], centerX), _mm_mul_ps(normalY[j], centerY)),
+                _mm_mul_ps(normalZ[j], centerZ)), intercept[j]);
+            __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[j], edgeX), _mm_mul_ps(absNormalY[j], edgeY)),
+                _mm_mul_ps(absNormalZ[j], edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(zero, absDist)));
+        }
+        
+        masks[i] = (unsigned char)(~_mm_movemask_ps(outside) & 0xf);
+    }
+    #else
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        const BoundingBoxBlock& block = blocks[i];
+        unsigned char mask = 0;
+        
+        for (unsigned j = 0; j < BOUNDING_BOX_BLOCK_SIZE; ++j)
+        {
+            Vector3 center(block.centerX_[j], block.centerY_[j], block.centerZ_[j]);
+            Vector3 edge(block.edgeX_[j], block.edgeY_[j], block.edgeZ_[j]);
+            bool inside = true;
+            
+            for (unsigned k = 0; k < NUM_FRUSTUM_PLANES; ++k)
+            {
+                const Plane& plane = planes_[k];
+                if (plane.normal_.DotProduct(center) - plane.intercept_ < -plane.absNormal_.DotProduct(edge))
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            
+            if (inside)
+                mask |= 1 << j;
+        }
+        
+        masks[i] = mask;
+    }
+    #endif
+}
+
 Rect Frustum::Projected(const Matrix4& projection) const
 {
     Rect rect;
@@ -151,6 +151,9 @@ public:
         return INSIDE;
     }
     
+    /// Test blocks of bounding boxes for being (partially) inside or outside. Write a bitmask of the boxes inside for each block.
+    void IsInsideFast(const BoundingBoxBlock* blocks, unsigned numBlocks, unsigned char* masks) const;
+    
     /// Return distance of a point to the frustum, or 0 if inside.
     float Distance(const Vector3& point) const
     {
@@ -27,6 +27,16 @@
 #include <cstdlib>
 #include <cmath>
 
+// Use SSE intrinsics only when enabled in the build and supported by the target instruction set
+#if defined(ENABLE_SSE) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define USE_SSE
+#endif
+
+// SSE2 integer intrinsics are used in addition where the target supports them
+#if defined(USE_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define USE_SSE2
+#endif
+
 namespace Urho3D
 {
 
@@ -27,9 +27,121 @@
 #include "Ray.h"
 #include "Sphere.h"
 
+#ifdef USE_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
+/// Helper for testing a ray against many triangles. With SSE in use the triangles are collected and tested four at a time.
+class TriangleHitTest
+{
+public:
+    /// Construct with ray.
+    TriangleHitTest(const Ray& ray) :
+        ray_(ray),
+        nearest_(M_INFINITY),
+        numTriangles_(0)
+    {
+    }
+    
+    /// Test a triangle.
+    void AddTriangle(const Vector3& v0, const Vector3& v1, const Vector3& v2)
+    {
+        #ifdef USE_SSE
+        vertices_[numTriangles_] = &v0;
+        vertices_[numTriangles_ + 4] = &v1;
+        vertices_[numTriangles_ + 8] = &v2;
+        if (++numTriangles_ == 4)
+        {
+            TestTriangles();
+            numTriangles_ = 0;
+        }
+        #else
+        nearest_ = Min(nearest_, ray_.HitDistance(v0, v1, v2));
+        #endif
+    }
+    
+    /// Return the nearest hit distance of the triangles, or infinity if no hit.
+    float GetNearest()
+    {
+        for (unsigned i = 0; i < numTriangles_; ++i)
+            nearest_ = Min(nearest_, ray_.HitDistance(*vertices_[i], *vertices_[i + 4], *vertices_[i + 8]));
+        numTriangles_ = 0;
+        
+        return nearest_;
+    }
+    
+private:
+    #ifdef USE_SSE
+    /// Load one coordinate of a vertex of the four triangles.
+    __m128 LoadCoordinate(unsigned vertex, unsigned coordinate) const
+    {
+        const Vector3* const* vertices = &vertices_[vertex * 4];
+        return _mm_setr_ps(vertices[0]->Data()[coordinate], vertices[1]->Data()[coordinate], vertices[2]->Data()[coordinate],
+            vertices[3]->Data()[coordinate]);
+    }
+    
+    /// Test the four collected triangles. Uses the same operation order as the single triangle test, so that the results are identical.
+    void TestTriangles()
+    {
+        __m128 v0x = LoadCoordinate(0, 0);
+        __m128 v0y = LoadCoordinate(0, 1);
+        __m128 v0z = LoadCoordinate(0, 2);
+        __m128 edge1x = _mm_sub_ps(LoadCoordinate(1, 0), v0x);
+        __m128 edge1y = _mm_sub_ps(LoadCoordinate(1, 1), v0y);
+        __m128 edge1z = _mm_sub_ps(LoadCoordinate(1, 2), v0z);
+        __m128 edge2x = _mm_sub_ps(LoadCoordinate(2, 0), v0x);
+        __m128 edge2y = _mm_sub_ps(LoadCoordinate(2, 1), v0y);
+        __m128 edge2z = _mm_sub_ps(LoadCoordinate(2, 2), v0z);
+        __m128 dirX = _mm_set1_ps(ray_.direction_.x_);
+        __m128 dirY = _mm_set1_ps(ray_.direction_.y_);
+        __m128 dirZ = _mm_set1_ps(ray_.direction_.z_);
+        
+        // Calculate determinant
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dirY, edge2z), _mm_mul_ps(dirZ, edge2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dirZ, edge2x), _mm_mul_ps(dirX, edge2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dirX, edge2y), _mm_mul_ps(dirY, edge2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1x, px), _mm_mul_ps(edge1y, py)), _mm_mul_ps(edge1z, pz));
+        
+        // Calculate u & v parameters
+        __m128 tx = _mm_sub_ps(_mm_set1_ps(ray_.origin_.x_), v0x);
+        __m128 ty = _mm_sub_ps(_mm_set1_ps(ray_.origin_.y_), v0y);
+        __m128 tz = _mm_sub_ps(_mm_set1_ps(ray_.origin_.z_), v0z);
+        __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz));
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, edge1z), _mm_mul_ps(tz, edge1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, edge1x), _mm_mul_ps(tx, edge1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, edge1y), _mm_mul_ps(ty, edge1x));
+        __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dirX, qx), _mm_mul_ps(dirY, qy)), _mm_mul_ps(dirZ, qz));
+        
+        // Check backfacing and the parameters, then calculate distance for the triangles that were hit
+        __m128 zero = _mm_setzero_ps();
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(det, _mm_set1_ps(M_EPSILON)), _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, det)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), det)));
+        if (!_mm_movemask_ps(hit))
+            return;
+        
+        __m128 dist = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2x, qx), _mm_mul_ps(edge2y, qy)), _mm_mul_ps(edge2z, qz)),
+            det);
+        dist = _mm_or_ps(_mm_and_ps(hit, dist), _mm_andnot_ps(hit, _mm_set1_ps(M_INFINITY)));
+        
+        float distances[4];
+        _mm_storeu_ps(distances, dist);
+        nearest_ = Min(nearest_, Min(Min(distances[0], distances[1]), Min(distances[2], distances[3])));
+    }
+    #endif
+    
+    /// Ray.
+    const Ray& ray_;
+    /// Nearest hit distance so far.
+    float nearest_;
+    /// Vertices of the collected triangles, first vertices first.
+    const Vector3* vertices_[12];
+    /// Number of collected triangles.
+    unsigned numTriangles_;
+};
+
 Vector3 Ray::Project(const Vector3& point) const
 {
     Vector3 offset = point - origin_;
@@ -158,6 +270,69 @@ float Ray::HitDistance(const BoundingBox& box) const
     return dist;
 }
 
+void Ray::HitDistanceFast(const BoundingBoxBlock* blocks, unsigned numBlocks, float* distances) const
+{
+    // Avoid division by zero when the ray is parallel to an axis
+    Vector3 invDirection(1.0f / (direction_.x_ != 0.0f ? direction_.x_ : 1e-20f), 1.0f / (direction_.y_ != 0.0f ?
+        direction_.y_ : 1e-20f), 1.0f / (direction_.z_ != 0.0f ? direction_.z_ : 1e-20f));
+    
+    #ifdef USE_SSE
+    __m128 originX = _mm_set1_ps(origin_.x_);
+    __m128 originY = _mm_set1_ps(origin_.y_);
+    __m128 originZ = _mm_set1_ps(origin_.z_);
+    __m128 invDirX = _mm_set1_ps(invDirection.x_);
+    __m128 invDirY = _mm_set1_ps(invDirection.y_);
+    __m128 invDirZ = _mm_set1_ps(invDirection.z_);
+    __m128 zero = _mm_setzero_ps();
+    __m128 infinity = _mm_set1_ps(M_INFINITY);
+    
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        const BoundingBoxBlock& block = blocks[i];
+        __m128 centerX = _mm_sub_ps(_mm_loadu_ps(block.centerX_), originX);
+        __m128 centerY = _mm_sub_ps(_mm_loadu_ps(block.centerY_), originY);
+        __m128 centerZ = _mm_sub_ps(_mm_loadu_ps(block.centerZ_), originZ);
+        __m128 edgeX = _mm_loadu_ps(block.edgeX_);
+        __m128 edgeY = _mm_loadu_ps(block.edgeY_);
+        __m128 edgeZ = _mm_loadu_ps(block.edgeZ_);
+        
+        // Intersect the slabs of each axis. The hit distance is zero if the origin is inside
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(centerX, edgeX), invDirX);
+        __m128 t2 = _mm_mul_ps(_mm_add_ps(centerX, edgeX), invDirX);
+        __m128 nearDist = _mm_max_ps(_mm_min_ps(t1, t2), zero);
+        __m128 farDist = _mm_max_ps(t1, t2);
+        t1 = _mm_mul_ps(_mm_sub_ps(centerY, edgeY), invDirY);
+        t2 = _mm_mul_ps(_mm_add_ps(centerY, edgeY), invDirY);
+        nearDist = _mm_max_ps(nearDist, _mm_min_ps(t1, t2));
+        farDist = _mm_min_ps(farDist, _mm_max_ps(t1, t2));
+        t1 = _mm_mul_ps(_mm_sub_ps(centerZ, edgeZ), invDirZ);
+        t2 = _mm_mul_ps(_mm_add_ps(centerZ, edgeZ), invDirZ);
+        nearDist = _mm_max_ps(nearDist, _mm_min_ps(t1, t2));
+        farDist = _mm_min_ps(farDist, _mm_max_ps(t1, t2));
+        
+        __m128 hit = _mm_cmple_ps(nearDist, farDist);
+        _mm_storeu_ps(distances + i * BOUNDING_BOX_BLOCK_SIZE, _mm_or_ps(_mm_and_ps(hit, nearDist), _mm_andnot_ps(hit,
+            infinity)));
+    }
+    #else
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        const BoundingBoxBlock& block = blocks[i];
+        
+        for (unsigned j = 0; j < BOUNDING_BOX_BLOCK_SIZE; ++j)
+        {
+            Vector3 center(block.centerX_[j] - origin_.x_, block.centerY_[j] - origin_.y_, block.centerZ_[j] - origin_.z_);
+            Vector3 edge(block.edgeX_[j], block.edgeY_[j], block.edgeZ_[j]);
+            Vector3 t1 = (center - edge) * invDirection;
+            Vector3 t2 = (center + edge) * invDirection;
+            float nearDist = Max(Max(Min(t1.x_, t2.x_), Min(t1.y_, t2.y_)), Max(Min(t1.z_, t2.z_), 0.0f));
+            float farDist = Min(Min(Max(t1.x_, t2.x_), Max(t1.y_, t2.y_)), Max(t1.z_, t2.z_));
+            distances[i * BOUNDING_BOX_BLOCK_SIZE + j] = nearDist <= farDist ? nearDist : M_INFINITY;
+        }
+    }
+    #endif
+}
+
 float Ray::HitDistance(const Frustum& frustum, bool solidInside) const
 {
     float maxOutside = 0.0f;
@@ -248,7 +423,7 @@ float Ray::HitDistance(const Vector3& v0, const Vector3& v1, const Vector3& v2)
 
 float Ray::HitDistance(const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount) const
 {
-    float nearest = M_INFINITY;
+    TriangleHitTest test(*this);
     const unsigned char* vertices = ((const unsigned char*)vertexData) + vertexStart * vertexSize;
     unsigned index = 0;
     
@@ -257,17 +432,17 @@ float Ray::HitDistance(const void* vertexData, unsigned vertexSize, unsigned ver
         const Vector3& v0 = *((const Vector3*)(&vertices[index * vertexSize]));
         const Vector3& v1 = *((const Vector3*)(&vertices[(index + 1) * vertexSize]));
         const Vector3& v2 = *((const Vector3*)(&vertices[(index + 2) * vertexSize]));
-        nearest = Min(nearest, HitDistance(v0, v1, v2));
+        test.AddTriangle(v0, v1, v2);
         index += 3;
     }
     
-    return nearest;
+    return test.GetNearest();
 }
 
 float Ray::HitDistance(const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize,
     unsigned indexStart, unsigned indexCount) const
 {
-    float nearest = M_INFINITY;
+    TriangleHitTest test(*this);
     const unsigned char* vertices = (const unsigned char*)vertexData;
     
     // 16-bit indices
@@ -281,7 +456,7 @@ float Ray::HitDistance(const void* vertexData, unsigned vertexSize, const void*
             const Vector3& v0 = *((const Vector3*)(&vertices[indices[0] * vertexSize]));
             const Vector3& v1 = *((const Vector3*)(&vertices[indices[1] * vertexSize]));
             const Vector3& v2 = *((const Vector3*)(&vertices[indices[2] * vertexSize]));
-            nearest = Min(nearest, HitDistance(v0, v1, v2));
+            test.AddTriangle(v0, v1, v2);
             indices += 3;
         }
     }
@@ -296,12 +471,12 @@ float Ray::HitDistance(const void* vertexData, unsigned vertexSize, const void*
             const Vector3& v0 = *((const Vector3*)(&vertices[indices[0] * vertexSize]));
             const Vector3& v1 = *((const Vector3*)(&vertices[indices[1] * vertexSize]));
             const Vector3& v2 = *((const Vector3*)(&vertices[indices[2] * vertexSize]));
-            nearest = Min(nearest, HitDistance(v0, v1, v2));
+            test.AddTriangle(v0, v1, v2);
             indices += 3;
         }
     }
     
-    return nearest;
+    return test.GetNearest();
 }
 
 bool Ray::InsideGeometry(const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount) const
@@ -31,6 +31,7 @@ class BoundingBox;
 class Frustum;
 class Plane;
 class Sphere;
+struct BoundingBoxBlock;
 
 /// Infinite straight line in three-dimensional space.
 class URHO3D_API Ray
@@ -85,6 +86,8 @@ public:
     float HitDistance(const Plane& plane) const;
     /// Return hit distance to a bounding box, or infinity if no hit.
     float HitDistance(const BoundingBox& box) const;
+    /// Return hit distances to blocks of bounding boxes, testing four boxes at a time. Writes infinity for no hit. The distances may differ very slightly from the single bounding box test, so they should be used for culling only.
+    void HitDistanceFast(const BoundingBoxBlock* blocks, unsigned numBlocks, float* distances) const;
     /// Return hit distance to a frustum, or infinity if no hit. If solidInside parameter is true (default) rays originating from inside return zero distance, otherwise the distance to the closest plane.
     float HitDistance(const Frustum& frustum, bool solidInside = true) const;
     /// Return hit distance to a sphere, or infinity if no hit.
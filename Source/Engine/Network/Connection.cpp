@@ -22,6 +22,7 @@
 
 #include "Precompiled.h"
 #include "Component.h"
+#include "Compression.h"
 #include "Connection.h"
 #include "File.h"
 #include "FileSystem.h"
@@ -36,10 +37,12 @@
 #include "ResourceCache.h"
 #include "Scene.h"
 #include "SceneEvents.h"
+#include "SimulatedLink.h"
 #include "SmoothedTransform.h"
 #include "StringUtils.h"
 
 #include <kNet.h>
+#include <kNet/UDPMessageConnection.h>
 
 #include "DebugNew.h"
 
@@ -48,7 +51,57 @@ namespace Urho3D
 
 static const int STATS_INTERVAL_MSEC = 2000;
 
+/// Remote event batch for reliable in-order delivery.
+static const unsigned BATCH_INORDER = 0;
+/// Remote event batch for reliable unordered delivery.
+static const unsigned BATCH_UNORDERED = 1;
+/// Remote event batch for unreliable delivery.
+static const unsigned BATCH_UNRELIABLE = 2;
+
+/// Return the network attributes written by an initial delta update, ie. those that differ from the defaults.
+static DirtyBits GetInitialAttributes(Serializable* object)
+{
+    DirtyBits ret;
+    NetworkState* state = object->GetNetworkState();
+    if (state && state->attributes_)
+    {
+        const Vector<AttributeInfo>& attributes = *state->attributes_;
+        for (unsigned i = 0; i < attributes.Size(); ++i)
+        {
+            if (state->currentValues_[i] != attributes[i].defaultValue_)
+                ret.Set(i);
+        }
+    }
+    return ret;
+}
+
+/// Return the network attributes written by a latest data update.
+static DirtyBits GetLatestDataAttributes(Serializable* object)
+{
+    DirtyBits ret;
+    const Vector<AttributeInfo>* attributes = object->GetNetworkAttributes();
+    if (attributes)
+    {
+        for (unsigned i = 0; i < attributes->Size(); ++i)
+        {
+            if (attributes->At(i).mode_ & AM_LATESTDATA)
+                ret.Set(i);
+        }
+    }
+    return ret;
+}
+
+/// Return checksum of a package file fragment for resuming downloads.
+static unsigned GetFragmentChecksum(const unsigned char* data, unsigned size)
+{
+    unsigned checksum = 0;
+    for (unsigned i = 0; i < size; ++i)
+        checksum = SDBMHash(checksum, data[i]);
+    return checksum;
+}
+
 PackageDownload::PackageDownload() :
+    fileSize_(0),
     totalFragments_(0),
     checksum_(0),
     initiated_(false)
@@ -65,14 +118,36 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
     Object(context),
     position_(Vector3::ZERO),
     connection_(connection),
+    packageBudget_(0),
+    bytesSent_(0),
+    resendsBase_(0),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
-    logStatistics_(false)
+    logStatistics_(false),
+    collectStatistics_(false)
 {
     sceneState_.connection_ = this;
 }
 
+Connection::Connection(Context* context, bool isClient, SimulatedLink* link) :
+    Object(context),
+    position_(Vector3::ZERO),
+    link_(link),
+    packageBudget_(0),
+    bytesSent_(0),
+    resendsBase_(0),
+    isClient_(isClient),
+    connectPending_(false),
+    sceneLoaded_(false),
+    logStatistics_(false),
+    collectStatistics_(false)
+{
+    sceneState_.connection_ = this;
+    if (link_)
+        link_->SetEndpoint(this, isClient_);
+}
+
 Connection::~Connection()
 {
     // Reset scene (remove possible owner references), as this connection is about to be destroyed
@@ -94,7 +169,14 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         return;
     }
     
-    connection_->SendMessage(msgID, reliable, inOrder, 0, contentID, (const char*)data, numBytes);
+    if (connection_)
+        connection_->SendMessage(msgID, reliable, inOrder, 0, contentID, (const char*)data, numBytes);
+    else if (link_)
+        link_->Send(this, msgID, reliable, inOrder, data, numBytes, contentID);
+    
+    bytesSent_ += numBytes;
+    if (collectStatistics_)
+        statistics_.total_.Add(numBytes);
 }
 
 void Connection::SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
@@ -212,30 +294,61 @@ void Connection::SetLogStatistics(bool enable)
     logStatistics_ = enable;
 }
 
+void Connection::ResetStatistics()
+{
+    statistics_.Clear();
+    resendsBase_ = GetNumResends();
+}
+
 void Connection::Disconnect(int waitMSec)
 {
-    connection_->Disconnect(waitMSec);
+    if (connection_)
+        connection_->Disconnect(waitMSec);
 }
 
 void Connection::SendServerUpdate()
 {
+    Network* network = GetSubsystem<Network>();
+    collectStatistics_ = network && network->GetCollectStatistics();
+    if (collectStatistics_)
+        statistics_.resends_ = GetNumResends() - resendsBase_;
+    
     if (!scene_ || !sceneLoaded_)
         return;
     
-    // Always check the root node (scene) first so that the scene-wide components get sent first,
-    // and all other replicated nodes get added to the dirty set for sending the initial state
-    unsigned sceneID = scene_->GetID();
-    nodesToProcess_.Insert(sceneID);
-    ProcessNode(sceneID);
+    // Take a snapshot of the dirty nodes. Nodes may stay dirty after processing, for example due to interest management
+    nodesToProcess_.words_ = sceneState_.dirtyNodes_.words_;
+    
+    // Send removals first, so that a removed node's ID can be reused by a new node
+    if (sceneState_.removedNodes_.Size())
+        ProcessRemovedNodes();
+    
+    // Check the root node (scene) first so that the scene-wide components get sent first. When the root node is sent for
+    // the first time, the scene queues all other replicated nodes to be sent as the initial state
+    if (!sceneState_.nodeStates_.Contains(scene_->GetID()))
+        ProcessNewNode(scene_);
+    else
+        ProcessNode(scene_->GetReplicationSlot());
     
     // Then go through all dirtied nodes
-    nodesToProcess_.Insert(sceneState_.dirtyNodes_);
-    nodesToProcess_.Erase(sceneID); // Do not process the root node twice
+    PODVector<unsigned>& words = nodesToProcess_.words_;
+    for (unsigned i = 0; i < words.Size(); ++i)
+    {
+        // Processing clears the bits, including those of depended on nodes later in the same word
+        while (words[i])
+        {
+            unsigned bit = 0;
+            while (!(words[i] & (1U << bit)))
+                ++bit;
+            ProcessNode((i << 5) + bit);
+        }
+    }
     
-    while (nodesToProcess_.Size())
+    // Finally stream the initial state to a newly joined client, limited by the configured bandwidth
+    if (sceneState_.IsSendingInitialState())
     {
-        unsigned nodeID = nodesToProcess_.Front();
-        ProcessNode(nodeID);
+        int bandwidth = network ? network->GetInitialStateBandwidth() : 0;
+        ProcessInitialState(bandwidth > 0 ? (unsigned)Max(bandwidth / network->GetUpdateFps(), 1) : M_MAX_UNSIGNED);
     }
 }
 
@@ -256,7 +369,7 @@ void Connection::SendClientUpdate()
 void Connection::SendRemoteEvents()
 {
     #ifdef ENABLE_LOGGING
-    if (logStatistics_ && statsTimer_.GetMSec(false) > STATS_INTERVAL_MSEC)
+    if (logStatistics_ && connection_ && statsTimer_.GetMSec(false) > STATS_INTERVAL_MSEC)
     {
         statsTimer_.Reset();
         char statsBuffer[256];
@@ -271,45 +384,115 @@ void Connection::SendRemoteEvents()
     
     PROFILE(SendRemoteEvents);
     
+    // Coalesce the events into as few messages as possible, keeping in-order events in the order they were queued
+    Network* network = GetSubsystem<Network>();
     for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
     {
-        msg_.Clear();
-        if (!i->senderID_)
+        const RemoteEventSchema* schema = network->GetRemoteEventSchema(i->eventType_);
+        unsigned index = i->inOrder_ ? BATCH_INORDER : BATCH_UNORDERED;
+        if (schema && !schema->reliable_)
+            index = BATCH_UNRELIABLE;
+        VectorBuffer& batch = remoteEventBatches_[index];
+        
+        unsigned char flags = 0;
+        if (i->senderID_)
+            flags |= REMOTEEVENT_NODE;
+        if (schema)
+            flags |= REMOTEEVENT_SCHEMA;
+        batch.WriteUByte(flags);
+        batch.WriteStringHash(i->eventType_);
+        if (i->senderID_)
+            batch.WriteNetID(i->senderID_);
+        
+        if (schema)
         {
-            msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTEEVENT, true, i->inOrder_, msg_);
+            // Write only the values, substituting the default for a missing parameter or one of the wrong type
+            for (unsigned j = 0; j < schema->names_.Size(); ++j)
+            {
+                const Variant& defaultValue = schema->defaults_[j];
+                VariantMap::ConstIterator k = i->eventData_.Find(schema->names_[j]);
+                if (k != i->eventData_.End() && k->second_.GetType() == defaultValue.GetType())
+                    batch.WriteVariantData(k->second_);
+                else
+                    batch.WriteVariantData(defaultValue);
+            }
         }
         else
-        {
-            msg_.WriteNetID(i->senderID_);
-            msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTENODEEVENT, true, i->inOrder_, msg_);
-        }
+            batch.WriteVariantMap(i->eventData_);
+        
+        if (batch.GetSize() >= REMOTE_EVENT_BATCH_SIZE)
+            SendRemoteEventBatch(index);
     }
     
+    SendRemoteEventBatch(BATCH_INORDER);
+    SendRemoteEventBatch(BATCH_UNORDERED);
+    SendRemoteEventBatch(BATCH_UNRELIABLE);
+    
     remoteEvents_.Clear();
 }
 
 void Connection::SendPackages()
 {
-    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() < 1000)
+    if (uploads_.Empty())
+    {
+        packageBudget_ = 0;
+        return;
+    }
+    
+    // Add this update's share of the package bandwidth. Unused budget is not accumulated, so that package data never
+    // bursts over the limit, while an overdraft from the last fragment is paid back during the next update
+    Network* network = GetSubsystem<Network>();
+    int bandwidth = network->GetPackageBandwidth();
+    if (bandwidth)
+    {
+        int updateBudget = Max(bandwidth / network->GetUpdateFps(), 1);
+        packageBudget_ = Min(packageBudget_ + updateBudget, updateBudget);
+    }
+    
+    bool compress = network->GetPackageCompression();
+    unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+    // Compressed data is only sent when it is smaller than the fragment, so twice the fragment size is enough
+    unsigned char compressBuffer[PACKAGE_FRAGMENT_SIZE * 2];
+    
+    while (!uploads_.Empty() && (!connection_ || connection_->NumOutboundMessagesPending() < 1000) && (!bandwidth ||
+        packageBudget_ > 0))
     {
-        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
-        
         for (HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Begin(); i != uploads_.End();)
         {
+            if (bandwidth && packageBudget_ <= 0)
+                break;
+            
             HashMap<StringHash, PackageUpload>::Iterator current = i++;
             PackageUpload& upload = current->second_;
+            unsigned index = upload.fragment_++;
             unsigned fragmentSize = Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)PACKAGE_FRAGMENT_SIZE);
             upload.file_->Read(buffer, fragmentSize);
             
             msg_.Clear();
             msg_.WriteStringHash(current->first_);
-            msg_.WriteUInt(upload.fragment_++);
-            msg_.Write(buffer, fragmentSize);
+            msg_.WriteUInt(index);
+            
+            if (index < upload.clientChecksums_.Size() && upload.clientChecksums_[index] == GetFragmentChecksum(buffer,
+                fragmentSize))
+            {
+                // The client already has this fragment from an interrupted download, so only confirm it
+                msg_.WriteVLE(0);
+            }
+            else
+            {
+                // The data is compressed if it is shorter than the fragment size
+                msg_.WriteVLE(fragmentSize);
+                unsigned compressedSize = compress ? CompressData(compressBuffer, buffer, fragmentSize) : 0;
+                if (compressedSize && compressedSize < fragmentSize)
+                    msg_.Write(compressBuffer, compressedSize);
+                else
+                    msg_.Write(buffer, fragmentSize);
+            }
+            
             SendMessage(MSG_PACKAGEDATA, true, false, msg_);
+            packageBudget_ -= msg_.GetSize();
+            if (collectStatistics_)
+                statistics_.packages_.Add(msg_.GetSize());
             
             // Check if upload finished
             if (upload.fragment_ == upload.totalFragments_)
@@ -397,9 +580,8 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer &msg)
             ProcessSceneUpdate(msgID, msg);
             break;
             
-        case MSG_REMOTEEVENT:
-        case MSG_REMOTENODEEVENT:
-            ProcessRemoteEvent(msgID, msg);
+        case MSG_REMOTEEVENTS:
+            ProcessRemoteEvents(msgID, msg);
             break;
             
         default:
@@ -626,6 +808,8 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
                 node->ReadLatestDataUpdate(msg);
                 // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
                 // Furthermore it would propagate to components and child nodes, which is not desired in this case
+                // Any data cached before the node was created is now stale and must not be applied over this
+                nodeLatestData_.Erase(nodeID);
             }
             else
             {
@@ -703,6 +887,8 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             {
                 component->ReadLatestDataUpdate(msg);
                 component->ApplyAttributes();
+                // Any data cached before the component was created is now stale and must not be applied over this
+                componentLatestData_.Erase(componentID);
             }
             else
             {
@@ -774,9 +960,20 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                     
                     LOGINFO("Transmitting package file " + name + " to client " + ToString());
                     
-                    uploads_[nameHash].file_ = file;
-                    uploads_[nameHash].fragment_ = 0;
-                    uploads_[nameHash].totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    PackageUpload& upload = uploads_[nameHash];
+                    upload.file_ = file;
+                    upload.fragment_ = 0;
+                    upload.totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    
+                    // Read the checksums of fragments the client already has from an interrupted download, if any
+                    upload.clientChecksums_.Clear();
+                    if (!msg.IsEof())
+                    {
+                        unsigned numChecksums = Min((int)msg.ReadVLE(), (int)upload.totalFragments_);
+                        upload.clientChecksums_.Resize(numChecksums);
+                        for (unsigned j = 0; j < numChecksums; ++j)
+                            upload.clientChecksums_[j] = msg.ReadUInt();
+                    }
                     return;
                 }
             }
@@ -824,12 +1021,44 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 }
             }
             
-            // Write the fragment data to the proper index
             unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
             unsigned index = msg.ReadUInt();
-            unsigned fragmentSize = msg.GetSize() - msg.GetPosition();
+            unsigned fragmentSize = msg.ReadVLE();
+            if (index >= download.totalFragments_ || fragmentSize > PACKAGE_FRAGMENT_SIZE)
+            {
+                OnPackageDownloadFailed(download.name_);
+                return;
+            }
+            
+            if (!fragmentSize)
+            {
+                // Server confirmed that the partial file from an interrupted download has the correct data
+                fragmentSize = Min((int)(download.fileSize_ - index * PACKAGE_FRAGMENT_SIZE), (int)PACKAGE_FRAGMENT_SIZE);
+                bool success = download.resumeFile_ && download.resumeFile_->Seek(index * PACKAGE_FRAGMENT_SIZE) ==
+                    index * PACKAGE_FRAGMENT_SIZE && download.resumeFile_->Read(buffer, fragmentSize) == fragmentSize;
+                if (!success)
+                {
+                    OnPackageDownloadFailed(download.name_);
+                    return;
+                }
+            }
+            else
+            {
+                // If the data is shorter than the fragment, it is compressed
+                unsigned dataSize = msg.GetSize() - msg.GetPosition();
+                if (dataSize < fragmentSize)
+                {
+                    if (DecompressData(buffer, fragmentSize, msg.GetData() + msg.GetPosition(), dataSize) != fragmentSize)
+                    {
+                        OnPackageDownloadFailed(download.name_);
+                        return;
+                    }
+                }
+                else
+                    msg.Read(buffer, fragmentSize);
+            }
             
-            msg.Read(buffer, fragmentSize);
+            // Write the fragment data to the proper index
             download.file_->Seek(index * PACKAGE_FRAGMENT_SIZE);
             download.file_->Write(buffer, fragmentSize);
             download.receivedFragments_.Insert(index);
@@ -839,9 +1068,23 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
             {
                 LOGINFO("Package " + download.name_ + " downloaded successfully");
                 
-                // Instantiate the package and add to the resource system, as we will need it to load the scene
+                // The partial file of an interrupted download is no longer needed
                 download.file_->Close();
+                if (download.resumeFile_)
+                {
+                    String resumeFileName = download.resumeFile_->GetName();
+                    download.resumeFile_->Close();
+                    GetSubsystem<FileSystem>()->Delete(resumeFileName);
+                }
+                
+                // Instantiate the package and add to the resource system, as we will need it to load the scene
                 SharedPtr<PackageFile> newPackage(new PackageFile(context_, download.file_->GetName()));
+                if (newPackage->GetTotalSize() != download.fileSize_ || newPackage->GetChecksum() != download.checksum_)
+                {
+                    GetSubsystem<FileSystem>()->Delete(download.file_->GetName());
+                    OnPackageDownloadFailed(download.name_);
+                    return;
+                }
                 GetSubsystem<ResourceCache>()->AddPackageFile(newPackage, true);
                 
                 // Then start the next download if there are more
@@ -849,15 +1092,7 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 if (downloads_.Empty())
                     OnPackagesReady();
                 else
-                {
-                    PackageDownload& nextDownload = downloads_.Begin()->second_;
-                    
-                    LOGINFO("Requesting package " + nextDownload.name_ + " from server");
-                    msg_.Clear();
-                    msg_.WriteString(nextDownload.name_);
-                    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-                    nextDownload.initiated_ = true;
-                }
+                    SendPackageRequest(downloads_.Begin()->second_);
             }
         }
         break;
@@ -939,48 +1174,60 @@ void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
     }
 }
 
-void Connection::ProcessRemoteEvent(int msgID, MemoryBuffer& msg)
+void Connection::ProcessRemoteEvents(int msgID, MemoryBuffer& msg)
 {
     using namespace RemoteEventData;
     
-    if (msgID == MSG_REMOTEEVENT)
+    Network* network = GetSubsystem<Network>();
+    
+    while (!msg.IsEof())
     {
+        unsigned char flags = msg.ReadUByte();
         StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
-        {
-            LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
-        }
+        unsigned nodeID = (flags & REMOTEEVENT_NODE) ? msg.ReadNetID() : 0;
         
-        VariantMap eventData = msg.ReadVariantMap();
-        eventData[P_CONNECTION] = (void*)this;
-        SendEvent(eventType, eventData);
-    }
-    else
-    {
-        if (!scene_)
+        // The event data must be read even if the event is discarded, to get to the next event
+        VariantMap eventData;
+        if (flags & REMOTEEVENT_SCHEMA)
         {
-            LOGERROR("Can not receive remote node event without an assigned scene");
-            return;
+            const RemoteEventSchema* schema = network->GetRemoteEventSchema(eventType);
+            if (!schema)
+            {
+                LOGERROR("No schema for remote event " + eventType.ToString() + ", discarding the rest of the message");
+                return;
+            }
+            for (unsigned i = 0; i < schema->names_.Size(); ++i)
+                eventData[schema->names_[i]] = msg.ReadVariant(schema->defaults_[i].GetType());
         }
+        else
+            eventData = msg.ReadVariantMap();
         
-        unsigned nodeID = msg.ReadNetID();
-        StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
+        if (!network->CheckRemoteEvent(eventType))
         {
             LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
+            continue;
         }
         
-        VariantMap eventData = msg.ReadVariantMap();
-        Node* sender = scene_->GetNode(nodeID);
-        if (!sender)
+        eventData[P_CONNECTION] = (void*)this;
+        
+        if (!nodeID)
+            SendEvent(eventType, eventData);
+        else
         {
-            LOGWARNING("Missing sender for remote node event, discarding");
-            return;
+            if (!scene_)
+            {
+                LOGERROR("Can not receive remote node event without an assigned scene");
+                continue;
+            }
+            
+            Node* sender = scene_->GetNode(nodeID);
+            if (!sender)
+            {
+                LOGWARNING("Missing sender for remote node event, discarding");
+                continue;
+            }
+            sender->SendEvent(eventType, eventData);
         }
-        eventData[P_CONNECTION] = (void*)this;
-        sender->SendEvent(eventType, eventData);
     }
 }
 
@@ -989,6 +1236,11 @@ kNet::MessageConnection* Connection::GetMessageConnection() const
     return const_cast<kNet::MessageConnection*>(connection_.ptr());
 }
 
+SimulatedLink* Connection::GetSimulatedLink() const
+{
+    return link_;
+}
+
 Scene* Connection::GetScene() const
 {
     return scene_;
@@ -996,11 +1248,17 @@ Scene* Connection::GetScene() const
 
 bool Connection::IsConnected() const
 {
-    return connection_->GetConnectionState() == kNet::ConnectionOK;
+    if (connection_)
+        return connection_->GetConnectionState() == kNet::ConnectionOK;
+    else
+        return link_.NotNull();
 }
 
 String Connection::GetAddress() const
 {
+    if (!connection_)
+        return "simulated";
+    
     kNet::EndPoint endPoint = connection_->RemoteEndPoint();
     ///\todo Not IPv6-capable.
     return Urho3D::ToString("%d.%d.%d.%d", endPoint.ip[0], endPoint.ip[1], endPoint.ip[2], endPoint.ip[3]);
@@ -1008,7 +1266,7 @@ String Connection::GetAddress() const
 
 unsigned short Connection::GetPort() const
 {
-    return connection_->RemoteEndPoint().port;
+    return connection_ ? connection_->RemoteEndPoint().port : 0;
 }
 
 String Connection::ToString() const
@@ -1016,6 +1274,17 @@ String Connection::ToString() const
     return GetAddress() + ":" + String(GetPort());
 }
 
+unsigned Connection::GetNumResends() const
+{
+    kNet::MessageConnection* connection = GetMessageConnection();
+    if (connection && connection->GetSocket() && connection->GetSocket()->TransportLayer() == kNet::SocketOverUDP)
+        return (unsigned)static_cast<kNet::UDPMessageConnection*>(connection)->NumResentMessages();
+    else if (link_)
+        return link_->GetStatistics(isClient_).resends_;
+    else
+        return 0;
+}
+
 unsigned Connection::GetNumDownloads() const
 {
     return downloads_.Size();
@@ -1050,56 +1319,111 @@ void Connection::HandleAsyncLoadFinished(StringHash eventType, VariantMap& event
     SendMessage(MSG_SCENELOADED, true, true, msg_);
 }
 
-void Connection::ProcessNode(unsigned nodeID)
+void Connection::ProcessNode(unsigned slot)
 {
     // Check that we have not already processed this due to dependency recursion
-    if (!nodesToProcess_.Erase(nodeID))
+    if (!nodesToProcess_.IsSet(slot))
+        return;
+    nodesToProcess_.Clear(slot);
+    
+    Node* node = scene_->GetReplicationSlotNode(slot);
+    if (!node)
+    {
+        // The node has been removed (removal is sent separately) and the slot is not in use: erase from dirty set
+        sceneState_.dirtyNodes_.Clear(slot);
         return;
+    }
     
     // Find replication state for the node
-    HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(nodeID);
+    HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Find(node->GetID());
     if (i != sceneState_.nodeStates_.End())
+        ProcessExistingNode(node, i->second_);
+    else if (!sceneState_.pendingNodes_.IsSet(slot))
+        ProcessNewNode(node);
+    // Else the node is part of the initial state and will be sent in its turn. Until then it stays dirty
+}
+
+void Connection::ProcessDependencyNodes(Node* node)
+{
+    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
+    for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
     {
-        // Replication state found: the node is either be existing or removed
-        Node* node = i->second_.node_;
-        if (!node)
-        {
-            msg_.Clear();
-            msg_.WriteNetID(nodeID);
-            
-            // Note: we will send MSG_REMOVENODE redundantly for each node in the hierarchy, even if removing the root node
-            // would be enough. However, this may be better due to the client not possibly having updated parenting
-            // information at the time of receiving this message
-            SendMessage(MSG_REMOVENODE, true, true, msg_);
-            sceneState_.nodeStates_.Erase(nodeID);
-        }
-        else
-            ProcessExistingNode(node, i->second_);
+        unsigned slot = (*i)->GetReplicationSlot();
+        // A depended on node that is still waiting in the initial state must be sent now for the client to resolve it
+        if (sceneState_.pendingNodes_.IsSet(slot))
+            ProcessNewNode(*i);
+        else if (sceneState_.dirtyNodes_.IsSet(slot))
+            ProcessNode(slot);
     }
-    else
+}
+
+void Connection::ProcessRemovedNodes()
+{
+    for (PODVector<unsigned>::ConstIterator i = sceneState_.removedNodes_.Begin(); i != sceneState_.removedNodes_.End(); ++i)
     {
-        // Replication state not found: this is a new node
-        Node* node = scene_->GetNode(nodeID);
+        unsigned nodeID = *i;
+        HashMap<unsigned, NodeReplicationState>::Iterator j = sceneState_.nodeStates_.Find(nodeID);
+        // Skip nodes the client never received
+        if (j == sceneState_.nodeStates_.End())
+            continue;
+        
+        Node* node = j->second_.node_;
         if (node)
-            ProcessNewNode(node);
-        else
         {
-            // Did not find the new node (may have been created, then removed immediately): erase from dirty set.
-            sceneState_.dirtyNodes_.Erase(nodeID);
+            // The node has left the scene but is still referenced elsewhere. Detach the replication states to be erased
+            node->CleanupConnection(this);
+            const Vector<SharedPtr<Component> >& components = node->GetComponents();
+            for (Vector<SharedPtr<Component> >::ConstIterator k = components.Begin(); k != components.End(); ++k)
+                (*k)->CleanupConnection(this);
         }
+        
+        msg_.Clear();
+        msg_.WriteNetID(nodeID);
+        
+        // Note: we will send MSG_REMOVENODE redundantly for each node in the hierarchy, even if removing the root node
+        // would be enough. However, this may be better due to the client not possibly having updated parenting
+        // information at the time of receiving this message
+        SendMessage(MSG_REMOVENODE, true, true, msg_);
+        if (collectStatistics_)
+            statistics_.nodes_[nodeID].Add(msg_.GetSize());
+        sceneState_.nodeStates_.Erase(j);
     }
+    
+    sceneState_.removedNodes_.Clear();
 }
 
-void Connection::ProcessNewNode(Node* node)
+void Connection::ProcessInitialState(unsigned maxBytes)
 {
-    // Process depended upon nodes first, if they are dirty
-    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
-    for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
+    // Count all messages sent, including those of the nodes the processed nodes depend on
+    unsigned startBytes = bytesSent_;
+    
+    while (sceneState_.IsSendingInitialState() && bytesSent_ - startBytes < maxBytes)
+    {
+        unsigned nodeID = sceneState_.initialNodes_[sceneState_.initialNodeIndex_++];
+        Node* node = scene_->GetNode(nodeID);
+        // Skip nodes that have been removed, or already sent due to being depended on or dirtied
+        if (!node || !sceneState_.pendingNodes_.IsSet(node->GetReplicationSlot()))
+            continue;
+        
+        ProcessNewNode(node);
+    }
+    
+    if (!sceneState_.IsSendingInitialState())
     {
-        unsigned nodeID = (*i)->GetID();
-        if (sceneState_.dirtyNodes_.Contains(nodeID))
-            ProcessNode(nodeID);
+        sceneState_.initialNodes_.Clear();
+        sceneState_.initialNodeIndex_ = 0;
     }
+}
+
+void Connection::ProcessNewNode(Node* node)
+{
+    // Mark as processed first to guard against dependency recursion
+    unsigned slot = node->GetReplicationSlot();
+    sceneState_.pendingNodes_.Clear(slot);
+    nodesToProcess_.Clear(slot);
+    
+    // Process depended upon nodes first
+    ProcessDependencyNodes(node);
     
     msg_.Clear();
     msg_.WriteNetID(node->GetID());
@@ -1122,6 +1446,9 @@ void Connection::ProcessNewNode(Node* node)
         msg_.WriteVariant(i->second_);
     }
     
+    if (collectStatistics_)
+        AddTypeStatistics(node, msg_.GetSize(), GetInitialAttributes(node));
+    
     // Write node's components
     msg_.WriteVLE(node->GetNumNetworkComponents());
     const Vector<SharedPtr<Component> >& components = node->GetComponents();
@@ -1138,27 +1465,27 @@ void Connection::ProcessNewNode(Node* node)
         componentState.component_ = component;
         component->AddReplicationState(&componentState);
         
+        unsigned componentStart = msg_.GetSize();
         msg_.WriteShortStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
         component->WriteInitialDeltaUpdate(msg_);
+        
+        if (collectStatistics_)
+            AddTypeStatistics(component, msg_.GetSize() - componentStart, GetInitialAttributes(component));
     }
     
     SendMessage(MSG_CREATENODE, true, true, msg_);
+    if (collectStatistics_)
+        statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
     
     nodeState.markedDirty_ = false;
-    sceneState_.dirtyNodes_.Erase(node->GetID());
+    sceneState_.dirtyNodes_.Clear(slot);
 }
 
 void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState)
 {
     // Process depended upon nodes first, if they are dirty
-    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
-    for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
-    {
-        unsigned nodeID = (*i)->GetID();
-        if (sceneState_.dirtyNodes_.Contains(nodeID))
-            ProcessNode(nodeID);
-    }
+    ProcessDependencyNodes(node);
     
     // Check from the interest management component, if exists, whether should update
     /// \todo Searching for the component is a potential CPU hotspot. It should be cached
@@ -1194,6 +1521,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             node->WriteLatestDataUpdate(msg_);
             
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
+            if (collectStatistics_)
+            {
+                statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
+                AddTypeStatistics(node, msg_.GetSize(), GetLatestDataAttributes(node));
+            }
         }
         
         // Send deltaupdate if remaining dirty bits, or vars have changed
@@ -1224,6 +1556,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             }
             
             SendMessage(MSG_NODEDELTAUPDATE, true, true, msg_);
+            if (collectStatistics_)
+            {
+                statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
+                AddTypeStatistics(node, msg_.GetSize(), nodeState.dirtyAttributes_);
+            }
             
             nodeState.dirtyAttributes_.ClearAll();
             nodeState.dirtyVars_.Clear();
@@ -1244,6 +1581,8 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.WriteNetID(current->first_);
             
             SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
+            if (collectStatistics_)
+                statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
             nodeState.componentStates_.Erase(current);
         }
         else
@@ -1272,6 +1611,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     component->WriteLatestDataUpdate(msg_);
                     
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
+                    if (collectStatistics_)
+                    {
+                        statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
+                        AddTypeStatistics(component, msg_.GetSize(), GetLatestDataAttributes(component));
+                    }
                 }
                 
                 // Send deltaupdate if remaining dirty bits
@@ -1282,6 +1626,11 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                     component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_);
                     
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
+                    if (collectStatistics_)
+                    {
+                        statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
+                        AddTypeStatistics(component, msg_.GetSize(), componentState.dirtyAttributes_);
+                    }
                     
                     componentState.dirtyAttributes_.ClearAll();
                 }
@@ -1317,12 +1666,44 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 component->WriteInitialDeltaUpdate(msg_);
                 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
+                if (collectStatistics_)
+                {
+                    statistics_.nodes_[node->GetID()].Add(msg_.GetSize());
+                    AddTypeStatistics(component, msg_.GetSize(), GetInitialAttributes(component));
+                }
             }
         }
     }
     
     nodeState.markedDirty_ = false;
-    sceneState_.dirtyNodes_.Erase(node->GetID());
+    sceneState_.dirtyNodes_.Clear(node->GetReplicationSlot());
+}
+
+void Connection::AddTypeStatistics(Serializable* object, unsigned bytes, const DirtyBits& attributeBits)
+{
+    TypeTrafficStatistics& stats = statistics_.types_[object->GetType()];
+    if (stats.typeName_.Empty())
+        stats.typeName_ = object->GetTypeName();
+    stats.total_.Add(bytes);
+    
+    NetworkState* state = object->GetNetworkState();
+    if (!state || !state->attributes_)
+        return;
+    
+    unsigned numAttributes = state->attributes_->Size();
+    while (stats.attributeBytes_.Size() < numAttributes)
+        stats.attributeBytes_.Push(0);
+    
+    // Measure each written attribute by serializing it again
+    for (unsigned i = 0; i < numAttributes; ++i)
+    {
+        if (attributeBits.IsSet(i))
+        {
+            statisticsBuffer_.Clear();
+            statisticsBuffer_.WriteVariantData(state->currentValues_[i]);
+            stats.attributeBytes_[i] += statisticsBuffer_.GetSize();
+        }
+    }
 }
 
 void Connection::RequestPackage(const String& name, unsigned fileSize, unsigned checksum)
@@ -1333,18 +1714,58 @@ void Connection::RequestPackage(const String& name, unsigned fileSize, unsigned
     
     PackageDownload& download = downloads_[nameHash];
     download.name_ = name;
+    download.fileSize_ = fileSize;
     download.totalFragments_ = (fileSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
     download.checksum_ = checksum;
     
     // Start download now only if no existing downloads, else wait for the existing ones to finish
     if (downloads_.Size() == 1)
+        SendPackageRequest(download);
+}
+
+void Connection::SendPackageRequest(PackageDownload& download)
+{
+    LOGINFO("Requesting package " + download.name_ + " from server");
+    msg_.Clear();
+    msg_.WriteString(download.name_);
+    
+    // An incomplete file at the download location is left by an interrupted download. Move it aside, as the download
+    // file will be rewritten, and send the checksums of its fragments so that the server can skip those already correct
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    String fileName = GetSubsystem<Network>()->GetPackageCacheDir() + ToStringHex(download.checksum_) + "_" + download.name_;
+    String resumeFileName = fileName + ".part";
+    if (fileSystem->FileExists(fileName))
     {
-        LOGINFO("Requesting package " + name + " from server");
-        msg_.Clear();
-        msg_.WriteString(name);
-        SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-        download.initiated_ = true;
+        fileSystem->Delete(resumeFileName);
+        fileSystem->Rename(fileName, resumeFileName);
+    }
+    
+    unsigned numFragments = 0;
+    if (fileSystem->FileExists(resumeFileName))
+    {
+        download.resumeFile_ = new File(context_, resumeFileName);
+        if (download.resumeFile_->IsOpen())
+            numFragments = Min((int)((download.resumeFile_->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE),
+                (int)download.totalFragments_);
+        else
+            download.resumeFile_.Reset();
     }
+    
+    msg_.WriteVLE(numFragments);
+    if (numFragments)
+    {
+        LOGINFO("Resuming download of package " + download.name_);
+        
+        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+        for (unsigned i = 0; i < numFragments; ++i)
+        {
+            unsigned fragmentSize = download.resumeFile_->Read(buffer, PACKAGE_FRAGMENT_SIZE);
+            msg_.WriteUInt(GetFragmentChecksum(buffer, fragmentSize));
+        }
+    }
+    
+    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
+    download.initiated_ = true;
 }
 
 void Connection::SendPackageError(const String& name)
@@ -1354,6 +1775,18 @@ void Connection::SendPackageError(const String& name)
     SendMessage(MSG_PACKAGEDATA, true, false, msg_);
 }
 
+void Connection::SendRemoteEventBatch(unsigned index)
+{
+    VectorBuffer& batch = remoteEventBatches_[index];
+    if (!batch.GetSize())
+        return;
+    
+    SendMessage(MSG_REMOTEEVENTS, index != BATCH_UNRELIABLE, index == BATCH_INORDER, batch);
+    if (collectStatistics_)
+        statistics_.remoteEvents_.Add(batch.GetSize());
+    batch.Clear();
+}
+
 void Connection::OnSceneLoadFailed()
 {
     sceneLoaded_ = false;
@@ -24,6 +24,7 @@
 
 #include "Controls.h"
 #include "HashSet.h"
+#include "NetworkStatistics.h"
 #include "Object.h"
 #include "ReplicationState.h"
 #include "Timer.h"
@@ -44,6 +45,7 @@ class MemoryBuffer;
 class Node;
 class Scene;
 class Serializable;
+class SimulatedLink;
 
 /// Queued remote event.
 struct RemoteEvent
@@ -66,10 +68,14 @@ struct PackageDownload
     
     /// Destination file.
     SharedPtr<File> file_;
+    /// Partial file left by an interrupted download, to copy fragments confirmed by the server from.
+    SharedPtr<File> resumeFile_;
     /// Already received fragments.
     HashSet<unsigned> receivedFragments_;
     /// Package name.
     String name_;
+    /// Package file size.
+    unsigned fileSize_;
     /// Total number of fragments.
     unsigned totalFragments_;
     /// Checksum.
@@ -86,6 +92,8 @@ struct PackageUpload
     
     /// Source file.
     SharedPtr<File> file_;
+    /// Fragment checksums of the client's partial file. Matching fragments are confirmed instead of sent.
+    PODVector<unsigned> clientChecksums_;
     /// Current fragment index.
     unsigned fragment_;
     /// Total number of fragments
@@ -100,6 +108,8 @@ class URHO3D_API Connection : public Object
 public:
     /// Construct with context and kNet message connection pointers.
     Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::MessageConnection> connection);
+    /// Construct with context and an in-memory simulated link instead of a kNet connection.
+    Connection(Context* context, bool isClient, SimulatedLink* link);
     /// Destruct.
     ~Connection();
     
@@ -123,6 +133,8 @@ public:
     void SetConnectPending(bool connectPending);
     /// Set whether to log data in/out statistics.
     void SetLogStatistics(bool enable);
+    /// Reset the traffic statistics.
+    void ResetStatistics();
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
@@ -138,8 +150,10 @@ public:
     /// Process a message from the server or client. Called by Network.
     bool ProcessMessage(int msgID, MemoryBuffer& msg);
     
-    /// Return the kNet message connection.
+    /// Return the kNet message connection. Null if using a simulated link.
     kNet::MessageConnection* GetMessageConnection() const;
+    /// Return the simulated link. Null if using a kNet connection.
+    SimulatedLink* GetSimulatedLink() const;
     /// Return client identity.
     const VariantMap& GetIdentity() const { return identity_; }
     /// Return the scene used by this connection.
@@ -158,6 +172,10 @@ public:
     bool IsSceneLoaded() const { return sceneLoaded_; }
     /// Return whether to log data in/out statistics.
     bool GetLogStatistics() const { return logStatistics_; }
+    /// Return traffic statistics. These are collected on the server when enabled with Network::SetCollectStatistics().
+    const NetworkStatistics& GetStatistics() const { return statistics_; }
+    /// Return number of messages resent due to packet loss since the connection was created.
+    unsigned GetNumResends() const;
     /// Return remote address.
     String GetAddress() const;
     /// Return remote port.
@@ -195,27 +213,41 @@ private:
     void ProcessControls(int msgID, MemoryBuffer& msg);
     /// Process a SceneLoaded message from the client. Called by Network.
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
-    /// Process a remote event message from the client or server. Called by Network.
-    void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
-    /// Process a node for sending a network update. Recurses to process depended on node(s) first.
-    void ProcessNode(unsigned nodeID);
+    /// Process a remote events message from the client or server. Called by Network.
+    void ProcessRemoteEvents(int msgID, MemoryBuffer& msg);
+    /// Process a dirty node by replication slot for sending a network update. Recurses to process depended on node(s) first.
+    void ProcessNode(unsigned slot);
+    /// Process nodes that a node depends on, if they are dirty or have not been sent yet.
+    void ProcessDependencyNodes(Node* node);
+    /// Send removal of nodes that the client has received.
+    void ProcessRemovedNodes();
+    /// Send queued initial state nodes up to a byte budget.
+    void ProcessInitialState(unsigned maxBytes);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
     /// Initiate a package download.
     void RequestPackage(const String& name, unsigned fileSize, unsigned checksum);
+    /// Send the request for a queued package download, including checksums of the fragments left by an interrupted download.
+    void SendPackageRequest(PackageDownload& download);
     /// Send an error reply for a package download.
     void SendPackageError(const String& name);
+    /// Send a batch of queued remote events if not empty.
+    void SendRemoteEventBatch(unsigned index);
     /// Handle scene load failure on the server or client.
     void OnSceneLoadFailed();
     /// Handle a package download failure on the client.
     void OnPackageDownloadFailed(const String& name);
     /// Handle all packages loaded successfully. Also called directly on MSG_LOADSCENE if there are none.
     void OnPackagesReady();
+    /// Add the bytes of a node or component update, and the sizes of the attributes it contains, to the type statistics.
+    void AddTypeStatistics(Serializable* object, unsigned bytes, const DirtyBits& attributeBits);
     
     /// kNet message connection.
     kNet::SharedPtr<kNet::MessageConnection> connection_;
+    /// Simulated in-memory link, used instead of the kNet connection for headless testing.
+    SharedPtr<SimulatedLink> link_;
     /// Scene.
     WeakPtr<Scene> scene_;
     /// Network replication state of the scene.
@@ -228,14 +260,26 @@ private:
     HashMap<unsigned, PODVector<unsigned char> > nodeLatestData_;
     /// Pending latest data for not yet received components.
     HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
-    /// Node ID's to process during a replication update.
-    HashSet<unsigned> nodesToProcess_;
+    /// Node replication slots to process during a replication update.
+    SlotBits nodesToProcess_;
     /// Reusable message buffer.
     VectorBuffer msg_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
+    /// Remote event messages being built for in-order, unordered and unreliable delivery.
+    VectorBuffer remoteEventBatches_[3];
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
+    /// Package data bytes that can still be sent within the package bandwidth limit.
+    int packageBudget_;
+    /// Message payload bytes sent, regardless of whether statistics are collected.
+    unsigned bytesSent_;
+    /// Traffic statistics.
+    NetworkStatistics statistics_;
+    /// Buffer for measuring attribute sizes for the statistics.
+    VectorBuffer statisticsBuffer_;
+    /// Resend count when the statistics were last reset.
+    unsigned resendsBase_;
     /// Statistics timer.
     Timer statsTimer_;
     /// Client connection flag.
@@ -246,6 +290,8 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Collect traffic statistics flag, updated on each server update.
+    bool collectStatistics_;
 };
 
 }
@@ -23,6 +23,7 @@
 #include "Precompiled.h"
 #include "Context.h"
 #include "CoreEvents.h"
+#include "File.h"
 #include "FileSystem.h"
 #include "Log.h"
 #include "MemoryBuffer.h"
@@ -32,6 +33,7 @@
 #include "Profiler.h"
 #include "Protocol.h"
 #include "Scene.h"
+#include "Sort.h"
 #include "StringUtils.h"
 
 #include <kNet.h>
@@ -43,11 +45,49 @@ namespace Urho3D
 
 static const int DEFAULT_UPDATE_FPS = 30;
 
+/// Node replication traffic for sorting.
+struct NodeTraffic
+{
+    /// Node ID.
+    unsigned nodeID_;
+    /// Traffic.
+    TrafficCounter traffic_;
+};
+
+/// Compare node replication traffic for sorting the largest first.
+static bool CompareNodeTraffic(const NodeTraffic& lhs, const NodeTraffic& rhs)
+{
+    return lhs.traffic_.bytes_ > rhs.traffic_.bytes_;
+}
+
+/// Compare type replication traffic for sorting the largest first.
+static bool CompareTypeTraffic(const TypeTrafficStatistics* lhs, const TypeTrafficStatistics* rhs)
+{
+    return lhs->total_.bytes_ > rhs->total_.bytes_;
+}
+
+/// Format a traffic counter for the log.
+static String FormatTraffic(const TrafficCounter& traffic)
+{
+    return String(traffic.messages_) + " messages " + String(traffic.bytes_) + " bytes";
+}
+
+/// Format the time per update of a server update phase in milliseconds.
+static String FormatPhaseTime(long long time, unsigned updates)
+{
+    return ToString("%.3f ms", updates ? (float)time / (float)updates * 0.001f : 0.0f);
+}
+
 Network::Network(Context* context) :
     Object(context),
     updateFps_(DEFAULT_UPDATE_FPS),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
-    updateAcc_(0.0f)
+    updateAcc_(0.0f),
+    initialStateBandwidth_(0),
+    packageBandwidth_(0),
+    packageCompression_(false),
+    statisticsInterval_(10000),
+    collectStatistics_(false)
 {
     network_ = new kNet::Network();
     
@@ -289,6 +329,21 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetInitialStateBandwidth(int bytesPerSecond)
+{
+    initialStateBandwidth_ = Max(bytesPerSecond, 0);
+}
+
+void Network::SetPackageBandwidth(int bytesPerSecond)
+{
+    packageBandwidth_ = Max(bytesPerSecond, 0);
+}
+
+void Network::SetPackageCompression(bool enable)
+{
+    packageCompression_ = enable;
+}
+
 void Network::RegisterRemoteEvent(StringHash eventType)
 {
     allowedRemoteEvents_.Insert(eventType);
@@ -304,11 +359,123 @@ void Network::UnregisterAllRemoteEvents()
     allowedRemoteEvents_.Clear();
 }
 
+void Network::SetRemoteEventSchema(StringHash eventType, const VariantMap& parameters, bool reliable)
+{
+    RemoteEventSchema& schema = remoteEventSchemas_[eventType];
+    schema.names_.Clear();
+    schema.defaults_.Clear();
+    schema.reliable_ = reliable;
+    
+    for (VariantMap::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
+        schema.names_.Push(i->first_);
+    Sort(schema.names_.Begin(), schema.names_.End());
+    for (unsigned i = 0; i < schema.names_.Size(); ++i)
+        schema.defaults_.Push(parameters.Find(schema.names_[i])->second_);
+}
+
+void Network::RemoveRemoteEventSchema(StringHash eventType)
+{
+    remoteEventSchemas_.Erase(eventType);
+}
+
 void Network::SetPackageCacheDir(const String& path)
 {
     packageCacheDir_ = AddTrailingSlash(path);
 }
 
+void Network::SetCollectStatistics(bool enable)
+{
+    collectStatistics_ = enable;
+}
+
+bool Network::SetStatisticsFile(const String& fileName, int intervalMSec)
+{
+    statisticsFile_.Reset();
+    statisticsInterval_ = Max(intervalMSec, 0);
+    statisticsTimer_.Reset();
+    
+    if (fileName.Empty())
+        return true;
+    
+    statisticsFile_ = new File(context_, fileName, FILE_WRITE);
+    if (!statisticsFile_->IsOpen())
+    {
+        statisticsFile_.Reset();
+        return false;
+    }
+    
+    // Write tab-separated columns for easy import into analysis tools
+    statisticsFile_->WriteLine("time\tsource\tcategory\tname\tcount\tvalue");
+    return true;
+}
+
+void Network::ResetStatistics()
+{
+    serverStatistics_ = ServerUpdateStatistics();
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+        i->second_->ResetStatistics();
+}
+
+void Network::DumpStatistics(unsigned maxEntries)
+{
+    unsigned updates = serverStatistics_.updates_;
+    LOGINFO("Server updates " + String(updates) + ": prepare " + FormatPhaseTime(serverStatistics_.prepareTime_, updates) +
+        ", replication " + FormatPhaseTime(serverStatistics_.replicationTime_, updates) + ", remote events " +
+        FormatPhaseTime(serverStatistics_.remoteEventTime_, updates) + ", packages " +
+        FormatPhaseTime(serverStatistics_.packageTime_, updates) + " per update, longest update " +
+        FormatPhaseTime(serverStatistics_.maxUpdateTime_, 1));
+    
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::ConstIterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+    {
+        const NetworkStatistics& stats = i->second_->GetStatistics();
+        LOGINFO("Client " + i->second_->ToString() + ": " + FormatTraffic(stats.total_) + ", remote events " +
+            FormatTraffic(stats.remoteEvents_) + ", packages " + FormatTraffic(stats.packages_) + ", resends " +
+            String(stats.resends_));
+        
+        PODVector<NodeTraffic> nodes;
+        for (HashMap<unsigned, TrafficCounter>::ConstIterator j = stats.nodes_.Begin(); j != stats.nodes_.End(); ++j)
+        {
+            NodeTraffic traffic;
+            traffic.nodeID_ = j->first_;
+            traffic.traffic_ = j->second_;
+            nodes.Push(traffic);
+        }
+        Sort(nodes.Begin(), nodes.End(), CompareNodeTraffic);
+        for (unsigned j = 0; j < nodes.Size() && j < maxEntries; ++j)
+            LOGINFO("  Node " + String(nodes[j].nodeID_) + ": " + FormatTraffic(nodes[j].traffic_));
+        
+        PODVector<const TypeTrafficStatistics*> types;
+        for (HashMap<ShortStringHash, TypeTrafficStatistics>::ConstIterator j = stats.types_.Begin(); j != stats.types_.End(); ++j)
+            types.Push(&j->second_);
+        Sort(types.Begin(), types.End(), CompareTypeTraffic);
+        for (unsigned j = 0; j < types.Size() && j < maxEntries; ++j)
+        {
+            const TypeTrafficStatistics& type = *types[j];
+            String line = "  " + type.typeName_ + ": " + FormatTraffic(type.total_);
+            
+            const Vector<AttributeInfo>* attributes = context_->GetNetworkAttributes(ShortStringHash(type.typeName_));
+            if (attributes)
+            {
+                String attributeBytes;
+                for (unsigned k = 0; k < type.attributeBytes_.Size() && k < attributes->Size(); ++k)
+                {
+                    if (!type.attributeBytes_[k])
+                        continue;
+                    if (!attributeBytes.Empty())
+                        attributeBytes += ", ";
+                    attributeBytes += attributes->At(k).name_ + " " + String(type.attributeBytes_[k]);
+                }
+                if (!attributeBytes.Empty())
+                    line += " (" + attributeBytes + ")";
+            }
+            
+            LOGINFO(line);
+        }
+    }
+}
+
 Connection* Network::GetConnection(kNet::MessageConnection* connection) const
 {
     if (serverConnection_ && serverConnection_->GetMessageConnection() == connection)
@@ -348,6 +515,15 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Empty() || allowedRemoteEvents_.Contains(eventType);
 }
 
+const RemoteEventSchema* Network::GetRemoteEventSchema(StringHash eventType) const
+{
+    if (remoteEventSchemas_.Empty())
+        return 0;
+    
+    HashMap<StringHash, RemoteEventSchema>::ConstIterator i = remoteEventSchemas_.Find(eventType);
+    return i != remoteEventSchemas_.End() ? &i->second_ : 0;
+}
+
 void Network::Update(float timeStep)
 {
     PROFILE(UpdateNetwork);
@@ -395,6 +571,9 @@ void Network::PostUpdate(float timeStep)
         
         if (IsServerRunning())
         {
+            HiresTimer phaseTimer;
+            long long updateTime = 0;
+            
             // Collect and prepare all networked scenes
             {
                 PROFILE(PrepareServerUpdate);
@@ -410,6 +589,13 @@ void Network::PostUpdate(float timeStep)
                 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
                     (*i)->PrepareNetworkUpdate();
+                
+                if (collectStatistics_)
+                {
+                    long long time = phaseTimer.GetUSec(true);
+                    serverStatistics_.prepareTime_ += time;
+                    updateTime += time;
+                }
             }
             
             {
@@ -420,8 +606,41 @@ void Network::PostUpdate(float timeStep)
                     i != clientConnections_.End(); ++i)
                 {
                     i->second_->SendServerUpdate();
+                    if (collectStatistics_)
+                    {
+                        long long time = phaseTimer.GetUSec(true);
+                        serverStatistics_.replicationTime_ += time;
+                        updateTime += time;
+                    }
+                    
                     i->second_->SendRemoteEvents();
+                    if (collectStatistics_)
+                    {
+                        long long time = phaseTimer.GetUSec(true);
+                        serverStatistics_.remoteEventTime_ += time;
+                        updateTime += time;
+                    }
+                    
                     i->second_->SendPackages();
+                    if (collectStatistics_)
+                    {
+                        long long time = phaseTimer.GetUSec(true);
+                        serverStatistics_.packageTime_ += time;
+                        updateTime += time;
+                    }
+                }
+            }
+            
+            if (collectStatistics_)
+            {
+                ++serverStatistics_.updates_;
+                if (updateTime > serverStatistics_.maxUpdateTime_)
+                    serverStatistics_.maxUpdateTime_ = updateTime;
+                
+                if (statisticsFile_ && statisticsTimer_.GetMSec(false) >= (unsigned)statisticsInterval_)
+                {
+                    statisticsTimer_.Reset();
+                    WriteStatistics();
                 }
             }
         }
@@ -438,6 +657,52 @@ void Network::PostUpdate(float timeStep)
     }
 }
 
+void Network::WriteStatistics()
+{
+    String time(GetSubsystem<Time>()->GetElapsedTime());
+    const ServerUpdateStatistics& server = serverStatistics_;
+    String prefix = time + "\tserver\tphase\t";
+    String updates = "\t" + String(server.updates_) + "\t";
+    statisticsFile_->WriteLine(prefix + "prepare" + updates + String((unsigned)server.prepareTime_));
+    statisticsFile_->WriteLine(prefix + "replication" + updates + String((unsigned)server.replicationTime_));
+    statisticsFile_->WriteLine(prefix + "remoteevents" + updates + String((unsigned)server.remoteEventTime_));
+    statisticsFile_->WriteLine(prefix + "packages" + updates + String((unsigned)server.packageTime_));
+    statisticsFile_->WriteLine(prefix + "maxupdate\t1\t" + String((unsigned)server.maxUpdateTime_));
+    
+    for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::ConstIterator i = clientConnections_.Begin();
+        i != clientConnections_.End(); ++i)
+    {
+        const NetworkStatistics& stats = i->second_->GetStatistics();
+        prefix = time + "\t" + i->second_->ToString() + "\t";
+        statisticsFile_->WriteLine(prefix + "traffic\ttotal\t" + String(stats.total_.messages_) + "\t" + String(stats.total_.bytes_));
+        statisticsFile_->WriteLine(prefix + "traffic\tremoteevents\t" + String(stats.remoteEvents_.messages_) + "\t" +
+            String(stats.remoteEvents_.bytes_));
+        statisticsFile_->WriteLine(prefix + "traffic\tpackages\t" + String(stats.packages_.messages_) + "\t" +
+            String(stats.packages_.bytes_));
+        statisticsFile_->WriteLine(prefix + "traffic\tresends\t" + String(stats.resends_) + "\t0");
+        
+        for (HashMap<unsigned, TrafficCounter>::ConstIterator j = stats.nodes_.Begin(); j != stats.nodes_.End(); ++j)
+            statisticsFile_->WriteLine(prefix + "node\t" + String(j->first_) + "\t" + String(j->second_.messages_) + "\t" +
+                String(j->second_.bytes_));
+        
+        for (HashMap<ShortStringHash, TypeTrafficStatistics>::ConstIterator j = stats.types_.Begin(); j != stats.types_.End(); ++j)
+        {
+            const TypeTrafficStatistics& type = j->second_;
+            statisticsFile_->WriteLine(prefix + "type\t" + type.typeName_ + "\t" + String(type.total_.messages_) + "\t" +
+                String(type.total_.bytes_));
+            
+            const Vector<AttributeInfo>* attributes = context_->GetNetworkAttributes(j->first_);
+            if (!attributes)
+                continue;
+            for (unsigned k = 0; k < type.attributeBytes_.Size() && k < attributes->Size(); ++k)
+                statisticsFile_->WriteLine(prefix + "attribute\t" + type.typeName_ + "/" + attributes->At(k).name_ + "\t0\t" +
+                    String(type.attributeBytes_[k]));
+        }
+    }
+    
+    statisticsFile_->Flush();
+}
+
 void Network::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     using namespace BeginFrame;
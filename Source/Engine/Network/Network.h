@@ -25,6 +25,7 @@
 #include "Connection.h"
 #include "HashSet.h"
 #include "Object.h"
+#include "Timer.h"
 #include "VectorBuffer.h"
 
 #include <kNet/IMessageHandler.h>
@@ -33,9 +34,21 @@
 namespace Urho3D
 {
 
+class File;
 class MemoryBuffer;
 class Scene;
 
+/// Compact encoding of a remote event type's data, which is sent as parameter values only.
+struct RemoteEventSchema
+{
+    /// Parameter names, sorted so that the order does not depend on how the schema was defined.
+    Vector<ShortStringHash> names_;
+    /// Parameter default values, which also define the value types.
+    Vector<Variant> defaults_;
+    /// Reliable delivery flag.
+    bool reliable_;
+};
+
 /// MessageConnection hash function.
 template <class T> unsigned MakeHash(kNet::MessageConnection* value)
 {
@@ -82,17 +95,41 @@ public:
     void BroadcastRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Set network update FPS.
     void SetUpdateFps(int fps);
+    /// Set maximum bandwidth in bytes per second for streaming the initial scene state to a newly joined client. 0 is unlimited (default.)
+    void SetInitialStateBandwidth(int bytesPerSecond);
+    /// Set maximum bandwidth in bytes per second for sending package files to each client, so that downloads leave room for scene updates. 0 is unlimited (default.)
+    void SetPackageBandwidth(int bytesPerSecond);
+    /// Set whether to compress package file data sent to clients. Default false.
+    void SetPackageCompression(bool enable);
     /// Register a remote event as allowed to be sent and received. If no events are registered, all are allowed.
     void RegisterRemoteEvent(StringHash eventType);
     /// Unregister a remote event as allowed to be sent and received.
     void UnregisterRemoteEvent(StringHash eventType);
     /// Unregister all remote events. This results in all being allowed.
     void UnregisterAllRemoteEvents();
+    /// Set a compact encoding for a remote event type. It must be set identically on both the server and the client. Only the parameters defined here are sent, without their names and types, and a missing or differently typed parameter is sent as the default value given here. An unreliable event may be lost or arrive out of order, and should only be used for cosmetic effects.
+    void SetRemoteEventSchema(StringHash eventType, const VariantMap& parameters, bool reliable = true);
+    /// Remove the compact encoding of a remote event type.
+    void RemoveRemoteEventSchema(StringHash eventType);
     /// Set the package download cache directory.
     void SetPackageCacheDir(const String& path);
+    /// Set whether to collect traffic statistics of client connections and times of the server update phases. Default false.
+    void SetCollectStatistics(bool enable);
+    /// Set a file to write the statistics to periodically while collecting them, for offline analysis. An empty filename closes the file.
+    bool SetStatisticsFile(const String& fileName, int intervalMSec = 10000);
+    /// Reset the statistics of the server and all client connections.
+    void ResetStatistics();
+    /// Write a summary of the statistics to the log, with the given number of nodes and types that have sent the most bytes.
+    void DumpStatistics(unsigned maxEntries = 10);
     
     /// Return network update FPS.
     int GetUpdateFps() const { return updateFps_; }
+    /// Return maximum bandwidth for streaming the initial scene state. 0 is unlimited.
+    int GetInitialStateBandwidth() const { return initialStateBandwidth_; }
+    /// Return maximum bandwidth for sending package files to each client. 0 is unlimited.
+    int GetPackageBandwidth() const { return packageBandwidth_; }
+    /// Return whether package file data is compressed.
+    bool GetPackageCompression() const { return packageCompression_; }
     /// Return a client or server connection by kNet MessageConnection, or null if none exist.
     Connection* GetConnection(kNet::MessageConnection* connection) const;
     /// Return the connection to the server. Null if not connected.
@@ -103,8 +140,14 @@ public:
     bool IsServerRunning() const;
     /// Return whether a remote event is allowed to be sent and received. If no events are registered, all are allowed.
     bool CheckRemoteEvent(StringHash eventType) const;
+    /// Return the compact encoding of a remote event type, or null if not set.
+    const RemoteEventSchema* GetRemoteEventSchema(StringHash eventType) const;
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
+    /// Return whether statistics are being collected.
+    bool GetCollectStatistics() const { return collectStatistics_; }
+    /// Return the server update phase statistics.
+    const ServerUpdateStatistics& GetServerUpdateStatistics() const { return serverStatistics_; }
     
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
@@ -120,6 +163,8 @@ private:
     void OnServerConnected();
     /// Handle server disconnection.
     void OnServerDisconnected();
+    /// Write all statistics to the statistics file.
+    void WriteStatistics();
     
     /// kNet instance.
     kNet::Network* network_;
@@ -129,6 +174,8 @@ private:
     HashMap<kNet::MessageConnection*, SharedPtr<Connection> > clientConnections_;
     /// Allowed remote events.
     HashSet<StringHash> allowedRemoteEvents_;
+    /// Remote event encodings.
+    HashMap<StringHash, RemoteEventSchema> remoteEventSchemas_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
     /// Update FPS.
@@ -137,6 +184,22 @@ private:
     float updateInterval_;
     /// Update time accumulator.
     float updateAcc_;
+    /// Initial scene state bandwidth in bytes per second.
+    int initialStateBandwidth_;
+    /// Package file bandwidth per client in bytes per second.
+    int packageBandwidth_;
+    /// Package file compression flag.
+    bool packageCompression_;
+    /// Server update phase statistics.
+    ServerUpdateStatistics serverStatistics_;
+    /// Statistics file.
+    SharedPtr<File> statisticsFile_;
+    /// Statistics file write timer.
+    Timer statisticsTimer_;
+    /// Statistics file write interval in milliseconds.
+    int statisticsInterval_;
+    /// Collect statistics flag.
+    bool collectStatistics_;
     /// Package cache directory.
     String packageCacheDir_;
 };
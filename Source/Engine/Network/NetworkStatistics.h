@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "HashMap.h"
+#include "Str.h"
+#include "StringHash.h"
+
+namespace Urho3D
+{
+
+/// Message and byte counts of network traffic.
+struct URHO3D_API TrafficCounter
+{
+    /// Construct with zero counts.
+    TrafficCounter() :
+        messages_(0),
+        bytes_(0)
+    {
+    }
+    
+    /// Count a message.
+    void Add(unsigned bytes)
+    {
+        ++messages_;
+        bytes_ += bytes;
+    }
+    
+    /// Messages.
+    unsigned messages_;
+    /// Bytes.
+    unsigned bytes_;
+};
+
+/// Replication traffic of the node or a component type.
+struct URHO3D_API TypeTrafficStatistics
+{
+    /// Type name.
+    String typeName_;
+    /// Replication messages and bytes of objects of this type. Objects sent as part of a node creation message count as one message each.
+    TrafficCounter total_;
+    /// Attribute data bytes by network attribute index.
+    PODVector<unsigned> attributeBytes_;
+};
+
+/// Traffic statistics of a server-side client connection.
+struct URHO3D_API NetworkStatistics
+{
+    /// Construct with zero counts.
+    NetworkStatistics() :
+        resends_(0)
+    {
+    }
+    
+    /// Reset all counters.
+    void Clear()
+    {
+        nodes_.Clear();
+        types_.Clear();
+        total_ = TrafficCounter();
+        remoteEvents_ = TrafficCounter();
+        packages_ = TrafficCounter();
+        resends_ = 0;
+    }
+    
+    /// Replication traffic by node ID, including the node's components.
+    HashMap<unsigned, TrafficCounter> nodes_;
+    /// Replication traffic by node or component type.
+    HashMap<ShortStringHash, TypeTrafficStatistics> types_;
+    /// All messages sent.
+    TrafficCounter total_;
+    /// Remote event messages sent.
+    TrafficCounter remoteEvents_;
+    /// Package data messages sent.
+    TrafficCounter packages_;
+    /// Resent messages.
+    unsigned resends_;
+};
+
+/// Accumulated time spent in the phases of the server network update.
+struct URHO3D_API ServerUpdateStatistics
+{
+    /// Construct with zero times.
+    ServerUpdateStatistics() :
+        updates_(0),
+        prepareTime_(0),
+        replicationTime_(0),
+        remoteEventTime_(0),
+        packageTime_(0),
+        maxUpdateTime_(0)
+    {
+    }
+    
+    /// Number of server updates.
+    unsigned updates_;
+    /// Microseconds spent preparing the scenes for replication.
+    long long prepareTime_;
+    /// Microseconds spent sending scene replication updates.
+    long long replicationTime_;
+    /// Microseconds spent sending remote events.
+    long long remoteEventTime_;
+    /// Microseconds spent sending package data.
+    long long packageTime_;
+    /// Microseconds of the longest server update.
+    long long maxUpdateTime_;
+};
+
+}
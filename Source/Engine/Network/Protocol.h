@@ -57,14 +57,19 @@ static const int MSG_COMPONENTLATESTDATA = 0x12;
 /// Server->client: remove component.
 static const int MSG_REMOVECOMPONENT = 0x13;
 
-/// Client->server and server->client: remote event.
-static const int MSG_REMOTEEVENT = 0x14;
-/// Client->server and server->client: remote node event.
-static const int MSG_REMOTENODEEVENT = 0x15;
+/// Client->server and server->client: remote events queued during one update.
+static const int MSG_REMOTEEVENTS = 0x14;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
 /// Package file fragment size.
 static const unsigned PACKAGE_FRAGMENT_SIZE = 1024;
+/// Remote event message size after which further events are sent in a new message.
+static const unsigned REMOTE_EVENT_BATCH_SIZE = 1024;
+
+/// Remote event flag: event is sent from a node, whose ID follows the event type.
+static const unsigned char REMOTEEVENT_NODE = 0x1;
+/// Remote event flag: event data is encoded with the event type's schema.
+static const unsigned char REMOTEEVENT_SCHEMA = 0x2;
 
 }
@@ -0,0 +1,272 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "Connection.h"
+#include "MemoryBuffer.h"
+#include "NetworkEvents.h"
+#include "SimulatedLink.h"
+
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Extra delay before a lost reliable message is resent, in addition to the round trip time.
+static const float RESEND_DELAY = 0.05f;
+/// Maximum number of send attempts for a reliable message before it is forced through.
+static const unsigned MAX_SEND_ATTEMPTS = 16;
+
+/// Return whether a message is delivered before another.
+static bool DeliveredBefore(const SimulatedMessage& lhs, const SimulatedMessage& rhs)
+{
+    return lhs.deliveryTime_ < rhs.deliveryTime_ || (lhs.deliveryTime_ == rhs.deliveryTime_ && lhs.sequence_ < rhs.sequence_);
+}
+
+/// Swap two messages without copying the message data.
+static void SwapMessages(SimulatedMessage& lhs, SimulatedMessage& rhs)
+{
+    lhs.data_.Swap(rhs.data_);
+    Swap(lhs.sendTime_, rhs.sendTime_);
+    Swap(lhs.deliveryTime_, rhs.deliveryTime_);
+    Swap(lhs.sequence_, rhs.sequence_);
+    Swap(lhs.msgID_, rhs.msgID_);
+    Swap(lhs.contentID_, rhs.contentID_);
+}
+
+SimulatedBottleneck::SimulatedBottleneck(float bandwidth) :
+    bandwidth_(Max(bandwidth, 1.0f)),
+    busyTime_(0.0f)
+{
+}
+
+float SimulatedBottleneck::Transmit(float time, unsigned numBytes)
+{
+    // Data waits for the earlier queued data to be transmitted first
+    busyTime_ = Max(busyTime_, time) + (float)numBytes / bandwidth_;
+    return busyTime_;
+}
+
+SimulatedLink::SimulatedLink(const LinkConditions& conditions, unsigned seed) :
+    conditions_(conditions),
+    time_(0.0f),
+    seed_(seed)
+{
+}
+
+SimulatedLink::~SimulatedLink()
+{
+}
+
+void SimulatedLink::SetEndpoint(Connection* connection, bool isClient)
+{
+    // On the server, the connection represents a client
+    if (isClient)
+        serverEndpoint_ = connection;
+    else
+        clientEndpoint_ = connection;
+}
+
+void SimulatedLink::SetConditions(const LinkConditions& conditions)
+{
+    conditions_ = conditions;
+}
+
+void SimulatedLink::SetBottleneck(SimulatedBottleneck* bottleneck)
+{
+    bottleneck_ = bottleneck;
+}
+
+void SimulatedLink::Send(Connection* sender, int msgID, bool reliable, bool inOrder, const unsigned char* data,
+    unsigned numBytes, unsigned contentID)
+{
+    SimulatedChannel& channel = channels_[sender == serverEndpoint_ ? 0 : 1];
+
+    ++channel.stats_.messagesSent_;
+    channel.stats_.bytesSent_ += numBytes;
+
+    float delay = conditions_.latency_;
+    if (conditions_.jitter_ > 0.0f)
+        delay += Random() * conditions_.jitter_;
+
+    if (Random() < conditions_.packetLoss_)
+    {
+        if (!reliable)
+        {
+            ++channel.stats_.messagesLost_;
+            return;
+        }
+
+        // Reliable messages are resent after the sender has failed to get an acknowledgement within the round trip time
+        unsigned attempts = 1;
+        do
+        {
+            delay += 2.0f * conditions_.latency_ + RESEND_DELAY;
+            ++channel.stats_.resends_;
+        }
+        while (++attempts < MAX_SEND_ATTEMPTS && Random() < conditions_.packetLoss_);
+    }
+
+    float sendTime = time_;
+    if (bottleneck_ && sender == serverEndpoint_)
+        sendTime = bottleneck_->Transmit(time_, numBytes);
+    
+    float deliveryTime = sendTime + delay;
+    if (inOrder)
+    {
+        // In-order messages can not overtake each other
+        deliveryTime = Max(deliveryTime, channel.lastInOrderTime_);
+        channel.lastInOrderTime_ = deliveryTime;
+    }
+    else if (conditions_.reorderRate_ > 0.0f && Random() < conditions_.reorderRate_)
+        deliveryTime += conditions_.latency_ + conditions_.jitter_;
+
+    Vector<SimulatedMessage>& heap = channel.messages_;
+    unsigned index = heap.Size();
+    heap.Resize(index + 1);
+    SimulatedMessage& message = heap.Back();
+    message.data_.Resize(numBytes);
+    if (numBytes)
+        memcpy(&message.data_[0], data, numBytes);
+    message.sendTime_ = time_;
+    message.deliveryTime_ = deliveryTime;
+    message.sequence_ = channel.nextSequence_++;
+    message.msgID_ = msgID;
+    message.contentID_ = contentID;
+
+    // Sift up to restore the heap order
+    while (index)
+    {
+        unsigned parent = (index - 1) >> 1;
+        if (!DeliveredBefore(heap[index], heap[parent]))
+            break;
+        SwapMessages(heap[index], heap[parent]);
+        index = parent;
+    }
+}
+
+void SimulatedLink::AdvanceTime(float timeStep)
+{
+    time_ += timeStep;
+}
+
+unsigned SimulatedLink::DeliverMessages(Connection* receiver)
+{
+    if (!receiver || (receiver != serverEndpoint_ && receiver != clientEndpoint_))
+        return 0;
+
+    // Messages towards the client are received by the client-side endpoint
+    SimulatedChannel& channel = channels_[receiver == clientEndpoint_ ? 0 : 1];
+    unsigned numDelivered = 0;
+
+    Vector<SimulatedMessage>& heap = channel.messages_;
+
+    while (!heap.Empty() && heap.Front().deliveryTime_ <= time_)
+    {
+        // Take ownership of the message first, as processing may cause new messages to be sent
+        SimulatedMessage message;
+        SwapMessages(message, heap.Front());
+        SwapMessages(heap.Front(), heap.Back());
+        heap.Pop();
+
+        // Sift down to restore the heap order
+        unsigned index = 0;
+        for (;;)
+        {
+            unsigned child = (index << 1) + 1;
+            if (child >= heap.Size())
+                break;
+            if (child + 1 < heap.Size() && DeliveredBefore(heap[child + 1], heap[child]))
+                ++child;
+            if (!DeliveredBefore(heap[child], heap[index]))
+                break;
+            SwapMessages(heap[index], heap[child]);
+            index = child;
+        }
+
+        // Like in kNet, discard a message if a newer one with the same content ID was already delivered
+        if (message.contentID_)
+        {
+            HashMap<unsigned, unsigned>& latest = channel.latestContent_[message.msgID_];
+            HashMap<unsigned, unsigned>::Iterator j = latest.Find(message.contentID_);
+            if (j != latest.End() && j->second_ > message.sequence_)
+            {
+                ++channel.stats_.messagesObsoleted_;
+                continue;
+            }
+            latest[message.contentID_] = message.sequence_;
+        }
+
+        float messageDelay = message.deliveryTime_ - message.sendTime_;
+        channel.stats_.totalDelay_ += messageDelay;
+        channel.stats_.maxDelay_ = Max(channel.stats_.maxDelay_, messageDelay);
+        ++channel.stats_.messagesDelivered_;
+        ++numDelivered;
+
+        MemoryBuffer msg(message.data_);
+        if (!receiver->ProcessMessage(message.msgID_, msg))
+        {
+            // If message was not handled internally, forward as an event, like Network does for kNet connections
+            using namespace NetworkMessage;
+
+            VariantMap eventData;
+            eventData[P_CONNECTION] = (void*)receiver;
+            eventData[P_MESSAGEID] = message.msgID_;
+            eventData[P_DATA].SetBuffer(msg.GetData(), msg.GetSize());
+            receiver->SendEvent(E_NETWORKMESSAGE, eventData);
+        }
+    }
+
+    return numDelivered;
+}
+
+void SimulatedLink::ResetStatistics()
+{
+    channels_[0].stats_ = LinkStatistics();
+    channels_[1].stats_ = LinkStatistics();
+}
+
+Connection* SimulatedLink::GetServerEndpoint() const
+{
+    return serverEndpoint_;
+}
+
+Connection* SimulatedLink::GetClientEndpoint() const
+{
+    return clientEndpoint_;
+}
+
+unsigned SimulatedLink::GetNumPendingMessages() const
+{
+    return channels_[0].messages_.Size() + channels_[1].messages_.Size();
+}
+
+float SimulatedLink::Random()
+{
+    // Same linear congruential generator as Rand(), but with own state so that game logic is not disturbed
+    seed_ = seed_ * 214013 + 2531011;
+    return (float)((seed_ >> 16) & 32767) / 32768.0f;
+}
+
+}
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "HashMap.h"
+#include "Ptr.h"
+
+namespace Urho3D
+{
+
+class Connection;
+
+/// Simulated network conditions of a SimulatedLink.
+struct URHO3D_API LinkConditions
+{
+    /// Construct as a perfect link.
+    LinkConditions() :
+        latency_(0.0f),
+        jitter_(0.0f),
+        packetLoss_(0.0f),
+        reorderRate_(0.0f)
+    {
+    }
+
+    /// One-way latency in seconds.
+    float latency_;
+    /// Maximum random extra latency in seconds.
+    float jitter_;
+    /// Probability of losing a message (0-1.) Lost reliable messages are resent, lost unreliable messages are discarded.
+    float packetLoss_;
+    /// Probability of holding an unordered message back so that later messages overtake it (0-1.)
+    float reorderRate_;
+};
+
+/// Traffic statistics of one direction of a SimulatedLink.
+struct URHO3D_API LinkStatistics
+{
+    /// Construct with zero counters.
+    LinkStatistics() :
+        messagesSent_(0),
+        bytesSent_(0),
+        messagesDelivered_(0),
+        messagesLost_(0),
+        messagesObsoleted_(0),
+        resends_(0),
+        totalDelay_(0.0f),
+        maxDelay_(0.0f)
+    {
+    }
+
+    /// Messages sent.
+    unsigned messagesSent_;
+    /// Payload bytes sent, not including resends.
+    unsigned bytesSent_;
+    /// Messages delivered to the receiving connection.
+    unsigned messagesDelivered_;
+    /// Unreliable messages lost.
+    unsigned messagesLost_;
+    /// Messages discarded on arrival because a newer message with the same content ID had already been delivered.
+    unsigned messagesObsoleted_;
+    /// Reliable message resends.
+    unsigned resends_;
+    /// Sum of the times from sending to delivery of the delivered messages, in seconds.
+    float totalDelay_;
+    /// Longest time from sending to delivery of a delivered message, in seconds.
+    float maxDelay_;
+};
+
+/// Message in flight on a SimulatedLink.
+struct SimulatedMessage
+{
+    /// Message data.
+    PODVector<unsigned char> data_;
+    /// Link time at which the message was sent.
+    float sendTime_;
+    /// Link time at which the message arrives.
+    float deliveryTime_;
+    /// Send order sequence number.
+    unsigned sequence_;
+    /// Message ID.
+    int msgID_;
+    /// Content ID.
+    unsigned contentID_;
+};
+
+/// One direction of a SimulatedLink.
+struct SimulatedChannel
+{
+    /// Construct.
+    SimulatedChannel() :
+        lastInOrderTime_(0.0f),
+        nextSequence_(0)
+    {
+    }
+
+    /// Messages in flight as a binary heap, earliest delivery time first. Messages arriving at the same time keep their send order.
+    Vector<SimulatedMessage> messages_;
+    /// Last delivered sequence number by message ID and content ID.
+    HashMap<int, HashMap<unsigned, unsigned> > latestContent_;
+    /// Statistics.
+    LinkStatistics stats_;
+    /// Delivery time of the last in-order message.
+    float lastInOrderTime_;
+    /// Next sequence number.
+    unsigned nextSequence_;
+};
+
+/// Bandwidth limited transmit queue, which can be shared by several SimulatedLinks to simulate for example the upload capacity of a server.
+class URHO3D_API SimulatedBottleneck : public RefCounted
+{
+public:
+    /// Construct with bandwidth in bytes per second.
+    SimulatedBottleneck(float bandwidth);
+    
+    /// Queue data for transmission at the given link time. Return the link time at which it has been transmitted.
+    float Transmit(float time, unsigned numBytes);
+    
+    /// Return bandwidth in bytes per second.
+    float GetBandwidth() const { return bandwidth_; }
+    
+private:
+    /// Bandwidth in bytes per second.
+    float bandwidth_;
+    /// Link time at which the queued data has been transmitted.
+    float busyTime_;
+};
+
+/// In-memory message transport between a server-side and a client-side Connection in the same process. Simulates latency, jitter, loss and reordering deterministically from a random seed, and does not require sockets.
+class URHO3D_API SimulatedLink : public RefCounted
+{
+public:
+    /// Construct with network conditions and random seed.
+    SimulatedLink(const LinkConditions& conditions = LinkConditions(), unsigned seed = 1);
+    /// Destruct.
+    ~SimulatedLink();
+
+    /// Attach a connection endpoint. Called by Connection.
+    void SetEndpoint(Connection* connection, bool isClient);
+    /// Set network conditions.
+    void SetConditions(const LinkConditions& conditions);
+    /// Set a bandwidth limit for messages towards the client. Null removes the limit.
+    void SetBottleneck(SimulatedBottleneck* bottleneck);
+    /// Queue a message from an endpoint to the other. Called by Connection.
+    void Send(Connection* sender, int msgID, bool reliable, bool inOrder, const unsigned char* data, unsigned numBytes, unsigned contentID);
+    /// Advance the link time.
+    void AdvanceTime(float timeStep);
+    /// Deliver the messages that have arrived to an endpoint. Return number of messages delivered.
+    unsigned DeliverMessages(Connection* receiver);
+    /// Reset statistics of both directions.
+    void ResetStatistics();
+
+    /// Return network conditions.
+    const LinkConditions& GetConditions() const { return conditions_; }
+    /// Return the bandwidth limit for messages towards the client.
+    SimulatedBottleneck* GetBottleneck() const { return bottleneck_; }
+    /// Return current link time.
+    float GetTime() const { return time_; }
+    /// Return the server-side connection, which represents the client on the server.
+    Connection* GetServerEndpoint() const;
+    /// Return the client-side connection, which represents the server on the client.
+    Connection* GetClientEndpoint() const;
+    /// Return statistics of messages sent towards the client or towards the server.
+    const LinkStatistics& GetStatistics(bool toClient) const { return channels_[toClient ? 0 : 1].stats_; }
+    /// Return number of messages in flight in both directions.
+    unsigned GetNumPendingMessages() const;
+
+private:
+    /// Return a random number between 0-1 from the link's own generator.
+    float Random();
+
+    /// Server-side endpoint.
+    WeakPtr<Connection> serverEndpoint_;
+    /// Client-side endpoint.
+    WeakPtr<Connection> clientEndpoint_;
+    /// Channels towards the client (index 0) and towards the server (index 1.)
+    SimulatedChannel channels_[2];
+    /// Bandwidth limit towards the client.
+    SharedPtr<SimulatedBottleneck> bottleneck_;
+    /// Network conditions.
+    LinkConditions conditions_;
+    /// Current link time.
+    float time_;
+    /// Random generator state.
+    unsigned seed_;
+};
+
+}
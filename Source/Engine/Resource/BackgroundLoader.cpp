@@ -0,0 +1,459 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "BackgroundLoader.h"
+#include "Context.h"
+#include "Log.h"
+#include "MemoryBuffer.h"
+#include "ResourceCache.h"
+#include "ResourceEvents.h"
+#include "Sort.h"
+#include "Timer.h"
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum number of files opened ahead for reading by the file read queue. Keeping a large number of files open would
+/// slow down opening and closing files.
+static const unsigned MAX_READ_AHEAD = 64;
+
+/// Compare queued resources for loading the highest priority first.
+static bool CompareLoadOrder(const BackgroundLoadOrder& lhs, const BackgroundLoadOrder& rhs)
+{
+    return lhs.priority_ != rhs.priority_ ? lhs.priority_ > rhs.priority_ : lhs.sequence_ < rhs.sequence_;
+}
+
+/// Add to the loading order heap.
+static void PushLoadOrder(PODVector<BackgroundLoadOrder>& heap, const BackgroundLoadOrder& order)
+{
+    unsigned index = heap.Size();
+    heap.Push(order);
+    
+    // Sift up to restore the heap order
+    while (index)
+    {
+        unsigned parent = (index - 1) >> 1;
+        if (!CompareLoadOrder(heap[index], heap[parent]))
+            break;
+        Swap(heap[index], heap[parent]);
+        index = parent;
+    }
+}
+
+/// Remove the top of the loading order heap.
+static void PopLoadOrder(PODVector<BackgroundLoadOrder>& heap)
+{
+    heap[0] = heap.Back();
+    heap.Pop();
+    
+    // Sift down to restore the heap order
+    unsigned index = 0;
+    for (;;)
+    {
+        unsigned child = (index << 1) + 1;
+        if (child >= heap.Size())
+            break;
+        if (child + 1 < heap.Size() && CompareLoadOrder(heap[child + 1], heap[child]))
+            ++child;
+        if (!CompareLoadOrder(heap[child], heap[index]))
+            break;
+        Swap(heap[index], heap[child]);
+        index = child;
+    }
+}
+
+/// Memory buffer over the file data read for a resource, which returns the file name for the log messages of the resource.
+class ReadDataBuffer : public MemoryBuffer
+{
+public:
+    /// Construct.
+    ReadDataBuffer(const PODVector<unsigned char>& data, const String& name) :
+        MemoryBuffer(data),
+        name_(name)
+    {
+    }
+    
+    /// Return the file name.
+    virtual const String& GetName() const { return name_; }
+    
+private:
+    /// File name.
+    String name_;
+};
+
+/// Run the thread-safe part of loading a queued resource.
+static void BeginLoadResource(BackgroundLoadItem& item, ResourceCache* cache)
+{
+    if (!item.read_)
+    {
+        if (!item.file_)
+            item.file_ = cache->GetResourceFile(item.resource_->GetName());
+        if (item.file_)
+            item.success_ = item.resource_->BeginLoad(*item.file_);
+        else
+        {
+            LOGERROR("Could not open the file for resource " + item.resource_->GetName());
+            item.success_ = false;
+        }
+    }
+    else if (item.read_->IsSuccess())
+    {
+        // The data stays in the read request until the item is finished, so it can be used without copying until EndLoad()
+        ReadDataBuffer source(item.read_->data_, item.file_->GetName());
+        item.success_ = item.resource_->BeginLoad(source);
+    }
+    else
+    {
+        LOGERROR("Could not read the file for resource " + item.resource_->GetName());
+        item.success_ = false;
+    }
+    
+    // The file is no longer needed unless mapped, as its data may be used until EndLoad()
+    if (item.file_ && !item.file_->IsMapped())
+        item.file_->Close();
+}
+
+BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+    owner_(owner),
+    nextSequence_(0),
+    numReadsAhead_(0)
+{
+}
+
+BackgroundLoader::~BackgroundLoader()
+{
+    Stop();
+}
+
+void BackgroundLoader::ThreadFunction()
+{
+    while (shouldRun_)
+    {
+        // Free the file data of finished resources, so that the main thread does not spend time on it
+        List<PODVector<unsigned char> > releasedData;
+        
+        // Take the highest priority item that has not been started yet. If its file is still being read, wait for it
+        // rather than start a lower priority item, as the file read queue reads in the same order
+        BackgroundLoadItem* item = 0;
+        BackgroundLoadOrder order;
+        bool waitingRead = false;
+        
+        queueMutex_.Acquire();
+        releasedData.Swap(releasedData_);
+        while (!loadOrder_.Empty())
+        {
+            order = loadOrder_.Front();
+            HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(order.key_);
+            if (i == backgroundLoadQueue_.End() || i->second_.started_ || i->second_.priority_ != order.priority_)
+            {
+                PopLoadOrder(loadOrder_);
+                continue;
+            }
+            if (i->second_.read_ && !i->second_.read_->IsCompleted())
+            {
+                waitingRead = true;
+                break;
+            }
+            
+            item = &i->second_;
+            item->started_ = true;
+            PopLoadOrder(loadOrder_);
+            break;
+        }
+        queueMutex_.Release();
+        
+        releasedData.Clear();
+        
+        if (!item)
+        {
+            Time::Sleep(waitingRead ? 0 : 5);
+            continue;
+        }
+        
+        // The item is not erased by the main thread while it is being processed, so it can be accessed without the mutex
+        BeginLoadResource(*item, owner_);
+        
+        queueMutex_.Acquire();
+        item->finished_ = true;
+        finishedOrder_.Push(order);
+        if (item->read_)
+            --numReadsAhead_;
+        queueMutex_.Release();
+    }
+}
+
+bool BackgroundLoader::QueueResource(ShortStringHash type, const String& name, int priority)
+{
+    Pair<StringHash, ShortStringHash> key(StringHash(name), type);
+    
+    // If already queued, only raise the priority
+    {
+        MutexLock lock(queueMutex_);
+        HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+        if (i != backgroundLoadQueue_.End())
+        {
+            if (priority > i->second_.priority_ && !i->second_.started_)
+            {
+                i->second_.priority_ = priority;
+                BackgroundLoadOrder order;
+                order.key_ = key;
+                order.priority_ = priority;
+                order.sequence_ = i->second_.sequence_;
+                PushLoadOrder(loadOrder_, order);
+            }
+            return true;
+        }
+    }
+    
+    // Only the main thread adds items, so the item can be prepared without the mutex
+    BackgroundLoadItem item;
+    item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
+    if (!item.resource_)
+    {
+        LOGERROR("Could not load unknown resource type " + String(type));
+        return false;
+    }
+    
+    // The file is opened when the item is started, or when it is read ahead
+    if (!owner_->Exists(name) && !owner_->Exists(GetCookedResourceName(name)))
+    {
+        LOGERROR("Could not find resource " + name);
+        return false;
+    }
+    
+    LOGDEBUG("Background loading resource " + name);
+    item.resource_->SetName(name);
+    item.priority_ = priority;
+    item.sequence_ = nextSequence_++;
+    
+    {
+        MutexLock lock(queueMutex_);
+        backgroundLoadQueue_[key] = item;
+        BackgroundLoadOrder order;
+        order.key_ = key;
+        order.priority_ = item.priority_;
+        order.sequence_ = item.sequence_;
+        PushLoadOrder(loadOrder_, order);
+    }
+    
+    if (owner_->GetSubsystem<FileReadQueue>())
+    {
+        readAheadQueue_.Push(key);
+        ReadAhead();
+    }
+    
+    if (!IsStarted())
+        Run();
+    
+    return true;
+}
+
+void BackgroundLoader::FinishResources(int maxMs)
+{
+    if (backgroundLoadQueue_.Empty())
+        return;
+    
+    HiresTimer timer;
+    
+    // Take the items first, as finishing a resource may finish or queue others
+    PODVector<BackgroundLoadOrder> finished;
+    {
+        MutexLock lock(queueMutex_);
+        finished.Swap(finishedOrder_);
+    }
+    
+    Sort(finished.Begin(), finished.End(), CompareLoadOrder);
+    
+    ReadAhead();
+    
+    for (unsigned i = 0; i < finished.Size(); ++i)
+    {
+        // The item may have been finished already by a synchronous request, and the same resource queued again
+        HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(finished[i].key_);
+        if (j != backgroundLoadQueue_.End() && j->second_.finished_)
+            FinishResource(j);
+        
+        if (maxMs > 0 && timer.GetUSec(false) >= maxMs * 1000LL)
+        {
+            // Return the rest for the next frame
+            MutexLock lock(queueMutex_);
+            for (unsigned k = i + 1; k < finished.Size(); ++k)
+                finishedOrder_.Push(finished[k]);
+            break;
+        }
+    }
+}
+
+void BackgroundLoader::WaitForResource(ShortStringHash type, StringHash nameHash)
+{
+    HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(MakePair(nameHash,
+        type));
+    if (i == backgroundLoadQueue_.End())
+        return;
+    
+    BackgroundLoadItem& item = i->second_;
+    
+    // If the loader thread has not started on the item, begin loading here instead of waiting
+    queueMutex_.Acquire();
+    bool started = item.started_;
+    item.started_ = true;
+    queueMutex_.Release();
+    
+    if (!started)
+    {
+        FileReadQueue* readQueue = owner_->GetSubsystem<FileReadQueue>();
+        if (item.read_ && readQueue)
+            readQueue->WaitForRequest(item.read_);
+        BeginLoadResource(item, owner_);
+        item.finished_ = true;
+        if (item.read_)
+        {
+            MutexLock lock(queueMutex_);
+            --numReadsAhead_;
+        }
+    }
+    else
+    {
+        for (;;)
+        {
+            queueMutex_.Acquire();
+            bool finished = item.finished_;
+            queueMutex_.Release();
+            if (finished)
+                break;
+            Time::Sleep(0);
+        }
+    }
+    
+    FinishResource(i);
+}
+
+bool BackgroundLoader::IsQueued(ShortStringHash type, StringHash nameHash) const
+{
+    return backgroundLoadQueue_.Contains(MakePair(nameHash, type));
+}
+
+unsigned BackgroundLoader::GetNumQueuedResources() const
+{
+    return backgroundLoadQueue_.Size();
+}
+
+void BackgroundLoader::ReadAhead()
+{
+    FileReadQueue* readQueue = owner_->GetSubsystem<FileReadQueue>();
+    if (!readQueue)
+    {
+        readAheadQueue_.Clear();
+        return;
+    }
+    
+    while (!readAheadQueue_.Empty())
+    {
+        {
+            MutexLock lock(queueMutex_);
+            if (numReadsAhead_ >= MAX_READ_AHEAD)
+                return;
+        }
+        
+        // Only the main thread adds or removes items, so the queue can be searched without the mutex
+        HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(
+            readAheadQueue_.Front());
+        readAheadQueue_.PopFront();
+        if (i == backgroundLoadQueue_.End() || i->second_.started_)
+            continue;
+        
+        BackgroundLoadItem& item = i->second_;
+        SharedPtr<File> file = owner_->GetResourceFile(item.resource_->GetName());
+        if (!file)
+            continue;
+        
+        // A memory-mapped file is read on access instead
+        SharedPtr<FileReadRequest> read;
+        if (!file->IsMapped())
+        {
+            read = new FileReadRequest(file);
+            read->priority_ = item.priority_;
+        }
+        
+        // If the loader thread started the item meanwhile, it opens the file itself
+        {
+            MutexLock lock(queueMutex_);
+            if (item.started_)
+                continue;
+            item.file_ = file;
+            item.read_ = read;
+            if (read)
+                ++numReadsAhead_;
+        }
+        
+        if (read)
+            readQueue->AddRequest(read);
+    }
+}
+
+void BackgroundLoader::FinishResource(HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i)
+{
+    BackgroundLoadItem& item = i->second_;
+    SharedPtr<Resource> resource = item.resource_;
+    ShortStringHash type = i->first_.second_;
+    
+    // Resources requested by EndLoad() are dependencies of this resource
+    bool success = item.success_;
+    if (success)
+    {
+        owner_->loadingResources_.Push(resource);
+        success = resource->EndLoad();
+        owner_->loadingResources_.Pop();
+    }
+    if (!success)
+        LOGERROR("Failed to load resource " + resource->GetName());
+    
+    // Remove from the queue before storing to the cache and sending the event, so that the resource is not found in both
+    {
+        MutexLock lock(queueMutex_);
+        if (item.read_)
+        {
+            releasedData_.Push(PODVector<unsigned char>());
+            releasedData_.Back().Swap(item.read_->data_);
+        }
+        backgroundLoadQueue_.Erase(i);
+    }
+    
+    if (success)
+    {
+        owner_->StoreResource(resource);
+        owner_->UpdateResourceGroup(type);
+    }
+    
+    using namespace ResourceBackgroundLoaded;
+    
+    VariantMap eventData;
+    eventData[P_RESOURCENAME] = resource->GetName();
+    eventData[P_SUCCESS] = success;
+    eventData[P_RESOURCE] = (void*)resource.Get();
+    owner_->SendEvent(E_RESOURCEBACKGROUNDLOADED, eventData);
+}
+
+}
@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "File.h"
+#include "FileReadQueue.h"
+#include "HashMap.h"
+#include "List.h"
+#include "Mutex.h"
+#include "Pair.h"
+#include "Resource.h"
+#include "Thread.h"
+
+namespace Urho3D
+{
+
+class ResourceCache;
+
+/// Queue item for background loading of a resource.
+struct BackgroundLoadItem
+{
+    /// Construct with defaults.
+    BackgroundLoadItem() :
+        priority_(0),
+        sequence_(0),
+        started_(false),
+        finished_(false),
+        success_(false)
+    {
+    }
+    
+    /// Resource being loaded.
+    SharedPtr<Resource> resource_;
+    /// Source file. Opened by the main thread when queued if read by the file read queue, otherwise by the thread that begins loading.
+    SharedPtr<File> file_;
+    /// Read of the file data by the file read queue, if used. The loader thread starts the item only after the read completes.
+    SharedPtr<FileReadRequest> read_;
+    /// Priority. Higher value is loaded first.
+    int priority_;
+    /// Request order for items of the same priority.
+    unsigned sequence_;
+    /// Loader thread has started processing the item.
+    bool started_;
+    /// Loader thread has finished processing the item.
+    volatile bool finished_;
+    /// BeginLoad() succeeded.
+    bool success_;
+};
+
+/// Position of a queued resource in the loading order.
+struct BackgroundLoadOrder
+{
+    /// Queue key.
+    Pair<StringHash, ShortStringHash> key_;
+    /// Priority.
+    int priority_;
+    /// Request order.
+    unsigned sequence_;
+};
+
+/// Background loader thread of the resource cache. Calls BeginLoad() of the queued resources in the background so that the main thread only needs to call EndLoad().
+class BackgroundLoader : public RefCounted, public Thread
+{
+public:
+    /// Construct.
+    BackgroundLoader(ResourceCache* owner);
+    /// Destruct. Stop the thread.
+    ~BackgroundLoader();
+    
+    /// Begin loading the queued resources until stopped.
+    virtual void ThreadFunction();
+    
+    /// Queue a resource for loading. If already queued, raise its priority if necessary. Return false if could not be queued.
+    bool QueueResource(ShortStringHash type, const String& name, int priority);
+    /// Finish loading the resources whose BeginLoad() has completed, until the time limit in milliseconds is exceeded. Zero or negative limit finishes all.
+    void FinishResources(int maxMs);
+    /// Wait for a queued resource's BeginLoad() to complete and finish its loading immediately. Called when the resource is requested synchronously.
+    void WaitForResource(ShortStringHash type, StringHash nameHash);
+    
+    /// Return whether a resource is queued.
+    bool IsQueued(ShortStringHash type, StringHash nameHash) const;
+    /// Return number of queued resources.
+    unsigned GetNumQueuedResources() const;
+    
+private:
+    /// Open files of the queued resources and queue them for reading in the file read queue, up to a limit of files read ahead.
+    void ReadAhead();
+    /// Finish loading a resource on the main thread and remove it from the queue.
+    void FinishResource(HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem>::Iterator i);
+    
+    /// Resource cache.
+    ResourceCache* owner_;
+    /// Resources in the queue, by name and type.
+    HashMap<Pair<StringHash, ShortStringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Resources not yet started as a binary heap, highest priority first. Entries of started or reprioritized items are skipped when they reach the top.
+    PODVector<BackgroundLoadOrder> loadOrder_;
+    /// Resources whose BeginLoad() has completed in the loader thread.
+    PODVector<BackgroundLoadOrder> finishedOrder_;
+    /// Resources to read ahead with the file read queue, in request order.
+    List<Pair<StringHash, ShortStringHash> > readAheadQueue_;
+    /// File data of finished resources, to be freed by the loader thread.
+    List<PODVector<unsigned char> > releasedData_;
+    /// Mutex for the queue.
+    mutable Mutex queueMutex_;
+    /// Next request sequence number.
+    unsigned nextSequence_;
+    /// Number of files read ahead whose loading has not begun yet.
+    unsigned numReadsAhead_;
+};
+
+}
@@ -207,7 +207,7 @@ void Image::RegisterObject(Context* context)
     context->RegisterFactory<Image>();
 }
 
-bool Image::Load(Deserializer& source)
+bool Image::BeginLoad(Deserializer& source)
 {
     // Check for DDS, KTX or PVR compressed format
     String fileID = source.ReadFileID();
@@ -607,6 +607,14 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
     
+    // Decode straight from a stream that resides in memory, such as a memory-mapped file
+    const unsigned char* directData = source.GetDirectData();
+    if (directData)
+    {
+        source.Seek(dataSize);
+        return stbi_load_from_memory(directData, dataSize, &width, &height, (int *)&components, 0);
+    }
+    
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int *)&components, 0);
@@ -23,21 +23,41 @@
 #include "Precompiled.h"
 #include "Log.h"
 #include "Resource.h"
+#include "ResourceCache.h"
 
 namespace Urho3D
 {
 
 Resource::Resource(Context* context) :
     Object(context),
-    memoryUse_(0)
+    memoryUse_(0),
+    group_(0),
+    lruPrev_(0),
+    lruNext_(0)
 {
 }
 
-bool Resource::Load(Deserializer& src)
+bool Resource::Load(Deserializer& source)
 {
+    bool success = BeginLoad(source);
+    if (success)
+        success &= EndLoad();
+    
+    return success;
+}
+
+bool Resource::BeginLoad(Deserializer& source)
+{
+    // This always needs to be overridden by subclasses
     return false;
 }
 
+bool Resource::EndLoad()
+{
+    // If no GPU upload step is necessary, no override is necessary
+    return true;
+}
+
 bool Resource::Save(Serializer& dest) const
 {
     LOGERROR("Save not supported for " + GetTypeName());
@@ -52,6 +72,9 @@ void Resource::SetName(const String& name)
 
 void Resource::SetMemoryUse(unsigned size)
 {
+    // Keep the group total up to date incrementally, so that the cache does not need to sum it over all resources
+    if (group_)
+        group_->memoryUse_ += size - memoryUse_;
     memoryUse_ = size;
 }
 
@@ -30,24 +30,31 @@ namespace Urho3D
 
 class Deserializer;
 class Serializer;
+struct ResourceGroup;
 
 /// Base class for resources.
 class URHO3D_API Resource : public Object
 {
     OBJECT(Resource);
     
+    friend class ResourceCache;
+    
 public:
     /// Construct.
     Resource(Context* context);
     
-    /// Load resource. Return true if successful.
-    virtual bool Load(Deserializer& source);
+    /// Load resource synchronously. Call both BeginLoad() & EndLoad() and return true if both succeeded.
+    bool Load(Deserializer& source);
+    /// Load resource from stream. May be called from a worker thread. The stream stays valid until EndLoad(), so data that resides in memory can be used from it without copying. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    virtual bool EndLoad();
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
     
     /// Set name.
     void SetName(const String& name);
-    /// Set memory use in bytes, possibly approximate.
+    /// Set memory use in bytes, possibly approximate. Updates the memory use of the resource cache group the resource is stored in.
     void SetMemoryUse(unsigned size);
     /// Reset last used timer.
     void ResetUseTimer();
@@ -70,6 +77,12 @@ private:
     Timer useTimer_;
     /// Memory use in bytes.
     unsigned memoryUse_;
+    /// Resource cache group the resource is stored in.
+    ResourceGroup* group_;
+    /// More recently used resource in the resource cache group.
+    Resource* lruPrev_;
+    /// Less recently used resource in the resource cache group.
+    Resource* lruNext_;
 };
 
 inline StringHash GetResourceHash(Resource* resource)
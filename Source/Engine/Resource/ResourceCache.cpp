@@ -21,6 +21,7 @@
 //
 
 #include "Precompiled.h"
+#include "BackgroundLoader.h"
 #include "Context.h"
 #include "CoreEvents.h"
 #include "FileSystem.h"
@@ -28,8 +29,11 @@
 #include "Image.h"
 #include "Log.h"
 #include "PackageFile.h"
+#include "Profiler.h"
 #include "ResourceCache.h"
 #include "ResourceEvents.h"
+#include "ResourceManifest.h"
+#include "Sort.h"
 #include "XMLFile.h"
 
 #include "DebugNew.h"
@@ -58,16 +62,37 @@ static const char* checkDirs[] = {
 
 static const SharedPtr<Resource> noResource;
 
+static const unsigned DEFAULT_MEMORY_MAP_THRESHOLD = 65536;
+
+static const char* cookedExtension = ".cooked";
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
-    autoReloadResources_(false)
+    finishBackgroundResourcesMs_(5),
+    memoryMapThreshold_(DEFAULT_MEMORY_MAP_THRESHOLD),
+    autoReloadResources_(false),
+    useCookedResources_(true)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
+    
+    // The loader thread is started when the first resource is queued
+    backgroundLoader_ = new BackgroundLoader(this);
+    
+    SubscribeToEvent(E_BEGINFRAME, HANDLER(ResourceCache, HandleBeginFrame));
 }
 
 ResourceCache::~ResourceCache()
 {
+    // Stop the loader thread before the resources it may be accessing are destroyed
+    backgroundLoader_.Reset();
+    
+    // Detach resources that outlive the cache from their groups
+    for (HashMap<ShortStringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin(); j != i->second_.resources_.End();)
+            j = EraseResource(i->second_, j);
+    }
 }
 
 bool ResourceCache::AddResourceDir(const String& pathName)
@@ -80,6 +105,7 @@ bool ResourceCache::AddResourceDir(const String& pathName)
     }
     
     String fixedPath = AddTrailingSlash(pathName);
+    MutexLock lock(resourceMutex_);
     
     // Check that the same path does not already exist
     for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
@@ -90,11 +116,12 @@ bool ResourceCache::AddResourceDir(const String& pathName)
     
     resourceDirs_.Push(fixedPath);
     
-    // Scan the path for files recursively and add their hash-to-name mappings
+    // Scan the path for files recursively, add their hash-to-name mappings and index their location
     Vector<String> fileNames;
     fileSystem->ScanDir(fileNames, fixedPath, "*.*", SCAN_FILES, true);
     for (unsigned i = 0; i < fileNames.Size(); ++i)
         StoreNameHash(fileNames[i]);
+    IndexResourceDir(resourceDirs_.Size() - 1, fileNames);
     
     // If resource auto-reloading active, create a file watcher for the directory
     if (autoReloadResources_)
@@ -114,15 +141,18 @@ void ResourceCache::AddPackageFile(PackageFile* package, bool addAsFirst)
     if (!package || !package->GetNumFiles())
         return;
     
+    MutexLock lock(resourceMutex_);
+    
     if (addAsFirst)
         packages_.Insert(packages_.Begin(), SharedPtr<PackageFile>(package));
     else
         packages_.Push(SharedPtr<PackageFile>(package));
     
-    // Scan the package for files and add their hash-to-name mappings
+    // Scan the package for files, add their hash-to-name mappings and index their location
     const HashMap<String, PackageEntry>& entries = package->GetEntries();
     for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
         StoreNameHash(i->first_);
+    IndexPackageFile(package, addAsFirst);
     
     LOGINFO("Added resource package " + package->GetName());
 }
@@ -142,9 +172,10 @@ bool ResourceCache::AddManualResource(Resource* resource)
         return false;
     }
     
+    // Hold a reference so that the resource is not released by the memory budget check right away
+    SharedPtr<Resource> resourcePtr(resource);
     StoreNameHash(name);
-    resource->ResetUseTimer();
-    resourceGroups_[resource->GetType()].resources_[resource->GetNameHash()] = resource;
+    StoreResource(resource);
     UpdateResourceGroup(resource->GetType());
     return true;
 }
@@ -152,6 +183,8 @@ bool ResourceCache::AddManualResource(Resource* resource)
 void ResourceCache::RemoveResourceDir(const String& path)
 {
     String fixedPath = AddTrailingSlash(path);
+    MutexLock lock(resourceMutex_);
+    
     for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
     {
         if (!resourceDirs_[i].Compare(path, false))
@@ -159,6 +192,7 @@ void ResourceCache::RemoveResourceDir(const String& path)
             resourceDirs_.Erase(i);
             if (fileWatchers_.Size() > i)
                 fileWatchers_.Erase(i);
+            RebuildResourceIndex();
             LOGINFO("Removed resource path " + fixedPath);
             return;
         }
@@ -167,6 +201,8 @@ void ResourceCache::RemoveResourceDir(const String& path)
 
 void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResources, bool forceRelease)
 {
+    MutexLock lock(resourceMutex_);
+    
     for (Vector<SharedPtr<PackageFile> >::Iterator i = packages_.Begin(); i != packages_.End(); ++i)
     {
         if (*i == package)
@@ -175,6 +211,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
                 ReleasePackageResources(*i, forceRelease);
             LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            RebuildResourceIndex();
             return;
         }
     }
@@ -184,6 +221,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
 {
     // Compare the name and extension only, not the path
     String fileNameNoPath = GetFileNameAndExtension(fileName);
+    MutexLock lock(resourceMutex_);
     
     for (Vector<SharedPtr<PackageFile> >::Iterator i = packages_.Begin(); i != packages_.End(); ++i)
     {
@@ -193,6 +231,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
                 ReleasePackageResources(*i, forceRelease);
             LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            RebuildResourceIndex();
             return;
         }
     }
@@ -212,60 +251,43 @@ void ResourceCache::ReleaseResource(ShortStringHash type, StringHash nameHash, b
     // If other references exist, do not release, unless forced
     if (existingRes.Refs() == 1 || force)
     {
-        resourceGroups_[type].resources_.Erase(nameHash);
-        UpdateResourceGroup(type);
+        ResourceGroup& group = resourceGroups_[type];
+        EraseResource(group, group.resources_.Find(nameHash));
     }
 }
 
 void ResourceCache::ReleaseResources(ShortStringHash type, bool force)
 {
-    bool released = false;
-    
     HashMap<ShortStringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
         for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
             // If other references exist, do not release, unless forced
-            if (current->second_.Refs() == 1 || force)
-            {
-                i->second_.resources_.Erase(current);
-                released = true;
-            }
+            if (j->second_.Refs() == 1 || force)
+                j = EraseResource(i->second_, j);
+            else
+                ++j;
         }
     }
-    
-    if (released)
-        UpdateResourceGroup(type);
 }
 
 void ResourceCache::ReleaseResources(ShortStringHash type, const String& partialName, bool force)
 {
-    bool released = false;
-    
     HashMap<ShortStringHash, ResourceGroup>::Iterator i = resourceGroups_.Find(type);
     if (i != resourceGroups_.End())
     {
         for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
-            if (current->second_->GetName().Contains(partialName))
-            {
-                // If other references exist, do not release, unless forced
-                if (current->second_.Refs() == 1 || force)
-                {
-                    i->second_.resources_.Erase(current);
-                    released = true;
-                }
-            }
+            // If other references exist, do not release, unless forced
+            if (j->second_->GetName().Contains(partialName) && (j->second_.Refs() == 1 || force))
+                j = EraseResource(i->second_, j);
+            else
+                ++j;
         }
     }
-    
-    if (released)
-        UpdateResourceGroup(type);
 }
 
 void ResourceCache::ReleaseAllResources(bool force)
@@ -273,21 +295,15 @@ void ResourceCache::ReleaseAllResources(bool force)
     for (HashMap<ShortStringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin();
         i != resourceGroups_.End(); ++i)
     {
-        bool released = false;
-        
         for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
             j != i->second_.resources_.End();)
         {
-            HashMap<StringHash, SharedPtr<Resource> >::Iterator current = j++;
             // If other references exist, do not release, unless forced
-            if ((current->second_.Refs() == 1 && current->second_.WeakRefs() == 0) || force)
-            {
-                i->second_.resources_.Erase(current);
-                released = true;
-            }
+            if ((j->second_.Refs() == 1 && j->second_.WeakRefs() == 0) || force)
+                j = EraseResource(i->second_, j);
+            else
+                ++j;
         }
-        if (released)
-            UpdateResourceGroup(i->first_);
     }
 }
 
@@ -298,14 +314,21 @@ bool ResourceCache::ReloadResource(Resource* resource)
     
     resource->SendEvent(E_RELOADSTARTED);
     
+    // The resource may request different resources this time
+    resourceDependencies_.Erase(resource->GetNameHash());
+    
     bool success = false;
-    SharedPtr<File> file = GetFile(resource->GetName());
+    SharedPtr<File> file = GetResourceFile(resource->GetName());
     if (file)
+    {
+        loadingResources_.Push(resource);
         success = resource->Load(*(file.Get()));
+        loadingResources_.Pop();
+    }
     
     if (success)
     {
-        resource->ResetUseTimer();
+        TouchResource(resource);
         UpdateResourceGroup(resource->GetType());
         resource->SendEvent(E_RELOADFINISHED);
         return true;
@@ -322,6 +345,72 @@ void ResourceCache::SetMemoryBudget(ShortStringHash type, unsigned budget)
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
+void ResourceCache::ResetStatistics()
+{
+    for (HashMap<ShortStringHash, ResourceGroup>::Iterator i = resourceGroups_.Begin(); i != resourceGroups_.End(); ++i)
+    {
+        i->second_.hits_ = 0;
+        i->second_.misses_ = 0;
+        i->second_.evictions_ = 0;
+        i->second_.evictedBytes_ = 0;
+    }
+}
+
+void ResourceCache::StartManifestRecording(ResourceManifest* manifest)
+{
+    recordingManifest_ = manifest;
+}
+
+void ResourceCache::StopManifestRecording()
+{
+    recordingManifest_.Reset();
+}
+
+unsigned ResourceCache::PreloadResources(ResourceManifest* manifest, int priority)
+{
+    if (!manifest)
+        return 0;
+    
+    PROFILE(PreloadResources);
+    
+    // Queue everything at once, so that the reads and the loader thread are not held up by resources being discovered
+    // one dependency level at a time. Deeper dependencies are loaded first, and are also queued first so that their files
+    // are read first
+    PODVector<unsigned> depths;
+    manifest->GetDepths(depths);
+    const Vector<ManifestEntry>& entries = manifest->GetResources();
+    
+    PODVector<Pair<int, unsigned> > order(entries.Size());
+    for (unsigned i = 0; i < entries.Size(); ++i)
+        order[i] = MakePair(-(int)depths[i], i);
+    Sort(order.Begin(), order.End());
+    
+    unsigned numQueued = 0;
+    for (unsigned i = 0; i < order.Size(); ++i)
+    {
+        const ManifestEntry& entry = entries[order[i].second_];
+        if (BackgroundLoadResource(entry.type_, entry.name_, priority - order[i].first_))
+            ++numQueued;
+    }
+    
+    return numQueued;
+}
+
+void ResourceCache::SetFinishBackgroundResourcesMs(int ms)
+{
+    finishBackgroundResourcesMs_ = ms;
+}
+
+void ResourceCache::SetMemoryMapThreshold(unsigned size)
+{
+    memoryMapThreshold_ = size;
+}
+
+void ResourceCache::SetUseCookedResources(bool enable)
+{
+    useCookedResources_ = enable;
+}
+
 void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
@@ -334,14 +423,9 @@ void ResourceCache::SetAutoReloadResources(bool enable)
                 watcher->StartWatching(resourceDirs_[i], true);
                 fileWatchers_.Push(watcher);
             }
-
-            SubscribeToEvent(E_BEGINFRAME, HANDLER(ResourceCache, HandleBeginFrame));
         }
         else
-        {
-            UnsubscribeFromEvent(E_BEGINFRAME);
             fileWatchers_.Clear();
-        }
         
         autoReloadResources_ = enable;
     }
@@ -349,40 +433,50 @@ void ResourceCache::SetAutoReloadResources(bool enable)
 
 SharedPtr<File> ResourceCache::GetFile(const String& nameIn)
 {
-    String name = SanitateResourceName(nameIn);
+    // Hold the lock until the file is open, so that the directory or package it was found in is not removed meanwhile
+    MutexLock lock(resourceMutex_);
     
-    // Check first the packages
-    for (unsigned i = 0; i < packages_.Size(); ++i)
+    // Check first the name index. Names that are already sanitated, like the names of loaded resources, are found without
+    // string processing
+    ResourceLocation location;
+    if (FindResourceLocation(StringHash(nameIn), location))
     {
-        if (packages_[i]->Exists(name))
-            return SharedPtr<File>(new File(context_, packages_[i], name));
+        SharedPtr<File> file = OpenFile(nameIn, location);
+        if (file)
+            return file;
     }
     
-    // Then the filesystem
-    FileSystem* fileSystem = GetSubsystem<FileSystem>();
-    if (fileSystem)
+    String name = SanitateResourceName(nameIn);
+    if (name != nameIn && FindResourceLocation(StringHash(name), location))
     {
-        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
-        {
-            if (fileSystem->FileExists(resourceDirs_[i] + name))
-            {
-                // Construct the file first with full path, then rename it to not contain the resource path,
-                // so that the file's name can be used in further GetFile() calls (for example over the network)
-                SharedPtr<File> file(new File(context_, resourceDirs_[i] + name));
-                file->SetName(name);
-                return file;
-            }
-        }
-        
-        // Fallback using absolute path
-        if (fileSystem->FileExists(name))
-            return SharedPtr<File>(new File(context_, name));
+        SharedPtr<File> file = OpenFile(name, location);
+        if (file)
+            return file;
+    }
+    
+    // The file may have been added or removed after the index was built, so search the packages and directories
+    if (UpdateResourceLocation(name, location))
+    {
+        SharedPtr<File> file = OpenFile(name, location);
+        if (file)
+            return file;
     }
     
+    // Fallback using absolute path
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem && fileSystem->FileExists(name))
+        return SharedPtr<File>(new File(context_, name));
+    
     LOGERROR("Could not find resource " + name);
     return SharedPtr<File>();
 }
 
+SharedPtr<File> ResourceCache::GetResourceFile(const String& name)
+{
+    SharedPtr<File> file = GetCookedFile(name);
+    return file ? file : GetFile(name);
+}
+
 Resource* ResourceCache::GetResource(ShortStringHash type, const String& nameIn)
 {
     String name = SanitateResourceName(nameIn);
@@ -404,9 +498,25 @@ Resource* ResourceCache::GetResource(ShortStringHash type, StringHash nameHash)
     if (!nameHash)
         return 0;
     
+    if (recordingManifest_ || !loadingResources_.Empty())
+        StoreResourceRequest(type, nameHash);
+    
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        ++existing->group_->hits_;
+        TouchResource(existing);
         return existing;
+    }
+    
+    ++resourceGroups_[type].misses_;
+    
+    // If the resource is being loaded in the background, finish it now
+    if (backgroundLoader_->IsQueued(type, nameHash))
+    {
+        backgroundLoader_->WaitForResource(type, nameHash);
+        return FindResource(type, nameHash);
+    }
     
     SharedPtr<Resource> resource;
     const String& name = GetResourceName(nameHash);
@@ -425,7 +535,7 @@ Resource* ResourceCache::GetResource(ShortStringHash type, StringHash nameHash)
     }
     
     // Attempt to load the resource
-    SharedPtr<File> file = GetFile(name);
+    SharedPtr<File> file = GetResourceFile(name);
     if (!file)
     {
         LOGERROR("Could not open the file for resource " + name);
@@ -433,18 +543,62 @@ Resource* ResourceCache::GetResource(ShortStringHash type, StringHash nameHash)
     }
 
     LOGDEBUG("Loading resource " + name);
-    resource->SetName(file->GetName());
-    if (!resource->Load(*(file.Get())))
+    resource->SetName(name);
+    loadingResources_.Push(resource);
+    bool success = resource->Load(*(file.Get()));
+    loadingResources_.Pop();
+    if (!success)
         return 0;
     
     // Store to cache
-    resource->ResetUseTimer();
-    resourceGroups_[type].resources_[nameHash] = resource;
+    StoreResource(resource);
     UpdateResourceGroup(type);
     
     return resource;
 }
 
+SharedPtr<Resource> ResourceCache::GetTempResource(ShortStringHash type, const String& nameIn)
+{
+    String name = SanitateResourceName(nameIn);
+    
+    // Do not touch the name hash map or the resource groups, as this may be called from a worker thread
+    SharedPtr<Resource> resource = DynamicCast<Resource>(context_->CreateObject(type));
+    if (!resource)
+    {
+        LOGERROR("Could not load unknown resource type " + String(type));
+        return SharedPtr<Resource>();
+    }
+    
+    SharedPtr<File> file = GetResourceFile(name);
+    if (!file)
+    {
+        LOGERROR("Could not open the file for resource " + name);
+        return SharedPtr<Resource>();
+    }
+    
+    LOGDEBUG("Loading temporary resource " + name);
+    resource->SetName(name);
+    if (!resource->Load(*(file.Get())))
+        return SharedPtr<Resource>();
+    
+    return resource;
+}
+
+bool ResourceCache::BackgroundLoadResource(ShortStringHash type, const String& nameIn, int priority)
+{
+    String name = SanitateResourceName(nameIn);
+    if (name.Empty())
+        return false;
+    
+    StoreNameHash(name);
+    if (recordingManifest_ || !loadingResources_.Empty())
+        StoreResourceRequest(type, StringHash(name));
+    if (FindResource(type, StringHash(name)))
+        return true;
+    
+    return backgroundLoader_->QueueResource(type, name, priority);
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, ShortStringHash type) const
 {
     result.Clear();
@@ -459,14 +613,15 @@ void ResourceCache::GetResources(PODVector<Resource*>& result, ShortStringHash t
 
 bool ResourceCache::Exists(const String& nameIn) const
 {
-    String name = SanitateResourceName(nameIn);
+    ResourceLocation location;
+    if (FindResourceLocation(StringHash(nameIn), location))
+        return true;
     
-    for (unsigned i = 0; i < packages_.Size(); ++i)
-    {
-        if (packages_[i]->Exists(name))
-            return true;
-    }
+    String name = SanitateResourceName(nameIn);
+    if (name != nameIn && FindResourceLocation(StringHash(name), location))
+        return true;
     
+    // Package files are always indexed, but the directories may contain files added after the index was built
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
     if (fileSystem)
     {
@@ -486,6 +641,10 @@ bool ResourceCache::Exists(const String& nameIn) const
 
 bool ResourceCache::Exists(StringHash nameHash) const
 {
+    ResourceLocation location;
+    if (FindResourceLocation(nameHash, location))
+        return true;
+    
     return Exists(GetResourceName(nameHash));
 }
 
@@ -515,6 +674,11 @@ unsigned ResourceCache::GetTotalMemoryUse() const
     return total;
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadResources() const
+{
+    return backgroundLoader_->GetNumQueuedResources();
+}
+
 const String& ResourceCache::GetResourceName(StringHash nameHash) const
 {
     HashMap<StringHash, String>::ConstIterator i = hashToName_.Find(nameHash);
@@ -662,8 +826,6 @@ const SharedPtr<Resource>& ResourceCache::FindResource(StringHash nameHash)
 
 void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
 {
-    HashSet<ShortStringHash> affectedGroups;
-    
     const HashMap<String, PackageEntry>& entries = package->GetEntries();
     for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
     {
@@ -678,17 +840,247 @@ void ResourceCache::ReleasePackageResources(PackageFile* package, bool force)
             {
                 // If other references exist, do not release, unless forced
                 if (k->second_.Refs() == 1 || force)
-                {
-                    j->second_.resources_.Erase(k);
-                    affectedGroups.Insert(j->first_);
-                }
+                    EraseResource(j->second_, k);
+                break;
+            }
+        }
+    }
+}
+
+void ResourceCache::IndexPackageFile(PackageFile* package, bool replacePackages)
+{
+    MutexLock lock(resourceIndexMutex_);
+    
+    // Package files are searched before the resource directories
+    const HashMap<String, PackageEntry>& entries = package->GetEntries();
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i)
+    {
+        ResourceLocation& location = resourceIndex_[StringHash(i->first_)];
+        if (!location.package_ || replacePackages)
+            location = ResourceLocation(package);
+    }
+}
+
+void ResourceCache::IndexResourceDir(unsigned index, const Vector<String>& fileNames)
+{
+    MutexLock lock(resourceIndexMutex_);
+    
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        StringHash nameHash(fileNames[i]);
+        if (!resourceIndex_.Contains(nameHash))
+            resourceIndex_[nameHash] = ResourceLocation(index);
+    }
+}
+
+void ResourceCache::RebuildResourceIndex()
+{
+    {
+        MutexLock lock(resourceIndexMutex_);
+        resourceIndex_.Clear();
+    }
+    
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+        IndexPackageFile(packages_[i], false);
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem)
+    {
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+        {
+            Vector<String> fileNames;
+            fileSystem->ScanDir(fileNames, resourceDirs_[i], "*.*", SCAN_FILES, true);
+            IndexResourceDir(i, fileNames);
+        }
+    }
+}
+
+bool ResourceCache::UpdateResourceLocation(const String& name, ResourceLocation& dest)
+{
+    bool found = false;
+    
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+    {
+        if (packages_[i]->Exists(name))
+        {
+            dest = ResourceLocation(packages_[i]);
+            found = true;
+            break;
+        }
+    }
+    
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!found && fileSystem)
+    {
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+        {
+            if (fileSystem->FileExists(resourceDirs_[i] + name))
+            {
+                dest = ResourceLocation(i);
+                found = true;
                 break;
             }
         }
     }
     
-    for (HashSet<ShortStringHash>::Iterator i = affectedGroups.Begin(); i != affectedGroups.End(); ++i)
-        UpdateResourceGroup(*i);
+    MutexLock lock(resourceIndexMutex_);
+    if (found)
+        resourceIndex_[StringHash(name)] = dest;
+    else
+        resourceIndex_.Erase(StringHash(name));
+    
+    return found;
+}
+
+bool ResourceCache::FindResourceLocation(StringHash nameHash, ResourceLocation& dest) const
+{
+    MutexLock lock(resourceIndexMutex_);
+    
+    HashMap<StringHash, ResourceLocation>::ConstIterator i = resourceIndex_.Find(nameHash);
+    if (i == resourceIndex_.End())
+        return false;
+    
+    dest = i->second_;
+    return true;
+}
+
+SharedPtr<File> ResourceCache::OpenFile(const String& name, const ResourceLocation& location)
+{
+    SharedPtr<File> file;
+    if (location.package_)
+        file = new File(context_, location.package_, name);
+    else if (location.dirIndex_ < resourceDirs_.Size())
+    {
+        // Construct the file first with full path, then rename it to not contain the resource path,
+        // so that the file's name can be used in further GetFile() calls (for example over the network)
+        file = new File(context_, resourceDirs_[location.dirIndex_] + name);
+        file->SetName(name);
+    }
+    
+    if (!file || !file->IsOpen())
+        return SharedPtr<File>();
+    
+    // Large files are mapped to memory, so that loaders can use the data without copying. Small files, typically text that
+    // is parsed to other structures anyway, are not worth a mapping. If mapping fails, the file is read normally
+    if (memoryMapThreshold_ && file->GetSize() >= memoryMapThreshold_ && !file->IsCompressed())
+        file->Map();
+    
+    return file;
+}
+
+SharedPtr<File> ResourceCache::GetCookedFile(const String& name)
+{
+    if (!useCookedResources_)
+        return SharedPtr<File>();
+    
+    MutexLock lock(resourceMutex_);
+    
+    // Cooked files are only looked up from the name index, so that resources without one cost just a hash lookup
+    String cookedName = GetCookedResourceName(name);
+    ResourceLocation cookedLocation;
+    if (!FindResourceLocation(StringHash(cookedName), cookedLocation))
+        return SharedPtr<File>();
+    
+    // The cooked file is only used if the resource file is in the same package file or resource directory, so that a
+    // resource file overriding the base data is not replaced by a cooked file of the base data. In a resource directory
+    // the resource file must also not have been modified after cooking. As the modification times have a resolution of
+    // one second, a cooked file written within the same second is considered out of date
+    ResourceLocation location;
+    if (FindResourceLocation(StringHash(name), location))
+    {
+        if (location.package_ != cookedLocation.package_)
+            return SharedPtr<File>();
+        if (!location.package_)
+        {
+            FileSystem* fileSystem = GetSubsystem<FileSystem>();
+            if (location.dirIndex_ != cookedLocation.dirIndex_ || location.dirIndex_ >= resourceDirs_.Size() || !fileSystem ||
+                fileSystem->GetLastModifiedTime(resourceDirs_[location.dirIndex_] + cookedName) <=
+                fileSystem->GetLastModifiedTime(resourceDirs_[location.dirIndex_] + name))
+                return SharedPtr<File>();
+        }
+    }
+    
+    SharedPtr<File> file = OpenFile(cookedName, cookedLocation);
+    if (!file)
+        return file;
+    
+    // All cooked formats begin with a file ID followed by the version
+    file->ReadFileID();
+    if (file->ReadUInt() != COOKED_RESOURCE_VERSION)
+    {
+        LOGWARNING("Ignoring " + cookedName + " which was cooked for another version");
+        return SharedPtr<File>();
+    }
+    
+    file->Seek(0);
+    return file;
+}
+
+void ResourceCache::StoreResource(Resource* resource)
+{
+    ResourceGroup& group = resourceGroups_[resource->GetType()];
+    HashMap<StringHash, SharedPtr<Resource> >::Iterator i = group.resources_.Find(resource->GetNameHash());
+    if (i != group.resources_.End())
+    {
+        if (i->second_ == resource)
+        {
+            TouchResource(resource);
+            return;
+        }
+        EraseResource(group, i);
+    }
+    
+    group.resources_[resource->GetNameHash()] = resource;
+    group.memoryUse_ += resource->memoryUse_;
+    resource->group_ = &group;
+    resource->lruPrev_ = 0;
+    resource->lruNext_ = group.mostRecent_;
+    if (group.mostRecent_)
+        group.mostRecent_->lruPrev_ = resource;
+    else
+        group.leastRecent_ = resource;
+    group.mostRecent_ = resource;
+    resource->ResetUseTimer();
+}
+
+HashMap<StringHash, SharedPtr<Resource> >::Iterator ResourceCache::EraseResource(ResourceGroup& group,
+    HashMap<StringHash, SharedPtr<Resource> >::Iterator i)
+{
+    Resource* resource = i->second_;
+    group.memoryUse_ -= resource->memoryUse_;
+    if (resource->lruPrev_)
+        resource->lruPrev_->lruNext_ = resource->lruNext_;
+    else
+        group.mostRecent_ = resource->lruNext_;
+    if (resource->lruNext_)
+        resource->lruNext_->lruPrev_ = resource->lruPrev_;
+    else
+        group.leastRecent_ = resource->lruPrev_;
+    resource->group_ = 0;
+    resource->lruPrev_ = 0;
+    resource->lruNext_ = 0;
+    
+    return group.resources_.Erase(i);
+}
+
+void ResourceCache::TouchResource(Resource* resource)
+{
+    resource->ResetUseTimer();
+    
+    ResourceGroup* group = resource->group_;
+    if (!group || group->mostRecent_ == resource)
+        return;
+    
+    // Unlink and relink at the most recently used end. The resource is not the first, so it has a previous resource
+    resource->lruPrev_->lruNext_ = resource->lruNext_;
+    if (resource->lruNext_)
+        resource->lruNext_->lruPrev_ = resource->lruPrev_;
+    else
+        group->leastRecent_ = resource->lruPrev_;
+    resource->lruPrev_ = 0;
+    resource->lruNext_ = group->mostRecent_;
+    group->mostRecent_->lruPrev_ = resource;
+    group->mostRecent_ = resource;
 }
 
 void ResourceCache::UpdateResourceGroup(ShortStringHash type)
@@ -697,38 +1089,70 @@ void ResourceCache::UpdateResourceGroup(ShortStringHash type)
     if (i == resourceGroups_.End())
         return;
     
-    for (;;)
+    ResourceGroup& group = i->second_;
+    
+    // If memory budget defined and is exceeded, release resources starting from the least recently used. Resources in use
+    // can not be released; they are moved to the most recently used end instead. Stop when all have been checked once
+    unsigned numInUse = 0;
+    while (group.memoryBudget_ && group.memoryUse_ > group.memoryBudget_ && numInUse < group.resources_.Size())
     {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        HashMap<StringHash, SharedPtr<Resource> >::Iterator oldestResource = i->second_.resources_.End();
-        
-        for (HashMap<StringHash, SharedPtr<Resource> >::Iterator j = i->second_.resources_.Begin();
-            j != i->second_.resources_.End(); ++j)
+        Resource* resource = group.leastRecent_;
+        if (resource->Refs() > 1)
         {
-            totalSize += j->second_->GetMemoryUse();
-            unsigned useTimer = j->second_->GetUseTimer();
-            if (useTimer > oldestTimer)
-            {
-                oldestTimer = useTimer;
-                oldestResource = j;
-            }
+            TouchResource(resource);
+            ++numInUse;
+            continue;
         }
         
-        i->second_.memoryUse_ = totalSize;
-        
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second_.memoryBudget_ && i->second_.memoryUse_ > i->second_.memoryBudget_ &&
-            oldestResource != i->second_.resources_.End())
+        LOGDEBUG("Resource group " + resource->GetTypeName() + " over memory budget, releasing resource " +
+            resource->GetName());
+        ++group.evictions_;
+        group.evictedBytes_ += resource->memoryUse_;
+        EraseResource(group, group.resources_.Find(resource->GetNameHash()));
+    }
+}
+
+void ResourceCache::StoreResourceRequest(ShortStringHash type, StringHash nameHash)
+{
+    Resource* loading = loadingResources_.Empty() ? 0 : loadingResources_.Back();
+    if (loading && loading->GetNameHash() != nameHash)
+    {
+        ResourceRef dependency(type, nameHash);
+        PODVector<ResourceRef>& dependencies = resourceDependencies_[loading->GetNameHash()];
+        if (!dependencies.Contains(dependency))
+            dependencies.Push(dependency);
+    }
+    
+    if (recordingManifest_)
+    {
+        unsigned index = RecordResource(type, nameHash);
+        if (loading)
+            recordingManifest_->AddDependency(RecordResource(loading->GetType(), loading->GetNameHash()), index);
+    }
+}
+
+unsigned ResourceCache::RecordResource(ShortStringHash type, StringHash nameHash)
+{
+    const String& name = GetResourceName(nameHash);
+    if (name.Empty())
+        return M_MAX_UNSIGNED;
+    
+    unsigned numResources = recordingManifest_->GetNumResources();
+    unsigned index = recordingManifest_->AddResource(type, name);
+    
+    // If the resource was loaded before, it will not request its dependencies again, so record them from what was seen
+    if (index == numResources)
+    {
+        HashMap<StringHash, PODVector<ResourceRef> >::ConstIterator i = resourceDependencies_.Find(nameHash);
+        if (i != resourceDependencies_.End())
         {
-            LOGDEBUG("Resource group " + oldestResource->second_->GetTypeName() + " over memory budget, releasing resource " +
-                oldestResource->second_->GetName());
-            i->second_.resources_.Erase(oldestResource);
+            const PODVector<ResourceRef>& dependencies = i->second_;
+            for (unsigned j = 0; j < dependencies.Size(); ++j)
+                recordingManifest_->AddDependency(index, RecordResource(dependencies[j].type_, dependencies[j].id_));
         }
-        else
-            break;
     }
+    
+    return index;
 }
 
 void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
@@ -738,6 +1162,15 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         String fileName;
         while (fileWatchers_[i]->GetNextChange(fileName))
         {
+            // Keep the name index up to date as files are added and removed. Removed files need no reloading
+            ResourceLocation location;
+            if (!UpdateResourceLocation(fileName, location))
+                continue;
+            
+            // A changed cooked file reloads the resource it was cooked from
+            if (fileName.EndsWith(cookedExtension))
+                fileName = fileName.Substring(0, fileName.Length() - String(cookedExtension).Length());
+            
             StringHash fileNameHash(fileName);
             // If the filename is a resource we keep track of, reload it
             const SharedPtr<Resource>& resource = FindResource(fileNameHash);
@@ -772,11 +1205,23 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
             }
         }
     }
+    
+    // Finish background loaded resources within the time limit
+    {
+        PROFILE(FinishBackgroundResources);
+        backgroundLoader_->FinishResources(finishBackgroundResourcesMs_);
+    }
+}
+
+String GetCookedResourceName(const String& name)
+{
+    return name + cookedExtension;
 }
 
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
+    ResourceManifest::RegisterObject(context);
     XMLFile::RegisterObject(context);
 }
 
@@ -24,13 +24,19 @@
 
 #include "File.h"
 #include "HashSet.h"
+#include "Mutex.h"
+#include "PackageFile.h"
 #include "Resource.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoader;
 class FileWatcher;
-class PackageFile;
+class ResourceManifest;
+
+/// Version of the cooked binary resource formats. Cooked files of another version are not used.
+static const unsigned COOKED_RESOURCE_VERSION = 1;
 
 /// Container of resources with specific type.
 struct ResourceGroup
@@ -38,7 +44,13 @@ struct ResourceGroup
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        mostRecent_(0),
+        leastRecent_(0),
+        hits_(0),
+        misses_(0),
+        evictions_(0),
+        evictedBytes_(0)
     {
     }
     
@@ -48,6 +60,46 @@ struct ResourceGroup
     unsigned memoryUse_;
     /// Resources.
     HashMap<StringHash, SharedPtr<Resource> > resources_;
+    /// Most recently used resource. The resources form a doubly linked list from the most to the least recently used.
+    Resource* mostRecent_;
+    /// Least recently used resource.
+    Resource* leastRecent_;
+    /// Number of resource requests that found the resource already loaded.
+    unsigned hits_;
+    /// Number of resource requests that had to load the resource.
+    unsigned misses_;
+    /// Number of resources released due to the memory budget.
+    unsigned evictions_;
+    /// Total memory use of the resources released due to the memory budget.
+    unsigned long long evictedBytes_;
+};
+
+/// Location of a resource file in the resource cache's name index.
+struct ResourceLocation
+{
+    /// Construct as undefined.
+    ResourceLocation() :
+        dirIndex_(0)
+    {
+    }
+    
+    /// Construct as located in a package file.
+    ResourceLocation(PackageFile* package) :
+        package_(package),
+        dirIndex_(0)
+    {
+    }
+    
+    /// Construct as located in a resource directory.
+    ResourceLocation(unsigned dirIndex) :
+        dirIndex_(dirIndex)
+    {
+    }
+    
+    /// Package file, or null if located in a resource directory. Holds a reference, so that a location copied from the name index stays valid if the package file is removed.
+    SharedPtr<PackageFile> package_;
+    /// Resource directory index. Only valid while the resource mutex is held, as removing a resource directory changes the indices.
+    unsigned dirIndex_;
 };
 
 /// %Resource cache subsystem. Loads resources on demand and stores them for later access.
@@ -55,6 +107,8 @@ class URHO3D_API ResourceCache : public Object
 {
     OBJECT(ResourceCache);
     
+    friend class BackgroundLoader;
+    
 public:
     /// Construct.
     ResourceCache(Context* context);
@@ -89,15 +143,35 @@ public:
     void SetMemoryBudget(ShortStringHash type, unsigned budget);
     /// Enable or disable automatic reloading of resources as files are modified.
     void SetAutoReloadResources(bool enable);
+    /// Set how many milliseconds per frame to spend at most on finishing background loaded resources. Zero or negative finishes all that are ready. Default 5.
+    void SetFinishBackgroundResourcesMs(int ms);
+    /// Set minimum size in bytes of resource files to memory-map for loading, so that loaders can use the data without copying. Files in compressed packages are not mapped. Zero disables. Default 64KB.
+    void SetMemoryMapThreshold(unsigned size);
+    /// Enable or disable loading resources from their cooked files when up to date. Default true.
+    void SetUseCookedResources(bool enable);
+    /// Reset the hit, miss and eviction statistics of all resource types.
+    void ResetStatistics();
+    /// Start recording the requested resources and the resources they request while loading to a manifest. Resources that were loaded before are recorded with the dependencies seen when they were loaded.
+    void StartManifestRecording(ResourceManifest* manifest);
+    /// Stop recording resource requests to a manifest.
+    void StopManifestRecording();
+    /// Queue all resources of a manifest for background loading. Dependencies get a higher priority than the resources requesting them, so that they are ready first. Return number of resources queued or already loaded.
+    unsigned PreloadResources(ResourceManifest* manifest, int priority = 0);
     
     /// Open and return a file from the resource load paths or from inside a package file. If not found, use a fallback search with absolute path. Return null if fails.
     SharedPtr<File> GetFile(const String& name);
+    /// Open and return the file to load a resource from: its cooked file if one is up to date, otherwise the file itself. Return null if fails.
+    SharedPtr<File> GetResourceFile(const String& name);
     /// Return a resource by type and name. Load if not loaded yet. Return null if fails.
     Resource* GetResource(ShortStringHash type, const String& name);
     /// Return a resource by type and name. Load if not loaded yet. Return null if fails.
     Resource* GetResource(ShortStringHash type, const char* name);
     /// Return a resource by type and name hash. Load if not loaded yet. Return null if fails.
     Resource* GetResource(ShortStringHash type, StringHash nameHash);
+    /// Load a resource without storing it in the cache. Return null if fails. Can be called from a worker thread for resource types that load completely in BeginLoad(), such as XMLFile.
+    SharedPtr<Resource> GetTempResource(ShortStringHash type, const String& name);
+    /// Queue a resource to be loaded in the background, unless already loaded. BeginLoad() is called in a worker thread, and EndLoad() is called, the resource stored to the cache and E_RESOURCEBACKGROUNDLOADED sent on the main thread. Higher priority resources are loaded first. Return false if could not be queued.
+    bool BackgroundLoadResource(ShortStringHash type, const String& name, int priority = 0);
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, ShortStringHash type) const;
     /// Return all loaded resources.
@@ -112,8 +186,12 @@ public:
     template <class T> T* GetResource(const char* name);
     /// Template version of returning a resource by name hash.
     template <class T> T* GetResource(StringHash nameHash);
+    /// Template version of loading a resource without storing it in the cache.
+    template <class T> SharedPtr<T> GetTempResource(const String& name);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
+    /// Template version of queueing a resource for background loading.
+    template <class T> bool BackgroundLoadResource(const String& name, int priority = 0);
     /// Return whether a file exists by name.
     bool Exists(const String& name) const;
     /// Return whether a file exists by name hash.
@@ -130,6 +208,16 @@ public:
     String GetResourceFileName(const String& name) const;
     /// Return whether automatic resource reloading is enabled.
     bool GetAutoReloadResources() const { return autoReloadResources_; }
+    /// Return how many milliseconds per frame to spend at most on finishing background loaded resources.
+    int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return minimum size in bytes of resource files to memory-map for loading.
+    unsigned GetMemoryMapThreshold() const { return memoryMapThreshold_; }
+    /// Return whether resources are loaded from their cooked files when up to date.
+    bool GetUseCookedResources() const { return useCookedResources_; }
+    /// Return number of resources queued for background loading.
+    unsigned GetNumBackgroundLoadResources() const;
+    /// Return the manifest being recorded to, or null if not recording.
+    ResourceManifest* GetRecordingManifest() const { return recordingManifest_; }
     
     /// Return either the path itself or its parent, based on which of them has recognized resource subdirectories.
     String GetPreferredResourceDir(const String& path) const;
@@ -149,9 +237,33 @@ private:
     const SharedPtr<Resource>& FindResource(StringHash nameHash);
     /// Release resources loaded from a package file.
     void ReleasePackageResources(PackageFile* package, bool force = false);
-    /// Update a resource group. Recalculate memory use and release resources if over memory budget.
+    /// Add the files of a package file to the name index. Optionally replace files from packages already indexed.
+    void IndexPackageFile(PackageFile* package, bool replacePackages);
+    /// Add the files of a resource directory to the name index, unless already found from elsewhere.
+    void IndexResourceDir(unsigned index, const Vector<String>& fileNames);
+    /// Rebuild the name index after removing a package file or a resource directory.
+    void RebuildResourceIndex();
+    /// Search a file from the package files and resource directories and update its location in the name index. Return true if found. Call with the resource mutex held.
+    bool UpdateResourceLocation(const String& name, ResourceLocation& dest);
+    /// Return location of a file from the name index.
+    bool FindResourceLocation(StringHash nameHash, ResourceLocation& dest) const;
+    /// Open a file from a location returned by the name index. Return null if fails. Call with the resource mutex held.
+    SharedPtr<File> OpenFile(const String& name, const ResourceLocation& location);
+    /// Open the cooked file of a resource if it exists, is in the same package file or resource directory as the resource file, is up to date and is of the current version. Return null otherwise.
+    SharedPtr<File> GetCookedFile(const String& name);
+    /// Store a resource to its group as the most recently used.
+    void StoreResource(Resource* resource);
+    /// Remove a resource from its group. Return iterator to the next resource.
+    HashMap<StringHash, SharedPtr<Resource> >::Iterator EraseResource(ResourceGroup& group, HashMap<StringHash, SharedPtr<Resource> >::Iterator i);
+    /// Mark a stored resource as the most recently used.
+    void TouchResource(Resource* resource);
+    /// Update a resource group. Release least recently used resources if over memory budget.
     void UpdateResourceGroup(ShortStringHash type);
-    /// Handle begin frame event. Automatic resource reloads are processed here.
+    /// Store a request of a resource as a dependency of the resource being loaded, and record it to the manifest.
+    void StoreResourceRequest(ShortStringHash type, StringHash nameHash);
+    /// Record a resource and its known dependencies to the manifest. Return its index in the manifest.
+    unsigned RecordResource(ShortStringHash type, StringHash nameHash);
+    /// Handle begin frame event. Automatic resource reloads and background loaded resources are processed here.
     void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
     
     /// Resources by type.
@@ -164,10 +276,30 @@ private:
     Vector<SharedPtr<PackageFile> > packages_;
     /// Mapping of hashes to filenames.
     HashMap<StringHash, String> hashToName_;
+    /// Locations of the files in the package files and resource directories by name hash.
+    HashMap<StringHash, ResourceLocation> resourceIndex_;
+    /// Mutex for the resource directories and package files, held while they are modified and while files are looked up and opened, as files may be opened by the background loader thread. Acquired before the name index mutex.
+    mutable Mutex resourceMutex_;
+    /// Mutex for the name index, as files may be opened by the background loader thread.
+    mutable Mutex resourceIndexMutex_;
     /// Dependent resources.
     HashMap<StringHash, HashSet<StringHash> > dependentResources_;
+    /// Resources requested by each resource while it was loading, by name hash of the requesting resource.
+    HashMap<StringHash, PODVector<ResourceRef> > resourceDependencies_;
+    /// Resources being loaded on the main thread, innermost last.
+    PODVector<Resource*> loadingResources_;
+    /// Manifest being recorded to.
+    SharedPtr<ResourceManifest> recordingManifest_;
+    /// Background loader.
+    SharedPtr<BackgroundLoader> backgroundLoader_;
+    /// Maximum milliseconds per frame to finish background loaded resources.
+    int finishBackgroundResourcesMs_;
+    /// Minimum size of resource files to memory-map.
+    unsigned memoryMapThreshold_;
     /// Automatic resource reloading flag.
     bool autoReloadResources_;
+    /// Cooked resource loading flag.
+    bool useCookedResources_;
 };
 
 template <class T> T* ResourceCache::GetResource(const String& name)
@@ -188,6 +320,18 @@ template <class T> T* ResourceCache::GetResource(StringHash nameHash)
     return static_cast<T*>(GetResource(type, nameHash));
 }
 
+template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& name)
+{
+    ShortStringHash type = T::GetTypeStatic();
+    return StaticCast<T>(GetTempResource(type, name));
+}
+
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, int priority)
+{
+    ShortStringHash type = T::GetTypeStatic();
+    return BackgroundLoadResource(type, name, priority);
+}
+
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
 {
     PODVector<Resource*>& resources = reinterpret_cast<PODVector<Resource*>&>(result);
@@ -202,6 +346,8 @@ template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
     }
 }
 
+/// Return the name of the cooked file of a resource.
+URHO3D_API String GetCookedResourceName(const String& name);
 /// Register Resource library subsystems and objects.
 void RegisterResourceLibrary(Context* context);
 
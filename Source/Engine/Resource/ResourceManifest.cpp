@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "Context.h"
+#include "Deserializer.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "ResourceManifest.h"
+#include "StringUtils.h"
+#include "XMLFile.h"
+#include "XMLReader.h"
+
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+ResourceManifest::ResourceManifest(Context* context) :
+    Resource(context)
+{
+}
+
+ResourceManifest::~ResourceManifest()
+{
+}
+
+void ResourceManifest::RegisterObject(Context* context)
+{
+    context->RegisterFactory<ResourceManifest>();
+}
+
+bool ResourceManifest::BeginLoad(Deserializer& source)
+{
+    PROFILE(LoadResourceManifest);
+
+    Clear();
+
+    XMLReader reader(source);
+    if (!reader.ReadRoot("manifest"))
+    {
+        LOGERROR("Could not read resource manifest " + source.GetName());
+        return false;
+    }
+
+    while (reader.NextChild())
+    {
+        if (!strcmp(reader.GetName(), "resource"))
+        {
+            unsigned index = AddResource(ShortStringHash(reader.GetAttributeCString("type")), reader.GetAttribute("name"));
+            Vector<String> dependencies = String(reader.GetAttributeCString("dependencies")).Split(' ');
+            for (unsigned i = 0; i < dependencies.Size(); ++i)
+                entries_[index].dependencies_.Push(ToUInt(dependencies[i]));
+        }
+        reader.SkipElement();
+    }
+
+    if (reader.HasError())
+    {
+        LOGERROR("Could not parse resource manifest " + source.GetName());
+        Clear();
+        return false;
+    }
+
+    // Drop dependencies that do not refer to a resource in the manifest
+    for (unsigned i = 0; i < entries_.Size(); ++i)
+    {
+        PODVector<unsigned>& dependencies = entries_[i].dependencies_;
+        for (unsigned j = 0; j < dependencies.Size();)
+        {
+            if (dependencies[j] >= entries_.Size() || dependencies[j] == i)
+                dependencies.Erase(j);
+            else
+                ++j;
+        }
+    }
+
+    SetMemoryUse(source.GetSize());
+    return true;
+}
+
+bool ResourceManifest::Save(Serializer& dest) const
+{
+    SharedPtr<XMLFile> xml(new XMLFile(context_));
+    XMLElement rootElem = xml->CreateRoot("manifest");
+
+    for (unsigned i = 0; i < entries_.Size(); ++i)
+    {
+        const ManifestEntry& entry = entries_[i];
+        XMLElement resourceElem = rootElem.CreateChild("resource");
+        resourceElem.SetAttribute("type", context_->GetTypeName(entry.type_));
+        resourceElem.SetAttribute("name", entry.name_);
+
+        if (!entry.dependencies_.Empty())
+        {
+            String dependencies;
+            for (unsigned j = 0; j < entry.dependencies_.Size(); ++j)
+            {
+                if (j)
+                    dependencies += ' ';
+                dependencies += String(entry.dependencies_[j]);
+            }
+            resourceElem.SetAttribute("dependencies", dependencies);
+        }
+    }
+
+    return xml->Save(dest);
+}
+
+unsigned ResourceManifest::AddResource(ShortStringHash type, const String& name)
+{
+    Pair<StringHash, ShortStringHash> key(StringHash(name), type);
+    HashMap<Pair<StringHash, ShortStringHash>, unsigned>::ConstIterator i = indices_.Find(key);
+    if (i != indices_.End())
+        return i->second_;
+
+    unsigned index = entries_.Size();
+    entries_.Resize(index + 1);
+    entries_[index].type_ = type;
+    entries_[index].name_ = name;
+    indices_[key] = index;
+    return index;
+}
+
+void ResourceManifest::AddDependency(unsigned index, unsigned dependencyIndex)
+{
+    if (index >= entries_.Size() || dependencyIndex >= entries_.Size() || index == dependencyIndex)
+        return;
+
+    PODVector<unsigned>& dependencies = entries_[index].dependencies_;
+    if (!dependencies.Contains(dependencyIndex))
+        dependencies.Push(dependencyIndex);
+}
+
+void ResourceManifest::Clear()
+{
+    entries_.Clear();
+    indices_.Clear();
+}
+
+unsigned ResourceManifest::FindResource(ShortStringHash type, const String& name) const
+{
+    HashMap<Pair<StringHash, ShortStringHash>, unsigned>::ConstIterator i = indices_.Find(MakePair(StringHash(name), type));
+    return i != indices_.End() ? i->second_ : M_MAX_UNSIGNED;
+}
+
+void ResourceManifest::GetDepths(PODVector<unsigned>& dest) const
+{
+    dest.Resize(entries_.Size());
+    for (unsigned i = 0; i < dest.Size(); ++i)
+        dest[i] = 0;
+
+    // Push the depths down the dependency edges until they no longer change. A dependency cycle would keep increasing
+    // them, so stop after as many passes as there are resources
+    for (unsigned pass = 0; pass < entries_.Size(); ++pass)
+    {
+        bool changed = false;
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+        {
+            const PODVector<unsigned>& dependencies = entries_[i].dependencies_;
+            for (unsigned j = 0; j < dependencies.Size(); ++j)
+            {
+                if (dest[dependencies[j]] <= dest[i])
+                {
+                    dest[dependencies[j]] = dest[i] + 1;
+                    changed = true;
+                }
+            }
+        }
+        if (!changed)
+            break;
+    }
+}
+
+}
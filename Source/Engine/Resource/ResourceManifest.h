@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "HashMap.h"
+#include "Pair.h"
+#include "Resource.h"
+
+namespace Urho3D
+{
+
+/// Resource in a resource manifest.
+struct ManifestEntry
+{
+    /// Resource type.
+    ShortStringHash type_;
+    /// Resource name.
+    String name_;
+    /// Indices of the resources that this resource requests while loading.
+    PODVector<unsigned> dependencies_;
+};
+
+/// List of the resources used by for example a scene, and the dependencies between them. Recorded by the resource cache and used to queue all the resources for background loading at once, instead of discovering them one dependency level at a time.
+class URHO3D_API ResourceManifest : public Resource
+{
+    OBJECT(ResourceManifest);
+
+public:
+    /// Construct.
+    ResourceManifest(Context* context);
+    /// Destruct.
+    virtual ~ResourceManifest();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Save resource. Return true if successful.
+    virtual bool Save(Serializer& dest) const;
+
+    /// Add a resource unless already added. Return its index.
+    unsigned AddResource(ShortStringHash type, const String& name);
+    /// Add a dependency between resources by index.
+    void AddDependency(unsigned index, unsigned dependencyIndex);
+    /// Remove all resources.
+    void Clear();
+
+    /// Return number of resources.
+    unsigned GetNumResources() const { return entries_.Size(); }
+    /// Return all resources.
+    const Vector<ManifestEntry>& GetResources() const { return entries_; }
+    /// Return index of a resource, or M_MAX_UNSIGNED if not found.
+    unsigned FindResource(ShortStringHash type, const String& name) const;
+    /// Return the dependency depth of each resource: zero for resources that no other resource depends on, otherwise one more than the deepest resource depending on it.
+    void GetDepths(PODVector<unsigned>& dest) const;
+
+private:
+    /// Resources.
+    Vector<ManifestEntry> entries_;
+    /// Resource indices by name and type.
+    HashMap<Pair<StringHash, ShortStringHash>, unsigned> indices_;
+};
+
+}
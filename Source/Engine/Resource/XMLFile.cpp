@@ -77,7 +77,7 @@ void XMLFile::RegisterObject(Context* context)
     context->RegisterFactory<XMLFile>();
 }
 
-bool XMLFile::Load(Deserializer& source)
+bool XMLFile::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadXMLFile);
     
@@ -87,12 +87,20 @@ bool XMLFile::Load(Deserializer& source)
         LOGERROR("Zero sized XML data in " + source.GetName());
         return false;
     }
-
-    SharedArrayPtr<char> buffer(new char[dataSize]);
-    if (source.Read(buffer.Get(), dataSize) != dataSize)
-        return false;
     
-    if (!document_->load_buffer(buffer.Get(), dataSize))
+    // Parse straight from a stream that resides in memory, such as a memory-mapped file
+    const unsigned char* directData = source.GetDirectData();
+    SharedArrayPtr<char> buffer;
+    if (directData)
+        source.Seek(dataSize);
+    else
+    {
+        buffer = new char[dataSize];
+        if (source.Read(buffer.Get(), dataSize) != dataSize)
+            return false;
+    }
+    
+    if (!document_->load_buffer(directData ? (const void*)directData : (const void*)buffer.Get(), dataSize))
     {
         LOGERROR("Could not parse XML data from " + source.GetName());
         return false;
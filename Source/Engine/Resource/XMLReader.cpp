@@ -0,0 +1,639 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Precompiled.h"
+#include "Deserializer.h"
+#include "Log.h"
+#include "ResourceCache.h"
+#include "StringUtils.h"
+#include "XMLReader.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Size of the read buffer when the source does not reside in memory.
+static const unsigned READ_BUFFER_SIZE = 16384;
+/// Maximum length of an entity reference name.
+static const unsigned MAX_ENTITY_LENGTH = 10;
+
+inline int XMLReader::Peek()
+{
+    if (position_ == end_ && !Fill())
+        return -1;
+
+    return *position_;
+}
+
+inline int XMLReader::Get()
+{
+    if (position_ == end_ && !Fill())
+        return -1;
+
+    int c = *position_++;
+    if (c == '\n')
+        ++line_;
+    return c;
+}
+
+bool XMLReader::Fill()
+{
+    if (error_ || source_.IsEof())
+        return false;
+
+    buffer_.Resize(READ_BUFFER_SIZE);
+    unsigned bytesRead = source_.Read(&buffer_[0], READ_BUFFER_SIZE);
+    if (!bytesRead)
+        return false;
+
+    position_ = &buffer_[0];
+    end_ = position_ + bytesRead;
+    return true;
+}
+
+XMLReader::XMLReader(Deserializer& source, ResourceCache* cache) :
+    source_(source),
+    cache_(cache),
+    position_(0),
+    end_(0),
+    token_(TOKEN_NONE),
+    emptyElement_(false),
+    error_(false),
+    line_(1)
+{
+    scratch_.Push(0);
+
+    // Read straight from a stream that resides in memory, such as a memory-mapped file
+    const unsigned char* directData = source_.GetDirectData();
+    if (directData)
+    {
+        position_ = directData + source_.GetPosition();
+        end_ = directData + source_.GetSize();
+        source_.Seek(source_.GetSize());
+    }
+
+    // Skip the UTF-8 byte order mark. Other encodings are not supported
+    int c = Peek();
+    if (c == 0xef)
+    {
+        if (Get() != 0xef || Get() != 0xbb || Get() != 0xbf)
+            SetError("Invalid byte order mark");
+    }
+    else if (c == 0xfe || c == 0xff || c == 0)
+        SetError("Only UTF-8 encoding is supported");
+}
+
+XMLReader::~XMLReader()
+{
+}
+
+bool XMLReader::Next()
+{
+    if (error_)
+        return false;
+
+    attributes_.Clear();
+
+    // Return the end of an empty element
+    if (emptyElement_)
+    {
+        emptyElement_ = false;
+        PopElement();
+        token_ = TOKEN_END;
+        return true;
+    }
+
+    for (;;)
+    {
+        // Skip element text
+        for (;;)
+        {
+            const unsigned char* ptr = position_;
+            while (ptr < end_ && *ptr != '<')
+            {
+                if (*ptr == '\n')
+                    ++line_;
+                ++ptr;
+            }
+            position_ = ptr;
+            if (ptr < end_ || !Fill())
+                break;
+        }
+
+        int c = Get();
+        if (c == -1)
+        {
+            if (!openElements_.Empty())
+                SetError("Unexpected end of data");
+            token_ = TOKEN_NONE;
+            scratch_.Resize(1);
+            scratch_[0] = 0;
+            return false;
+        }
+
+        c = Peek();
+        if (c == '?')
+        {
+            if (!SkipPast("?>"))
+            {
+                SetError("Unterminated processing instruction");
+                return false;
+            }
+        }
+        else if (c == '!')
+        {
+            Get();
+            c = Peek();
+            if (c == '-')
+            {
+                if (!SkipPast("--") || !SkipPast("-->"))
+                {
+                    SetError("Unterminated comment");
+                    return false;
+                }
+            }
+            else if (c == '[')
+            {
+                if (!SkipPast("]]>"))
+                {
+                    SetError("Unterminated CDATA section");
+                    return false;
+                }
+            }
+            else
+            {
+                // Document type declaration, which may contain an internal subset in brackets
+                int brackets = 0;
+                for (;;)
+                {
+                    c = Get();
+                    if (c == -1)
+                    {
+                        SetError("Unterminated document type declaration");
+                        return false;
+                    }
+                    if (c == '[')
+                        ++brackets;
+                    else if (c == ']')
+                        --brackets;
+                    else if (c == '>' && brackets <= 0)
+                        break;
+                }
+            }
+        }
+        else if (c == '/')
+        {
+            Get();
+            return ReadEndTag();
+        }
+        else
+            return ReadStartTag();
+    }
+}
+
+bool XMLReader::ReadRoot(const String& name)
+{
+    if (!Next() || token_ != TOKEN_START)
+        return false;
+
+    return name.Empty() || name == GetName();
+}
+
+bool XMLReader::NextChild()
+{
+    return Next() && token_ == TOKEN_START;
+}
+
+void XMLReader::SkipElement()
+{
+    if (token_ != TOKEN_START)
+        return;
+
+    unsigned depth = 1;
+    while (depth && Next())
+    {
+        if (token_ == TOKEN_START)
+            ++depth;
+        else
+            --depth;
+    }
+}
+
+const char* XMLReader::GetAttributeName(unsigned index) const
+{
+    index <<= 1;
+    return index < attributes_.Size() ? &scratch_[attributes_[index]] : 0;
+}
+
+const char* XMLReader::GetAttributeValue(unsigned index) const
+{
+    index <<= 1;
+    return index < attributes_.Size() ? &scratch_[attributes_[index + 1]] : 0;
+}
+
+bool XMLReader::HasAttribute(const char* name) const
+{
+    for (unsigned i = 0; i < attributes_.Size(); i += 2)
+    {
+        if (!strcmp(&scratch_[attributes_[i]], name))
+            return true;
+    }
+
+    return false;
+}
+
+String XMLReader::GetAttribute(const char* name) const
+{
+    return String(GetAttributeCString(name));
+}
+
+const char* XMLReader::GetAttributeCString(const char* name) const
+{
+    for (unsigned i = 0; i < attributes_.Size(); i += 2)
+    {
+        if (!strcmp(&scratch_[attributes_[i]], name))
+            return &scratch_[attributes_[i + 1]];
+    }
+
+    return "";
+}
+
+bool XMLReader::GetBool(const char* name) const
+{
+    return ToBool(GetAttributeCString(name));
+}
+
+int XMLReader::GetInt(const char* name) const
+{
+    return ToInt(GetAttributeCString(name));
+}
+
+unsigned XMLReader::GetUInt(const char* name) const
+{
+    return ToUInt(GetAttributeCString(name));
+}
+
+Variant XMLReader::GetVariant()
+{
+    VariantType type = Variant::GetTypeFromName(GetAttributeCString("type"));
+    return GetVariantValue(type);
+}
+
+Variant XMLReader::GetVariantValue(VariantType type)
+{
+    Variant ret;
+
+    if (type == VAR_RESOURCEREF)
+        ret = GetResourceRef();
+    else if (type == VAR_RESOURCEREFLIST)
+        ret = GetResourceRefList();
+    else if (type == VAR_VARIANTVECTOR)
+        ret = GetVariantVector();
+    else if (type == VAR_VARIANTMAP)
+        ret = GetVariantMap();
+    else
+        ret.FromString(type, GetAttributeCString("value"));
+
+    return ret;
+}
+
+bool XMLReader::SkipPast(const char* terminator)
+{
+    // Compare the terminator to the last characters read
+    unsigned length = strlen(terminator);
+    char window[4] = { 0, 0, 0, 0 };
+    for (;;)
+    {
+        int c = Get();
+        if (c == -1)
+            return false;
+
+        for (unsigned i = 1; i < length; ++i)
+            window[i - 1] = window[i];
+        window[length - 1] = (char)c;
+        if (!strncmp(window, terminator, length))
+            return true;
+    }
+}
+
+void XMLReader::SkipWhitespace()
+{
+    for (;;)
+    {
+        const unsigned char* ptr = position_;
+        while (ptr < end_ && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n'))
+        {
+            if (*ptr == '\n')
+                ++line_;
+            ++ptr;
+        }
+        position_ = ptr;
+        if (ptr < end_ || !Fill())
+            return;
+    }
+}
+
+bool XMLReader::ReadName()
+{
+    unsigned start = scratch_.Size();
+    for (;;)
+    {
+        const unsigned char* ptr = position_;
+        while (ptr < end_ && *ptr > ' ' && *ptr != '>' && *ptr != '/' && *ptr != '=')
+            ++ptr;
+        Append(position_, ptr);
+        position_ = ptr;
+        if (ptr < end_ || !Fill())
+            break;
+    }
+
+    bool success = scratch_.Size() > start;
+    scratch_.Push(0);
+    return success;
+}
+
+bool XMLReader::ReadStartTag()
+{
+    scratch_.Clear();
+    if (!ReadName())
+    {
+        SetError("Invalid element name");
+        return false;
+    }
+    // Remember the name for checking the end of the element
+    unsigned nameLength = scratch_.Size();
+    openElements_.Push(openElementNames_.Size());
+    openElementNames_.Resize(openElementNames_.Size() + nameLength);
+    memcpy(&openElementNames_[openElements_.Back()], &scratch_[0], nameLength);
+
+    for (;;)
+    {
+        SkipWhitespace();
+        int c = Peek();
+        if (c == '>')
+        {
+            Get();
+            break;
+        }
+        else if (c == '/')
+        {
+            Get();
+            if (Get() != '>')
+            {
+                SetError("Invalid empty element " + String(&scratch_[0]));
+                return false;
+            }
+            emptyElement_ = true;
+            break;
+        }
+
+        attributes_.Push(scratch_.Size());
+        if (!ReadName())
+        {
+            SetError("Invalid attribute name in element " + String(&scratch_[0]));
+            return false;
+        }
+        SkipWhitespace();
+        if (Get() != '=')
+        {
+            SetError("Missing attribute value in element " + String(&scratch_[0]));
+            return false;
+        }
+        SkipWhitespace();
+        attributes_.Push(scratch_.Size());
+        if (!ReadAttributeValue())
+            return false;
+    }
+
+    token_ = TOKEN_START;
+    return true;
+}
+
+bool XMLReader::ReadEndTag()
+{
+    scratch_.Clear();
+    ReadName();
+    SkipWhitespace();
+    if (Get() != '>' || openElements_.Empty() || strcmp(&openElementNames_[openElements_.Back()], &scratch_[0]))
+    {
+        SetError("Mismatched end of element " + String(&scratch_[0]));
+        return false;
+    }
+
+    PopElement();
+    token_ = TOKEN_END;
+    return true;
+}
+
+void XMLReader::PopElement()
+{
+    openElementNames_.Resize(openElements_.Back());
+    openElements_.Pop();
+}
+
+bool XMLReader::ReadAttributeValue()
+{
+    int quote = Get();
+    if (quote != '\"' && quote != '\'')
+    {
+        SetError("Attribute value not in quotes in element " + String(&scratch_[0]));
+        return false;
+    }
+
+    for (;;)
+    {
+        // Copy ordinary characters in one go
+        const unsigned char* ptr = position_;
+        while (ptr < end_ && *ptr != quote && *ptr != '&' && *ptr >= ' ')
+            ++ptr;
+        Append(position_, ptr);
+        position_ = ptr;
+
+        int c = Get();
+        if (c == quote)
+            break;
+        else if (c == -1)
+        {
+            SetError("Unterminated attribute value in element " + String(&scratch_[0]));
+            return false;
+        }
+        else if (c == '&')
+            ReadEntity();
+        else if (c == '\r')
+        {
+            // Convert line breaks and tabs to spaces like pugixml does by default
+            if (Peek() == '\n')
+                Get();
+            scratch_.Push(' ');
+        }
+        else if (c == '\n' || c == '\t')
+            scratch_.Push(' ');
+        else
+            scratch_.Push((char)c);
+    }
+
+    scratch_.Push(0);
+    return true;
+}
+
+void XMLReader::Append(const unsigned char* start, const unsigned char* end)
+{
+    unsigned length = end - start;
+    if (length)
+    {
+        unsigned oldSize = scratch_.Size();
+        scratch_.Resize(oldSize + length);
+        memcpy(&scratch_[oldSize], start, length);
+    }
+}
+
+void XMLReader::ReadEntity()
+{
+    char name[MAX_ENTITY_LENGTH + 1];
+    unsigned length = 0;
+    int c = Peek();
+    while (length < MAX_ENTITY_LENGTH && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        c == '#'))
+    {
+        name[length++] = (char)Get();
+        c = Peek();
+    }
+    name[length] = 0;
+
+    unsigned unicodeChar = 0;
+    if (c == ';')
+    {
+        if (name[0] == '#')
+            unicodeChar = name[1] == 'x' ? strtoul(name + 2, 0, 16) : strtoul(name + 1, 0, 10);
+        else if (!strcmp(name, "lt"))
+            unicodeChar = '<';
+        else if (!strcmp(name, "gt"))
+            unicodeChar = '>';
+        else if (!strcmp(name, "amp"))
+            unicodeChar = '&';
+        else if (!strcmp(name, "quot"))
+            unicodeChar = '\"';
+        else if (!strcmp(name, "apos"))
+            unicodeChar = '\'';
+    }
+
+    if (unicodeChar)
+    {
+        Get();
+        char encoded[8];
+        char* dest = encoded;
+        String::EncodeUTF8(dest, unicodeChar);
+        for (char* src = encoded; src < dest; ++src)
+            scratch_.Push(*src);
+    }
+    else
+    {
+        // Keep an unknown reference as is
+        scratch_.Push('&');
+        for (unsigned i = 0; i < length; ++i)
+            scratch_.Push(name[i]);
+    }
+}
+
+void XMLReader::SetError(const String& message)
+{
+    LOGERROR("Could not parse XML data from " + source_.GetName() + " line " + String(line_) + ": " + message);
+    error_ = true;
+    token_ = TOKEN_NONE;
+    emptyElement_ = false;
+    attributes_.Clear();
+}
+
+ResourceRef XMLReader::GetResourceRef() const
+{
+    ResourceRef ret;
+
+    Vector<String> values = GetAttribute("value").Split(';');
+    if (values.Size() == 2)
+    {
+        ret.type_ = values[0];
+        ret.id_ = values[1];
+
+        // Store the reverse mapping of the resource name like XMLElement does
+        if (cache_)
+            cache_->StoreNameHash(values[1]);
+    }
+
+    return ret;
+}
+
+ResourceRefList XMLReader::GetResourceRefList() const
+{
+    ResourceRefList ret;
+
+    Vector<String> values = GetAttribute("value").Split(';');
+    if (values.Size() >= 1)
+    {
+        ret.type_ = values[0];
+        ret.ids_.Resize(values.Size() - 1);
+        for (unsigned i = 1; i < values.Size(); ++i)
+        {
+            ret.ids_[i - 1] = StringHash(values[i]);
+            if (cache_)
+                cache_->StoreNameHash(values[i]);
+        }
+    }
+
+    return ret;
+}
+
+VariantVector XMLReader::GetVariantVector()
+{
+    VariantVector ret;
+
+    while (NextChild())
+    {
+        if (!strcmp(GetName(), "variant"))
+            ret.Push(GetVariant());
+        SkipElement();
+    }
+
+    return ret;
+}
+
+VariantMap XMLReader::GetVariantMap()
+{
+    VariantMap ret;
+
+    while (NextChild())
+    {
+        if (!strcmp(GetName(), "variant"))
+        {
+            ShortStringHash key(GetInt("hash"));
+            ret[key] = GetVariant();
+        }
+        SkipElement();
+    }
+
+    return ret;
+}
+
+}
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "Variant.h"
+
+namespace Urho3D
+{
+
+class Deserializer;
+class ResourceCache;
+
+/// Streaming XML reader. Reads the elements of an XML stream one at a time without building a document, so that the memory use does not depend on the data size. Element text, comments and processing instructions are skipped.
+class URHO3D_API XMLReader
+{
+public:
+    /// Construct with source stream. Optionally store the names of resource references to the resource cache.
+    XMLReader(Deserializer& source, ResourceCache* cache = 0);
+    /// Destruct.
+    ~XMLReader();
+
+    /// Advance to the next start or end of an element. An empty element is returned as a start followed by an end. Return false at the end of the data or on error.
+    bool Next();
+    /// Advance to the root element, with optionally specified name. Return true if found.
+    bool ReadRoot(const String& name = String::EMPTY);
+    /// Advance to the next child of the current element. The reader must be at the start of the parent element or at the end of a previous child. Return false when the parent element ends or on error.
+    bool NextChild();
+    /// Skip the rest of the current element including its children, if at the start of an element.
+    void SkipElement();
+
+    /// Return whether is at the start of an element.
+    bool IsStartElement() const { return token_ == TOKEN_START; }
+    /// Return whether is at the end of an element.
+    bool IsEndElement() const { return token_ == TOKEN_END; }
+    /// Return whether a parse error has occurred.
+    bool HasError() const { return error_; }
+    /// Return current element name.
+    const char* GetName() const { return &scratch_[0]; }
+    /// Return number of attributes of the current element.
+    unsigned GetNumAttributes() const { return attributes_.Size() >> 1; }
+    /// Return attribute name by index.
+    const char* GetAttributeName(unsigned index) const;
+    /// Return attribute value by index.
+    const char* GetAttributeValue(unsigned index) const;
+    /// Return whether the current element has an attribute.
+    bool HasAttribute(const char* name) const;
+    /// Return attribute, or empty if missing.
+    String GetAttribute(const char* name) const;
+    /// Return attribute as C string, or empty if missing.
+    const char* GetAttributeCString(const char* name) const;
+    /// Return bool attribute, or false if missing.
+    bool GetBool(const char* name) const;
+    /// Return integer attribute, or zero if missing.
+    int GetInt(const char* name) const;
+    /// Return unsigned integer attribute, or zero if missing.
+    unsigned GetUInt(const char* name) const;
+    /// Return a variant attribute, or empty if missing. Reads the child elements of a variant vector or map.
+    Variant GetVariant();
+    /// Return the "value" attribute as a variant of specific type. Reads the child elements of a variant vector or map.
+    Variant GetVariantValue(VariantType type);
+    /// Return current line number.
+    unsigned GetLine() const { return line_; }
+
+private:
+    /// Element token.
+    enum Token
+    {
+        TOKEN_NONE = 0,
+        TOKEN_START,
+        TOKEN_END
+    };
+
+    /// Return next character without consuming it, or -1 at the end of the data.
+    int Peek();
+    /// Return and consume next character, or -1 at the end of the data.
+    int Get();
+    /// Read more data to the buffer. Return true if successful.
+    bool Fill();
+    /// Skip data until a terminating string, which is also skipped. Return true if found.
+    bool SkipPast(const char* terminator);
+    /// Skip whitespace characters.
+    void SkipWhitespace();
+    /// Read a name to the scratch buffer. Return true if not empty.
+    bool ReadName();
+    /// Read the rest of an element start tag.
+    bool ReadStartTag();
+    /// Read the rest of an element end tag.
+    bool ReadEndTag();
+    /// Remove the innermost open element.
+    void PopElement();
+    /// Read an attribute value to the scratch buffer, decoding entity references.
+    bool ReadAttributeValue();
+    /// Append characters to the scratch buffer.
+    void Append(const unsigned char* start, const unsigned char* end);
+    /// Read an entity reference after the ampersand to the scratch buffer.
+    void ReadEntity();
+    /// Log a parse error and stop reading.
+    void SetError(const String& message);
+    /// Return a resource reference from the current element.
+    ResourceRef GetResourceRef() const;
+    /// Return a resource reference list from the current element.
+    ResourceRefList GetResourceRefList() const;
+    /// Return a variant vector from the child elements of the current element.
+    VariantVector GetVariantVector();
+    /// Return a variant map from the child elements of the current element.
+    VariantMap GetVariantMap();
+
+    /// Source stream.
+    Deserializer& source_;
+    /// Resource cache for storing resource names.
+    ResourceCache* cache_;
+    /// Read buffer, when the source is not in memory.
+    PODVector<unsigned char> buffer_;
+    /// Current read position.
+    const unsigned char* position_;
+    /// End of the readable data.
+    const unsigned char* end_;
+    /// Current element name followed by the attribute names and values, each null-terminated.
+    PODVector<char> scratch_;
+    /// Scratch buffer offsets of the attribute names and values.
+    PODVector<unsigned> attributes_;
+    /// Names of the open elements, each null-terminated.
+    PODVector<char> openElementNames_;
+    /// Name offsets of the open elements.
+    PODVector<unsigned> openElements_;
+    /// Current token.
+    Token token_;
+    /// Current element is empty and its end is returned next.
+    bool emptyElement_;
+    /// Parse error flag.
+    bool error_;
+    /// Current line number.
+    unsigned line_;
+};
+
+}
@@ -31,6 +31,9 @@
 #include "SceneEvents.h"
 #include "SmoothedTransform.h"
 #include "XMLFile.h"
+#include "XMLReader.h"
+
+#include <cstring>
 
 #include "DebugNew.h"
 
@@ -46,6 +49,7 @@ Node::Node(Context* context) :
     parent_(0),
     scene_(0),
     id_(0),
+    replicationSlot_(M_MAX_UNSIGNED),
     position_(Vector3::ZERO),
     rotation_(Quaternion::IDENTITY),
     scale_(Vector3::ONE),
@@ -164,6 +168,25 @@ bool Node::LoadXML(const XMLElement& source, bool setInstanceDefault)
     return success;
 }
 
+bool Node::LoadXML(XMLReader& source, bool setInstanceDefault)
+{
+    SceneResolver resolver;
+
+    // Read own ID. Will not be applied, only stored for resolving possible references
+    unsigned nodeID = source.GetInt("id");
+    resolver.AddNode(nodeID, this);
+
+    // Read attributes, components and child nodes
+    bool success = LoadXML(source, resolver);
+    if (success)
+    {
+        resolver.Resolve();
+        ApplyAttributes();
+    }
+
+    return success;
+}
+
 bool Node::SaveXML(XMLElement& dest) const
 {
     // Write node ID
@@ -879,10 +902,16 @@ void Node::SetScene(Scene* scene)
     scene_ = scene;
 }
 
+void Node::SetReplicationSlot(unsigned slot)
+{
+    replicationSlot_ = slot;
+}
+
 void Node::ResetScene()
 {
     SetID(0);
     SetScene(0);
+    SetReplicationSlot(M_MAX_UNSIGNED);
     SetOwner(0);
 }
 
@@ -1069,6 +1098,54 @@ bool Node::LoadXML(const XMLElement& source, SceneResolver& resolver, bool readC
     return true;
 }
 
+bool Node::LoadXML(XMLReader& source, SceneResolver& resolver, bool readChildren, bool rewriteIDs, CreateMode mode)
+{
+    // Remove all children and components first in case this is not a fresh load
+    RemoveAllChildren();
+    RemoveAllComponents();
+
+    if (!source.IsStartElement())
+    {
+        LOGERROR("Could not load node, source is not at the start of an element");
+        return false;
+    }
+
+    unsigned startIndex = 0;
+
+    while (source.NextChild())
+    {
+        const char* name = source.GetName();
+        if (!strcmp(name, "attribute"))
+            LoadXMLAttribute(source, startIndex, false);
+        else if (!strcmp(name, "component"))
+        {
+            String typeName = source.GetAttribute("type");
+            unsigned compID = source.GetInt("id");
+            Component* newComponent = CreateComponent(typeName,
+                (mode == REPLICATED && compID < FIRST_LOCAL_ID) ? REPLICATED : LOCAL, rewriteIDs ? 0 : compID);
+            if (newComponent)
+            {
+                resolver.AddComponent(compID, newComponent);
+                if (!newComponent->LoadXML(source))
+                    return false;
+            }
+        }
+        else if (readChildren && !strcmp(name, "node"))
+        {
+            unsigned nodeID = source.GetInt("id");
+            Node* newNode = CreateChild(rewriteIDs ? 0 : nodeID, (mode == REPLICATED && nodeID < FIRST_LOCAL_ID) ? REPLICATED :
+                LOCAL);
+            resolver.AddNode(nodeID, newNode);
+            if (!newNode->LoadXML(source, resolver, readChildren, rewriteIDs, mode))
+                return false;
+        }
+
+        source.SkipElement();
+    }
+
+    return !source.HasError();
+}
+
 
 void Node::PrepareNetworkUpdate()
 {
@@ -1132,7 +1209,7 @@ void Node::PrepareNetworkUpdate()
                 if (!nodeState->markedDirty_)
                 {
                     nodeState->markedDirty_ = true;
-                    nodeState->sceneState_->dirtyNodes_.Insert(id_);
+                    nodeState->sceneState_->dirtyNodes_.Set(replicationSlot_);
                 }
             }
         }
@@ -1156,7 +1233,7 @@ void Node::PrepareNetworkUpdate()
                 if (!nodeState->markedDirty_)
                 {
                     nodeState->markedDirty_ = true;
-                    nodeState->sceneState_->dirtyNodes_.Insert(id_);
+                    nodeState->sceneState_->dirtyNodes_.Set(replicationSlot_);
                 }
             }
         }
@@ -1200,7 +1277,7 @@ void Node::MarkReplicationDirty()
             if (!nodeState->markedDirty_)
             {
                 nodeState->markedDirty_ = true;
-                nodeState->sceneState_->dirtyNodes_.Insert(id_);
+                nodeState->sceneState_->dirtyNodes_.Set(replicationSlot_);
             }
         }
     }
@@ -64,6 +64,8 @@ public:
     virtual bool Load(Deserializer& source, bool setInstanceDefault = false);
     /// Load from XML data. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader positioned at the start of the element. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, bool setInstanceDefault = false);
     /// Save as binary data. Return true if successful.
     virtual bool Save(Serializer& dest) const;
     /// Save as XML data. Return true if successful.
@@ -303,6 +305,8 @@ public:
     void SetID(unsigned id);
     /// Set scene. Called by Scene.
     void SetScene(Scene* scene);
+    /// Set scene replication slot. Called by Scene.
+    void SetReplicationSlot(unsigned slot);
     /// Reset scene. Called by Scene.
     void ResetScene();
     /// Set network position attribute.
@@ -321,8 +325,12 @@ public:
     bool Load(Deserializer& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false, CreateMode mode = REPLICATED);
     /// Load components from XML data and optionally load child nodes.
     bool LoadXML(const XMLElement& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false, CreateMode mode = REPLICATED);
+    /// Load components and optionally load child nodes from a streaming XML reader. Attributes, components and child nodes are loaded in the order they appear in the data.
+    bool LoadXML(XMLReader& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false, CreateMode mode = REPLICATED);
     /// Return the depended on nodes to order network updates.
     const PODVector<Node*>& GetDependencyNodes() const { return dependencyNodes_; }
+    /// Return dense index among the scene's replicated nodes, used for network replication bookkeeping. M_MAX_UNSIGNED if none.
+    unsigned GetReplicationSlot() const { return replicationSlot_; }
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
     /// Clean up all references to a network connection that is about to be removed.
@@ -374,6 +382,8 @@ private:
     Scene* scene_;
     /// Unique ID within the scene.
     unsigned id_;
+    /// Replication slot within the scene.
+    unsigned replicationSlot_;
     /// Position.
     Vector3 position_;
     /// Rotation.
@@ -27,6 +27,7 @@
 #include "HashSet.h"
 #include "Ptr.h"
 #include "StringHash.h"
+#include "Vector.h"
 
 #include <cstring>
 
@@ -121,6 +122,51 @@ struct URHO3D_API DirtyBits
     unsigned char count_;
 };
 
+/// Growable bitset indexed by scene replication slot.
+struct URHO3D_API SlotBits
+{
+    /// Set a bit.
+    void Set(unsigned index)
+    {
+        unsigned wordIndex = index >> 5;
+        if (wordIndex >= words_.Size())
+        {
+            // Guard against invalid slots from nodes that have left the scene
+            if (index == M_MAX_UNSIGNED)
+                return;
+            unsigned oldSize = words_.Size();
+            words_.Resize(wordIndex + 1);
+            memset(&words_[oldSize], 0, (words_.Size() - oldSize) * sizeof(unsigned));
+        }
+        words_[wordIndex] |= 1U << (index & 31);
+    }
+    
+    /// Clear a bit.
+    void Clear(unsigned index)
+    {
+        unsigned wordIndex = index >> 5;
+        if (wordIndex < words_.Size())
+            words_[wordIndex] &= ~(1U << (index & 31));
+    }
+    
+    /// Clear all bits.
+    void ClearAll()
+    {
+        if (words_.Size())
+            memset(&words_[0], 0, words_.Size() * sizeof(unsigned));
+    }
+    
+    /// Return if bit is set.
+    bool IsSet(unsigned index) const
+    {
+        unsigned wordIndex = index >> 5;
+        return wordIndex < words_.Size() && (words_[wordIndex] & (1U << (index & 31))) != 0;
+    }
+    
+    /// Bit data, 32 slots per word.
+    PODVector<unsigned> words_;
+};
+
 /// Per-object attribute state for network replication, allocated on demand.
 struct URHO3D_API NetworkState
 {
@@ -186,13 +232,36 @@ struct URHO3D_API SceneReplicationState : public ReplicationState
 {
     /// Nodes by ID.
     HashMap<unsigned, NodeReplicationState> nodeStates_;
-    /// Dirty node IDs.
-    HashSet<unsigned> dirtyNodes_;
+    /// Dirty nodes by scene replication slot.
+    SlotBits dirtyNodes_;
+    /// Nodes that have not been sent yet as part of the initial state, by scene replication slot.
+    SlotBits pendingNodes_;
+    /// IDs of nodes to send in the initial state, in hierarchy order.
+    PODVector<unsigned> initialNodes_;
+    /// Position in the initial state node list.
+    unsigned initialNodeIndex_;
+    /// IDs of removed nodes.
+    PODVector<unsigned> removedNodes_;
+    
+    /// Construct.
+    SceneReplicationState() :
+        ReplicationState(),
+        initialNodeIndex_(0)
+    {
+    }
+    
+    /// Return whether the initial state is still being sent.
+    bool IsSendingInitialState() const { return initialNodeIndex_ < initialNodes_.Size(); }
     
+    /// Clear all state.
     void Clear()
     {
         nodeStates_.Clear();
-        dirtyNodes_.Clear();
+        dirtyNodes_.words_.Clear();
+        pendingNodes_.words_.Clear();
+        initialNodes_.Clear();
+        initialNodeIndex_ = 0;
+        removedNodes_.Clear();
     }
 };
 
@@ -25,15 +25,19 @@
 #include "Context.h"
 #include "CoreEvents.h"
 #include "File.h"
+#include "FileReadQueue.h"
 #include "Log.h"
+#include "MemoryBuffer.h"
 #include "PackageFile.h"
 #include "Profiler.h"
 #include "ReplicationState.h"
+#include "ResourceCache.h"
 #include "Scene.h"
 #include "SceneEvents.h"
 #include "SmoothedTransform.h"
 #include "WorkQueue.h"
 #include "XMLFile.h"
+#include "XMLReader.h"
 
 #include "DebugNew.h"
 
@@ -172,13 +176,43 @@ bool Scene::LoadXML(const XMLElement& source, bool setInstanceDefault)
         return false;
 }
 
+bool Scene::LoadXML(XMLReader& source, bool setInstanceDefault)
+{
+    PROFILE(LoadSceneXML);
+
+    StopAsyncLoading();
+
+    // Load the whole scene, then perform post-load if successfully loaded
+    if (Node::LoadXML(source, setInstanceDefault))
+    {
+        FinishLoading(0);
+        return true;
+    }
+    else
+        return false;
+}
+
 void Scene::AddReplicationState(NodeReplicationState* state)
 {
     Node::AddReplicationState(state);
 
-    // This is the first update for a new connection. Mark all replicated nodes dirty
-    for (HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
-        state->sceneState_->dirtyNodes_.Insert(i->first_);
+    // This is the first update for a new connection. Queue all other replicated nodes to be sent as the initial state,
+    // parents before children. The connection streams them over several updates
+    SceneReplicationState* sceneState = state->sceneState_;
+    PODVector<Node*> nodes;
+    GetChildren(nodes, true);
+    
+    sceneState->initialNodes_.Clear();
+    sceneState->initialNodeIndex_ = 0;
+    for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        Node* node = *i;
+        if (node->GetID() < FIRST_LOCAL_ID)
+        {
+            sceneState->initialNodes_.Push(node->GetID());
+            sceneState->pendingNodes_.Set(node->GetReplicationSlot());
+        }
+    }
 }
 
 bool Scene::LoadXML(Deserializer& source)
@@ -187,15 +221,20 @@ bool Scene::LoadXML(Deserializer& source)
 
     StopAsyncLoading();
 
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
+    // Read the elements one at a time instead of building an XML document, which would use several times the file size
+    XMLReader reader(source, GetSubsystem<ResourceCache>());
+    if (!reader.ReadRoot())
+    {
+        if (!reader.HasError())
+            LOGERROR("No root element in " + source.GetName());
         return false;
+    }
 
     LOGINFO("Loading scene from " + source.GetName());
 
     Clear();
 
-    if (Node::LoadXML(xml->GetRoot()))
+    if (Node::LoadXML(reader))
     {
         FinishLoading(&source);
         return true;
@@ -261,6 +300,15 @@ bool Scene::LoadAsync(File* file)
     asyncProgress_.loadedNodes_ = 0;
     asyncProgress_.totalNodes_ = file->ReadVLE();
 
+    // Read the rest of the file in an I/O thread, so that the async updates do not stall on the disk
+    FileReadQueue* readQueue = GetSubsystem<FileReadQueue>();
+    if (readQueue && !file->IsMapped() && !file->IsEof())
+    {
+        asyncProgress_.read_ = new FileReadRequest(file, file->GetPosition());
+        asyncProgress_.readPosition_ = 0;
+        readQueue->AddRequest(asyncProgress_.read_);
+    }
+
     return true;
 }
 
@@ -314,6 +362,14 @@ bool Scene::LoadAsyncXML(File* file)
 void Scene::StopAsyncLoading()
 {
     asyncLoading_ = false;
+    if (asyncProgress_.read_)
+    {
+        // If the read has already started, the queue keeps the request until it completes
+        FileReadQueue* readQueue = GetSubsystem<FileReadQueue>();
+        if (readQueue)
+            readQueue->CancelRequest(asyncProgress_.read_);
+        asyncProgress_.read_.Reset();
+    }
     asyncProgress_.file_.Reset();
     asyncProgress_.xmlFile_.Reset();
     asyncProgress_.xmlElement_ = XMLElement::EMPTY;
@@ -368,11 +424,29 @@ Node* Scene::InstantiateXML(const XMLElement& source, const Vector3& position, c
 
 Node* Scene::InstantiateXML(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
+    PROFILE(InstantiateXML);
+
+    XMLReader reader(source, GetSubsystem<ResourceCache>());
+    if (!reader.ReadRoot())
         return 0;
 
-    return InstantiateXML(xml->GetRoot(), position, rotation, mode);
+    SceneResolver resolver;
+    unsigned nodeID = reader.GetInt("id");
+    // Rewrite IDs when instantiating
+    Node* node = CreateChild(0, mode);
+    resolver.AddNode(nodeID, node);
+    if (node->LoadXML(reader, resolver, true, true, mode))
+    {
+        resolver.Resolve();
+        node->ApplyAttributes();
+        node->SetTransform(position, rotation);
+        return node;
+    }
+    else
+    {
+        node->Remove();
+        return 0;
+    }
 }
 
 void Scene::Clear()
@@ -667,11 +741,29 @@ void Scene::NodeAdded(Node* node)
         if (i != replicatedNodes_.End() && i->second_ != node)
         {
             LOGWARNING("Overwriting node with ID " + String(id));
+            unsigned oldSlot = i->second_->GetReplicationSlot();
+            replicationSlots_[oldSlot] = 0;
+            freeReplicationSlots_.Push(oldSlot);
             i->second_->ResetScene();
         }
 
         replicatedNodes_[id] = node;
 
+        // Assign a dense slot for replication bookkeeping, reusing free slots first
+        unsigned slot;
+        if (freeReplicationSlots_.Size())
+        {
+            slot = freeReplicationSlots_.Back();
+            freeReplicationSlots_.Pop();
+            replicationSlots_[slot] = node;
+        }
+        else
+        {
+            slot = replicationSlots_.Size();
+            replicationSlots_.Push(node);
+        }
+        node->SetReplicationSlot(slot);
+
         MarkNetworkUpdate(node);
         MarkReplicationDirty(node);
     }
@@ -697,13 +789,21 @@ void Scene::NodeRemoved(Node* node)
     if (id < FIRST_LOCAL_ID)
     {
         replicatedNodes_.Erase(id);
-        MarkReplicationDirty(node);
+        MarkReplicationRemoved(node);
+
+        unsigned slot = node->GetReplicationSlot();
+        if (slot < replicationSlots_.Size() && replicationSlots_[slot] == node)
+        {
+            replicationSlots_[slot] = 0;
+            freeReplicationSlots_.Push(slot);
+        }
     }
     else
         localNodes_.Erase(id);
 
     node->SetID(0);
     node->SetScene(0);
+    node->SetReplicationSlot(M_MAX_UNSIGNED);
 }
 
 void Scene::ComponentAdded(Component* component)
@@ -823,11 +923,33 @@ void Scene::MarkReplicationDirty(Node* node)
 
     if (id < FIRST_LOCAL_ID && networkState_)
     {
+        unsigned slot = node->GetReplicationSlot();
+
         for (PODVector<ReplicationState*>::Iterator i = networkState_->replicationStates_.Begin(); i !=
             networkState_->replicationStates_.End(); ++i)
         {
             NodeReplicationState* nodeState = static_cast<NodeReplicationState*>(*i);
-            nodeState->sceneState_->dirtyNodes_.Insert(id);
+            nodeState->sceneState_->dirtyNodes_.Set(slot);
+            // The node is newer than the connection's initial state, so it should not wait for its turn in the stream
+            nodeState->sceneState_->pendingNodes_.Clear(slot);
+        }
+    }
+}
+
+void Scene::MarkReplicationRemoved(Node* node)
+{
+    unsigned id = node->GetID();
+
+    if (id < FIRST_LOCAL_ID && networkState_)
+    {
+        unsigned slot = node->GetReplicationSlot();
+
+        for (PODVector<ReplicationState*>::Iterator i = networkState_->replicationStates_.Begin(); i !=
+            networkState_->replicationStates_.End(); ++i)
+        {
+            NodeReplicationState* nodeState = static_cast<NodeReplicationState*>(*i);
+            nodeState->sceneState_->removedNodes_.Push(id);
+            nodeState->sceneState_->pendingNodes_.Clear(slot);
         }
     }
 }
@@ -844,6 +966,21 @@ void Scene::UpdateAsyncLoading()
 {
     PROFILE(UpdateAsyncLoading);
 
+    // Wait for the background read to complete before loading the nodes from it
+    FileReadRequest* read = asyncProgress_.read_;
+    if (read && !read->IsCompleted())
+        return;
+    if (read && !read->IsSuccess())
+    {
+        LOGERROR("Could not read scene file " + asyncProgress_.file_->GetName());
+        StopAsyncLoading();
+        return;
+    }
+
+    MemoryBuffer readData(read ? read->data_.Begin().ptr_ : 0, read ? read->data_.Size() : 0);
+    readData.Seek(asyncProgress_.readPosition_);
+    Deserializer& source = read ? (Deserializer&)readData : (Deserializer&)*asyncProgress_.file_;
+
     Timer asyncLoadTimer;
 
     for (;;)
@@ -857,10 +994,10 @@ void Scene::UpdateAsyncLoading()
         // Read one child node with its full sub-hierarchy either from binary or XML
         if (!asyncProgress_.xmlFile_)
         {
-            unsigned nodeID = asyncProgress_.file_->ReadUInt();
+            unsigned nodeID = source.ReadUInt();
             Node* newNode = CreateChild(nodeID, nodeID < FIRST_LOCAL_ID ? REPLICATED : LOCAL);
             resolver_.AddNode(nodeID, newNode);
-            newNode->Load(*asyncProgress_.file_, resolver_);
+            newNode->Load(source, resolver_);
         }
         else
         {
@@ -878,6 +1015,8 @@ void Scene::UpdateAsyncLoading()
             break;
     }
 
+    asyncProgress_.readPosition_ = readData.GetPosition();
+
     using namespace AsyncLoadProgress;
 
     VariantMap eventData;
@@ -32,6 +32,7 @@ namespace Urho3D
 {
 
 class File;
+class FileReadRequest;
 class PackageFile;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
@@ -44,6 +45,10 @@ struct AsyncProgress
 {
     /// File for binary mode.
     SharedPtr<File> file_;
+    /// Background read of the rest of the file for binary mode.
+    SharedPtr<FileReadRequest> read_;
+    /// Position within the background read data.
+    unsigned readPosition_;
     /// XML file for XML mode.
     SharedPtr<XMLFile> xmlFile_;
     /// Current XML element for XML mode.
@@ -76,10 +81,12 @@ public:
     virtual bool Save(Serializer& dest) const;
     /// Load from XML data. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, bool setInstanceDefault = false);
     /// Add a replication state that is tracking this scene.
     virtual void AddReplicationState(NodeReplicationState* state);
 
-    /// Load from an XML file. Return true if successful.
+    /// Load from an XML file. The file is read with a streaming XML reader. Return true if successful.
     bool LoadXML(Deserializer& source);
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest) const;
@@ -93,7 +100,7 @@ public:
     Node* Instantiate(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
     /// Instantiate scene content from XML data. Return root node if successful.
     Node* InstantiateXML(const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
-    /// Instantiate scene content from XML data. Return root node if successful.
+    /// Instantiate scene content from XML data, which is read with a streaming XML reader. Return root node if successful.
     Node* InstantiateXML(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
     /// Clear scene completely of nodes and components.
     void Clear();
@@ -122,6 +129,10 @@ public:
     Node* GetNode(unsigned id) const;
     /// Return component from the whole scene by ID, or null if not found.
     Component* GetComponent(unsigned id) const;
+    /// Return replicated node by replication slot, or null if the slot is free.
+    Node* GetReplicationSlotNode(unsigned slot) const { return slot < replicationSlots_.Size() ? replicationSlots_[slot] : 0; }
+    /// Return number of replication slots, including free slots.
+    unsigned GetNumReplicationSlots() const { return replicationSlots_.Size(); }
     /// Return whether updates are enabled.
     bool IsUpdateEnabled() const { return updateEnabled_; }
     /// Return asynchronous loading flag.
@@ -181,6 +192,8 @@ public:
     void MarkNetworkUpdate(Component* component);
     /// Mark a node dirty in scene replication states. The node does not need to have own replication state yet.
     void MarkReplicationDirty(Node* node);
+    /// Mark a node removed in scene replication states.
+    void MarkReplicationRemoved(Node* node);
 
 private:
     /// Handle the logic update event to update the scene, if active.
@@ -198,6 +211,10 @@ private:
     HashMap<unsigned, Node*> replicatedNodes_;
     /// Local scene nodes by ID.
     HashMap<unsigned, Node*> localNodes_;
+    /// Replicated scene nodes by replication slot. Free slots are null.
+    PODVector<Node*> replicationSlots_;
+    /// Free replication slots.
+    PODVector<unsigned> freeReplicationSlots_;
     /// Replicated components by ID.
     HashMap<unsigned, Component*> replicatedComponents_;
     /// Local components by ID.
@@ -30,6 +30,9 @@
 #include "Serializer.h"
 #include "StringUtils.h"
 #include "XMLElement.h"
+#include "XMLReader.h"
+
+#include <cstring>
 
 #include "DebugNew.h"
 
@@ -372,6 +375,26 @@ bool Serializable::LoadXML(const XMLElement& source, bool setInstanceDefault)
     return true;
 }
 
+bool Serializable::LoadXML(XMLReader& source, bool setInstanceDefault)
+{
+    if (!source.IsStartElement())
+    {
+        LOGERROR("Could not load " + GetTypeName() + ", source is not at the start of an element");
+        return false;
+    }
+
+    unsigned startIndex = 0;
+
+    while (source.NextChild())
+    {
+        if (!strcmp(source.GetName(), "attribute"))
+            LoadXMLAttribute(source, startIndex, setInstanceDefault);
+        source.SkipElement();
+    }
+
+    return !source.HasError();
+}
+
 bool Serializable::SaveXML(XMLElement& dest) const
 {
     if (dest.IsNull())
@@ -742,6 +765,70 @@ unsigned Serializable::GetNumNetworkAttributes() const
     return attributes ? attributes->Size() : 0;
 }
 
+void Serializable::LoadXMLAttribute(XMLReader& source, unsigned& startIndex, bool setInstanceDefault)
+{
+    const Vector<AttributeInfo>* attributes = GetAttributes();
+    if (!attributes || attributes->Empty())
+        return;
+
+    // Compare the name without converting it to a string. The attributes are usually stored in the order they are defined
+    const char* name = source.GetAttributeCString("name");
+    unsigned i = startIndex % attributes->Size();
+    unsigned attempts = attributes->Size();
+
+    while (attempts)
+    {
+        const AttributeInfo& attr = attributes->At(i);
+        if ((attr.mode_ & AM_FILE) && !strcmp(attr.name_.CString(), name))
+        {
+            Variant varValue;
+
+            // If enums specified, do enum lookup and int assignment. Otherwise assign the variant directly
+            if (attr.enumNames_)
+            {
+                const char* value = source.GetAttributeCString("value");
+                bool enumFound = false;
+                int enumValue = 0;
+                const char** enumPtr = attr.enumNames_;
+                while (*enumPtr)
+                {
+                    if (!String::Compare(value, *enumPtr, false))
+                    {
+                        enumFound = true;
+                        break;
+                    }
+                    ++enumPtr;
+                    ++enumValue;
+                }
+                if (enumFound)
+                    varValue = enumValue;
+                else
+                    LOGWARNING("Unknown enum value " + String(value) + " in attribute " + attr.name_);
+            }
+            else
+                varValue = source.GetVariantValue(attr.type_);
+
+            if (!varValue.IsEmpty())
+            {
+                OnSetAttribute(attr, varValue);
+
+                if (setInstanceDefault)
+                    SetInstanceDefault(attr.name_, varValue);
+            }
+
+            startIndex = (i + 1) % attributes->Size();
+            return;
+        }
+        else
+        {
+            i = (i + 1) % attributes->Size();
+            --attempts;
+        }
+    }
+
+    LOGWARNING("Unknown attribute " + String(name) + " in XML data");
+}
+
 void Serializable::SetInstanceDefault(const String& name, const Variant& defaultValue)
 {
     // Allocate the instance level default value
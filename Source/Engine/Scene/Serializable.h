@@ -34,6 +34,7 @@ class Connection;
 class Deserializer;
 class Serializer;
 class XMLElement;
+class XMLReader;
 
 struct DirtyBits;
 struct NetworkState;
@@ -64,6 +65,8 @@ public:
     virtual bool Save(Serializer& dest) const;
     /// Load from XML data. When setInstanceDefault is set to true, after setting the attribute value, store the value as instance's default value. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader positioned at the start of the element. Leaves the reader at the end of the element. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, bool setInstanceDefault = false);
     /// Save as XML data. Return true if successful.
     virtual bool SaveXML(XMLElement& dest) const;
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
@@ -108,8 +111,13 @@ public:
     unsigned GetNumNetworkAttributes() const;
     /// Return whether is temporary.
     bool IsTemporary() const { return temporary_; }
+    /// Return network attribute state, or null if not allocated.
+    NetworkState* GetNetworkState() const { return networkState_; }
 
 protected:
+    /// Load an attribute from a streaming XML reader positioned at an attribute element. The start index is the attribute to try first, and is advanced past the loaded attribute.
+    void LoadXMLAttribute(XMLReader& source, unsigned& startIndex, bool setInstanceDefault);
+    
     /// Network attribute state.
     NetworkState* networkState_;
 
@@ -93,6 +93,7 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "void SendRemoteEvent(Node@+, const String&in, bool, const VariantMap&in eventData = VariantMap())", asFUNCTION(SendRemoteNodeEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Connection", "void Disconnect(int waitMSec = 0)", asMETHOD(Connection, Disconnect), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "String ToString() const", asMETHOD(Connection, ToString), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void ResetStatistics()", asMETHOD(Connection, ResetStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_scene(Scene@+)", asMETHOD(Connection, SetScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "Scene@+ get_scene() const", asMETHOD(Connection, GetScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_logStatistics(bool)", asMETHOD(Connection, SetLogStatistics), asCALL_THISCALL);
@@ -154,6 +155,16 @@ static void NetworkUnregisterRemoteEvent(const String& eventType, Network* ptr)
     ptr->UnregisterRemoteEvent(eventType);
 }
 
+static void NetworkSetRemoteEventSchema(const String& eventType, const VariantMap& parameters, bool reliable, Network* ptr)
+{
+    ptr->SetRemoteEventSchema(eventType, parameters, reliable);
+}
+
+static void NetworkRemoveRemoteEventSchema(const String& eventType, Network* ptr)
+{
+    ptr->RemoveRemoteEventSchema(eventType);
+}
+
 static bool NetworkCheckRemoteEvent(const String& eventType, Network* ptr)
 {
     return ptr->CheckRemoteEvent(eventType);
@@ -173,11 +184,24 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "void RegisterRemoteEvent(const String&in) const", asFUNCTION(NetworkRegisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterRemoteEvent(const String&in) const", asFUNCTION(NetworkUnregisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterAllRemoteEvents()", asMETHOD(Network, UnregisterAllRemoteEvents), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void SetRemoteEventSchema(const String&in, const VariantMap&in, bool reliable = true)", asFUNCTION(NetworkSetRemoteEventSchema), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void RemoveRemoteEventSchema(const String&in)", asFUNCTION(NetworkRemoveRemoteEventSchema), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "bool CheckRemoteEvent(const String&in) const", asFUNCTION(NetworkCheckRemoteEvent), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "bool SetStatisticsFile(const String&in, int intervalMSec = 10000)", asMETHOD(Network, SetStatisticsFile), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void ResetStatistics()", asMETHOD(Network, ResetStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void DumpStatistics(uint maxEntries = 10)", asMETHOD(Network, DumpStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_updateFps(int)", asMETHOD(Network, SetUpdateFps), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "int get_updateFps() const", asMETHOD(Network, GetUpdateFps), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_initialStateBandwidth(int)", asMETHOD(Network, SetInitialStateBandwidth), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "int get_initialStateBandwidth() const", asMETHOD(Network, GetInitialStateBandwidth), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageBandwidth(int)", asMETHOD(Network, SetPackageBandwidth), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "int get_packageBandwidth() const", asMETHOD(Network, GetPackageBandwidth), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageCompression(bool)", asMETHOD(Network, SetPackageCompression), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_packageCompression() const", asMETHOD(Network, GetPackageCompression), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_packageCacheDir(const String&in)", asMETHOD(Network, SetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_packageCacheDir() const", asMETHOD(Network, GetPackageCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_collectStatistics(bool)", asMETHOD(Network, SetCollectStatistics), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_collectStatistics() const", asMETHOD(Network, GetCollectStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool get_serverRunning() const", asMETHOD(Network, IsServerRunning), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Connection@+ get_serverConnection() const", asMETHOD(Network, GetServerConnection), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Array<Connection@>@ get_clientConnections() const", asFUNCTION(NetworkGetClientConnections), asCALL_CDECL_OBJLAST);
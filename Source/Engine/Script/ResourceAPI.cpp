@@ -25,6 +25,7 @@
 #include "Image.h"
 #include "PackageFile.h"
 #include "ResourceCache.h"
+#include "ResourceManifest.h"
 
 namespace Urho3D
 {
@@ -36,11 +37,23 @@ void RegisterResource(asIScriptEngine* engine)
     RegisterResource<Resource>(engine, "Resource");
 }
 
+static void RegisterResourceManifest(asIScriptEngine* engine)
+{
+    RegisterResource<ResourceManifest>(engine, "ResourceManifest");
+    engine->RegisterObjectMethod("ResourceManifest", "void Clear()", asMETHOD(ResourceManifest, Clear), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceManifest", "uint get_numResources() const", asMETHOD(ResourceManifest, GetNumResources), asCALL_THISCALL);
+}
+
 static Resource* ResourceCacheGetResource(const String& type, const String& name, ResourceCache* ptr)
 {
     return ptr->GetResource(ShortStringHash(type), name);
 }
 
+static bool ResourceCacheBackgroundLoadResource(const String& type, const String& name, int priority, ResourceCache* ptr)
+{
+    return ptr->BackgroundLoadResource(ShortStringHash(type), name, priority);
+}
+
 static File* ResourceCacheGetFile(const String& name, ResourceCache* ptr)
 {
     SharedPtr<File> file = ptr->GetFile(name);
@@ -109,6 +122,7 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "void ReleaseResources(const String&in, bool force = false)", asFUNCTION(ResourceCacheReleaseResources), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void ReleaseResources(const String&in, const String&in, bool force = false)", asFUNCTION(ResourceCacheReleaseResourcesPartial), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void ReleaseAllResources(bool force = false)", asMETHOD(ResourceCache, ReleaseAllResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void ResetStatistics()", asMETHOD(ResourceCache, ResetStatistics), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool ReloadResource(Resource@+)", asMETHOD(ResourceCache, ReloadResource), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool Exists(const String&in) const", asMETHODPR(ResourceCache, Exists, (const String&) const, bool), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "File@ GetFile(const String&in)", asFUNCTION(ResourceCacheGetFile), asCALL_CDECL_OBJLAST);
@@ -119,6 +133,10 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(const String&in, const String&in)", asFUNCTION(ResourceCacheGetResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(ShortStringHash, StringHash)", asMETHODPR(ResourceCache, GetResource, (ShortStringHash, StringHash), Resource*), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(ShortStringHash, const String&in)", asMETHODPR(ResourceCache, GetResource, (ShortStringHash, const String&), Resource*), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, int priority = 0)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "uint PreloadResources(ResourceManifest@+, int priority = 0)", asMETHOD(ResourceCache, PreloadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void StartManifestRecording(ResourceManifest@+)", asMETHOD(ResourceCache, StartManifestRecording), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void StopManifestRecording()", asMETHOD(ResourceCache, StopManifestRecording), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_memoryBudget(const String&in, uint)", asFUNCTION(ResourceCacheSetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryBudget(const String&in) const", asFUNCTION(ResourceCacheGetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint get_memoryUse(const String&in) const", asFUNCTION(ResourceCacheGetMemoryUse), asCALL_CDECL_OBJLAST);
@@ -127,6 +145,14 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "Array<PackageFile@>@ get_packageFiles() const", asFUNCTION(ResourceCacheGetPackageFiles), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_autoReloadResources(bool)", asMETHOD(ResourceCache, SetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_autoReloadResources() const", asMETHOD(ResourceCache, GetAutoReloadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_finishBackgroundResourcesMs(int)", asMETHOD(ResourceCache, SetFinishBackgroundResourcesMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "int get_finishBackgroundResourcesMs() const", asMETHOD(ResourceCache, GetFinishBackgroundResourcesMs), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_memoryMapThreshold(uint)", asMETHOD(ResourceCache, SetMemoryMapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_memoryMapThreshold() const", asMETHOD(ResourceCache, GetMemoryMapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadResources() const", asMETHOD(ResourceCache, GetNumBackgroundLoadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_useCookedResources(bool)", asMETHOD(ResourceCache, SetUseCookedResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_useCookedResources() const", asMETHOD(ResourceCache, GetUseCookedResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "ResourceManifest@+ get_recordingManifest() const", asMETHOD(ResourceCache, GetRecordingManifest), asCALL_THISCALL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_resourceCache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_cache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
 }
@@ -323,6 +349,7 @@ static void RegisterXMLFile(asIScriptEngine* engine)
 void RegisterResourceAPI(asIScriptEngine* engine)
 {
     RegisterResource(engine);
+    RegisterResourceManifest(engine);
     RegisterResourceCache(engine);
     RegisterImage(engine);
     RegisterXMLElement(engine);
@@ -25,6 +25,7 @@
 #include "Context.h"
 #include "FileSystem.h"
 #include "Log.h"
+#include "MemoryBuffer.h"
 #include "Profiler.h"
 #include "ResourceCache.h"
 #include "Script.h"
@@ -96,7 +97,8 @@ ScriptFile::ScriptFile(Context* context) :
     Resource(context),
     script_(GetSubsystem<Script>()),
     scriptModule_(0),
-    compiled_(false)
+    compiled_(false),
+    loadDataSize_(0)
 {
 }
 
@@ -110,10 +112,34 @@ void ScriptFile::RegisterObject(Context* context)
     context->RegisterFactory<ScriptFile>();
 }
 
-bool ScriptFile::Load(Deserializer& source)
+bool ScriptFile::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadScript);
     
+    // Only read the data here. AngelScript can not build modules in several threads, and the script engine must only be
+    // accessed from the main thread
+    loadDataSize_ = source.GetSize();
+    loadData_ = new unsigned char[loadDataSize_];
+    if (source.Read(loadData_.Get(), loadDataSize_) != loadDataSize_)
+    {
+        loadData_.Reset();
+        return false;
+    }
+    
+    return true;
+}
+
+bool ScriptFile::EndLoad()
+{
+    if (!loadData_)
+        return false;
+    
+    PROFILE(CompileScript);
+    
+    MemoryBuffer source(loadData_.Get(), loadDataSize_);
+    SharedArrayPtr<unsigned char> data = loadData_;
+    loadData_.Reset();
+    
     ReleaseModule();
     
     // Create the module. Discard previous module if there was one
@@ -145,7 +171,7 @@ bool ScriptFile::Load(Deserializer& source)
         source.Seek(0);
     
     // Not bytecode: add the initial section and check for includes
-    if (!AddScriptSection(engine, source))
+    if (!AddScriptSection(engine, source, GetName()))
         return false;
     
     // Compile. Set script engine logging to retained mode so that potential exceptions can show all error info
@@ -394,7 +420,7 @@ asIScriptFunction* ScriptFile::GetMethod(asIScriptObject* object, const String&
     return function;
 }
 
-bool ScriptFile::AddScriptSection(asIScriptEngine* engine, Deserializer& source)
+bool ScriptFile::AddScriptSection(asIScriptEngine* engine, Deserializer& source, const String& sectionName)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
     
@@ -503,7 +529,7 @@ bool ScriptFile::AddScriptSection(asIScriptEngine* engine, Deserializer& source)
         SharedPtr<File> file = cache->GetFile(includeFiles[i]);
         if (file)
         {
-            if (!AddScriptSection(engine, *file))
+            if (!AddScriptSection(engine, *file, file->GetName()))
                 return false;
         }
         else
@@ -514,9 +540,9 @@ bool ScriptFile::AddScriptSection(asIScriptEngine* engine, Deserializer& source)
     }
     
     // Then add this section
-    if (scriptModule_->AddScriptSection(source.GetName().CString(), (const char*)buffer.Get(), dataSize) < 0)
+    if (scriptModule_->AddScriptSection(sectionName.CString(), (const char*)buffer.Get(), dataSize) < 0)
     {
-        LOGERROR("Failed to add script section " + source.GetName());
+        LOGERROR("Failed to add script section " + sectionName);
         return false;
     }
     
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "ArrayPtr.h"
 #include "HashSet.h"
 #include "Resource.h"
 #include "ScriptEventListener.h"
@@ -53,8 +54,10 @@ public:
     /// Register object factory.
     static void RegisterObject(Context* context);
     
-    /// Load resource. Return true if successful.
-    virtual bool Load(Deserializer& source);
+    /// Load resource from stream. May be called from a worker thread. Return true if successful.
+    virtual bool BeginLoad(Deserializer& source);
+    /// Finish resource loading. Always called from the main thread. Return true if successful.
+    virtual bool EndLoad();
     /// Add an event handler. Called by script exposed version of SubscribeToEvent().
     virtual void AddEventHandler(StringHash eventType, const String& handlerName);
     /// Add an event handler for a specific sender. Called by script exposed version of SubscribeToEvent().
@@ -84,7 +87,7 @@ public:
     
 private:
     /// Add a script section, checking for includes recursively. Return true if successful.
-    bool AddScriptSection(asIScriptEngine* engine, Deserializer& source);
+    bool AddScriptSection(asIScriptEngine* engine, Deserializer& source, const String& sectionName);
     /// Set parameters for a function or method.
     void SetParameters(asIScriptContext* context, asIScriptFunction* function, const VariantVector& parameters);
     /// Release the script module.
@@ -106,6 +109,10 @@ private:
     HashMap<String, asIScriptFunction*> functions_;
     /// Search cache for methods.
     HashMap<asIObjectType*, HashMap<String, asIScriptFunction*> > methods_;
+    /// Script file data read during BeginLoad.
+    SharedArrayPtr<unsigned char> loadData_;
+    /// Script file data size.
+    unsigned loadDataSize_;
 };
 
 /// Get currently executing script file.
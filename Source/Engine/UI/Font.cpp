@@ -154,7 +154,7 @@ void Font::RegisterObject(Context* context)
     context->RegisterFactory<Font>();
 }
 
-bool Font::Load(Deserializer& source)
+bool Font::BeginLoad(Deserializer& source)
 {
     PROFILE(LoadFont);
     
@@ -28,6 +28,9 @@
 #include "UI.h"
 #include "UIEvents.h"
 #include "Window.h"
+#include "XMLReader.h"
+
+#include <cstring>
 
 #include "DebugNew.h"
 
@@ -227,6 +230,125 @@ bool Menu::LoadXML(const XMLElement& source, XMLFile* styleFile, bool setInstanc
     return true;
 }
 
+bool Menu::LoadXML(XMLReader& source, XMLFile* styleFile, bool setInstanceDefault)
+{
+    if (!source.IsStartElement())
+    {
+        LOGERROR("Could not load " + GetTypeName() + ", source is not at the start of an element");
+        return false;
+    }
+
+    // Get style override if defined
+    String styleName = source.GetAttribute("style");
+
+    // Apply the style first, if the style file is available
+    if (styleFile)
+    {
+        // If not defined, use type name
+        if (styleName.Empty())
+            styleName = GetTypeName();
+
+        SetStyle(styleName, styleFile);
+    }
+    // The 'style' attribute value in the style file cannot be equals to original's applied style to prevent infinite loop
+    else if (!styleName.Empty() && styleName != appliedStyle_)
+    {
+        // Attempt to use the default style file
+        styleFile = GetDefaultStyle();
+
+        if (styleFile)
+        {
+            // Remember the original applied style
+            String appliedStyle(appliedStyle_);
+            SetStyle(styleName, styleFile);
+            appliedStyle_ = appliedStyle;
+        }
+    }
+
+    unsigned startIndex = 0;
+    unsigned nextInternalChild = 0;
+
+    // Load attributes and child elements in the order they appear. Internal elements are not to be created as they
+    // already exist
+    while (source.NextChild())
+    {
+        const char* name = source.GetName();
+        if (!strcmp(name, "attribute"))
+            LoadXMLAttribute(source, startIndex, setInstanceDefault);
+        else if (!strcmp(name, "element"))
+        {
+            bool internalElem = source.GetBool("internal");
+            bool popupElem = source.GetBool("popup");
+            String typeName = source.GetAttribute("type");
+            if (typeName.Empty())
+                typeName = "UIElement";
+            unsigned index = source.HasAttribute("index") ? source.GetUInt("index") : M_MAX_UNSIGNED;
+            UIElement* child = 0;
+
+            if (!internalElem)
+            {
+                if (!popupElem)
+                    child = CreateChild(typeName, String::EMPTY, index);
+                else
+                {
+                    // Do not add the popup element as a child even temporarily, as that can break layouts
+                    SharedPtr<UIElement> popup = DynamicCast<UIElement>(context_->CreateObject(typeName));
+                    if (!popup)
+                        LOGERROR("Could not create popup element type " + typeName);
+                    else
+                    {
+                        child = popup;
+                        SetPopup(popup);
+                    }
+                }
+            }
+            else
+            {
+                // An internal popup element should already exist
+                if (popupElem)
+                    child = popup_;
+                else
+                {
+                    for (unsigned i = nextInternalChild; i < children_.Size(); ++i)
+                    {
+                        if (children_[i]->IsInternal() && children_[i]->GetTypeName() == typeName)
+                        {
+                            child = children_[i];
+                            nextInternalChild = i + 1;
+                            break;
+                        }
+                    }
+
+                    if (!child)
+                        LOGWARNING("Could not find matching internal child element of type " + typeName + " in " + GetTypeName());
+                }
+            }
+
+            if (child)
+            {
+                if (!styleFile)
+                    styleFile = GetDefaultStyle();
+
+                // As popup is not a child element in itself, set the default style to it for its child elements to find
+                if (popupElem)
+                    child->SetDefaultStyle(styleFile);
+
+                if (!child->LoadXML(source, styleFile, setInstanceDefault))
+                    return false;
+            }
+        }
+
+        source.SkipElement();
+    }
+
+    if (source.HasError())
+        return false;
+
+    ApplyAttributes();
+
+    return true;
+}
+
 bool Menu::SaveXML(XMLElement& dest) const
 {
     if (!Button::SaveXML(dest))
@@ -44,6 +44,8 @@ public:
 
     /// Load from XML data with style. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, XMLFile* styleFile, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader with style. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, XMLFile* styleFile, bool setInstanceDefault = false);
     /// Save as XML data. Return true if successful.
     virtual bool SaveXML(XMLElement& dest) const;
 
@@ -28,6 +28,7 @@
 #include "Log.h"
 #include "Material.h"
 #include "Node.h"
+#include "Octree.h"
 #include "ResourceCache.h"
 #include "Technique.h"
 #include "Text.h"
@@ -99,8 +100,15 @@ void Text3D::UpdateBatches(const FrameInfo& frame)
     
     if (faceCamera_)
     {
-        customWorldTransform_ = Matrix3x4(node_->GetWorldPosition(), frame.camera_->GetNode()->GetWorldRotation(), node_->GetWorldScale());
-        worldBoundingBoxDirty_ = true;
+        Matrix3x4 faceCameraTransform(node_->GetWorldPosition(), frame.camera_->GetNode()->GetWorldRotation(), node_->GetWorldScale());
+        if (faceCameraTransform != customWorldTransform_)
+        {
+            customWorldTransform_ = faceCameraTransform;
+            worldBoundingBoxDirty_ = true;
+            // Called from a worker thread, so let the octree refresh its copy of the bounding box on the next update
+            if (!reinsertionQueued_ && octant_)
+                octant_->GetRoot()->QueueReinsertion(this);
+        }
     }
     
     for (unsigned i = 0; i < batches_.Size(); ++i)
@@ -38,6 +38,7 @@
 #include "Matrix3x4.h"
 #include "Profiler.h"
 #include "Renderer.h"
+#include "ResourceCache.h"
 #include "ScrollBar.h"
 #include "Shader.h"
 #include "ShaderVariation.h"
@@ -51,6 +52,7 @@
 #include "UIEvents.h"
 #include "VertexBuffer.h"
 #include "Window.h"
+#include "XMLReader.h"
 
 #include "DebugNew.h"
 
@@ -392,11 +394,41 @@ void UI::DebugDraw(UIElement* element)
 
 SharedPtr<UIElement> UI::LoadLayout(Deserializer& source, XMLFile* styleFile)
 {
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    if (!xml->Load(source))
-        return SharedPtr<UIElement>();
-    else
-        return LoadLayout(xml, styleFile);
+    PROFILE(LoadUILayout);
+
+    SharedPtr<UIElement> root;
+
+    LOGDEBUG("Loading UI layout " + source.GetName());
+
+    // Read the elements one at a time instead of building an XML document
+    XMLReader reader(source, GetSubsystem<ResourceCache>());
+    if (!reader.ReadRoot("element"))
+    {
+        if (!reader.HasError())
+            LOGERROR("No root UI element in " + source.GetName());
+        return root;
+    }
+
+    String typeName = reader.GetAttribute("type");
+    if (typeName.Empty())
+        typeName = "UIElement";
+
+    root = DynamicCast<UIElement>(context_->CreateObject(typeName));
+    if (!root)
+    {
+        LOGERROR("Could not create unknown UI element " + typeName);
+        return root;
+    }
+
+    // Use default style file of the root element if it has one
+    if (!styleFile)
+        styleFile = rootElement_->GetDefaultStyle(false);
+    // Set it as default for later use by children elements
+    if (styleFile)
+        root->SetDefaultStyle(styleFile);
+
+    root->LoadXML(reader, styleFile);
+    return root;
 }
 
 SharedPtr<UIElement> UI::LoadLayout(XMLFile* file, XMLFile* styleFile)
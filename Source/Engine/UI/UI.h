@@ -69,7 +69,7 @@ public:
     void Render();
     /// Debug draw a UI element.
     void DebugDraw(UIElement* element);
-    /// Load a UI layout from an XML file. Optionally specify another XML file for element style. Return the root element.
+    /// Load a UI layout from an XML file with a streaming XML reader. Optionally specify another XML file for element style. Return the root element.
     SharedPtr<UIElement> LoadLayout(Deserializer& source, XMLFile* styleFile = 0);
     /// Load a UI layout from an XML file. Optionally specify another XML file for element style. Return the root element.
     SharedPtr<UIElement> LoadLayout(XMLFile* file, XMLFile* styleFile = 0);
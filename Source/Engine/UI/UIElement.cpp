@@ -31,6 +31,9 @@
 #include "UI.h"
 #include "UIElement.h"
 #include "UIEvents.h"
+#include "XMLReader.h"
+
+#include <cstring>
 
 #include "DebugNew.h"
 
@@ -294,6 +297,103 @@ bool UIElement::LoadXML(const XMLElement& source, XMLFile* styleFile, bool setIn
     return true;
 }
 
+bool UIElement::LoadXML(XMLReader& source, bool setInstanceDefault)
+{
+    return LoadXML(source, 0, setInstanceDefault);
+}
+
+bool UIElement::LoadXML(XMLReader& source, XMLFile* styleFile, bool setInstanceDefault)
+{
+    if (!source.IsStartElement())
+    {
+        LOGERROR("Could not load " + GetTypeName() + ", source is not at the start of an element");
+        return false;
+    }
+
+    // Get style override if defined
+    String styleName = source.GetAttribute("style");
+
+    // Apply the style first, if the style file is available
+    if (styleFile)
+    {
+        // If not defined, use type name
+        if (styleName.Empty())
+            styleName = GetTypeName();
+
+        SetStyle(styleName, styleFile);
+    }
+    // The 'style' attribute value in the style file cannot be equals to original's applied style to prevent infinite loop
+    else if (!styleName.Empty() && styleName != appliedStyle_)
+    {
+        // Attempt to use the default style file
+        styleFile = GetDefaultStyle();
+
+        if (styleFile)
+        {
+            // Remember the original applied style
+            String appliedStyle(appliedStyle_);
+            SetStyle(styleName, styleFile);
+            appliedStyle_ = appliedStyle;
+        }
+    }
+
+    unsigned startIndex = 0;
+    unsigned nextInternalChild = 0;
+
+    // Load attributes and child elements in the order they appear. Internal elements are not to be created as they
+    // already exist
+    while (source.NextChild())
+    {
+        const char* name = source.GetName();
+        if (!strcmp(name, "attribute"))
+            LoadXMLAttribute(source, startIndex, setInstanceDefault);
+        else if (!strcmp(name, "element"))
+        {
+            bool internalElem = source.GetBool("internal");
+            String typeName = source.GetAttribute("type");
+            if (typeName.Empty())
+                typeName = "UIElement";
+            unsigned index = source.HasAttribute("index") ? source.GetUInt("index") : M_MAX_UNSIGNED;
+            UIElement* child = 0;
+
+            if (!internalElem)
+                child = CreateChild(typeName, String::EMPTY, index);
+            else
+            {
+                for (unsigned i = nextInternalChild; i < children_.Size(); ++i)
+                {
+                    if (children_[i]->IsInternal() && children_[i]->GetTypeName() == typeName)
+                    {
+                        child = children_[i];
+                        nextInternalChild = i + 1;
+                        break;
+                    }
+                }
+
+                if (!child)
+                    LOGWARNING("Could not find matching internal child element of type " + typeName + " in " + GetTypeName());
+            }
+
+            if (child)
+            {
+                if (!styleFile)
+                    styleFile = GetDefaultStyle();
+                if (!child->LoadXML(source, styleFile, setInstanceDefault))
+                    return false;
+            }
+        }
+
+        source.SkipElement();
+    }
+
+    if (source.HasError())
+        return false;
+
+    ApplyAttributes();
+
+    return true;
+}
+
 bool UIElement::LoadChildXML(const XMLElement& childElem, XMLFile* styleFile, bool setInstanceDefault)
 {
     bool internalElem = childElem.GetBool("internal");
@@ -537,8 +637,8 @@ void UIElement::OnPositionSet()
 
 bool UIElement::LoadXML(Deserializer& source)
 {
-    SharedPtr<XMLFile> xml(new XMLFile(context_));
-    return xml->Load(source) && LoadXML(xml->GetRoot());
+    XMLReader reader(source, GetSubsystem<ResourceCache>());
+    return reader.ReadRoot() && LoadXML(reader);
 }
 
 bool UIElement::SaveXML(Serializer& dest) const
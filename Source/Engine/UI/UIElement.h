@@ -129,6 +129,10 @@ public:
     virtual bool LoadXML(const XMLElement& source, bool setInstanceDefault = false);
     /// Load from XML data with style. Return true if successful.
     virtual bool LoadXML(const XMLElement& source, XMLFile* styleFile, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, bool setInstanceDefault = false);
+    /// Load from a streaming XML reader with style. Return true if successful.
+    virtual bool LoadXML(XMLReader& source, XMLFile* styleFile, bool setInstanceDefault = false);
     /// Create a child by loading from XML data with style. Return true if successful.
     virtual bool LoadChildXML(const XMLElement& childElem, XMLFile* styleFile = 0, bool setInstanceDefault = false);
     /// Save as XML data. Return true if successful.
@@ -171,7 +175,7 @@ public:
     /// React to position change.
     virtual void OnPositionSet();
 
-    /// Load from an XML file. Return true if successful.
+    /// Load from an XML file. The file is read with a streaming XML reader. Return true if successful.
     bool LoadXML(Deserializer& source);
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest) const;
@@ -63,7 +63,7 @@ UDPMessageConnection::UDPMessageConnection(Network *owner, NetworkServer *ownerS
 retransmissionTimeout(1000.f), numAcksLastFrame(0), numLossesLastFrame(0), smoothedRTT(1000.f), rttVariation(0.f), rttCleared(true), // Set RTT initial values as per RFC 2988.
 lastReceivedInOrderPacketID(0), 
 lastSentInOrderPacketID(0), datagramPacketIDCounter(1),
-packetLossRate(0.f), packetLossCount(0.f), 
+packetLossRate(0.f), packetLossCount(0.f), numResentMessages(0), 
 datagramSendRate(50.f), lowestDatagramSendRateOnPacketLoss(50.f), slowModeDelay(0),
 receivedPacketIDs(64 * 1024), outboundPacketAckTrack(1024),
 previousReceivedPacketID(0), queuedInboundDatagrams(128)
@@ -563,6 +563,9 @@ MessageConnection::PacketSendResult UDPMessageConnection::SendOutPacket()
 	for(size_t i = 0; i < datagramSerializedMessages.size(); ++i)
 	{
 		++datagramSerializedMessages[i]->sendCount;
+		// Urho3D: count resends for network statistics
+		if (datagramSerializedMessages[i]->sendCount > 1)
+			++numResentMessages;
 
 #ifdef KNET_NETWORK_PROFILING
 		std::stringstream ss;
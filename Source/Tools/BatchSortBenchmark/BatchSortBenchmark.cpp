@@ -0,0 +1,258 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Batch.h"
+#include "Context.h"
+#include "ProcessUtils.h"
+#include "StringUtils.h"
+#include "Timer.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned NUM_SORT_MODES = 3;
+static const char* sortModeNames[] =
+{
+    "state",
+    "front_to_back",
+    "back_to_front"
+};
+
+/// Compare batches by state, then distance, like the comparison sort used before the radix sort.
+bool CompareBatchesState(Batch* lhs, Batch* rhs)
+{
+    if (lhs->sortKey_ != rhs->sortKey_)
+        return lhs->sortKey_ < rhs->sortKey_;
+    else
+        return lhs->distance_ < rhs->distance_;
+}
+
+/// Compare batches by distance, then state.
+bool CompareBatchesFrontToBack(Batch* lhs, Batch* rhs)
+{
+    if (lhs->distance_ != rhs->distance_)
+        return lhs->distance_ < rhs->distance_;
+    else
+        return lhs->sortKey_ < rhs->sortKey_;
+}
+
+/// Compare batches by reverse distance, then state.
+bool CompareBatchesBackToFront(Batch* lhs, Batch* rhs)
+{
+    if (lhs->distance_ != rhs->distance_)
+        return lhs->distance_ > rhs->distance_;
+    else
+        return lhs->sortKey_ < rhs->sortKey_;
+}
+
+SharedPtr<Context> context_(new Context());
+BatchQueue queue_;
+PODVector<Batch*> compareBatches_;
+PODVector<Batch*> radixBatches_;
+unsigned compareTimes_[NUM_SORT_MODES];
+unsigned radixTimes_[NUM_SORT_MODES];
+
+unsigned numBatches_ = 20000;
+unsigned numQueues_ = 50;
+unsigned numShaders_ = 32;
+unsigned numMaterials_ = 200;
+unsigned numGeometries_ = 500;
+unsigned numLights_ = 8;
+unsigned seed_ = 1;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+void CreateBatches();
+bool SortBatches(BatchSortMode mode);
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    return Run(arguments);
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'b':
+                numBatches_ = Max(ToInt(value), 1);
+                break;
+
+            case 'q':
+                numQueues_ = Max(ToInt(value), 1);
+                break;
+
+            case 'h':
+                numShaders_ = Clamp(ToInt(value), 1, 0x3fff);
+                break;
+
+            case 'm':
+                numMaterials_ = Clamp(ToInt(value), 1, 0xffff);
+                break;
+
+            case 'g':
+                numGeometries_ = Clamp(ToInt(value), 1, 0xffff);
+                break;
+
+            case 'l':
+                numLights_ = Clamp(ToInt(value), 1, 0xffff);
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: BatchSortBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-bX  Number of batches per queue, default 20000\n"
+                    "-qX  Number of queues to sort, default 50\n"
+                    "-hX  Number of shader combinations, default 32\n"
+                    "-mX  Number of materials, default 200\n"
+                    "-gX  Number of geometries, default 500\n"
+                    "-lX  Number of light queues, default 8\n"
+                    "-sX  Random seed, default 1\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    SetRandomSeed(seed_);
+
+    for (unsigned i = 0; i < NUM_SORT_MODES; ++i)
+        compareTimes_[i] = radixTimes_[i] = 0;
+
+    // Sort each queue in all modes, first with the comparison sort and then with the radix sort
+    bool resultsMatch = true;
+    for (unsigned i = 0; i < numQueues_; ++i)
+    {
+        CreateBatches();
+        for (unsigned j = 0; j < NUM_SORT_MODES; ++j)
+        {
+            if (!SortBatches((BatchSortMode)j))
+                resultsMatch = false;
+        }
+    }
+
+    PrintResult("batches", String(numBatches_));
+    PrintResult("queues", String(numQueues_));
+    for (unsigned i = 0; i < NUM_SORT_MODES; ++i)
+    {
+        String name(sortModeNames[i]);
+        PrintResult(name + "_compare_sort_usec", String(compareTimes_[i] / numQueues_));
+        PrintResult(name + "_radix_sort_usec", String(radixTimes_[i] / numQueues_));
+        PrintResult(name + "_radix_sort_speedup", String((float)compareTimes_[i] / (float)Max((int)radixTimes_[i], 1)));
+    }
+    PrintResult("results_match", String(resultsMatch));
+
+    return resultsMatch ? 0 : 1;
+}
+
+void CreateBatches()
+{
+    // Build the sort keys the same way as Batch::CalculateSortKey(), from a limited set of shaders, light queues, materials
+    // and geometries. Quantize some of the distances so that the secondary keys matter
+    queue_.batches_.Resize(numBatches_);
+    for (unsigned i = 0; i < numBatches_; ++i)
+    {
+        Batch& batch = queue_.batches_[i];
+        unsigned shaderID = Rand() % numShaders_;
+        batch.isBase_ = Rand() % 4 == 0;
+        if (!batch.isBase_)
+            shaderID |= 0x8000;
+        unsigned lightQueueID = Rand() % numLights_;
+        unsigned materialID = Rand() % numMaterials_;
+        unsigned geometryID = Rand() % numGeometries_;
+
+        batch.sortKey_ = (((unsigned long long)shaderID) << 48) | (((unsigned long long)lightQueueID) << 32) |
+            (((unsigned long long)materialID) << 16) | geometryID;
+        batch.distance_ = Random(1000.0f);
+        if (Rand() % 4 == 0)
+            batch.distance_ = floorf(batch.distance_);
+    }
+
+    compareBatches_.Resize(numBatches_);
+    radixBatches_.Resize(numBatches_);
+}
+
+bool SortBatches(BatchSortMode mode)
+{
+    for (unsigned i = 0; i < numBatches_; ++i)
+        compareBatches_[i] = radixBatches_[i] = &queue_.batches_[i];
+
+    HiresTimer timer;
+    switch (mode)
+    {
+    case BSM_STATE:
+        Sort(compareBatches_.Begin(), compareBatches_.End(), CompareBatchesState);
+        break;
+
+    case BSM_FRONTTOBACK:
+        Sort(compareBatches_.Begin(), compareBatches_.End(), CompareBatchesFrontToBack);
+        break;
+
+    case BSM_BACKTOFRONT:
+        Sort(compareBatches_.Begin(), compareBatches_.End(), CompareBatchesBackToFront);
+        break;
+    }
+    compareTimes_[mode] += (unsigned)timer.GetUSec(true);
+    queue_.SortBatches(radixBatches_, mode);
+    radixTimes_[mode] += (unsigned)timer.GetUSec(false);
+
+    // Batches with equal keys and distances may be in either order, so compare the keys and distances only
+    for (unsigned i = 0; i < numBatches_; ++i)
+    {
+        if (compareBatches_[i]->sortKey_ != radixBatches_[i]->sortKey_ || compareBatches_[i]->distance_ !=
+            radixBatches_[i]->distance_)
+            return false;
+    }
+
+    return true;
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
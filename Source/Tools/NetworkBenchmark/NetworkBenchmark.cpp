@@ -0,0 +1,851 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Component.h"
+#include "Connection.h"
+#include "Context.h"
+#include "File.h"
+#include "FileSystem.h"
+#include "Network.h"
+#include "PackageFile.h"
+#include "ProcessUtils.h"
+#include "ResourceCache.h"
+#include "Scene.h"
+#include "SimulatedLink.h"
+#include "SmoothedTransform.h"
+#include "StringUtils.h"
+#include "Timer.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <cmath>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+/// Remote event sent to the clients, like a gameplay hit notification.
+EVENT(E_BENCHMARKHIT, BenchmarkHit)
+{
+    PARAM(P_POSITION, Position);            // Vector3
+    PARAM(P_DAMAGE, Damage);                // int
+    PARAM(P_CRITICAL, Critical);            // bool
+}
+
+/// Replicated test component with one delta update and one latest data attribute.
+class BenchmarkComponent : public Component
+{
+    OBJECT(BenchmarkComponent);
+
+public:
+    /// Construct.
+    BenchmarkComponent(Context* context) :
+        Component(context),
+        counter_(0),
+        value_(0.0f)
+    {
+    }
+
+    /// Register object factory and attributes.
+    static void RegisterObject(Context* context)
+    {
+        context->RegisterFactory<BenchmarkComponent>();
+
+        ATTRIBUTE(BenchmarkComponent, VAR_INT, "Counter", counter_, 0, AM_DEFAULT);
+        ATTRIBUTE(BenchmarkComponent, VAR_FLOAT, "Value", value_, 0.0f, AM_DEFAULT | AM_LATESTDATA);
+    }
+
+    /// Change the attributes.
+    void Modify(int counter, float value)
+    {
+        counter_ = counter;
+        value_ = value;
+        MarkNetworkUpdate();
+    }
+
+    /// Counter attribute, sent as delta update.
+    int counter_;
+    /// Value attribute, sent as latest data.
+    float value_;
+};
+
+/// Counter of the remote events received by the clients.
+class RemoteEventCounter : public Object
+{
+    OBJECT(RemoteEventCounter);
+
+public:
+    /// Construct and subscribe to the remote event from any sender.
+    RemoteEventCounter(Context* context) :
+        Object(context),
+        count_(0)
+    {
+        SubscribeToEvent(E_BENCHMARKHIT, HANDLER(RemoteEventCounter, HandleHit));
+    }
+
+    /// Handle a received remote event.
+    void HandleHit(StringHash eventType, VariantMap& eventData)
+    {
+        ++count_;
+    }
+
+    /// Number of events received.
+    unsigned count_;
+};
+
+/// Server-side and client-side state of one simulated client.
+struct SimulatedClient
+{
+    /// In-memory link between the server and the client.
+    SharedPtr<SimulatedLink> link_;
+    /// Connection representing the client on the server.
+    SharedPtr<Connection> serverConnection_;
+    /// Connection representing the server on the client.
+    SharedPtr<Connection> clientConnection_;
+    /// Client's replicated copy of the scene.
+    SharedPtr<Scene> scene_;
+};
+
+/// Replication state divergence between the server and a client scene.
+struct Divergence
+{
+    /// Construct with zero values.
+    Divergence() :
+        maxPositionError_(0.0f),
+        missingNodes_(0),
+        extraNodes_(0),
+        attributeMismatches_(0)
+    {
+    }
+
+    /// Accumulate the worst values of another divergence.
+    void Merge(const Divergence& rhs)
+    {
+        maxPositionError_ = Max(maxPositionError_, rhs.maxPositionError_);
+        missingNodes_ = Max((int)missingNodes_, (int)rhs.missingNodes_);
+        extraNodes_ = Max((int)extraNodes_, (int)rhs.extraNodes_);
+        attributeMismatches_ = Max((int)attributeMismatches_, (int)rhs.attributeMismatches_);
+    }
+
+    /// Largest node world position difference.
+    float maxPositionError_;
+    /// Server nodes that do not exist on the client.
+    unsigned missingNodes_;
+    /// Replicated client nodes that do not exist on the server.
+    unsigned extraNodes_;
+    /// Components with differing attribute values.
+    unsigned attributeMismatches_;
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Scene> serverScene_;
+Vector<SimulatedClient> clients_;
+PODVector<Node*> nodes_;
+PODVector<unsigned> initialNodeIDs_;
+
+unsigned numClients_ = 4;
+unsigned numNodes_ = 1000;
+unsigned numTicks_ = 300;
+unsigned updateFps_ = 30;
+float moveRatio_ = 0.25f;
+float churnRatio_ = 0.0f;
+bool hierarchy_ = false;
+int initialStateBandwidth_ = 0;
+unsigned packageSize_ = 0;
+int packageBandwidth_ = 0;
+bool packageCompression_ = false;
+bool interruptDownload_ = false;
+bool collectStatistics_ = false;
+unsigned numRemoteEvents_ = 0;
+bool remoteEventSchema_ = false;
+bool unreliableRemoteEvents_ = false;
+float uploadBandwidth_ = 0.0f;
+unsigned seed_ = 1;
+float maxDivergence_ = 0.001f;
+LinkConditions conditions_;
+SharedPtr<SimulatedBottleneck> uplink_;
+String packageDir_;
+unsigned downloadTicks_ = 0;
+unsigned downloadBytes_ = 0;
+bool downloadInterrupted_ = false;
+unsigned remoteEventBytes_ = 0;
+unsigned remoteEventMessages_ = 0;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+void CreateServerScene();
+void CreateClients();
+void ConnectClient(SimulatedClient& client, unsigned index);
+void CreatePackage();
+void RemovePackageFiles();
+void UpdateDownload(unsigned tick);
+void UpdateServerScene(unsigned tick);
+void SendRemoteEvents(unsigned tick);
+bool HasInitialState();
+Divergence MeasureDivergence(Scene* clientScene);
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    int result = Run(arguments);
+
+    // Release the scenes and connections before the context
+    clients_.Clear();
+    nodes_.Clear();
+    serverScene_.Reset();
+    return result;
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'c':
+                numClients_ = Max(ToInt(value), 1);
+                break;
+
+            case 'n':
+                numNodes_ = Max(ToInt(value), 1);
+                break;
+
+            case 't':
+                numTicks_ = Max(ToInt(value), 1);
+                break;
+
+            case 'f':
+                updateFps_ = Max(ToInt(value), 1);
+                break;
+
+            case 'm':
+                moveRatio_ = Clamp(ToFloat(value), 0.0f, 1.0f);
+                break;
+
+            case 'x':
+                churnRatio_ = Clamp(ToFloat(value), 0.0f, 1.0f);
+                break;
+
+            case 'h':
+                hierarchy_ = true;
+                break;
+
+            case 'b':
+                initialStateBandwidth_ = Max(ToInt(value), 0);
+                break;
+
+            case 'k':
+                packageSize_ = Max(ToInt(value), 0);
+                break;
+
+            case 'g':
+                packageBandwidth_ = Max(ToInt(value), 0);
+                break;
+
+            case 'z':
+                packageCompression_ = true;
+                break;
+
+            case 'i':
+                interruptDownload_ = true;
+                break;
+
+            case 'a':
+                collectStatistics_ = true;
+                break;
+
+            case 'e':
+                numRemoteEvents_ = Max(ToInt(value), 0);
+                break;
+
+            case 'v':
+                remoteEventSchema_ = true;
+                break;
+
+            case 'w':
+                remoteEventSchema_ = true;
+                unreliableRemoteEvents_ = true;
+                break;
+
+            case 'u':
+                uploadBandwidth_ = Max(ToFloat(value), 0.0f) * 1024.0f;
+                break;
+
+            case 'l':
+                conditions_.latency_ = Max(ToFloat(value), 0.0f) * 0.001f;
+                break;
+
+            case 'j':
+                conditions_.jitter_ = Max(ToFloat(value), 0.0f) * 0.001f;
+                break;
+
+            case 'p':
+                conditions_.packetLoss_ = Clamp(ToFloat(value), 0.0f, 100.0f) * 0.01f;
+                break;
+
+            case 'r':
+                conditions_.reorderRate_ = Clamp(ToFloat(value), 0.0f, 100.0f) * 0.01f;
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            case 'd':
+                maxDivergence_ = Max(ToFloat(value), 0.0f);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: NetworkBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-cX  Number of clients, default 4\n"
+                    "-nX  Number of replicated nodes, default 1000\n"
+                    "-tX  Number of network updates to simulate, default 300\n"
+                    "-fX  Network update FPS, default 30\n"
+                    "-mX  Ratio of nodes moving on each update (0-1), default 0.25\n"
+                    "-xX  Ratio of nodes removed and recreated on each update (0-1), default 0\n"
+                    "-h   Arrange nodes into a hierarchy instead of a flat list\n"
+                    "-bX  Initial state bandwidth in bytes per second, default 0 (unlimited)\n"
+                    "-kX  Size in kilobytes of a package downloaded by a client joining during the run, default 0 (none)\n"
+                    "-gX  Package bandwidth per client in bytes per second, default 0 (unlimited)\n"
+                    "-z   Compress package data\n"
+                    "-i   Interrupt the package download halfway and reconnect to resume it\n"
+                    "-eX  Number of remote events sent to each client on each update, default 0\n"
+                    "-v   Send the remote events with a compact schema\n"
+                    "-w   Send the remote events with a compact schema and unreliably\n"
+                    "-a   Collect connection traffic statistics and print bytes per component type\n"
+                    "-uX  Server upload bandwidth shared by all clients in kilobytes per second, default 0 (unlimited)\n"
+                    "-lX  One-way latency in milliseconds, default 0\n"
+                    "-jX  Random extra latency (jitter) in milliseconds, default 0\n"
+                    "-pX  Packet loss percentage, default 0\n"
+                    "-rX  Percentage of unordered messages to reorder, default 0\n"
+                    "-sX  Random seed, default 1\n"
+                    "-dX  Maximum allowed final position divergence, default 0.001\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    Network* network = new Network(context_);
+    network->SetUpdateFps(updateFps_);
+    network->SetInitialStateBandwidth(initialStateBandwidth_);
+    network->SetPackageBandwidth(packageBandwidth_);
+    network->SetPackageCompression(packageCompression_);
+    network->SetCollectStatistics(collectStatistics_);
+    if (remoteEventSchema_)
+    {
+        using namespace BenchmarkHit;
+
+        VariantMap parameters;
+        parameters[P_POSITION] = Vector3::ZERO;
+        parameters[P_DAMAGE] = 0;
+        parameters[P_CRITICAL] = false;
+        network->SetRemoteEventSchema(E_BENCHMARKHIT, parameters, !unreliableRemoteEvents_);
+    }
+    context_->RegisterSubsystem(network);
+    RegisterSceneLibrary(context_);
+    BenchmarkComponent::RegisterObject(context_);
+    SetRandomSeed(seed_);
+
+    if (uploadBandwidth_ > 0.0f)
+        uplink_ = new SimulatedBottleneck(uploadBandwidth_);
+
+    CreateServerScene();
+    CreateClients();
+    SharedPtr<RemoteEventCounter> eventCounter(new RemoteEventCounter(context_));
+
+    float timeStep = 1.0f / (float)updateFps_;
+    long long prepareTime = 0;
+    long long sendTime = 0;
+    long long processTime = 0;
+    long long remoteEventTime = 0;
+    Divergence maxDivergence;
+    unsigned initialStateTicks = 0;
+    HiresTimer timer;
+
+    // Let the clients process the LoadScene message and report back before measuring
+    while (true)
+    {
+        bool allLoaded = true;
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            SimulatedClient& client = clients_[i];
+            client.link_->AdvanceTime(timeStep);
+            client.link_->DeliverMessages(client.clientConnection_);
+            client.link_->DeliverMessages(client.serverConnection_);
+            if (!client.serverConnection_->IsSceneLoaded())
+                allLoaded = false;
+        }
+        if (allLoaded)
+            break;
+    }
+    for (unsigned i = 0; i < clients_.Size(); ++i)
+    {
+        clients_[i].link_->ResetStatistics();
+        clients_[i].serverConnection_->ResetStatistics();
+    }
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+        initialNodeIDs_.Push(nodes_[i]->GetID());
+
+    // Join one more client, which has to download the package before it can load the scene
+    if (packageSize_)
+    {
+        CreatePackage();
+        clients_.Push(SimulatedClient());
+        clients_.Back().scene_ = new Scene(context_);
+        ConnectClient(clients_.Back(), numClients_);
+    }
+
+    for (unsigned tick = 0; tick < numTicks_; ++tick)
+    {
+        UpdateServerScene(tick);
+
+        timer.Reset();
+        serverScene_->PrepareNetworkUpdate();
+        prepareTime += timer.GetUSec(true);
+
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            Connection* connection = clients_[i].serverConnection_;
+            connection->SendServerUpdate();
+            connection->SendRemoteEvents();
+            connection->SendPackages();
+        }
+        sendTime += timer.GetUSec(true);
+
+        if (numRemoteEvents_)
+        {
+            SendRemoteEvents(tick);
+            remoteEventTime += timer.GetUSec(true);
+        }
+
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            SimulatedClient& client = clients_[i];
+            client.link_->AdvanceTime(timeStep);
+            client.link_->DeliverMessages(client.clientConnection_);
+            client.clientConnection_->ProcessPendingLatestData();
+        }
+        processTime += timer.GetUSec(true);
+
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            SimulatedClient& client = clients_[i];
+            client.clientConnection_->SendClientUpdate();
+            client.clientConnection_->SendRemoteEvents();
+            client.link_->DeliverMessages(client.serverConnection_);
+        }
+
+        for (unsigned i = 0; i < numClients_; ++i)
+            maxDivergence.Merge(MeasureDivergence(clients_[i].scene_));
+
+        // Count the ticks until every client has received the nodes that existed when it joined
+        if (initialStateTicks == tick && !HasInitialState())
+            initialStateTicks = tick + 1;
+
+        UpdateDownload(tick);
+    }
+
+    // Let all messages in flight arrive without further changes, then check that the clients converged to the server state
+    unsigned settleTicks = 0;
+    while (true)
+    {
+        serverScene_->PrepareNetworkUpdate();
+
+        unsigned numPending = 0;
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            SimulatedClient& client = clients_[i];
+            client.serverConnection_->SendServerUpdate();
+            client.serverConnection_->SendRemoteEvents();
+            client.serverConnection_->SendPackages();
+            client.link_->AdvanceTime(timeStep);
+            client.link_->DeliverMessages(client.clientConnection_);
+            client.clientConnection_->ProcessPendingLatestData();
+            client.link_->DeliverMessages(client.serverConnection_);
+            numPending += client.link_->GetNumPendingMessages();
+        }
+
+        // The package download may still be in progress within its bandwidth limit. When it finishes, the server
+        // starts sending the scene on the next update
+        UpdateDownload(numTicks_ + settleTicks);
+        if (packageSize_ && downloadTicks_ >= numTicks_ + settleTicks)
+            ++numPending;
+
+        ++settleTicks;
+        if (!numPending || settleTicks >= updateFps_ * 60)
+            break;
+    }
+
+    if (packageSize_)
+    {
+        RemovePackageFiles();
+        context_->GetSubsystem<FileSystem>()->RemoveDir(packageDir_);
+    }
+
+    Divergence finalDivergence;
+    for (unsigned i = 0; i < clients_.Size(); ++i)
+        finalDivergence.Merge(MeasureDivergence(clients_[i].scene_));
+
+    LinkStatistics totals;
+    for (unsigned i = 0; i < clients_.Size(); ++i)
+    {
+        const LinkStatistics& stats = clients_[i].link_->GetStatistics(true);
+        totals.messagesSent_ += stats.messagesSent_;
+        totals.bytesSent_ += stats.bytesSent_;
+        totals.messagesLost_ += stats.messagesLost_;
+        totals.messagesObsoleted_ += stats.messagesObsoleted_;
+        totals.resends_ += stats.resends_;
+    }
+
+    // Measure the update delay of the clients that joined before the run, as it is affected by a download to another client
+    LinkStatistics updateTotals;
+    for (unsigned i = 0; i < numClients_; ++i)
+    {
+        const LinkStatistics& stats = clients_[i].link_->GetStatistics(true);
+        updateTotals.messagesDelivered_ += stats.messagesDelivered_;
+        updateTotals.totalDelay_ += stats.totalDelay_;
+        updateTotals.maxDelay_ = Max(updateTotals.maxDelay_, stats.maxDelay_);
+    }
+    float averageDelay = updateTotals.messagesDelivered_ ? updateTotals.totalDelay_ / (float)updateTotals.messagesDelivered_ :
+        0.0f;
+
+    // Print results as name value pairs for easy parsing in regression tests
+    PrintResult("clients", String(numClients_));
+    PrintResult("nodes", String(numNodes_));
+    PrintResult("ticks", String(numTicks_));
+    PrintResult("bytes_per_tick", String((float)totals.bytesSent_ / (float)numTicks_));
+    PrintResult("messages_per_tick", String((float)totals.messagesSent_ / (float)numTicks_));
+    PrintResult("messages_lost", String(totals.messagesLost_));
+    PrintResult("messages_obsoleted", String(totals.messagesObsoleted_));
+    PrintResult("resends", String(totals.resends_));
+    PrintResult("prepare_usec_per_tick", String((float)prepareTime / (float)numTicks_));
+    PrintResult("send_usec_per_tick", String((float)sendTime / (float)numTicks_));
+    PrintResult("process_usec_per_tick", String((float)processTime / (float)numTicks_));
+    PrintResult("update_delay_avg_msec", String(averageDelay * 1000.0f));
+    PrintResult("update_delay_max_msec", String(updateTotals.maxDelay_ * 1000.0f));
+    PrintResult("max_position_error", String(maxDivergence.maxPositionError_));
+    PrintResult("max_missing_nodes", String(maxDivergence.missingNodes_));
+    PrintResult("initial_state_ticks", String(initialStateTicks));
+    if (numRemoteEvents_)
+    {
+        PrintResult("remote_event_bytes_per_tick", String((float)remoteEventBytes_ / (float)numTicks_));
+        PrintResult("remote_event_messages_per_tick", String((float)remoteEventMessages_ / (float)numTicks_));
+        PrintResult("remote_event_usec_per_tick", String((float)remoteEventTime / (float)numTicks_));
+        PrintResult("remote_events_received", String(eventCounter->count_));
+    }
+    if (packageSize_)
+    {
+        PrintResult("download_ticks", String(downloadTicks_));
+        PrintResult("download_bytes", String(downloadBytes_));
+    }
+    if (collectStatistics_)
+    {
+        // Sum the statistics of the server-side connections by component type
+        TrafficCounter statisticsTotal;
+        HashMap<String, TrafficCounter> typeTotals;
+        for (unsigned i = 0; i < clients_.Size(); ++i)
+        {
+            const NetworkStatistics& stats = clients_[i].serverConnection_->GetStatistics();
+            statisticsTotal.messages_ += stats.total_.messages_;
+            statisticsTotal.bytes_ += stats.total_.bytes_;
+            for (HashMap<ShortStringHash, TypeTrafficStatistics>::ConstIterator j = stats.types_.Begin(); j != stats.types_.End(); ++j)
+            {
+                TrafficCounter& typeTotal = typeTotals[j->second_.typeName_];
+                typeTotal.messages_ += j->second_.total_.messages_;
+                typeTotal.bytes_ += j->second_.total_.bytes_;
+            }
+        }
+        PrintResult("statistics_bytes", String(statisticsTotal.bytes_));
+        for (HashMap<String, TrafficCounter>::ConstIterator i = typeTotals.Begin(); i != typeTotals.End(); ++i)
+            PrintResult("statistics_" + i->first_.ToLower() + "_bytes", String(i->second_.bytes_));
+    }
+    PrintResult("settle_ticks", String(settleTicks));
+    PrintResult("final_position_error", String(finalDivergence.maxPositionError_));
+    PrintResult("final_missing_nodes", String(finalDivergence.missingNodes_));
+    PrintResult("final_extra_nodes", String(finalDivergence.extraNodes_));
+    PrintResult("final_attribute_mismatches", String(finalDivergence.attributeMismatches_));
+
+    bool converged = finalDivergence.maxPositionError_ <= maxDivergence_ && !finalDivergence.missingNodes_ &&
+        !finalDivergence.extraNodes_ && !finalDivergence.attributeMismatches_;
+    PrintResult("converged", String(converged));
+
+    return converged ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void CreateServerScene()
+{
+    serverScene_ = new Scene(context_);
+
+    for (unsigned i = 0; i < numNodes_; ++i)
+    {
+        Node* parent = hierarchy_ && i ? nodes_[(i - 1) / 4] : serverScene_;
+        Node* node = parent->CreateChild("Node" + String(i));
+        node->SetPosition(Vector3((float)(i % 100), 0.0f, (float)(i / 100)));
+        node->CreateComponent<BenchmarkComponent>();
+        nodes_.Push(node);
+    }
+}
+
+void CreateClients()
+{
+    for (unsigned i = 0; i < numClients_; ++i)
+    {
+        SimulatedClient client;
+        client.scene_ = new Scene(context_);
+        ConnectClient(client, i);
+        clients_.Push(client);
+    }
+}
+
+void ConnectClient(SimulatedClient& client, unsigned index)
+{
+    // Release an earlier connection first, so that its replication state is removed from the server scene
+    client.serverConnection_.Reset();
+    client.clientConnection_.Reset();
+
+    client.link_ = new SimulatedLink(conditions_, seed_ + index);
+    client.link_->SetBottleneck(uplink_);
+    client.serverConnection_ = new Connection(context_, true, client.link_);
+    client.clientConnection_ = new Connection(context_, false, client.link_);
+
+    // The client must have its scene assigned before the server sends the LoadScene message
+    client.clientConnection_->SetScene(client.scene_);
+    client.serverConnection_->SetScene(serverScene_);
+}
+
+void CreatePackage()
+{
+    // Use the same directory for the server's package and the client's download cache
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    packageDir_ = fileSystem->GetTemporaryDir() + "NetworkBenchmarkTemp/";
+    fileSystem->CreateDir(packageDir_);
+    RemovePackageFiles();
+    context_->GetSubsystem<Network>()->SetPackageCacheDir(packageDir_);
+
+    // Fill the package with words of random text, so that it compresses somewhat like real resource data
+    static const char* words[] = { "<node>", "<component>", "name=", "value=", "\"0 0 0\"", "true", "false", "</node>" };
+    PODVector<unsigned char> data;
+    while (data.Size() < packageSize_ * 1024)
+    {
+        const char* word = words[Rand() & 7];
+        while (*word)
+            data.Push(*word++);
+        data.Push(' ');
+    }
+
+    unsigned checksum = 0;
+    for (unsigned i = 0; i < data.Size(); ++i)
+        checksum = SDBMHash(checksum, data[i]);
+
+    String entryName = "Data.bin";
+    String fileName = packageDir_ + "Benchmark.pak";
+    {
+        File file(context_, fileName, FILE_WRITE);
+        file.WriteFileID("UPAK");
+        file.WriteUInt(1);
+        file.WriteUInt(checksum);
+        file.WriteString(entryName);
+        // The data follows the file ID, entry count, checksum and the single entry
+        file.WriteUInt(4 + 2 * sizeof(unsigned) + entryName.Length() + 1 + 3 * sizeof(unsigned));
+        file.WriteUInt(data.Size());
+        file.WriteUInt(checksum);
+        file.Write(&data[0], data.Size());
+    }
+
+    SharedPtr<PackageFile> package(new PackageFile(context_, fileName));
+    serverScene_->AddRequiredPackageFile(package);
+}
+
+void RemovePackageFiles()
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    Vector<String> files;
+    fileSystem->ScanDir(files, packageDir_, "*.*", SCAN_FILES, false);
+    for (unsigned i = 0; i < files.Size(); ++i)
+        fileSystem->Delete(packageDir_ + files[i]);
+}
+
+void UpdateServerScene(unsigned tick)
+{
+    unsigned numMoving = (unsigned)(moveRatio_ * numNodes_);
+    unsigned numChurn = (unsigned)(churnRatio_ * numNodes_);
+    float time = (float)tick / (float)updateFps_;
+
+    // Move a sliding window of nodes so that every node gets updated over time
+    for (unsigned i = 0; i < numMoving; ++i)
+    {
+        unsigned index = (tick * numMoving + i) % nodes_.Size();
+        Node* node = nodes_[index];
+        node->Translate(Vector3(sinf(time + index), 0.0f, cosf(time + index)) * 0.1f);
+        node->GetComponent<BenchmarkComponent>()->Modify(tick, time);
+    }
+
+    // Remove and recreate random leaf nodes
+    for (unsigned i = 0; i < numChurn; ++i)
+    {
+        unsigned index = Rand() % nodes_.Size();
+        Node* node = nodes_[index];
+        if (node->GetNumChildren())
+            continue;
+
+        Node* parent = node->GetParent();
+        node->Remove();
+        node = parent->CreateChild("Node" + String(index));
+        node->SetPosition(Vector3(Random(100.0f), 0.0f, Random(100.0f)));
+        node->CreateComponent<BenchmarkComponent>();
+        nodes_[index] = node;
+    }
+}
+
+void SendRemoteEvents(unsigned tick)
+{
+    using namespace BenchmarkHit;
+
+    VariantMap eventData;
+    for (unsigned i = 0; i < clients_.Size(); ++i)
+    {
+        Connection* connection = clients_[i].serverConnection_;
+        const LinkStatistics& stats = clients_[i].link_->GetStatistics(true);
+        unsigned bytesBefore = stats.bytesSent_;
+        unsigned messagesBefore = stats.messagesSent_;
+
+        // Send every other event from a node, like an effect that the client attaches to the node
+        for (unsigned j = 0; j < numRemoteEvents_; ++j)
+        {
+            Node* node = nodes_[(tick * numRemoteEvents_ + j) % nodes_.Size()];
+            eventData[P_POSITION] = node->GetWorldPosition();
+            eventData[P_DAMAGE] = (int)(j * 10);
+            eventData[P_CRITICAL] = (j & 3) == 0;
+            if (j & 1)
+                connection->SendRemoteEvent(node, E_BENCHMARKHIT, true, eventData);
+            else
+                connection->SendRemoteEvent(E_BENCHMARKHIT, true, eventData);
+        }
+        connection->SendRemoteEvents();
+
+        remoteEventBytes_ += stats.bytesSent_ - bytesBefore;
+        remoteEventMessages_ += stats.messagesSent_ - messagesBefore;
+    }
+}
+
+void UpdateDownload(unsigned tick)
+{
+    // Count the ticks and bytes until the joining client has downloaded the package and loaded the scene
+    if (!packageSize_ || downloadTicks_ != tick)
+        return;
+
+    SimulatedClient& client = clients_.Back();
+    if (client.serverConnection_->IsSceneLoaded())
+    {
+        downloadBytes_ += client.link_->GetStatistics(true).bytesSent_;
+        return;
+    }
+
+    downloadTicks_ = tick + 1;
+
+    if (interruptDownload_ && !downloadInterrupted_ && client.clientConnection_->GetNumDownloads() &&
+        client.clientConnection_->GetDownloadProgress() >= 0.5f)
+    {
+        downloadBytes_ += client.link_->GetStatistics(true).bytesSent_;
+        ConnectClient(client, numClients_);
+        downloadInterrupted_ = true;
+    }
+}
+
+bool HasInitialState()
+{
+    for (unsigned i = 0; i < numClients_; ++i)
+    {
+        for (unsigned j = 0; j < initialNodeIDs_.Size(); ++j)
+        {
+            // Nodes that have since been removed on the server do not count
+            unsigned id = initialNodeIDs_[j];
+            if (serverScene_->GetNode(id) && !clients_[i].scene_->GetNode(id))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+Divergence MeasureDivergence(Scene* clientScene)
+{
+    Divergence ret;
+    unsigned numFound = 0;
+
+    for (unsigned i = 0; i < nodes_.Size(); ++i)
+    {
+        Node* serverNode = nodes_[i];
+        Node* clientNode = clientScene->GetNode(serverNode->GetID());
+        if (!clientNode)
+        {
+            ++ret.missingNodes_;
+            continue;
+        }
+
+        ++numFound;
+
+        // Compare against the smoothing target, as the client interpolates towards the received position. Compare in
+        // parent space, as the parent may still be interpolating
+        SmoothedTransform* transform = clientNode->GetComponent<SmoothedTransform>();
+        Vector3 clientPosition = transform ? transform->GetTargetPosition() : clientNode->GetPosition();
+        ret.maxPositionError_ = Max(ret.maxPositionError_, (clientPosition - serverNode->GetPosition()).Length());
+
+        BenchmarkComponent* serverComponent = serverNode->GetComponent<BenchmarkComponent>();
+        BenchmarkComponent* clientComponent = clientNode->GetComponent<BenchmarkComponent>();
+        if (!clientComponent || clientComponent->counter_ != serverComponent->counter_ || clientComponent->value_ !=
+            serverComponent->value_)
+            ++ret.attributeMismatches_;
+    }
+
+    // The client scene contains the replicated nodes and the scene itself
+    unsigned numClientNodes = clientScene->GetNumChildren(true);
+    if (numClientNodes > numFound)
+        ret.extraNodes_ = numClientNodes - numFound;
+
+    return ret;
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
@@ -0,0 +1,454 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Camera.h"
+#include "Context.h"
+#include "Node.h"
+#include "OcclusionBuffer.h"
+#include "ProcessUtils.h"
+#include "Scene.h"
+#include "Sort.h"
+#include "StringUtils.h"
+#include "Timer.h"
+#include "WorkQueue.h"
+
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned SPHERE_RINGS = 16;
+static const unsigned SPHERE_SEGMENTS = 32;
+static const unsigned SPHERE_OCCLUDER_INTERVAL = 10;
+
+/// Occluder with a world transform and a shared mesh.
+struct Occluder
+{
+    /// World transform.
+    Matrix3x4 transform_;
+    /// World bounding box.
+    BoundingBox box_;
+    /// Sorting key: triangles divided by screen size in the current view.
+    float sortValue_;
+    /// Vertex data.
+    PODVector<Vector3>* vertices_;
+    /// Index data.
+    PODVector<unsigned short>* indices_;
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Scene> scene_;
+PODVector<Vector3> boxVertices_;
+PODVector<unsigned short> boxIndices_;
+PODVector<Vector3> sphereVertices_;
+PODVector<unsigned short> sphereIndices_;
+PODVector<Occluder> occluders_;
+PODVector<Occluder*> viewOccluders_;
+PODVector<BoundingBox> occludees_;
+PODVector<Matrix3x4> views_;
+PODVector<BoundingBox> testBoxes_;
+PODVector<bool> singleResults_;
+PODVector<bool> batchResults_;
+unsigned singleTestTime_ = 0;
+unsigned batchTestTime_ = 0;
+unsigned numTestedOccludees_ = 0;
+unsigned numVisibleOccludees_ = 0;
+bool testResultsMatch_ = true;
+PODVector<unsigned> serialDrawnOccluders_;
+PODVector<unsigned> threadedDrawnOccluders_;
+
+unsigned numOccluders_ = 500;
+unsigned numOccludees_ = 20000;
+unsigned numViews_ = 100;
+unsigned maxTriangles_ = 5000;
+int bufferSize_ = 256;
+float worldSize_ = 1000.0f;
+unsigned numThreads_ = GetNumPhysicalCPUs() - 1;
+unsigned seed_ = 1;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+void CreateBoxMesh();
+void CreateSphereMesh();
+void CreateOccluders();
+void CreateOccludees();
+void CreateViews();
+bool CompareOccluders(const Occluder* lhs, const Occluder* rhs);
+unsigned DrawViews(OcclusionBuffer* buffer, Camera* camera, PODVector<int>& depths, PODVector<unsigned>& numDrawnOccluders,
+    unsigned& numTriangles, bool testOccludees);
+void TestOccludees(OcclusionBuffer* buffer, Camera* camera);
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    int result = Run(arguments);
+
+    // Release the scene before the context
+    scene_.Reset();
+    return result;
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'o':
+                numOccluders_ = Max(ToInt(value), 1);
+                break;
+
+            case 'n':
+                numOccludees_ = ToUInt(value);
+                break;
+
+            case 'v':
+                numViews_ = Max(ToInt(value), 1);
+                break;
+
+            case 'm':
+                maxTriangles_ = ToUInt(value);
+                break;
+
+            case 'b':
+                bufferSize_ = NextPowerOfTwo(Max(ToInt(value), OCCLUSION_MIN_SIZE));
+                break;
+
+            case 'w':
+                worldSize_ = Max(ToFloat(value), 1.0f);
+                break;
+
+            case 't':
+                numThreads_ = ToUInt(value);
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: OcclusionBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-oX  Number of occluders, default 500\n"
+                    "-nX  Number of occludees, default 20000\n"
+                    "-vX  Number of camera views to render, default 100\n"
+                    "-mX  Maximum number of occluder triangles per view, 0 = unlimited, default 5000\n"
+                    "-bX  Occlusion buffer width, rounded up to a power of two, default 256\n"
+                    "-wX  Size of the world along each horizontal axis, default 1000\n"
+                    "-tX  Number of worker threads, default number of CPU cores - 1\n"
+                    "-sX  Random seed, default 1\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    RegisterSceneLibrary(context_);
+    Camera::RegisterObject(context_);
+    SetRandomSeed(seed_);
+
+    CreateBoxMesh();
+    CreateSphereMesh();
+    CreateOccluders();
+    CreateOccludees();
+    CreateViews();
+
+    scene_ = new Scene(context_);
+    Camera* camera = scene_->CreateChild()->CreateComponent<Camera>();
+    camera->SetFarClip(worldSize_);
+    camera->SetAspectRatio(16.0f / 9.0f);
+
+    SharedPtr<OcclusionBuffer> buffer(new OcclusionBuffer(context_));
+    buffer->SetSize(bufferSize_, (int)((float)bufferSize_ / camera->GetAspectRatio() + 0.5f));
+    buffer->SetMaxTriangles(maxTriangles_ ? maxTriangles_ : M_MAX_UNSIGNED);
+
+    // Render first on the main thread only, then in horizontal bands in the worker threads
+    PODVector<int> serialDepths;
+    PODVector<int> threadedDepths;
+    unsigned numTriangles = 0;
+    unsigned serialTime = DrawViews(buffer, camera, serialDepths, serialDrawnOccluders_, numTriangles, true);
+    context_->GetSubsystem<WorkQueue>()->CreateThreads(numThreads_);
+    unsigned threadedTime = DrawViews(buffer, camera, threadedDepths, threadedDrawnOccluders_, numTriangles, false);
+
+    unsigned numDrawnOccluders = 0;
+    for (unsigned i = 0; i < numViews_; ++i)
+        numDrawnOccluders += serialDrawnOccluders_[i];
+
+    bool resultsMatch = serialDepths == threadedDepths && serialDrawnOccluders_ == threadedDrawnOccluders_ &&
+        testResultsMatch_;
+
+    PrintResult("occluders", String(numOccluders_));
+    PrintResult("views", String(numViews_));
+    PrintResult("buffer_size", String(buffer->GetWidth()) + "x" + String(buffer->GetHeight()));
+    PrintResult("threads", String(numThreads_));
+    PrintResult("max_triangles", String(maxTriangles_));
+    PrintResult("occluders_drawn_per_view", String(numDrawnOccluders / numViews_));
+    PrintResult("triangles_per_view", String(numTriangles / numViews_));
+    PrintResult("serial_view_usec", String(serialTime / numViews_));
+    PrintResult("threaded_view_usec", String(threadedTime / numViews_));
+    PrintResult("threaded_speedup", String((float)serialTime / (float)Max((int)threadedTime, 1)));
+    PrintResult("occludees_tested_per_view", String(numTestedOccludees_ / numViews_));
+    PrintResult("occludees_visible_per_view", String(numVisibleOccludees_ / numViews_));
+    PrintResult("single_test_view_usec", String(singleTestTime_ / numViews_));
+    PrintResult("batch_test_view_usec", String(batchTestTime_ / numViews_));
+    PrintResult("batch_test_speedup", String((float)singleTestTime_ / (float)Max((int)batchTestTime_, 1)));
+    PrintResult("results_match", String(resultsMatch));
+
+    return resultsMatch ? 0 : 1;
+}
+
+void CreateBoxMesh()
+{
+    // Unit cube with the bottom at the origin, with clockwise triangles when seen from outside
+    for (unsigned i = 0; i < 8; ++i)
+        boxVertices_.Push(Vector3(i & 1 ? 0.5f : -0.5f, i & 2 ? 1.0f : 0.0f, i & 4 ? 0.5f : -0.5f));
+
+    static const unsigned short faces[] =
+    {
+        0, 2, 3, 1,
+        4, 5, 7, 6,
+        0, 4, 6, 2,
+        1, 3, 7, 5,
+        0, 1, 5, 4,
+        2, 6, 7, 3
+    };
+
+    for (unsigned i = 0; i < 24; i += 4)
+    {
+        boxIndices_.Push(faces[i]);
+        boxIndices_.Push(faces[i + 1]);
+        boxIndices_.Push(faces[i + 2]);
+        boxIndices_.Push(faces[i]);
+        boxIndices_.Push(faces[i + 2]);
+        boxIndices_.Push(faces[i + 3]);
+    }
+}
+
+void CreateSphereMesh()
+{
+    for (unsigned i = 0; i <= SPHERE_RINGS; ++i)
+    {
+        float latitude = (float)i * 180.0f / (float)SPHERE_RINGS;
+        for (unsigned j = 0; j <= SPHERE_SEGMENTS; ++j)
+        {
+            float longitude = (float)j * 360.0f / (float)SPHERE_SEGMENTS;
+            sphereVertices_.Push(0.5f * Vector3(Sin(latitude) * Cos(longitude), Cos(latitude), Sin(latitude) * Sin(longitude)));
+        }
+    }
+
+    for (unsigned i = 0; i < SPHERE_RINGS; ++i)
+    {
+        for (unsigned j = 0; j < SPHERE_SEGMENTS; ++j)
+        {
+            unsigned short v0 = (unsigned short)(i * (SPHERE_SEGMENTS + 1) + j);
+            unsigned short v1 = (unsigned short)(v0 + SPHERE_SEGMENTS + 1);
+            sphereIndices_.Push(v0);
+            sphereIndices_.Push(v0 + 1);
+            sphereIndices_.Push(v1);
+            sphereIndices_.Push(v1);
+            sphereIndices_.Push(v0 + 1);
+            sphereIndices_.Push(v1 + 1);
+        }
+    }
+}
+
+void CreateOccluders()
+{
+    // City blocks of box-shaped buildings, with some rounded high-polygon occluders among them
+    for (unsigned i = 0; i < numOccluders_; ++i)
+    {
+        Occluder occluder;
+        Vector3 position(Random(worldSize_) - worldSize_ * 0.5f, 0.0f, Random(worldSize_) - worldSize_ * 0.5f);
+        Quaternion rotation(Random(90.0f), Vector3::UP);
+        if (i % SPHERE_OCCLUDER_INTERVAL)
+        {
+            Vector3 scale(10.0f + Random(30.0f), 10.0f + Random(90.0f), 10.0f + Random(30.0f));
+            occluder.transform_ = Matrix3x4(position, rotation, scale);
+            occluder.vertices_ = &boxVertices_;
+            occluder.indices_ = &boxIndices_;
+        }
+        else
+        {
+            float scale = 20.0f + Random(40.0f);
+            occluder.transform_ = Matrix3x4(position + Vector3(0.0f, scale * 0.5f, 0.0f), rotation, scale);
+            occluder.vertices_ = &sphereVertices_;
+            occluder.indices_ = &sphereIndices_;
+        }
+        occluder.box_.Define(&occluder.vertices_->Front(), occluder.vertices_->Size());
+        occluder.box_.Transform(occluder.transform_);
+        occluder.sortValue_ = 0.0f;
+        occluders_.Push(occluder);
+    }
+}
+
+void CreateOccludees()
+{
+    // Small objects at the street level, most of them hidden behind the buildings
+    for (unsigned i = 0; i < numOccludees_; ++i)
+    {
+        Vector3 position(Random(worldSize_) - worldSize_ * 0.5f, 0.0f, Random(worldSize_) - worldSize_ * 0.5f);
+        Vector3 size(0.5f + Random(4.5f), 0.5f + Random(2.5f), 0.5f + Random(4.5f));
+        occludees_.Push(BoundingBox(position - Vector3(size.x_, 0.0f, size.z_) * 0.5f, position + Vector3(size.x_ * 0.5f,
+            size.y_, size.z_ * 0.5f)));
+    }
+}
+
+void CreateViews()
+{
+    // Cameras above the street level, looking roughly horizontally
+    for (unsigned i = 0; i < numViews_; ++i)
+    {
+        Vector3 position(Random(worldSize_) - worldSize_ * 0.5f, 2.0f + Random(20.0f), Random(worldSize_) - worldSize_ * 0.5f);
+        Quaternion rotation(Random(20.0f) - 5.0f, Random(360.0f), 0.0f);
+        views_.Push(Matrix3x4(position, rotation, 1.0f));
+    }
+}
+
+bool CompareOccluders(const Occluder* lhs, const Occluder* rhs)
+{
+    return lhs->sortValue_ < rhs->sortValue_;
+}
+
+unsigned DrawViews(OcclusionBuffer* buffer, Camera* camera, PODVector<int>& depths, PODVector<unsigned>& numDrawnOccluders,
+    unsigned& numTriangles, bool testOccludees)
+{
+    unsigned bufferSize = buffer->GetWidth() * buffer->GetHeight();
+    depths.Resize(numViews_ * bufferSize);
+    numDrawnOccluders.Resize(numViews_);
+    numTriangles = 0;
+    unsigned time = 0;
+
+    for (unsigned i = 0; i < numViews_; ++i)
+    {
+        camera->GetNode()->SetTransform(views_[i].Translation(), views_[i].Rotation());
+
+        HiresTimer timer;
+
+        // Gather the occluders inside the view frustum and sort them like the View does, so that the best occluders are
+        // drawn first if the triangle budget is exceeded
+        const Frustum& frustum = camera->GetFrustum();
+        Vector3 cameraPosition = views_[i].Translation();
+        viewOccluders_.Clear();
+        for (unsigned j = 0; j < occluders_.Size(); ++j)
+        {
+            Occluder& occluder = occluders_[j];
+            if (!frustum.IsInsideFast(occluder.box_))
+                continue;
+
+            float distance = Max((occluder.box_.Center() - cameraPosition).Length(), M_EPSILON);
+            occluder.sortValue_ = (float)(occluder.indices_->Size() / 3) * distance / occluder.box_.Size().Length();
+            viewOccluders_.Push(&occluder);
+        }
+        if (viewOccluders_.Size())
+            Sort(viewOccluders_.Begin(), viewOccluders_.End(), CompareOccluders);
+
+        buffer->SetView(camera);
+        buffer->Clear();
+        numDrawnOccluders[i] = 0;
+        for (unsigned j = 0; j < viewOccluders_.Size(); ++j)
+        {
+            const Occluder& occluder = *viewOccluders_[j];
+            if (j > 0)
+            {
+                // Skip the occluders hidden by the previous ones. Flush the triangles queued for the worker threads first,
+                // as the View does
+                if (buffer->GetNumQueuedTriangles())
+                    buffer->DrawTriangles();
+                if (!buffer->IsVisible(occluder.box_))
+                    continue;
+            }
+
+            ++numDrawnOccluders[i];
+            if (!buffer->Draw(occluder.transform_, &occluder.vertices_->Front(), sizeof(Vector3), &occluder.indices_->Front(),
+                sizeof(unsigned short), 0, occluder.indices_->Size()))
+                break;
+        }
+        buffer->BuildDepthHierarchy();
+        time += (unsigned)timer.GetUSec(false);
+
+        numTriangles += buffer->GetNumTriangles();
+        memcpy(&depths[i * bufferSize], buffer->GetBuffer(), bufferSize * sizeof(int));
+
+        if (testOccludees)
+            TestOccludees(buffer, camera);
+    }
+
+    return time;
+}
+
+void TestOccludees(OcclusionBuffer* buffer, Camera* camera)
+{
+    // Test the occludees inside the view frustum one at a time, then as one batch
+    const Frustum& frustum = camera->GetFrustum();
+    testBoxes_.Clear();
+    for (unsigned i = 0; i < occludees_.Size(); ++i)
+    {
+        if (frustum.IsInsideFast(occludees_[i]))
+            testBoxes_.Push(occludees_[i]);
+    }
+    if (testBoxes_.Empty())
+        return;
+
+    singleResults_.Resize(testBoxes_.Size());
+    batchResults_.Resize(testBoxes_.Size());
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < testBoxes_.Size(); ++i)
+        singleResults_[i] = buffer->IsVisible(testBoxes_[i]);
+    singleTestTime_ += (unsigned)timer.GetUSec(true);
+    buffer->IsVisible(&testBoxes_[0], testBoxes_.Size(), &batchResults_[0]);
+    batchTestTime_ += (unsigned)timer.GetUSec(false);
+
+    numTestedOccludees_ += testBoxes_.Size();
+    for (unsigned i = 0; i < testBoxes_.Size(); ++i)
+    {
+        if (singleResults_[i])
+            ++numVisibleOccludees_;
+        if (singleResults_[i] != batchResults_[i])
+            testResultsMatch_ = false;
+    }
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
@@ -0,0 +1,564 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Context.h"
+#include "Drawable.h"
+#include "Node.h"
+#include "Octree.h"
+#include "OctreeQuery.h"
+#include "ProcessUtils.h"
+#include "Scene.h"
+#include "StringUtils.h"
+#include "Timer.h"
+#include "WorkQueue.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned SPHERE_RINGS = 8;
+static const unsigned SPHERE_SEGMENTS = 16;
+static const unsigned RAYS_PER_ORIGIN = 4;
+static const unsigned CHANGES_PER_WORK_ITEM = 256;
+
+PODVector<Vector3> sphereVertices_;
+PODVector<unsigned short> sphereIndices_;
+
+/// Drawable with a fixed local space bounding box. For triangle-level raycasts it has a sphere mesh that fills the bounding box.
+class BenchmarkDrawable : public Drawable
+{
+    OBJECT(BenchmarkDrawable);
+
+public:
+    /// Construct.
+    BenchmarkDrawable(Context* context) :
+        Drawable(context, DRAWABLE_GEOMETRY),
+        boundingBox_(-0.5f, 0.5f)
+    {
+    }
+
+    /// Register object factory.
+    static void RegisterObject(Context* context)
+    {
+        context->RegisterFactory<BenchmarkDrawable>();
+    }
+
+    /// Set local space bounding box.
+    void SetBoundingBox(const BoundingBox& box)
+    {
+        boundingBox_ = box;
+        OnMarkedDirty(node_);
+    }
+
+    /// Return local space bounding box.
+    const BoundingBox& GetBoundingBox() const { return boundingBox_; }
+
+    /// Process octree raycast.
+    virtual void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results)
+    {
+        if (query.level_ < RAY_TRIANGLE)
+        {
+            Drawable::ProcessRayQuery(query, results);
+            return;
+        }
+
+        Matrix3x4 inverse(node_->GetWorldTransform().Inverse());
+        Ray localRay(inverse * query.ray_.origin_, inverse * Vector4(query.ray_.direction_, 0.0f));
+        if (localRay.HitDistance(boundingBox_) >= query.maxDistance_)
+            return;
+
+        // The mesh is shared, so scale the ray so that the bounding box is a unit cube. This does not change the hit distance
+        float scale = 1.0f / boundingBox_.Size().x_;
+        Ray meshRay(localRay.origin_ * scale, localRay.direction_ * scale);
+        float distance = meshRay.HitDistance(&sphereVertices_[0], sizeof(Vector3), &sphereIndices_[0], sizeof(unsigned short), 0,
+            sphereIndices_.Size());
+        // Ignore the hit behind the ray origin if the origin is inside the sphere
+        if (distance >= 0.0f && distance < query.maxDistance_)
+        {
+            RayQueryResult result;
+            result.drawable_ = this;
+            result.node_ = node_;
+            result.distance_ = distance;
+            result.subObject_ = M_MAX_UNSIGNED;
+            results.Push(result);
+        }
+    }
+
+protected:
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate()
+    {
+        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+    }
+
+private:
+    /// Local space bounding box.
+    BoundingBox boundingBox_;
+};
+
+/// %Frustum octree query that tests the drawables one at a time, like before the bounding box blocks.
+class ScalarFrustumOctreeQuery : public FrustumOctreeQuery
+{
+public:
+    /// Construct with frustum and query parameters.
+    ScalarFrustumOctreeQuery(PODVector<Drawable*>& result, const Frustum& frustum, unsigned char drawableFlags = DRAWABLE_ANY,
+        unsigned viewMask = DEFAULT_VIEWMASK) :
+        FrustumOctreeQuery(result, frustum, drawableFlags, viewMask)
+    {
+    }
+
+    /// Intersection test for drawables with their world bounding boxes in blocks. Ignores the blocks.
+    virtual void TestDrawableBounds(Drawable** start, Drawable** end, const BoundingBoxBlock* bounds, bool inside,
+        PODVector<Drawable*>& result)
+    {
+        TestDrawables(start, end, inside, result);
+    }
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Scene> scene_;
+PODVector<Node*> nodes_;
+PODVector<Drawable*> movedDrawables_;
+PODVector<Octant*> movedOctants_;
+PODVector<BenchmarkDrawable*> changedDrawables_;
+PODVector<float> changedSizes_;
+
+unsigned numDrawables_ = 100000;
+unsigned numFrustums_ = 100;
+unsigned numRays_ = 10000;
+unsigned numLevels_ = 8;
+float worldSize_ = 1000.0f;
+float farClip_ = 500.0f;
+float moveRatio_ = 0.0f;
+float moveDistance_ = 1.0f;
+float changeRatio_ = 0.0f;
+float looseness_ = 2.0f;
+unsigned numThreads_ = GetNumPhysicalCPUs() - 1;
+unsigned seed_ = 1;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+void CreateScene();
+void CreateSphereMesh();
+void MoveDrawables();
+void ChangeBoundingBoxes();
+void ChangeBoundingBoxesWork(const WorkItem* item, unsigned threadIndex);
+Frustum CreateFrustum();
+void CreateRays(PODVector<Ray>& rays);
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    int result = Run(arguments);
+
+    // Release the scene before the context
+    nodes_.Clear();
+    scene_.Reset();
+    return result;
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'n':
+                numDrawables_ = Max(ToInt(value), 1);
+                break;
+
+            case 'f':
+                numFrustums_ = Max(ToInt(value), 1);
+                break;
+
+            case 'r':
+                numRays_ = Max(ToInt(value), 1);
+                break;
+
+            case 'l':
+                numLevels_ = Max(ToInt(value), 1);
+                break;
+
+            case 'w':
+                worldSize_ = Max(ToFloat(value), 1.0f);
+                break;
+
+            case 'c':
+                farClip_ = Max(ToFloat(value), 1.0f);
+                break;
+
+            case 'm':
+                moveRatio_ = Clamp(ToFloat(value), 0.0f, 1.0f);
+                break;
+
+            case 'v':
+                moveDistance_ = Max(ToFloat(value), 0.0f);
+                break;
+
+            case 'b':
+                changeRatio_ = Clamp(ToFloat(value), 0.0f, 1.0f);
+                break;
+
+            case 'x':
+                looseness_ = ToFloat(value);
+                break;
+
+            case 't':
+                numThreads_ = ToUInt(value);
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: OctreeBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-nX  Number of drawables, default 100000\n"
+                    "-fX  Number of camera frustums to query, default 100\n"
+                    "-rX  Number of rays to cast, default 10000\n"
+                    "-lX  Number of octree levels, default 8\n"
+                    "-wX  Size of the world along each axis, default 1000\n"
+                    "-cX  Far clip distance of the camera frustums, default 500\n"
+                    "-mX  Ratio of drawables moving before each query (0-1), default 0\n"
+                    "-vX  Maximum distance a drawable moves along each horizontal axis, default 1\n"
+                    "-bX  Ratio of drawables changing their bounding box in the worker threads before each query (0-1), default 0\n"
+                    "-xX  Octree looseness, default 2\n"
+                    "-tX  Number of worker threads, default number of CPU cores - 1\n"
+                    "-sX  Random seed, default 1\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    context_->GetSubsystem<WorkQueue>()->CreateThreads(numThreads_);
+    RegisterSceneLibrary(context_);
+    Octree::RegisterObject(context_);
+    BenchmarkDrawable::RegisterObject(context_);
+    SetRandomSeed(seed_);
+
+    HiresTimer timer;
+    CreateScene();
+    Octree* octree = scene_->GetComponent<Octree>();
+    FrameInfo frame;
+    frame.frameNumber_ = 0;
+    frame.timeStep_ = 0.0f;
+    frame.camera_ = 0;
+    octree->Update(frame);
+    PrintResult("create_msec", String((float)timer.GetUSec(true) / 1000.0f));
+
+    PODVector<Drawable*> scalarResult;
+    PODVector<Drawable*> blockResult;
+    PODVector<Drawable*> threadedResult;
+    long long updateTime = 0;
+    long long scalarTime = 0;
+    long long blockTime = 0;
+    long long threadedTime = 0;
+    unsigned long long numVisible = 0;
+    unsigned long long numReinserted = 0;
+    bool resultsMatch = true;
+
+    for (unsigned i = 0; i < numFrustums_; ++i)
+    {
+        if (moveRatio_ > 0.0f || changeRatio_ > 0.0f)
+        {
+            MoveDrawables();
+            timer.Reset();
+            ++frame.frameNumber_;
+            octree->Update(frame);
+            updateTime += timer.GetUSec(false);
+
+            for (unsigned j = 0; j < movedDrawables_.Size(); ++j)
+            {
+                if (movedDrawables_[j]->GetOctant() != movedOctants_[j])
+                    ++numReinserted;
+            }
+        }
+
+        // Change bounding boxes in the worker threads like animated models and 3D text do while the views are processed. The
+        // drawables only queue themselves for reinsertion, so the queries must not trust the octants' bounding box blocks for
+        // them until the next octree update
+        if (changeRatio_ > 0.0f)
+            ChangeBoundingBoxes();
+
+        Frustum frustum = CreateFrustum();
+
+        // Query with the drawables tested one at a time, then with the bounding box blocks
+        ScalarFrustumOctreeQuery scalarQuery(scalarResult, frustum, DRAWABLE_GEOMETRY);
+        timer.Reset();
+        octree->GetDrawables(scalarQuery);
+        scalarTime += timer.GetUSec(false);
+
+        FrustumOctreeQuery blockQuery(blockResult, frustum, DRAWABLE_GEOMETRY);
+        timer.Reset();
+        octree->GetDrawables(blockQuery);
+        blockTime += timer.GetUSec(false);
+
+        // Then with the octree split into subtrees queried in worker threads
+        FrustumOctreeQuery threadedQuery(threadedResult, frustum, DRAWABLE_GEOMETRY);
+        timer.Reset();
+        octree->GetDrawables(threadedQuery, true);
+        threadedTime += timer.GetUSec(false);
+
+        numVisible += blockResult.Size();
+        if (blockResult != scalarResult || threadedResult != blockResult)
+            resultsMatch = false;
+    }
+
+    PrintResult("drawables", String(octree->GetNumDrawables()));
+    PrintResult("threads", String(numThreads_));
+    PrintResult("looseness", String(octree->GetLooseness()));
+    PrintResult("visible_avg", String((unsigned)(numVisible / numFrustums_)));
+    if (moveRatio_ > 0.0f || changeRatio_ > 0.0f)
+    {
+        PrintResult("update_usec_avg", String((float)updateTime / (float)numFrustums_));
+        PrintResult("reinserted_avg", String((unsigned)(numReinserted / numFrustums_)));
+    }
+    PrintResult("scalar_query_usec_avg", String((float)scalarTime / (float)numFrustums_));
+    PrintResult("block_query_usec_avg", String((float)blockTime / (float)numFrustums_));
+    PrintResult("threaded_query_usec_avg", String((float)threadedTime / (float)numFrustums_));
+    PrintResult("speedup", String((float)scalarTime / (float)Max((int)blockTime, 1)));
+    PrintResult("threaded_speedup", String((float)blockTime / (float)Max((int)threadedTime, 1)));
+
+    // Cast triangle-level rays one at a time, then as a batch
+    PODVector<Ray> rays;
+    CreateRays(rays);
+    PODVector<RayQueryResult> singleResults(numRays_);
+    Vector<PODVector<RayQueryResult> > batchResults(numRays_);
+    PODVector<RayOctreeQuery*> batchQueries;
+    for (unsigned i = 0; i < numRays_; ++i)
+        batchQueries.Push(new RayOctreeQuery(batchResults[i], rays[i], RAY_TRIANGLE, farClip_, DRAWABLE_GEOMETRY));
+
+    PODVector<RayQueryResult> result;
+    timer.Reset();
+    for (unsigned i = 0; i < numRays_; ++i)
+    {
+        RayOctreeQuery query(result, rays[i], RAY_TRIANGLE, farClip_, DRAWABLE_GEOMETRY);
+        octree->RaycastSingle(query);
+        singleResults[i].drawable_ = result.Size() ? result[0].drawable_ : 0;
+        singleResults[i].distance_ = result.Size() ? result[0].distance_ : M_INFINITY;
+    }
+    long long singleRayTime = timer.GetUSec(false);
+
+    timer.Reset();
+    octree->RaycastSingle(batchQueries);
+    long long batchRayTime = timer.GetUSec(false);
+
+    unsigned numRayHits = 0;
+    for (unsigned i = 0; i < numRays_; ++i)
+    {
+        Drawable* drawable = batchResults[i].Size() ? batchResults[i][0].drawable_ : 0;
+        float distance = batchResults[i].Size() ? batchResults[i][0].distance_ : M_INFINITY;
+        if (drawable != singleResults[i].drawable_ || distance != singleResults[i].distance_)
+            resultsMatch = false;
+        if (drawable)
+            ++numRayHits;
+        delete batchQueries[i];
+    }
+
+    PrintResult("rays", String(numRays_));
+    PrintResult("ray_hits", String(numRayHits));
+    PrintResult("single_raycast_rays_per_sec", String((float)numRays_ * 1000000.0f / (float)Max((int)singleRayTime, 1)));
+    PrintResult("batch_raycast_rays_per_sec", String((float)numRays_ * 1000000.0f / (float)Max((int)batchRayTime, 1)));
+    PrintResult("raycast_speedup", String((float)singleRayTime / (float)Max((int)batchRayTime, 1)));
+    PrintResult("results_match", String(resultsMatch));
+
+    return resultsMatch ? 0 : 1;
+}
+
+void CreateScene()
+{
+    scene_ = new Scene(context_);
+    Octree* octree = scene_->CreateComponent<Octree>();
+    octree->SetLooseness(looseness_);
+    octree->Resize(BoundingBox(-worldSize_ * 0.5f, worldSize_ * 0.5f), numLevels_);
+
+    CreateSphereMesh();
+
+    // Mostly small objects, with some larger ones that stay in the upper octree levels
+    for (unsigned i = 0; i < numDrawables_; ++i)
+    {
+        Node* node = scene_->CreateChild(String::EMPTY, LOCAL);
+        node->SetPosition(Vector3(Random(worldSize_), Random(worldSize_ * 0.1f), Random(worldSize_)) - Vector3(worldSize_ * 0.5f,
+            worldSize_ * 0.05f, worldSize_ * 0.5f));
+        node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+        float size = Random() < 0.05f ? 10.0f + Random(40.0f) : 0.5f + Random(4.5f);
+        BenchmarkDrawable* drawable = node->CreateComponent<BenchmarkDrawable>();
+        drawable->SetBoundingBox(BoundingBox(-size * 0.5f, size * 0.5f));
+        nodes_.Push(node);
+    }
+}
+
+void CreateSphereMesh()
+{
+    for (unsigned i = 0; i <= SPHERE_RINGS; ++i)
+    {
+        float latitude = (float)i * 180.0f / (float)SPHERE_RINGS;
+        for (unsigned j = 0; j <= SPHERE_SEGMENTS; ++j)
+        {
+            float longitude = (float)j * 360.0f / (float)SPHERE_SEGMENTS;
+            sphereVertices_.Push(0.5f * Vector3(Sin(latitude) * Cos(longitude), Cos(latitude), Sin(latitude) * Sin(longitude)));
+        }
+    }
+
+    for (unsigned i = 0; i < SPHERE_RINGS; ++i)
+    {
+        for (unsigned j = 0; j < SPHERE_SEGMENTS; ++j)
+        {
+            unsigned short v0 = (unsigned short)(i * (SPHERE_SEGMENTS + 1) + j);
+            unsigned short v1 = (unsigned short)(v0 + SPHERE_SEGMENTS + 1);
+            sphereIndices_.Push(v0);
+            sphereIndices_.Push(v0 + 1);
+            sphereIndices_.Push(v1);
+            sphereIndices_.Push(v1);
+            sphereIndices_.Push(v0 + 1);
+            sphereIndices_.Push(v1 + 1);
+        }
+    }
+}
+
+void MoveDrawables()
+{
+    unsigned numMoves = (unsigned)(moveRatio_ * (float)nodes_.Size());
+    movedDrawables_.Clear();
+    movedOctants_.Clear();
+
+    for (unsigned i = 0; i < numMoves; ++i)
+    {
+        Node* node = nodes_[Min((int)Random((float)nodes_.Size()), (int)nodes_.Size() - 1)];
+        node->Translate(Vector3(Random(2.0f) - 1.0f, 0.0f, Random(2.0f) - 1.0f) * moveDistance_);
+
+        // Remember the octant to count the reinserted drawables
+        Drawable* drawable = node->GetComponent<BenchmarkDrawable>();
+        movedDrawables_.Push(drawable);
+        movedOctants_.Push(drawable->GetOctant());
+    }
+}
+
+void ChangeBoundingBoxes()
+{
+    // Change every Nth drawable, so that each is changed by one work item only. Randomize the sizes in the main thread. Grow
+    // a drawable only if it still fits its octant's culling box, as the octants are not culled by the drawables' own boxes
+    unsigned numChanges = (unsigned)Max((int)(changeRatio_ * (float)nodes_.Size()), 1);
+    unsigned step = nodes_.Size() / numChanges;
+    unsigned offset = Min((int)Random((float)step), (int)step - 1);
+    changedDrawables_.Clear();
+    changedSizes_.Clear();
+
+    for (unsigned i = 0; i < numChanges; ++i)
+    {
+        Node* node = nodes_[offset + i * step];
+        BenchmarkDrawable* drawable = node->GetComponent<BenchmarkDrawable>();
+        float size = drawable->GetBoundingBox().Size().x_;
+        float scale = 0.5f + Random(1.0f);
+        BoundingBox grownBox(-size * scale * 0.5f, size * scale * 0.5f);
+        if (scale > 1.0f && drawable->GetOctant()->GetCullingBox().IsInside(grownBox.Transformed(node->GetWorldTransform())) !=
+            INSIDE)
+            scale = 1.0f / scale;
+
+        changedDrawables_.Push(drawable);
+        changedSizes_.Push(size * scale);
+    }
+
+    WorkQueue* queue = context_->GetSubsystem<WorkQueue>();
+    WorkItem item;
+    item.workFunction_ = ChangeBoundingBoxesWork;
+
+    for (unsigned i = 0; i < numChanges; i += CHANGES_PER_WORK_ITEM)
+    {
+        item.start_ = &changedDrawables_[i];
+        item.end_ = &changedDrawables_[0] + Min((int)(i + CHANGES_PER_WORK_ITEM), (int)numChanges);
+        item.aux_ = &changedSizes_[i];
+        queue->AddWorkItem(item);
+    }
+
+    queue->Complete(M_MAX_UNSIGNED);
+}
+
+void ChangeBoundingBoxesWork(const WorkItem* item, unsigned threadIndex)
+{
+    BenchmarkDrawable** start = reinterpret_cast<BenchmarkDrawable**>(item->start_);
+    BenchmarkDrawable** end = reinterpret_cast<BenchmarkDrawable**>(item->end_);
+    const float* sizes = reinterpret_cast<const float*>(item->aux_);
+
+    while (start != end)
+    {
+        BenchmarkDrawable* drawable = *start++;
+        float size = *sizes++;
+        drawable->SetBoundingBox(BoundingBox(-size * 0.5f, size * 0.5f));
+        // Update the world bounding box here, as the threaded query must not
+        drawable->GetWorldBoundingBox();
+    }
+}
+
+Frustum CreateFrustum()
+{
+    Vector3 position(Random(worldSize_) - worldSize_ * 0.5f, Random(worldSize_ * 0.1f), Random(worldSize_) - worldSize_ * 0.5f);
+    Quaternion rotation(Random(60.0f) - 30.0f, Random(360.0f), 0.0f);
+
+    Frustum frustum;
+    frustum.Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, farClip_, Matrix3x4(position, rotation, 1.0f));
+    return frustum;
+}
+
+void CreateRays(PODVector<Ray>& rays)
+{
+    // Groups of rays with the same origin and nearly the same direction, like line of sight checks of an AI agent
+    while (rays.Size() < numRays_)
+    {
+        Vector3 origin(Random(worldSize_) - worldSize_ * 0.5f, Random(worldSize_ * 0.1f) - worldSize_ * 0.05f, Random(worldSize_) -
+            worldSize_ * 0.5f);
+        float yaw = Random(360.0f);
+        float pitch = Random(20.0f) - 10.0f;
+
+        for (unsigned i = 0; i < RAYS_PER_ORIGIN && rays.Size() < numRays_; ++i)
+        {
+            Quaternion rotation(pitch + Random(4.0f) - 2.0f, yaw + Random(4.0f) - 2.0f, 0.0f);
+            rays.Push(Ray(origin, rotation * Vector3::FORWARD));
+        }
+    }
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
@@ -22,8 +22,10 @@
 
 #include "Context.h"
 #include "ArrayPtr.h"
+#include "Compression.h"
 #include "File.h"
 #include "FileSystem.h"
+#include "PackageFile.h"
 #include "ProcessUtils.h"
 
 #ifdef WIN32
@@ -50,6 +52,7 @@ SharedPtr<FileSystem> fileSystem_(new FileSystem(context_));
 String basePath_;
 Vector<FileEntry> entries_;
 unsigned checksum_ = 0;
+bool compress_ = false;
 
 String ignoreExtensions_[] = {
     ".bak",
@@ -78,13 +81,35 @@ int main(int argc, char** argv)
 
 void Run(const Vector<String>& arguments)
 {
-    if (arguments.Size() < 2)
-        ErrorExit("Usage: PackageTool <directory to process> <package name> [basepath]\n");
+    // Separate the options from the other arguments
+    Vector<String> names;
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String option = arguments[i].Substring(1).ToLower();
+            if (option == "c")
+                compress_ = true;
+            else
+                ErrorExit("Unrecognized option " + arguments[i]);
+        }
+        else
+            names.Push(arguments[i]);
+    }
+    
+    if (names.Size() < 2)
+    {
+        ErrorExit(
+            "Usage: PackageTool <directory to process> <package name> [basepath] [options]\n\n"
+            "Options:\n"
+            "-c  Compress the files in blocks with LZ4\n"
+        );
+    }
     
-    const String& dirName = arguments[0];
-    const String& packageName = arguments[1];
-    if (arguments.Size() > 2)
-        basePath_ = AddTrailingSlash(arguments[2]);
+    const String& dirName = names[0];
+    const String& packageName = names[1];
+    if (names.Size() > 2)
+        basePath_ = AddTrailingSlash(names[2]);
     
     PrintLine("Scanning directory " + dirName + " for files");
     
@@ -140,7 +165,7 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         ErrorExit("Could not open output file " + fileName);
     
     // Write ID, number of files & placeholder for checksum
-    dest.WriteFileID("UPAK");
+    dest.WriteFileID(compress_ ? "ULZ4" : "UPAK");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
     
@@ -178,12 +203,43 @@ void WritePackageFile(const String& fileName, const String& rootDir)
             entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
         }
         
-        dest.Write(&buffer[0], entries_[i].size_);
+        if (!compress_)
+            dest.Write(&buffer[0], dataSize);
+        else
+        {
+            // Compress in blocks, and precede the blocks with a table of their offsets so that File::Seek() stays cheap
+            unsigned numBlocks = (dataSize + PACKAGE_BLOCK_SIZE - 1) / PACKAGE_BLOCK_SIZE;
+            PODVector<unsigned> blockOffsets(numBlocks + 1);
+            PODVector<unsigned char> blockData;
+            SharedArrayPtr<unsigned char> packed(new unsigned char[EstimateCompressBound(PACKAGE_BLOCK_SIZE)]);
+            
+            for (unsigned j = 0; j < numBlocks; ++j)
+            {
+                blockOffsets[j] = (numBlocks + 1) * sizeof(unsigned) + blockData.Size();
+                const unsigned char* src = &buffer[j * PACKAGE_BLOCK_SIZE];
+                unsigned unpackedSize = Min((int)PACKAGE_BLOCK_SIZE, (int)(dataSize - j * PACKAGE_BLOCK_SIZE));
+                unsigned packedSize = CompressData(&packed[0], src, unpackedSize);
+                
+                // Store the block as is if it did not compress. The reader detects this from the block size
+                if (packedSize && packedSize < unpackedSize)
+                    src = &packed[0];
+                else
+                    packedSize = unpackedSize;
+                
+                unsigned oldSize = blockData.Size();
+                blockData.Resize(oldSize + packedSize);
+                memcpy(&blockData[oldSize], src, packedSize);
+            }
+            blockOffsets[numBlocks] = (numBlocks + 1) * sizeof(unsigned) + blockData.Size();
+            
+            dest.Write(&blockOffsets[0], blockOffsets.Size() * sizeof(unsigned));
+            dest.Write(&blockData[0], blockData.Size());
+        }
     }
     
     // Write header again with correct offsets & checksums
     dest.Seek(0);
-    dest.WriteFileID("UPAK");
+    dest.WriteFileID(compress_ ? "ULZ4" : "UPAK");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
     
@@ -195,5 +251,13 @@ void WritePackageFile(const String& fileName, const String& rootDir)
         dest.WriteUInt(entries_[i].checksum_);
     }
     
-    PrintLine("Package total size " + String(dest.GetSize()) + " bytes");
+    if (compress_)
+    {
+        unsigned dataSize = 0;
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+            dataSize += entries_[i].size_;
+        PrintLine("Package total size " + String(dest.GetSize()) + " bytes, uncompressed file data " + String(dataSize) + " bytes");
+    }
+    else
+        PrintLine("Package total size " + String(dest.GetSize()) + " bytes");
 }
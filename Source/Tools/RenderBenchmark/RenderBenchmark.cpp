@@ -0,0 +1,507 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "AnimatedModel.h"
+#include "Animation.h"
+#include "AnimationState.h"
+#include "Camera.h"
+#include "Context.h"
+#include "FileSystem.h"
+#include "Graphics.h"
+#include "Image.h"
+#include "Light.h"
+#include "Material.h"
+#include "Model.h"
+#include "Octree.h"
+#include "ParticleEmitter.h"
+#include "ProcessUtils.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "ResourceCache.h"
+#include "Scene.h"
+#include "StaticModel.h"
+#include "StringUtils.h"
+#include "Terrain.h"
+#include "Timer.h"
+#include "Viewport.h"
+#include "WorkQueue.h"
+#include "XMLFile.h"
+#include "Zone.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+static const unsigned WARMUP_FRAMES = 10;
+static const float TIME_STEP = 1.0f / 60.0f;
+static const float CAMERA_ROTATION_SPEED = 15.0f;
+static const float WALK_SPEED = 2.0f;
+static const unsigned OCCLUDER_INTERVAL = 10;
+static const unsigned SPOT_LIGHT_INTERVAL = 3;
+static const unsigned SHADOWED_LIGHT_INTERVAL = 4;
+
+/// Profiler block measured as a benchmark phase.
+struct Phase
+{
+    /// Result name.
+    const char* name_;
+    /// Profiler block names, whose times are summed.
+    const char* blocks_[2];
+};
+
+static const Phase phases[] =
+{
+    { "scene_update_usec", { "UpdateScene", 0 } },
+    { "octree_update_usec", { "UpdateDrawables", "ReinsertToOctree" } },
+    { "get_drawables_usec", { "GetDrawables", 0 } },
+    { "process_lights_usec", { "ProcessLights", 0 } },
+    { "get_light_batches_usec", { "GetLightBatches", 0 } },
+    { "get_base_batches_usec", { "GetBaseBatches", 0 } },
+    { "sort_and_update_geometry_usec", { "SortAndUpdateGeometry", 0 } },
+    { "prepare_instancing_usec", { "PrepareInstancingBuffer", 0 } },
+    { "update_views_usec", { "UpdateViews", 0 } },
+    { "render_views_usec", { "RenderViews", 0 } }
+};
+
+static const unsigned NUM_PHASES = sizeof(phases) / sizeof(phases[0]);
+
+/// Animated model walking across the world.
+struct Walker
+{
+    /// Scene node.
+    Node* node_;
+    /// Walk animation.
+    AnimationState* state_;
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Scene> scene_;
+SharedPtr<Viewport> viewport_;
+Node* cameraNode_ = 0;
+Terrain* terrain_ = 0;
+PODVector<Walker> walkers_;
+
+unsigned numStaticModels_ = 2000;
+unsigned numAnimatedModels_ = 100;
+unsigned numLights_ = 20;
+unsigned numParticleEmitters_ = 20;
+int terrainPatchSize_ = 32;
+unsigned numFrames_ = 200;
+float worldSize_ = 500.0f;
+unsigned numThreads_ = GetNumPhysicalCPUs() - 1;
+unsigned seed_ = 1;
+String resourcePrefix_;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+bool CreateScene();
+void CreateTerrain();
+void CreateStaticModels();
+void CreateAnimatedModels();
+void CreateLights();
+void CreateParticleEmitters();
+Vector3 GetRandomPosition();
+void RunFrame();
+long long GetBlockTime(const ProfilerBlock* block, const char* name);
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    int result = Run(arguments);
+
+    // Release the scene and the viewport before the context
+    viewport_.Reset();
+    scene_.Reset();
+    return result;
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'm':
+                numStaticModels_ = ToUInt(value);
+                break;
+
+            case 'a':
+                numAnimatedModels_ = ToUInt(value);
+                break;
+
+            case 'l':
+                numLights_ = ToUInt(value);
+                break;
+
+            case 'p':
+                numParticleEmitters_ = ToUInt(value);
+                break;
+
+            case 'r':
+                terrainPatchSize_ = ToInt(value);
+                break;
+
+            case 'f':
+                numFrames_ = Max(ToInt(value), 1);
+                break;
+
+            case 'w':
+                worldSize_ = Max(ToFloat(value), 1.0f);
+                break;
+
+            case 'd':
+                resourcePrefix_ = AddTrailingSlash(arguments[i].Substring(2));
+                break;
+
+            case 't':
+                numThreads_ = ToUInt(value);
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: RenderBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-mX  Number of static models, default 2000\n"
+                    "-aX  Number of animated models, default 100\n"
+                    "-lX  Number of point and spot lights, default 20\n"
+                    "-pX  Number of particle emitters, default 20\n"
+                    "-rX  Terrain patch size, 0 for no terrain, default 32\n"
+                    "-fX  Number of frames to measure, default 200\n"
+                    "-wX  Size of the world along each horizontal axis, default 500\n"
+                    "-dX  Directory containing CoreData and Data, default the executable's directory\n"
+                    "-tX  Number of worker threads, default number of CPU cores - 1\n"
+                    "-sX  Random seed, default 1\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new WorkQueue(context_));
+    context_->RegisterSubsystem(new Profiler(context_));
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    RegisterSceneLibrary(context_);
+    context_->GetSubsystem<WorkQueue>()->CreateThreads(numThreads_);
+    SetRandomSeed(seed_);
+
+    if (resourcePrefix_.Empty())
+        resourcePrefix_ = context_->GetSubsystem<FileSystem>()->GetProgramDir();
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    if (!cache->AddResourceDir(resourcePrefix_ + "CoreData") || !cache->AddResourceDir(resourcePrefix_ + "Data"))
+        ErrorExit("Could not find resource directories CoreData and Data in " + resourcePrefix_);
+
+    // Run the renderer without a window or rendering device, so that only its CPU-side work is measured
+    Graphics* graphics = new Graphics(context_);
+    context_->RegisterSubsystem(graphics);
+    Renderer* renderer = new Renderer(context_);
+    context_->RegisterSubsystem(renderer);
+    if (!graphics->SetHeadlessMode(1280, 720))
+        ErrorExit("Could not set headless graphics mode");
+
+    if (!CreateScene())
+        ErrorExit("Could not load the resources of the benchmark scene");
+
+    viewport_ = new Viewport(context_, scene_, cameraNode_->GetComponent<Camera>());
+    renderer->SetViewport(0, viewport_);
+
+    Profiler* profiler = context_->GetSubsystem<Profiler>();
+    for (unsigned i = 0; i < WARMUP_FRAMES; ++i)
+        RunFrame();
+    profiler->BeginInterval();
+
+    unsigned numGeometries = 0;
+    unsigned numLights = 0;
+    unsigned numShadowMaps = 0;
+    unsigned numOccluders = 0;
+    long long frameTime = 0;
+
+    for (unsigned i = 0; i < numFrames_; ++i)
+    {
+        HiresTimer timer;
+        RunFrame();
+        frameTime += timer.GetUSec(false);
+
+        numGeometries += renderer->GetNumGeometries(true);
+        numLights += renderer->GetNumLights(true);
+        numShadowMaps += renderer->GetNumShadowMaps(true);
+        numOccluders += renderer->GetNumOccluders(true);
+    }
+
+    PrintResult("static_models", String(numStaticModels_));
+    PrintResult("animated_models", String(numAnimatedModels_));
+    PrintResult("lights", String(numLights_));
+    PrintResult("particle_emitters", String(numParticleEmitters_));
+    PrintResult("terrain_patches", String(terrain_ ? terrain_->GetNumPatches().x_ * terrain_->GetNumPatches().y_ : 0));
+    PrintResult("frames", String(numFrames_));
+    PrintResult("threads", String(numThreads_));
+    PrintResult("geometries_per_frame", String(numGeometries / numFrames_));
+    PrintResult("lights_per_frame", String(numLights / numFrames_));
+    PrintResult("shadow_maps_per_frame", String(numShadowMaps / numFrames_));
+    PrintResult("occluders_per_frame", String(numOccluders / numFrames_));
+
+    // Profiling blocks record only in the main thread, so the phases include the time spent waiting for the worker threads
+    const ProfilerBlock* root = profiler->GetRootBlock();
+    for (unsigned i = 0; i < NUM_PHASES; ++i)
+    {
+        long long time = 0;
+        for (unsigned j = 0; j < 2 && phases[i].blocks_[j]; ++j)
+            time += GetBlockTime(root, phases[i].blocks_[j]);
+        PrintResult(phases[i].name_, String((unsigned)(time / numFrames_)));
+    }
+
+    PrintResult("frame_usec", String((unsigned)(frameTime / numFrames_)));
+
+    return 0;
+}
+
+bool CreateScene()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+
+    scene_ = new Scene(context_);
+    scene_->CreateComponent<Octree>()->Resize(BoundingBox(-worldSize_, worldSize_), 8);
+
+    Zone* zone = scene_->CreateComponent<Zone>();
+    zone->SetBoundingBox(BoundingBox(-worldSize_, worldSize_));
+    zone->SetAmbientColor(Color(0.15f, 0.15f, 0.15f));
+    zone->SetFogColor(Color(0.5f, 0.5f, 0.7f));
+    zone->SetFogStart(worldSize_ * 0.4f);
+    zone->SetFogEnd(worldSize_ * 0.5f);
+
+    cameraNode_ = scene_->CreateChild("Camera");
+    Camera* camera = cameraNode_->CreateComponent<Camera>();
+    camera->SetFarClip(worldSize_ * 0.5f);
+
+    if (!cache->GetResource<Model>("Models/Box.mdl") || !cache->GetResource<Model>("Models/Mushroom.mdl") ||
+        !cache->GetResource<Model>("Models/Jack.mdl") || !cache->GetResource<Animation>("Models/Jack_Walk.ani") ||
+        !cache->GetResource<XMLFile>("Particle/Smoke.xml") || !cache->GetResource<Image>("Textures/HeightMap.png"))
+        return false;
+
+    if (terrainPatchSize_ > 0)
+        CreateTerrain();
+    CreateStaticModels();
+    CreateAnimatedModels();
+    CreateLights();
+    CreateParticleEmitters();
+    return true;
+}
+
+void CreateTerrain()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    Image* heightMap = cache->GetResource<Image>("Textures/HeightMap.png");
+
+    // Stretch the heightmap over the whole world
+    float spacing = worldSize_ / (float)(heightMap->GetWidth() - 1);
+    terrain_ = scene_->CreateChild("Terrain")->CreateComponent<Terrain>();
+    terrain_->SetPatchSize(terrainPatchSize_);
+    terrain_->SetSpacing(Vector3(spacing, spacing * 0.25f, spacing));
+    terrain_->SetHeightMap(heightMap);
+    terrain_->SetMaterial(cache->GetResource<Material>("Materials/Terrain.xml"));
+    terrain_->SetOccluder(true);
+}
+
+void CreateStaticModels()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    Model* box = cache->GetResource<Model>("Models/Box.mdl");
+    Model* mushroom = cache->GetResource<Model>("Models/Mushroom.mdl");
+    Material* stone = cache->GetResource<Material>("Materials/Stone.xml");
+    Material* stoneSmall = cache->GetResource<Material>("Materials/StoneSmall.xml");
+    Material* mushroomMaterial = cache->GetResource<Material>("Materials/Mushroom.xml");
+
+    // Mushrooms and crates, with large boxes as occluders among them
+    for (unsigned i = 0; i < numStaticModels_; ++i)
+    {
+        Node* node = scene_->CreateChild("StaticModel");
+        node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+        StaticModel* model = node->CreateComponent<StaticModel>();
+        model->SetCastShadows(true);
+
+        if (!(i % OCCLUDER_INTERVAL))
+        {
+            node->SetScale(Vector3(5.0f + Random(10.0f), 5.0f + Random(15.0f), 5.0f + Random(10.0f)));
+            model->SetModel(box);
+            model->SetMaterial(stone);
+            model->SetOccluder(true);
+        }
+        else if (i & 1)
+        {
+            node->SetScale(0.5f + Random(1.5f));
+            model->SetModel(mushroom);
+            model->SetMaterial(mushroomMaterial);
+        }
+        else
+        {
+            node->SetScale(0.5f + Random(1.0f));
+            model->SetModel(box);
+            model->SetMaterial(stoneSmall);
+        }
+
+        node->SetPosition(GetRandomPosition() + Vector3(0.0f, node->GetScale().y_ * 0.5f, 0.0f));
+    }
+}
+
+void CreateAnimatedModels()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    Model* jack = cache->GetResource<Model>("Models/Jack.mdl");
+    Material* jackMaterial = cache->GetResource<Material>("Materials/Jack.xml");
+    Animation* walk = cache->GetResource<Animation>("Models/Jack_Walk.ani");
+
+    for (unsigned i = 0; i < numAnimatedModels_; ++i)
+    {
+        Node* node = scene_->CreateChild("AnimatedModel");
+        node->SetPosition(GetRandomPosition());
+        node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+        AnimatedModel* model = node->CreateComponent<AnimatedModel>();
+        model->SetModel(jack);
+        model->SetMaterial(jackMaterial);
+        model->SetCastShadows(true);
+
+        Walker walker;
+        walker.node_ = node;
+        walker.state_ = model->AddAnimationState(walk);
+        walker.state_->SetWeight(1.0f);
+        walker.state_->SetLooped(true);
+        walker.state_->AddTime(Random(walk->GetLength()));
+        walkers_.Push(walker);
+    }
+}
+
+void CreateLights()
+{
+    // A shadowed sun, and point and spot lights of which a part cast shadows
+    Node* sunNode = scene_->CreateChild("Sun");
+    sunNode->SetDirection(Vector3(0.6f, -1.0f, 0.8f));
+    Light* sun = sunNode->CreateComponent<Light>();
+    sun->SetLightType(LIGHT_DIRECTIONAL);
+    sun->SetCastShadows(true);
+    sun->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
+
+    for (unsigned i = 0; i < numLights_; ++i)
+    {
+        Node* node = scene_->CreateChild("Light");
+        node->SetPosition(GetRandomPosition() + Vector3(0.0f, 5.0f + Random(10.0f), 0.0f));
+        node->SetDirection(Vector3(Random(2.0f) - 1.0f, -1.0f, Random(2.0f) - 1.0f));
+        Light* light = node->CreateComponent<Light>();
+        light->SetLightType(i % SPOT_LIGHT_INTERVAL ? LIGHT_POINT : LIGHT_SPOT);
+        light->SetRange(20.0f + Random(20.0f));
+        light->SetFov(30.0f + Random(30.0f));
+        light->SetColor(Color(0.5f + Random(0.5f), 0.5f + Random(0.5f), 0.5f + Random(0.5f)));
+        light->SetCastShadows(!(i % SHADOWED_LIGHT_INTERVAL));
+    }
+}
+
+void CreateParticleEmitters()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    XMLFile* smoke = cache->GetResource<XMLFile>("Particle/Smoke.xml");
+
+    for (unsigned i = 0; i < numParticleEmitters_; ++i)
+    {
+        Node* node = scene_->CreateChild("ParticleEmitter");
+        node->SetPosition(GetRandomPosition());
+        node->CreateComponent<ParticleEmitter>()->Load(smoke);
+    }
+}
+
+Vector3 GetRandomPosition()
+{
+    // Keep the objects within the central part of the world, which the camera sees while rotating
+    Vector3 position((Random(1.0f) - 0.5f) * worldSize_ * 0.5f, 0.0f, (Random(1.0f) - 0.5f) * worldSize_ * 0.5f);
+    if (terrain_)
+        position.y_ = terrain_->GetHeight(position);
+    return position;
+}
+
+void RunFrame()
+{
+    Time* time = context_->GetSubsystem<Time>();
+    Renderer* renderer = context_->GetSubsystem<Renderer>();
+
+    time->BeginFrame(TIME_STEP);
+
+    // Rotate the camera above the center of the world, looking slightly down
+    float yaw = (float)time->GetFrameNumber() * TIME_STEP * CAMERA_ROTATION_SPEED;
+    cameraNode_->SetRotation(Quaternion(15.0f, yaw, 0.0f));
+    cameraNode_->SetPosition(Vector3(0.0f, (terrain_ ? terrain_->GetHeight(Vector3::ZERO) : 0.0f) + 20.0f, 0.0f) -
+        cameraNode_->GetDirection() * worldSize_ * 0.1f);
+
+    // Walk the animated models forward, and turn them back towards the center when they have wandered too far
+    for (unsigned i = 0; i < walkers_.Size(); ++i)
+    {
+        Node* node = walkers_[i].node_;
+        walkers_[i].state_->AddTime(TIME_STEP);
+        Vector3 position = node->GetPosition() + node->GetDirection() * WALK_SPEED * TIME_STEP;
+        if (Abs(position.x_) > worldSize_ * 0.25f || Abs(position.z_) > worldSize_ * 0.25f)
+            node->SetDirection(Vector3(-position.x_, 0.0f, -position.z_));
+        if (terrain_)
+            position.y_ = terrain_->GetHeight(position);
+        node->SetPosition(position);
+    }
+
+    scene_->Update(TIME_STEP);
+    renderer->Update(TIME_STEP);
+    renderer->Render();
+
+    time->EndFrame();
+}
+
+long long GetBlockTime(const ProfilerBlock* block, const char* name)
+{
+    // Sum the time of all blocks with the name, for example from several views
+    if (String(block->name_) == name)
+        return block->intervalTime_;
+
+    long long time = 0;
+    for (unsigned i = 0; i < block->children_.Size(); ++i)
+        time += GetBlockTime(block->children_[i], name);
+    return time;
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
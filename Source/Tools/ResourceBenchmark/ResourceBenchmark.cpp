@@ -0,0 +1,844 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Component.h"
+#include "Context.h"
+#include "File.h"
+#include "FileReadQueue.h"
+#include "FileSystem.h"
+#include "PackageFile.h"
+#include "ProcessUtils.h"
+#include "ResourceCache.h"
+#include "ResourceManifest.h"
+#include "Scene.h"
+#include "StringUtils.h"
+#include "Timer.h"
+#include "XMLFile.h"
+#include "XMLReader.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <cmath>
+#include <cstring>
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+/// Resource that reads only its simulated memory use from the file, so that the cache bookkeeping is not hidden by load time.
+class BenchmarkResource : public Resource
+{
+    OBJECT(BenchmarkResource);
+
+public:
+    /// Construct.
+    BenchmarkResource(Context* context) :
+        Resource(context)
+    {
+    }
+
+    /// Load resource from stream.
+    virtual bool BeginLoad(Deserializer& source)
+    {
+        SetMemoryUse(source.ReadUInt());
+        return true;
+    }
+};
+
+/// Resource that requests other resources when its loading finishes, like a material requests its textures.
+class BenchmarkAsset : public Resource
+{
+    OBJECT(BenchmarkAsset);
+
+public:
+    /// Construct.
+    BenchmarkAsset(Context* context) :
+        Resource(context)
+    {
+    }
+
+    /// Load resource from stream. Checksum the payload in place of decoding it.
+    virtual bool BeginLoad(Deserializer& source)
+    {
+        dependencyNames_.Resize(source.ReadVLE());
+        for (unsigned i = 0; i < dependencyNames_.Size(); ++i)
+            dependencyNames_[i] = source.ReadString();
+
+        PODVector<unsigned char> data(source.ReadUInt());
+        if (data.Size() && source.Read(&data[0], data.Size()) != data.Size())
+            return false;
+        checksum_ = 0;
+        for (unsigned i = 0; i < data.Size(); ++i)
+            checksum_ = checksum_ * 31 + data[i];
+
+        SetMemoryUse(data.Size());
+        return true;
+    }
+
+    /// Finish resource loading by requesting the dependencies.
+    virtual bool EndLoad()
+    {
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+        dependencies_.Clear();
+        for (unsigned i = 0; i < dependencyNames_.Size(); ++i)
+        {
+            SharedPtr<BenchmarkAsset> dependency(cache->GetResource<BenchmarkAsset>(dependencyNames_[i]));
+            if (!dependency)
+                return false;
+            dependencies_.Push(dependency);
+        }
+        dependencyNames_.Clear();
+        return true;
+    }
+
+private:
+    /// Names of the resources to request.
+    Vector<String> dependencyNames_;
+    /// Requested resources.
+    Vector<SharedPtr<BenchmarkAsset> > dependencies_;
+    /// Payload checksum.
+    unsigned checksum_;
+};
+
+/// Component that refers to an asset, like a static model refers to its model.
+class BenchmarkComponent : public Component
+{
+    OBJECT(BenchmarkComponent);
+
+public:
+    /// Construct.
+    BenchmarkComponent(Context* context) :
+        Component(context)
+    {
+    }
+
+    /// Register object factory and attributes.
+    static void RegisterObject(Context* context)
+    {
+        context->RegisterFactory<BenchmarkComponent>();
+        ACCESSOR_ATTRIBUTE(BenchmarkComponent, VAR_RESOURCEREF, "Asset", GetAssetAttr, SetAssetAttr, ResourceRef, ResourceRef(BenchmarkAsset::GetTypeStatic()), AM_DEFAULT);
+    }
+
+    /// Set asset attribute.
+    void SetAssetAttr(ResourceRef value)
+    {
+        asset_ = GetSubsystem<ResourceCache>()->GetResource<BenchmarkAsset>(value.id_);
+    }
+
+    /// Return asset attribute.
+    ResourceRef GetAssetAttr() const
+    {
+        return GetResourceRef(asset_, BenchmarkAsset::GetTypeStatic());
+    }
+
+private:
+    /// Asset.
+    SharedPtr<BenchmarkAsset> asset_;
+};
+
+SharedPtr<Context> context_(new Context());
+Vector<String> resourceNames_;
+Vector<SharedPtr<BenchmarkResource> > heldResources_;
+String tempDir_;
+String packageName_;
+
+unsigned numResources_ = 10000;
+unsigned numRequests_ = 1000000;
+unsigned resourceSize_ = 65536;
+unsigned budgetPercent_ = 25;
+float skew_ = 3.0f;
+unsigned numHeld_ = 0;
+unsigned seed_ = 1;
+unsigned numDirs_ = 1;
+unsigned memoryMapThreshold_ = 0;
+unsigned numReadThreads_ = 0;
+unsigned numSceneNodes_ = 0;
+unsigned numFirstFrameNodes_ = 0;
+bool measureLookups_ = false;
+bool useXMLDocument_ = false;
+
+int main(int argc, char** argv);
+int Run(const Vector<String>& arguments);
+int MeasureRequests(unsigned totalSize);
+int MeasureLookups();
+int MeasurePackage();
+int MeasureSceneLoad();
+int MeasureFirstFrame();
+long long LoadFirstFrame(const String& sceneFileName, const String& manifestFileName, unsigned& numLoaded);
+unsigned CreateResourceFiles();
+String CreateSceneFile();
+String CreateFirstFrameFiles(unsigned& numAssets);
+unsigned GetPeakMemoryUse();
+void RemoveResourceFiles();
+void PrintResult(const String& name, const String& value);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    int result = Run(arguments);
+
+    // Release the resources before the context
+    heldResources_.Clear();
+    return result;
+}
+
+int Run(const Vector<String>& arguments)
+{
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String argument = arguments[i].Substring(1).ToLower();
+            String value = argument.Substring(1);
+
+            switch (argument[0])
+            {
+            case 'n':
+                numResources_ = Max(ToInt(value), 1);
+                break;
+
+            case 'r':
+                numRequests_ = Max(ToInt(value), 1);
+                break;
+
+            case 'k':
+                resourceSize_ = Max(ToInt(value), 1);
+                break;
+
+            case 'b':
+                budgetPercent_ = Clamp(ToInt(value), 0, 100);
+                break;
+
+            case 'x':
+                skew_ = Max(ToFloat(value), 1.0f);
+                break;
+
+            case 'h':
+                numHeld_ = Max(ToInt(value), 0);
+                break;
+
+            case 's':
+                seed_ = ToUInt(value);
+                break;
+
+            case 'd':
+                numDirs_ = Max(ToInt(value), 1);
+                break;
+
+            case 'l':
+                measureLookups_ = true;
+                break;
+
+            case 'p':
+                // Keep the case of the file name
+                packageName_ = arguments[i].Substring(2);
+                break;
+
+            case 'm':
+                memoryMapThreshold_ = ToUInt(value);
+                break;
+
+            case 'a':
+                numReadThreads_ = ToUInt(value);
+                break;
+
+            case 'g':
+                numSceneNodes_ = Max(ToInt(value), 1);
+                break;
+
+            case 'w':
+                useXMLDocument_ = true;
+                break;
+
+            case 'f':
+                numFirstFrameNodes_ = Max(ToInt(value), 1);
+                break;
+
+            default:
+                ErrorExit(
+                    "Usage: ResourceBenchmark [options]\n\n"
+                    "Options:\n"
+                    "-nX  Number of resources, default 10000\n"
+                    "-rX  Number of resource requests, default 1000000\n"
+                    "-kX  Average memory use of a resource in bytes, default 65536\n"
+                    "-bX  Memory budget as percentage of the memory use of all resources, default 25. 0 is unlimited\n"
+                    "-xX  Request skew, 1 requests all resources evenly and higher values favor the first resources, default 3\n"
+                    "-hX  Number of first requested resources to keep in use during the run, default 0\n"
+                    "-sX  Random seed, default 1\n"
+                    "-dX  Number of resource directories to spread the resources into, default 1\n"
+                    "-l   Measure file lookups by name instead of resource requests\n"
+                    "-pX  Measure reading the files of package file X instead of resource requests\n"
+                    "-mX  Memory-map package files of at least X bytes when reading them, default 0 (no mapping)\n"
+                    "-aX  Read the package files asynchronously with X I/O threads, default 0 (synchronous reads)\n"
+                    "-gX  Measure loading a generated scene XML file of X nodes instead of resource requests\n"
+                    "-w   Load the scene XML file through an XML document instead of the streaming XML reader\n"
+                    "-fX  Measure time to first frame of a generated scene of X nodes without and with a resource manifest\n"
+                );
+            }
+        }
+    }
+
+    context_->RegisterSubsystem(new Time(context_));
+    context_->RegisterSubsystem(new FileSystem(context_));
+    context_->RegisterSubsystem(new ResourceCache(context_));
+    context_->RegisterFactory<BenchmarkResource>();
+    SetRandomSeed(seed_);
+
+    if (!packageName_.Empty())
+        return MeasurePackage();
+    if (numSceneNodes_)
+        return MeasureSceneLoad();
+    if (numFirstFrameNodes_)
+        return MeasureFirstFrame();
+
+    unsigned totalSize = CreateResourceFiles();
+    int result = measureLookups_ ? MeasureLookups() : MeasureRequests(totalSize);
+    RemoveResourceFiles();
+    return result;
+}
+
+int MeasureRequests(unsigned totalSize)
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    ShortStringHash type = BenchmarkResource::GetTypeStatic();
+    unsigned budget = (unsigned)((unsigned long long)totalSize * budgetPercent_ / 100);
+    cache->SetMemoryBudget(type, budget);
+
+    const ResourceGroup& group = cache->GetAllResources().Find(type)->second_;
+    long long hitTime = 0;
+    long long missTime = 0;
+    long long maxMissTime = 0;
+    HiresTimer timer;
+    HiresTimer requestTimer;
+
+    for (unsigned i = 0; i < numRequests_; ++i)
+    {
+        // Request the first resources more often, like the assets shared by many scenes
+        unsigned index = Min((int)(pow(Random(), skew_) * numResources_), (int)numResources_ - 1);
+        unsigned misses = group.misses_;
+
+        requestTimer.Reset();
+        BenchmarkResource* resource = cache->GetResource<BenchmarkResource>(resourceNames_[index]);
+        long long requestTime = requestTimer.GetUSec(false);
+
+        if (!resource)
+        {
+            PrintLine("Failed to load resource " + resourceNames_[index]);
+            return EXIT_FAILURE;
+        }
+        if (group.misses_ != misses)
+        {
+            missTime += requestTime;
+            maxMissTime = Max((int)maxMissTime, (int)requestTime);
+        }
+        else
+            hitTime += requestTime;
+        if (heldResources_.Size() < numHeld_)
+            heldResources_.Push(SharedPtr<BenchmarkResource>(resource));
+    }
+
+    long long totalTime = timer.GetUSec(false);
+
+    PrintResult("requests_per_sec", String((float)numRequests_ * 1000000.0f / (float)Max((int)totalTime, 1)));
+    PrintResult("hits", String(group.hits_));
+    PrintResult("misses", String(group.misses_));
+    PrintResult("hit_usec_avg", String((float)hitTime / (float)Max((int)group.hits_, 1)));
+    PrintResult("miss_usec_avg", String((float)missTime / (float)Max((int)group.misses_, 1)));
+    PrintResult("miss_usec_max", String((int)maxMissTime));
+    PrintResult("evictions", String(group.evictions_));
+    PrintResult("evicted_bytes", String(group.evictedBytes_));
+    PrintResult("resources_cached", String(group.resources_.Size()));
+    PrintResult("memory_use", String(group.memoryUse_));
+    PrintResult("memory_budget", String(budget));
+
+    // The budget can only be exceeded by resources that are in use
+    bool withinBudget = !budget || group.memoryUse_ <= budget || !heldResources_.Empty();
+    PrintResult("within_budget", String(withinBudget));
+
+    return withinBudget ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int MeasureLookups()
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    unsigned numFound = 0;
+    HiresTimer timer;
+
+    for (unsigned i = 0; i < numRequests_; ++i)
+    {
+        if (cache->Exists(resourceNames_[Rand() % numResources_]))
+            ++numFound;
+    }
+    long long existsTime = timer.GetUSec(true);
+
+    for (unsigned i = 0; i < numRequests_; ++i)
+    {
+        SharedPtr<File> file = cache->GetFile(resourceNames_[Rand() % numResources_]);
+        if (file && file->IsOpen())
+            ++numFound;
+    }
+    long long getFileTime = timer.GetUSec(true);
+
+    // Names that do not exist have to be searched from every location
+    for (unsigned i = 0; i < numRequests_; ++i)
+        cache->Exists("Missing" + String(Rand() % numResources_) + ".dat");
+    long long missingTime = timer.GetUSec(false);
+
+    PrintResult("exists_per_sec", String((float)numRequests_ * 1000000.0f / (float)Max((int)existsTime, 1)));
+    PrintResult("get_file_per_sec", String((float)numRequests_ * 1000000.0f / (float)Max((int)getFileTime, 1)));
+    PrintResult("missing_exists_per_sec", String((float)numRequests_ * 1000000.0f / (float)Max((int)missingTime, 1)));
+
+    bool allFound = numFound == 2 * numRequests_;
+    PrintResult("all_found", String(allFound));
+
+    return allFound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int MeasurePackage()
+{
+    SharedPtr<PackageFile> package(new PackageFile(context_, packageName_));
+    if (!package->GetNumFiles())
+        ErrorExit("Could not open package file " + packageName_);
+
+    // Open the files through the resource cache like resource loading does
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    cache->SetMemoryMapThreshold(memoryMapThreshold_);
+    cache->AddPackageFile(package);
+
+    const HashMap<String, PackageEntry>& entries = package->GetEntries();
+    Vector<SharedPtr<File> > files(entries.Size());
+    Vector<PODVector<unsigned char> > loadedData(entries.Size());
+    PODVector<unsigned char> buffer;
+    long long readTime = 0;
+    HiresTimer timer;
+
+    if (numReadThreads_)
+    {
+        // Queue the reads of all files at once like background resource loading does. The I/O threads read them in the
+        // order of their position in the package
+        FileReadQueue* readQueue = new FileReadQueue(context_);
+        context_->RegisterSubsystem(readQueue);
+        readQueue->CreateThreads(numReadThreads_);
+
+        Vector<SharedPtr<FileReadRequest> > requests;
+        unsigned index = 0;
+        for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i, ++index)
+        {
+            files[index] = cache->GetFile(i->first_);
+            SharedPtr<FileReadRequest> request(new FileReadRequest(files[index]));
+            readQueue->AddRequest(request);
+            requests.Push(request);
+        }
+        for (unsigned i = 0; i < requests.Size(); ++i)
+        {
+            readQueue->WaitForRequest(requests[i]);
+            loadedData[i].Swap(requests[i]->data_);
+        }
+        readTime = timer.GetUSec(false);
+    }
+    else
+    {
+        unsigned index = 0;
+        for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i, ++index)
+        {
+            // Copy the data to its final destination like Model does with vertex data. A memory-mapped file is copied
+            // from directly, otherwise the data is first read to a buffer
+            timer.Reset();
+            SharedPtr<File> file = cache->GetFile(i->first_);
+            unsigned size = file ? file->GetSize() : 0;
+            const unsigned char* data = file ? file->GetDirectData() : 0;
+            if (!data && size)
+            {
+                buffer.Resize(size);
+                file->Read(&buffer[0], size);
+                data = &buffer[0];
+            }
+            loadedData[index].Resize(size);
+            if (size)
+                memcpy(&loadedData[index][0], data, size);
+            readTime += timer.GetUSec(false);
+            files[index] = file;
+        }
+    }
+
+    // Verify the data outside the measured time
+    unsigned dataSize = 0;
+    unsigned mappedDataSize = 0;
+    unsigned checksumErrors = 0;
+    String largestName;
+    unsigned largestSize = 0;
+    unsigned index = 0;
+    for (HashMap<String, PackageEntry>::ConstIterator i = entries.Begin(); i != entries.End(); ++i, ++index)
+    {
+        const PODVector<unsigned char>& data = loadedData[index];
+        unsigned checksum = 0;
+        for (unsigned j = 0; j < data.Size(); ++j)
+            checksum = SDBMHash(checksum, data[j]);
+        if (!files[index] || checksum != i->second_.checksum_)
+            ++checksumErrors;
+
+        dataSize += data.Size();
+        if (files[index] && files[index]->IsMapped())
+            mappedDataSize += data.Size();
+        if (data.Size() > largestSize)
+        {
+            largestName = i->first_;
+            largestSize = data.Size();
+        }
+    }
+
+    // Close the files before the seek test
+    files.Clear();
+
+    // Read small chunks from random positions of the largest file, like a streaming sound or an animation would
+    SharedPtr<File> file = cache->GetFile(largestName);
+    unsigned char chunk[64];
+    timer.Reset();
+    for (unsigned i = 0; i < numRequests_; ++i)
+    {
+        file->Seek((unsigned)(Random() * largestSize));
+        file->Read(chunk, sizeof chunk);
+    }
+    long long seekTime = timer.GetUSec(false);
+
+    PrintResult("package_bytes", String(package->GetTotalSize()));
+    PrintResult("file_data_bytes", String(dataSize));
+    PrintResult("mapped_data_bytes", String(mappedDataSize));
+    PrintResult("compressed", String(package->IsCompressed()));
+    PrintResult("read_threads", String(numReadThreads_));
+    PrintResult("read_usec", String((int)readTime));
+    PrintResult("read_mb_per_sec", String((float)dataSize / (float)Max((int)readTime, 1)));
+    PrintResult("seek_read_usec_avg", String((float)seekTime / (float)numRequests_));
+    PrintResult("checksum_errors", String(checksumErrors));
+
+    return checksumErrors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int MeasureSceneLoad()
+{
+    RegisterSceneLibrary(context_);
+    String fileName = CreateSceneFile();
+    SharedPtr<Scene> scene(new Scene(context_));
+    unsigned fileSize = 0;
+    bool success = false;
+
+    unsigned startPeakMemoryUse = GetPeakMemoryUse();
+    HiresTimer timer;
+    {
+        File file(context_, fileName);
+        fileSize = file.GetSize();
+        if (useXMLDocument_)
+        {
+            SharedPtr<XMLFile> xml(new XMLFile(context_));
+            success = xml->Load(file) && scene->LoadXML(xml->GetRoot());
+        }
+        else
+        {
+            XMLReader reader(file);
+            success = reader.ReadRoot() && scene->LoadXML(reader);
+        }
+    }
+    long long loadTime = timer.GetUSec(false);
+    unsigned peakMemoryIncrease = GetPeakMemoryUse() - startPeakMemoryUse;
+
+    unsigned numNodes = scene->GetNumChildren(true);
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    fileSystem->Delete(fileName);
+    fileSystem->RemoveDir(tempDir_);
+
+    PrintResult("xml_document", String(useXMLDocument_));
+    PrintResult("file_size", String(fileSize));
+    PrintResult("nodes_loaded", String(numNodes));
+    PrintResult("load_usec", String(loadTime));
+    PrintResult("peak_memory_increase", String(peakMemoryIncrease));
+
+    return success && numNodes == numSceneNodes_ ? 0 : 1;
+}
+
+int MeasureFirstFrame()
+{
+    RegisterSceneLibrary(context_);
+    context_->RegisterFactory<BenchmarkAsset>();
+    BenchmarkComponent::RegisterObject(context_);
+
+    if (numReadThreads_)
+    {
+        FileReadQueue* readQueue = new FileReadQueue(context_);
+        context_->RegisterSubsystem(readQueue);
+        readQueue->CreateThreads(numReadThreads_);
+    }
+
+    unsigned numAssets = 0;
+    String sceneFileName = CreateFirstFrameFiles(numAssets);
+    String manifestFileName = tempDir_ + "FirstFrame.manifest";
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    cache->AddResourceDir(tempDir_);
+    cache->SetFinishBackgroundResourcesMs(0);
+
+    // Record the manifest on a first load, which also brings the files to the operating system's file cache for both
+    // measured loads
+    unsigned numRecorded = 0;
+    SharedPtr<ResourceManifest> manifest(new ResourceManifest(context_));
+    cache->StartManifestRecording(manifest);
+    LoadFirstFrame(sceneFileName, String::EMPTY, numRecorded);
+    cache->StopManifestRecording();
+    {
+        File file(context_, manifestFileName, FILE_WRITE);
+        manifest->Save(file);
+    }
+
+    unsigned numLoaded = 0;
+    unsigned numPreloaded = 0;
+    long long loadTime = LoadFirstFrame(sceneFileName, String::EMPTY, numLoaded);
+    long long preloadTime = LoadFirstFrame(sceneFileName, manifestFileName, numPreloaded);
+
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    fileSystem->Delete(sceneFileName);
+    fileSystem->Delete(manifestFileName);
+    for (unsigned i = 0; i < resourceNames_.Size(); ++i)
+        fileSystem->Delete(tempDir_ + resourceNames_[i]);
+    fileSystem->RemoveDir(tempDir_);
+
+    PrintResult("read_threads", String(numReadThreads_));
+    PrintResult("resources", String(numAssets));
+    PrintResult("manifest_resources", String(manifest->GetNumResources()));
+    PrintResult("first_frame_usec", String(loadTime));
+    PrintResult("first_frame_manifest_usec", String(preloadTime));
+
+    return numLoaded == numAssets && numPreloaded == numAssets && manifest->GetNumResources() == numAssets ? 0 : 1;
+}
+
+long long LoadFirstFrame(const String& sceneFileName, const String& manifestFileName, unsigned& numLoaded)
+{
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    Time* time = context_->GetSubsystem<Time>();
+    SharedPtr<Scene> scene(new Scene(context_));
+
+    HiresTimer timer;
+    if (!manifestFileName.Empty())
+    {
+        File file(context_, manifestFileName);
+        SharedPtr<ResourceManifest> manifest(new ResourceManifest(context_));
+        if (manifest->Load(file))
+            cache->PreloadResources(manifest);
+    }
+    {
+        File file(context_, sceneFileName);
+        scene->LoadXML(file);
+    }
+    // The first frame can be rendered once the resources loading in the background have finished
+    while (cache->GetNumBackgroundLoadResources())
+    {
+        time->BeginFrame(0.0f);
+        time->EndFrame();
+    }
+    long long loadTime = timer.GetUSec(false);
+
+    PODVector<BenchmarkAsset*> assets;
+    cache->GetResources<BenchmarkAsset>(assets);
+    numLoaded = assets.Size();
+
+    scene.Reset();
+    cache->ReleaseAllResources(true);
+    return loadTime;
+}
+
+unsigned CreateResourceFiles()
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    tempDir_ = fileSystem->GetTemporaryDir() + "ResourceBenchmarkTemp/";
+    fileSystem->CreateDir(tempDir_);
+    for (unsigned i = 0; i < numDirs_; ++i)
+        fileSystem->CreateDir(tempDir_ + "Dir" + String(i));
+
+    // Spread the resources evenly into the directories. Vary the memory use between half and one and a half times the average
+    unsigned totalSize = 0;
+    for (unsigned i = 0; i < numResources_; ++i)
+    {
+        String name = "Resource" + String(i) + ".dat";
+        unsigned size = resourceSize_ / 2 + (unsigned)(Random() * resourceSize_);
+        File file(context_, tempDir_ + "Dir" + String(i % numDirs_) + "/" + name, FILE_WRITE);
+        file.WriteUInt(size);
+        resourceNames_.Push(name);
+        totalSize += size;
+    }
+
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    HiresTimer timer;
+    for (unsigned i = 0; i < numDirs_; ++i)
+        cache->AddResourceDir(tempDir_ + "Dir" + String(i));
+    PrintResult("add_dirs_usec", String((int)timer.GetUSec(false)));
+
+    return totalSize;
+}
+
+void RemoveResourceFiles()
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceNames_.Size(); ++i)
+        fileSystem->Delete(tempDir_ + "Dir" + String(i % numDirs_) + "/" + resourceNames_[i]);
+    for (unsigned i = 0; i < numDirs_; ++i)
+        fileSystem->RemoveDir(tempDir_ + "Dir" + String(i));
+    fileSystem->RemoveDir(tempDir_);
+}
+
+String CreateSceneFile()
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    tempDir_ = fileSystem->GetTemporaryDir() + "ResourceBenchmarkTemp/";
+    fileSystem->CreateDir(tempDir_);
+    String fileName = tempDir_ + "Scene.xml";
+
+    // Write the XML text directly instead of building and saving a scene, so that the peak memory use is not raised
+    // before the measurement. Every fourth node is a root level node with the next three as its children
+    File file(context_, fileName, FILE_WRITE);
+    String text = "<?xml version=\"1.0\"?>\n<scene id=\"1\">\n";
+    text += "\t<attribute name=\"Next Replicated Node ID\" value=\"" + String(numSceneNodes_ + 2) + "\" />\n";
+    text += "\t<attribute name=\"Next Replicated Component ID\" value=\"" + String(numSceneNodes_ + 1) + "\" />\n";
+    file.Write(text.CString(), text.Length());
+
+    String healthHash(ShortStringHash("Health").Value());
+    for (unsigned i = 0; i < numSceneNodes_; ++i)
+    {
+        bool isChild = (i & 3) != 0;
+        bool closeGroup = i + 1 == numSceneNodes_ || ((i + 1) & 3) == 0;
+        String indent = isChild ? "\t\t" : "\t";
+
+        text = indent + "<node id=\"" + String(i + 2) + "\">\n";
+        text += indent + "\t<attribute name=\"Is Enabled\" value=\"true\" />\n";
+        text += indent + "\t<attribute name=\"Name\" value=\"Node" + String(i) + "\" />\n";
+        text += indent + "\t<attribute name=\"Position\" value=\"" + String(Random(1000.0f)) + " 0 " + String(Random(1000.0f)) + "\" />\n";
+        text += indent + "\t<attribute name=\"Rotation\" value=\"1 0 0 0\" />\n";
+        text += indent + "\t<attribute name=\"Scale\" value=\"1 1 1\" />\n";
+        text += indent + "\t<attribute name=\"Variables\">\n";
+        text += indent + "\t\t<variant hash=\"" + healthHash + "\" type=\"Int\" value=\"" + String(Rand() % 100) + "\" />\n";
+        text += indent + "\t</attribute>\n";
+        text += indent + "\t<component type=\"SmoothedTransform\" id=\"" + String(i + 1) + "\" />\n";
+        if (isChild || closeGroup)
+            text += indent + "</node>\n";
+        if (isChild && closeGroup)
+            text += "\t</node>\n";
+        file.Write(text.CString(), text.Length());
+    }
+
+    text = "</scene>\n";
+    file.Write(text.CString(), text.Length());
+    return fileName;
+}
+
+String CreateFirstFrameFiles(unsigned& numAssets)
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    tempDir_ = fileSystem->GetTemporaryDir() + "ResourceBenchmarkTemp/";
+    fileSystem->CreateDir(tempDir_);
+
+    // Every four nodes share a model, which requests two materials shared with the neighbouring models. Each material
+    // requests two textures. The textures have the payload size given with -k and the models a quarter of it
+    unsigned numModels = Max(numFirstFrameNodes_ / 4, 1);
+    PODVector<unsigned char> payload(resourceSize_ * 3 / 2);
+    for (unsigned i = 0; i < payload.Size(); ++i)
+        payload[i] = (unsigned char)Rand();
+
+    for (unsigned i = 0; i < numModels * 4; ++i)
+    {
+        Vector<String> dependencies;
+        unsigned size = 0;
+        String name;
+        if (i < numModels)
+        {
+            name = "Model" + String(i) + ".dat";
+            dependencies.Push("Material" + String(i) + ".dat");
+            dependencies.Push("Material" + String((i + 1) % numModels) + ".dat");
+            size = resourceSize_ / 4;
+        }
+        else if (i < numModels * 2)
+        {
+            unsigned index = i - numModels;
+            name = "Material" + String(index) + ".dat";
+            dependencies.Push("Texture" + String(index * 2) + ".dat");
+            dependencies.Push("Texture" + String(index * 2 + 1) + ".dat");
+        }
+        else
+        {
+            name = "Texture" + String(i - numModels * 2) + ".dat";
+            size = resourceSize_ / 2 + (unsigned)(Random() * resourceSize_);
+        }
+
+        File file(context_, tempDir_ + name, FILE_WRITE);
+        file.WriteVLE(dependencies.Size());
+        for (unsigned j = 0; j < dependencies.Size(); ++j)
+            file.WriteString(dependencies[j]);
+        file.WriteUInt(size);
+        file.Write(&payload[0], size);
+        resourceNames_.Push(name);
+    }
+    numAssets = resourceNames_.Size();
+
+    String fileName = tempDir_ + "FirstFrame.xml";
+    File file(context_, fileName, FILE_WRITE);
+    String text = "<?xml version=\"1.0\"?>\n<scene id=\"1\">\n";
+    file.Write(text.CString(), text.Length());
+    for (unsigned i = 0; i < numFirstFrameNodes_; ++i)
+    {
+        text = "\t<node id=\"" + String(i + 2) + "\">\n";
+        text += "\t\t<attribute name=\"Position\" value=\"" + String(Random(1000.0f)) + " 0 " + String(Random(1000.0f)) + "\" />\n";
+        text += "\t\t<component type=\"BenchmarkComponent\" id=\"" + String(i + 1) + "\">\n";
+        text += "\t\t\t<attribute name=\"Asset\" value=\"BenchmarkAsset;Model" + String((i / 4) % numModels) + ".dat\" />\n";
+        text += "\t\t</component>\n";
+        text += "\t</node>\n";
+        file.Write(text.CString(), text.Length());
+    }
+    text = "</scene>\n";
+    file.Write(text.CString(), text.Length());
+    return fileName;
+}
+
+unsigned GetPeakMemoryUse()
+{
+    #ifdef WIN32
+    return 0;
+    #else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #ifdef __APPLE__
+    return (unsigned)usage.ru_maxrss;
+    #else
+    return (unsigned)usage.ru_maxrss * 1024;
+    #endif
+    #endif
+}
+
+void PrintResult(const String& name, const String& value)
+{
+    PrintLine(name + " " + value);
+}
@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2008-2013 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "Context.h"
+#include "File.h"
+#include "FileSystem.h"
+#include "Log.h"
+#include "Material.h"
+#include "ProcessUtils.h"
+#include "ResourceCache.h"
+#include "Technique.h"
+#include "VectorBuffer.h"
+#include "XMLFile.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include "DebugNew.h"
+
+using namespace Urho3D;
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<FileSystem> fileSystem_(new FileSystem(context_));
+bool force_ = false;
+bool clean_ = false;
+unsigned numCooked_ = 0;
+unsigned numUpToDate_ = 0;
+unsigned numFailed_ = 0;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+bool IsUpToDate(const String& fileName, const String& cookedFileName);
+void CookFile(const String& fileName, const String& cookedFileName);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+    
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+    
+    Run(arguments);
+    return numFailed_ ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    // Separate the options from the other arguments
+    Vector<String> names;
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() > 1 && arguments[i][0] == '-')
+        {
+            String option = arguments[i].Substring(1).ToLower();
+            if (option == "f")
+                force_ = true;
+            else if (option == "c")
+                clean_ = true;
+            else
+                ErrorExit("Unrecognized option " + arguments[i]);
+        }
+        else
+            names.Push(arguments[i]);
+    }
+    
+    if (names.Size() < 1)
+    {
+        ErrorExit(
+            "Usage: ResourceCooker <directory to process> [options]\n\n"
+            "Converts material and technique XML files to binary cooked files next to them,\n"
+            "which the resource cache loads instead while they are up to date.\n\n"
+            "Options:\n"
+            "-f  Cook also the files whose cooked file is up to date\n"
+            "-c  Remove the cooked files instead of cooking\n"
+        );
+    }
+    
+    context_->RegisterSubsystem(fileSystem_);
+    context_->RegisterSubsystem(new Log(context_));
+    Log* log = context_->GetSubsystem<Log>();
+    log->SetLevel(LOG_WARNING);
+    log->SetTimeStamp(false);
+    
+    String dirName = AddTrailingSlash(names[0]);
+    PrintLine("Scanning directory " + dirName + " for files");
+    
+    Vector<String> fileNames;
+    fileSystem_->ScanDir(fileNames, dirName, "*.xml", SCAN_FILES, true);
+    
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        String fileName = dirName + fileNames[i];
+        String cookedFileName = GetCookedResourceName(fileName);
+        
+        if (clean_)
+        {
+            if (fileSystem_->FileExists(cookedFileName) && fileSystem_->Delete(cookedFileName))
+                ++numCooked_;
+        }
+        else if (!force_ && IsUpToDate(fileName, cookedFileName))
+            ++numUpToDate_;
+        else
+            CookFile(fileName, cookedFileName);
+    }
+    
+    if (clean_)
+        PrintLine("Removed " + String(numCooked_) + " cooked files");
+    else
+    {
+        PrintLine("Cooked " + String(numCooked_) + " files, " + String(numUpToDate_) + " up to date, " + String(numFailed_) +
+            " failed");
+    }
+}
+
+bool IsUpToDate(const String& fileName, const String& cookedFileName)
+{
+    // The modification times have a resolution of one second, so a cooked file from the same second is cooked again, like
+    // the resource cache considers it out of date
+    if (!fileSystem_->FileExists(cookedFileName) || fileSystem_->GetLastModifiedTime(cookedFileName) <=
+        fileSystem_->GetLastModifiedTime(fileName))
+        return false;
+    
+    // A cooked file of another version needs cooking again
+    File cookedFile(context_, cookedFileName);
+    cookedFile.ReadFileID();
+    return cookedFile.ReadUInt() == COOKED_RESOURCE_VERSION;
+}
+
+void CookFile(const String& fileName, const String& cookedFileName)
+{
+    File file(context_, fileName);
+    XMLFile xml(context_);
+    if (!xml.Load(file))
+    {
+        ++numFailed_;
+        return;
+    }
+    
+    // Only the resource types that have a cooked format are cooked, other XML files are loaded as they are
+    XMLElement rootElem = xml.GetRoot();
+    String rootName = rootElem.GetName();
+    VectorBuffer cooked;
+    bool success;
+    if (rootName == "material")
+        success = Material::Cook(rootElem, cooked);
+    else if (rootName == "technique")
+        success = Technique::Cook(rootElem, cooked);
+    else
+        return;
+    
+    if (success)
+    {
+        File cookedFile(context_, cookedFileName, FILE_WRITE);
+        success = cookedFile.IsOpen() && cookedFile.Write(cooked.GetData(), cooked.GetSize()) == cooked.GetSize();
+    }
+    
+    if (success)
+    {
+        PrintLine("Cooked " + fileName);
+        ++numCooked_;
+    }
+    else
+    {
+        PrintLine("Failed to cook " + fileName);
+        ++numFailed_;
+    }
+}